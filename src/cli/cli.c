@@ -22,6 +22,12 @@
 #include <syslog.h>
 #include "internal_libreport.h"
 #include "cli-report.h"
+#include "metrics.h"
+
+/* Messages per call site allowed in the interval (seconds) when logging to
+ * syslog, see log_set_rate_limit() */
+#define SYSLOG_RATE_LIMIT_BURST    100
+#define SYSLOG_RATE_LIMIT_INTERVAL 10
 
 static char *steal_directory_if_needed(char *dump_dir_name)
 {
@@ -37,6 +43,38 @@ static char *steal_directory_if_needed(char *dump_dir_name)
     return dump_dir_name;
 }
 
+/* Prints the metrics collected by all processes in $LIBREPORT_METRICS_FILE */
+static int print_metrics(const char *format)
+{
+    const char *path = getenv("LIBREPORT_METRICS_FILE");
+    if (path == NULL || path[0] == '\0')
+    {
+        error_msg(_("Metrics are disabled, LIBREPORT_METRICS_FILE is not set"));
+        return 1;
+    }
+
+    struct metrics_snapshot snapshot;
+    const int r = metrics_load_snapshot(path, &snapshot);
+    /* No process has exited yet, all metrics are zeros */
+    if (r != 0 && r != -ENOENT)
+    {
+        error_msg(_("Can't read '%s': %s"), path, strerror(-r));
+        return 1;
+    }
+
+    if (strcmp(format, "json") == 0)
+        metrics_write_json(STDOUT_FILENO, &snapshot);
+    else if (strcmp(format, "prometheus") == 0)
+        metrics_write_prometheus(STDOUT_FILENO, &snapshot);
+    else
+    {
+        error_msg(_("Unknown metrics format '%s', use 'json' or 'prometheus'"), format);
+        return 1;
+    }
+
+    return 0;
+}
+
 int main(int argc, char** argv)
 {
     abrt_init(argv);
@@ -57,6 +95,7 @@ int main(int argc, char** argv)
 
     GList *event_list = NULL;
     const char *pfx = "";
+    const char *metrics_format = NULL;
 
     /* Can't keep these strings/structs static: _() doesn't support that */
     const char *program_usage_string = _(
@@ -64,6 +103,7 @@ int main(int argc, char** argv)
         "\n""   or: & [-vspy] -e EVENT PROBLEM_DIR"
         "\n""   or: & [-vspy] -d PROBLEM_DIR"
         "\n""   or: & [-vspy] -x PROBLEM_DIR"
+        "\n""   or: & --metrics FORMAT"
     );
     enum {
         OPT_list_events  = 1 << 0,
@@ -75,9 +115,10 @@ int main(int argc, char** argv)
         OPT_v            = 1 << 6,
         OPT_s            = 1 << 7,
         OPT_p            = 1 << 8,
+        OPT_metrics      = 1 << 9,
         /* An virtual option used when no other operation is specified */
-        OPT_workflow     = 1 << 9,
-        OPTMASK_op       = OPT_list_events|OPT_run_event|OPT_delete|OPT_expert|OPT_version,
+        OPT_workflow     = 1 << 10,
+        OPTMASK_op       = OPT_list_events|OPT_run_event|OPT_delete|OPT_expert|OPT_version|OPT_metrics,
         OPTMASK_need_arg = OPT_run_event|OPT_delete|OPT_expert|OPT_workflow
     };
     /* Keep enum above and order of options below in sync! */
@@ -92,6 +133,7 @@ int main(int argc, char** argv)
         OPT__VERBOSE(&g_verbose),
         OPT_BOOL(     's', NULL     , NULL,                    _("Log to syslog")),
         OPT_BOOL(     'p', NULL     , NULL,                    _("Add program names to log")),
+        OPT_STRING(    0 , "metrics", &metrics_format, "FORMAT", _("Print metrics of libreport operations as json or prometheus")),
         OPT_END()
     };
     unsigned opts = parse_opts(argc, argv, program_options, program_usage_string);
@@ -127,11 +169,20 @@ int main(int argc, char** argv)
         return 0;
     }
 
+    if (op == OPT_metrics)
+        return print_metrics(metrics_format);
+
     export_abrt_envvars(opts & OPT_p);
     if (opts & OPT_s)
     {
         openlog(msg_prefix, 0, LOG_DAEMON);
         logmode = LOGMODE_SYSLOG;
+
+        /* Verbose event runs log a lot, keep syslog() off this thread and
+         * don't let a single call site flood the log. The messages don't go
+         * to the terminal, so the delay can't mix them with questions. */
+        log_async_start(/*default ring size*/0);
+        log_set_rate_limit(SYSLOG_RATE_LIMIT_BURST, SYSLOG_RATE_LIMIT_INTERVAL);
     }
 
     char *dump_dir_name = argv[0];
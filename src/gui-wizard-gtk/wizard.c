@@ -29,8 +29,6 @@
 #define DEFAULT_HEIGHT  500
 
 #define EMERGENCY_ANALYSIS_EVENT_NAME "report_EmergencyAnalysis"
-#define FORBIDDEN_WORDS_BLACKLLIST "forbidden_words.conf"
-#define FORBIDDEN_WORDS_WHITELIST "ignored_words.conf"
 
 #if GTK_MAJOR_VERSION == 2 && GTK_MINOR_VERSION < 22
 # define gtk_assistant_commit(...) ((void)0)
@@ -166,6 +164,8 @@ enum
 static guint g_timeout = 0;
 static GtkEntry *g_search_entry_bt;
 static const gchar *g_search_text;
+/* Compiled g_search_text */
+static struct word_scanner *g_search_scanner;
 static search_item_t *g_current_highlighted_word;
 
 enum
@@ -2424,52 +2424,58 @@ static void log_ready_state(void)
 
 static GList *find_words_in_text_buffer(int page,
                                         GtkTextView *tev,
-                                        GList *words,
-                                        GList *ignore_sitem_list,
-                                        GtkTextIter start_find,
-                                        GtkTextIter end_find,
-                                        bool case_insensitive
-                                        )
+                                        const struct word_scanner *words,
+                                        const struct word_scanner *ignored_words)
 {
     GtkTextBuffer *buffer = gtk_text_view_get_buffer(tev);
     gtk_text_buffer_set_modified(buffer, FALSE);
 
+    GtkTextIter start_find;
+    gtk_text_buffer_get_start_iter(buffer, &start_find);
+    GtkTextIter end_find;
+    gtk_text_buffer_get_end_iter(buffer, &end_find);
+
+    /* The slice has one character for every character offset of the buffer */
+    gchar *text = gtk_text_buffer_get_slice(buffer, &start_find, &end_find,
+            /*include hidden chars*/TRUE);
+
+    size_t count = 0;
+    struct word_match *matches = word_scanner_find(words, ignored_words, text, strlen(text), &count);
+
     GList *found_words = NULL;
-    GtkTextIter start_match;
-    GtkTextIter end_match;
 
-    for (GList *w = words; w; w = g_list_next(w))
+    /* The matches are ordered by their byte offsets, convert them to character
+     * offsets incrementally instead of walking the text from its beginning. */
+    const gchar *prev_pos = text;
+    glong prev_offset = 0;
+    for (size_t i = 0; i < count; ++i)
     {
-        gtk_text_buffer_get_start_iter(buffer, &start_find);
+        const gchar *match = text + matches[i].wm_start;
+        prev_offset += g_utf8_pointer_to_offset(prev_pos, match);
+        prev_pos = match;
 
-        const char *search_word = w->data;
-        while (search_word && search_word[0] && gtk_text_iter_forward_search(&start_find, search_word,
-                    GTK_TEXT_SEARCH_TEXT_ONLY | (case_insensitive ? GTK_TEXT_SEARCH_CASE_INSENSITIVE : 0),
-                    &start_match,
-                    &end_match, NULL))
-        {
-            search_item_t *found_word = sitem_new(
-                    page,
-                    buffer,
-                    tev,
-                    start_match,
-                    end_match
-                );
-            int offset = gtk_text_iter_get_offset(&end_match);
-            gtk_text_buffer_get_iter_at_offset(buffer, &start_find, offset);
+        const glong match_len = g_utf8_pointer_to_offset(match, text + matches[i].wm_end);
 
-            if (sitem_is_in_sitemlist(found_word, ignore_sitem_list))
-            {
-                sitem_free(found_word);
-                // don't count the word if it's part of some of the ignored words
-                continue;
-            }
+        GtkTextIter start_match;
+        GtkTextIter end_match;
+        gtk_text_buffer_get_iter_at_offset(buffer, &start_match, prev_offset);
+        gtk_text_buffer_get_iter_at_offset(buffer, &end_match, prev_offset + match_len);
 
-            found_words = g_list_prepend(found_words, found_word);
-        }
+        search_item_t *found_word = sitem_new(
+                page,
+                buffer,
+                tev,
+                start_match,
+                end_match
+            );
+
+        found_words = g_list_prepend(found_words, found_word);
     }
 
-    return found_words;
+    free(matches);
+    g_free(text);
+
+    return g_list_reverse(found_words);
 }
 
 static void search_item_to_list_store_item(GtkListStore *store, GtkTreeIter *new_row,
@@ -2520,7 +2526,8 @@ static void search_item_to_list_store_item(GtkListStore *store, GtkTreeIter *new
             -1);
 }
 
-static bool highligh_words_in_textview(int page, GtkTextView *tev, GList *words, GList *ignored_words, bool case_insensitive)
+static bool highligh_words_in_textview(int page, GtkTextView *tev,
+        const struct word_scanner *words, const struct word_scanner *ignored_words)
 {
     GtkTextBuffer *buffer = gtk_text_view_get_buffer(tev);
     gtk_text_buffer_set_modified(buffer, FALSE);
@@ -2584,26 +2591,7 @@ static bool highligh_words_in_textview(int page, GtkTextView *tev, GList *words,
     gtk_label_set_attributes(GTK_LABEL(tab_lbl), NULL);
     pango_attr_list_unref(attrs);
 
-    GList *result = NULL;
-    GList *ignored_words_in_buffer = NULL;
-
-    ignored_words_in_buffer = find_words_in_text_buffer(page,
-                                                        tev,
-                                                        ignored_words,
-                                                        NULL,
-                                                        start_find,
-                                                        end_find,
-                                                        /*case sensitive*/false);
-
-
-    result = find_words_in_text_buffer(page,
-                                       tev,
-                                       words,
-                                       ignored_words_in_buffer,
-                                       start_find,
-                                       end_find,
-                                       case_insensitive
-                                        );
+    GList *result = find_words_in_text_buffer(page, tev, words, ignored_words);
 
     for (GList *w = result; w; w = g_list_next(w))
     {
@@ -2622,12 +2610,7 @@ static bool highligh_words_in_textview(int page, GtkTextView *tev, GList *words,
         pango_attr_list_insert(attrs, underline_attr);
         gtk_label_set_attributes(GTK_LABEL(tab_lbl), attrs);
 
-        /* The current order of the found words is defined by order of words in the
-         * passed list. We have to order the words according to their occurrence in
-         * the buffer.
-         */
-        result = g_list_sort(result, (GCompareFunc)sitem_compare);
-
+        /* The found words are ordered according to their occurrence in the buffer */
         GList *search_result = result;
         for ( ; search_result != NULL; search_result = g_list_next(search_result))
         {
@@ -2652,13 +2635,13 @@ static bool highligh_words_in_textview(int page, GtkTextView *tev, GList *words,
         }
     }
 
-    g_list_free_full(ignored_words_in_buffer, free);
     g_list_free(result);
 
     return result != NULL;
 }
 
-static gboolean highligh_words_in_tabs(GList *forbidden_words,  GList *allowed_words, bool case_insensitive)
+static gboolean highligh_words_in_tabs(const struct word_scanner *forbidden_words,
+        const struct word_scanner *allowed_words)
 {
     gboolean found = false;
 
@@ -2675,7 +2658,7 @@ static gboolean highligh_words_in_tabs(GList *forbidden_words,  GList *allowed_w
             continue;
 
         GtkTextView *tev = GTK_TEXT_VIEW(gtk_bin_get_child(GTK_BIN(notebook_child)));
-        found |= highligh_words_in_textview(page, tev, forbidden_words, allowed_words, case_insensitive);
+        found |= highligh_words_in_textview(page, tev, forbidden_words, allowed_words);
     }
 
     GtkTreeIter iter;
@@ -2687,15 +2670,7 @@ static gboolean highligh_words_in_tabs(GList *forbidden_words,  GList *allowed_w
 
 static gboolean highlight_forbidden(void)
 {
-    GList *forbidden_words = load_words_from_file(FORBIDDEN_WORDS_BLACKLLIST);
-    GList *allowed_words = load_words_from_file(FORBIDDEN_WORDS_WHITELIST);
-
-    const gboolean result = highligh_words_in_tabs(forbidden_words, allowed_words, /*case sensitive*/false);
-
-    list_free_with_free(forbidden_words);
-    list_free_with_free(allowed_words);
-
-    return result;
+    return highligh_words_in_tabs(get_forbidden_words_scanner(), get_ignored_words_scanner());
 }
 
 static char *get_next_processed_event(GList **events_list)
@@ -3166,11 +3141,7 @@ static gint select_next_page_no(gint current_page_no, gpointer data)
 
 static void rehighlight_forbidden_words(int page, GtkTextView *tev)
 {
-    GList *forbidden_words = load_words_from_file(FORBIDDEN_WORDS_BLACKLLIST);
-    GList *allowed_words = load_words_from_file(FORBIDDEN_WORDS_WHITELIST);
-    highligh_words_in_textview(page, tev, forbidden_words, allowed_words, /*case sensitive*/false);
-    list_free_with_free(forbidden_words);
-    list_free_with_free(allowed_words);
+    highligh_words_in_textview(page, tev, get_forbidden_words_scanner(), get_ignored_words_scanner());
 }
 
 static void on_sensitive_word_selection_changed(GtkTreeSelection *sel, gpointer user_data)
@@ -3198,9 +3169,7 @@ static void on_sensitive_word_selection_changed(GtkTreeSelection *sel, gpointer
         else
         {
             log_notice("searching again: '%s'", g_search_text);
-            GList *searched_words = g_list_append(NULL, (gpointer)g_search_text);
-            highligh_words_in_textview(new_word->page, new_word->tev, searched_words, NULL, /*case insensitive*/true);
-            g_list_free(searched_words);
+            highligh_words_in_textview(new_word->page, new_word->tev, g_search_scanner, NULL);
         }
 
         return;
@@ -3220,8 +3189,11 @@ static void highlight_search(GtkEntry *entry)
 
     log_notice("searching: '%s'", g_search_text);
     GList *words = g_list_append(NULL, (gpointer)g_search_text);
-    highligh_words_in_tabs(words, NULL, /*case insensitive*/true);
+    word_scanner_free(g_search_scanner);
+    g_search_scanner = word_scanner_new(words, WORD_SCANNER_CASE_INSENSITIVE);
     g_list_free(words);
+
+    highligh_words_in_tabs(g_search_scanner, NULL);
 }
 
 static gboolean highlight_search_on_timeout(gpointer user_data)
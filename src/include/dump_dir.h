@@ -114,6 +114,10 @@ struct dump_dir {
      * dd_get_meta_data_dir_fd()
      */
     int dd_md_fd;
+    /* Never use this member directly, it is intialized on demand by the
+     * reported_to functions
+     */
+    struct reported_to_index *dd_reported_to;
 };
 
 void dd_close(struct dump_dir *dd);
@@ -405,9 +409,19 @@ int add_reported_to_data(char **reported_to, const char *line);
 #define add_reported_to_entry_data libreport_add_reported_to_entry_data
 int add_reported_to_entry_data(char **reported_to, struct report_result *result);
 
+/* Converts the result to a reported_to line without the trailing new line
+ *
+ * @return NULL if result->label is invalid; otherwise a malloced string
+ */
+#define format_reported_to_entry libreport_format_reported_to_entry
+char *format_reported_to_entry(const struct report_result *result);
+
 /* This is a wrapper of add_reported_to_data which accepts 'struct dump_dir *'
- * in the first argument instead of 'char **'. The added line is stored in
+ * in the first argument instead of 'char **'. The added line is appended to
  * 'reported_to' dump directory file.
+ *
+ * The lines of the file are indexed in dd, so adding more lines or looking
+ * them up by find_in_reported_to() does not read the whole file again.
  */
 #define add_reported_to libreport_add_reported_to
 void add_reported_to(struct dump_dir *dd, const char *line);
@@ -509,6 +523,20 @@ struct dump_dir *create_dump_dir(const char *base_dir_name, const char *type,
 int dd_create_archive(struct dump_dir *dd, const char *archive_name,
         const_string_vector_const_ptr_t exclude_elements, int flags);
 
+/* Writes a '.tar.gz' archive of the dump directory contents to the file
+ * descriptor
+ *
+ * Works like dd_create_archive(), but fd can be a pipe or a socket, e.g. to
+ * upload the archive while it is being created. The caller keeps the
+ * ownership of fd.
+ *
+ * @return 0 on success; otherwise non-0 value. -ECHILD if child process
+ * fails. Other negative values can be converted to errno values by turning
+ * them positive.
+ */
+int dd_write_archive(struct dump_dir *dd, int fd,
+        const_string_vector_const_ptr_t exclude_elements, int flags);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,106 @@
+/*
+    Copyright (C) 2026  ABRT team
+    Copyright (C) 2026  RedHat Inc
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+/*
+ * Cache of duplicate searches in bug trackers
+ *
+ * Every crash of a component makes its reporter search the tracker for bugs
+ * with the same duphash, the results are remembered for a limited time so
+ * that the following crashes do not need to ask the tracker again.
+ *
+ * The cache holds one file per tracker and duphash, one line per search:
+ *
+ *   <sha1 of product, version and component> <time> <id>[,<id>...]
+ *
+ * where '-' stands for no bugs found. The files are replaced atomically, so
+ * lookups don't need any locking, updates are serialized by flock() on the
+ * file '.lock'. Counters of hits and misses are kept in the file 'stats'.
+ */
+#ifndef LIBREPORT_DUP_SEARCH_CACHE_H_
+#define LIBREPORT_DUP_SEARCH_CACHE_H_
+
+#include "libreport_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Cache of root, other users use $XDG_CACHE_HOME/libreport/dup-search.
+ * Can be overridden by LIBREPORT_DEBUG_DUP_SEARCH_CACHE_DIR.
+ */
+#define DUP_SEARCH_CACHE_DIR LOCALSTATEDIR"/cache/libreport/dup-search"
+
+typedef struct dup_search_cache dup_search_cache_t;
+
+struct dup_search_cache_stats
+{
+    unsigned long dscs_hits;
+    unsigned long dscs_misses;
+    unsigned long dscs_stores;
+    unsigned long dscs_invalidations;
+};
+
+/* Opens the cache of searches in the tracker at tracker_url.
+ *
+ * @param ttl Seconds the results are valid for, 0 disables the cache
+ * @return NULL if the cache is disabled or unusable. All functions accept
+ * NULL and behave as if the cache was empty.
+ */
+#define dup_search_cache_open libreport_dup_search_cache_open
+dup_search_cache_t *dup_search_cache_open(const char *tracker_url, unsigned ttl);
+
+/* Writes the hits and misses of this handle to the shared statistics, logs
+ * the hit rate of the cache and frees it */
+#define dup_search_cache_close libreport_dup_search_cache_close
+void dup_search_cache_close(dup_search_cache_t *cache);
+
+/* Looks up results of the search for duphash, product, version and
+ * component, any of the last three can be NULL. Doesn't lock the cache,
+ * the hit or miss is written to the statistics later.
+ *
+ * @param ids Set to the list of bug ids (malloced strings), the best match
+ * first, on hit
+ * @return true on hit
+ */
+#define dup_search_cache_lookup libreport_dup_search_cache_lookup
+bool dup_search_cache_lookup(dup_search_cache_t *cache, const char *product,
+                             const char *version, const char *component,
+                             const char *duphash, GList **ids);
+
+/* Remembers results of the search, ids is a list of strings */
+#define dup_search_cache_store libreport_dup_search_cache_store
+void dup_search_cache_store(dup_search_cache_t *cache, const char *product,
+                            const char *version, const char *component,
+                            const char *duphash, GList *ids);
+
+/* Forgets all searches for duphash, must be called after creating or
+ * closing a bug with the duphash */
+#define dup_search_cache_invalidate libreport_dup_search_cache_invalidate
+void dup_search_cache_invalidate(dup_search_cache_t *cache, const char *duphash);
+
+/* The shared statistics including the lookups of this handle
+ * @return false if the statistics can't be read */
+#define dup_search_cache_get_stats libreport_dup_search_cache_get_stats
+bool dup_search_cache_get_stats(dup_search_cache_t *cache, struct dup_search_cache_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -81,6 +81,10 @@ bool get_global_stop_on_not_reportable(void);
 #define set_global_stop_on_not_reportable libreport_set_global_stop_on_not_reportable
 void set_global_stop_on_not_reportable(bool enabled, int flags);
 
+/* Returns false if the global configuration has not been loaded */
+#define get_global_tls_session_cache libreport_get_global_tls_session_cache
+bool get_global_tls_session_cache(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -40,6 +40,7 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
 #include <arpa/inet.h> /* sockaddr_in, sockaddr_in6 etc */
 #include <termios.h>
@@ -223,6 +224,9 @@ ssize_t full_read(int fd, void *buf, size_t count);
 ssize_t full_write(int fd, const void *buf, size_t count);
 #define full_write_str libreport_full_write_str
 ssize_t full_write_str(int fd, const char *buf);
+/* Writes more than IOV_MAX buffers too, iov is modified */
+#define full_writev libreport_full_writev
+ssize_t full_writev(int fd, struct iovec *iov, int iovcnt);
 #define xmalloc_read libreport_xmalloc_read
 void* xmalloc_read(int fd, size_t *maxsz_p);
 #define xmalloc_open_read_close libreport_xmalloc_open_read_close
@@ -473,6 +477,13 @@ int is_regular_file(struct dirent *dent, const char *dirname);
 #define is_regular_file_at libreport_is_regular_file_at
 int is_regular_file_at(struct dirent *dent, int dir_fd);
 
+/* Creates the cache directory dir and its parents. The cache is usable only
+ * if dir is a directory owned by the effective user whose permission bits
+ * have nothing in common with mode_mask, e.g. 077 for secrets.
+ */
+#define create_private_cache_dir libreport_create_private_cache_dir
+bool create_private_cache_dir(const char *dir, mode_t mode_mask);
+
 #define dot_or_dotdot libreport_dot_or_dotdot
 bool dot_or_dotdot(const char *filename);
 #define last_char_is libreport_last_char_is
@@ -599,6 +610,36 @@ void log_and_die_wrapper(int level,
                  bool use_custom_logger,
                  const char *format, ...) __attribute__ ((noreturn, format (printf, 7,8)));
 
+/* Asynchronous logging
+ *
+ * Messages for stderr, syslog and journal are queued in a lock-free ring
+ * and written by a background thread in batches. The custom logger is
+ * always called synchronously from the logging thread. When the ring is
+ * full, the queued messages are written first and then the message is
+ * written synchronously. After fork() the child logs
+ * synchronously and the queued messages of the parent are dropped in it.
+ *
+ * @param ring_size Number of queued messages, 0 for the default
+ * @return 0 on success, -errno if the writer thread can't be started
+ */
+#define log_async_start libreport_log_async_start
+int log_async_start(unsigned ring_size);
+
+/* Waits until all messages queued so far are written */
+#define log_async_flush libreport_log_async_flush
+void log_async_flush(void);
+
+/* Writes the queued messages and returns to synchronous logging */
+#define log_async_stop libreport_log_async_stop
+void log_async_stop(void);
+
+/* Lets every call site log at most 'burst' messages per 'interval'
+ * seconds, the following messages are dropped and their number is logged
+ * with the next message from the call site. 0 burst disables the limit.
+ */
+#define log_set_rate_limit libreport_log_set_rate_limit
+void log_set_rate_limit(unsigned burst, unsigned interval);
+
 struct strbuf
 {
     /* Size of the allocated buffer. Always > 0. */
@@ -655,6 +696,22 @@ struct strbuf *strbuf_append_char(struct strbuf *strbuf, char c);
 struct strbuf *strbuf_append_str(struct strbuf *strbuf,
                                  const char *str);
 
+/**
+ * The current content of the string buffer is extended by adding the
+ * first len characters of str at its end. str does not need to be
+ * null-terminated.
+ */
+#define strbuf_append_strn libreport_strbuf_append_strn
+struct strbuf *strbuf_append_strn(struct strbuf *strbuf,
+                                  const char *str, size_t len);
+
+/**
+ * Makes sure that the string buffer can hold at least size characters
+ * without reallocation.
+ */
+#define strbuf_reserve libreport_strbuf_reserve
+void strbuf_reserve(struct strbuf *strbuf, size_t size);
+
 /**
  * The current content of the string buffer is extended by inserting a
  * string str at its beginning.
@@ -728,8 +785,23 @@ char* get_rootdir(pid_t pid);
 int get_fsuid(const char *proc_pid_status);
 #define get_fsgid libreport_get_fsgid
 int get_fsgid(const char *proc_pid_status);
+/* Lists the descriptors in the calling thread, see dump_fd_info_bulk_at() */
 #define dump_fd_info_at libreport_dump_fd_info_at
 int dump_fd_info_at(int pid_proc_fd, FILE *dest);
+/* Appends the text of dump_fd_info_at() to dest
+ *
+ * The descriptors are listed by getdents64() and their links and fdinfo files
+ * are read right into the buffer. Callers can opt in to splitting processes
+ * with many descriptors among several threads.
+ *
+ * @param max_fds Lists only the lowest max_fds descriptors followed by a line
+ * "N more file descriptors are not listed", 0 means no limit
+ * @param workers The number of threads, 0 for one thread per 8192
+ * descriptors up to the number of CPUs (at most 8)
+ * @return 0 on success, -errno otherwise
+ */
+#define dump_fd_info_bulk_at libreport_dump_fd_info_bulk_at
+int dump_fd_info_bulk_at(int pid_proc_fd, struct strbuf *dest, unsigned max_fds, unsigned workers);
 #define dump_fd_info_ext libreport_dump_fd_info_ext
 int dump_fd_info_ext(const char *dest_filename, const char *proc_pid_fd_path, uid_t uid, gid_t gid);
 #define dump_fd_info libreport_dump_fd_info
@@ -777,6 +849,69 @@ int dump_namespace_diff_ext(const char *dest_filename, pid_t base_pid, pid_t tes
 #define dump_namespace_diff libreport_dump_namespace_diff
 int dump_namespace_diff(const char *dest_filename, pid_t base_pid, pid_t tested_pid);
 
+/* Items of a process collected by proc_snapshot_collect_at(),
+ * PROC_SNAPSHOT_CONTAINER implies PROC_SNAPSHOT_NAMESPACES
+ */
+enum {
+    PROC_SNAPSHOT_CMDLINE    = 1 << 0,
+    PROC_SNAPSHOT_ENVIRON    = 1 << 1,
+    PROC_SNAPSHOT_EXECUTABLE = 1 << 2,
+    PROC_SNAPSHOT_CWD        = 1 << 3,
+    PROC_SNAPSHOT_ROOTDIR    = 1 << 4,
+    PROC_SNAPSHOT_OPEN_FDS   = 1 << 5,
+    PROC_SNAPSHOT_NAMESPACES = 1 << 6,
+    PROC_SNAPSHOT_MOUNTINFO  = 1 << 7,
+    PROC_SNAPSHOT_CONTAINER  = 1 << 8,
+    PROC_SNAPSHOT_ALL        = (1 << 9) - 1,
+};
+
+/* Everything the get_*_at() helpers return for a process
+ *
+ * The members are valid if their bit is set in ps_items. A snapshot can be
+ * collected again, the read buffer is reused.
+ */
+struct proc_snapshot
+{
+    unsigned ps_items;
+    char *ps_cmdline;           ///< as get_cmdline_at()
+    char *ps_environ;           ///< as get_environ_at()
+    char *ps_executable;        ///< as get_executable_at()
+    char *ps_cwd;
+    char *ps_rootdir;
+    char *ps_open_fds;          ///< as dump_fd_info_at()
+    char *ps_mountinfo;         ///< raw /proc/[pid]/mountinfo
+    struct mountinfo_table *ps_mounts; ///< parsed ps_mountinfo
+    struct ns_ids ps_ns_ids;
+    struct ns_ids ps_init_ns_ids; ///< namespaces of PID 1
+    pid_t ps_container_pid;     ///< as get_pid_of_container_at()
+
+    unsigned ps_max_fds;        ///< limit of ps_open_fds, see dump_fd_info_bulk_at()
+    unsigned ps_fd_workers;     ///< threads listing ps_open_fds, 1 by default
+    struct strbuf *ps_buffer;
+};
+
+#define proc_snapshot_init libreport_proc_snapshot_init
+void proc_snapshot_init(struct proc_snapshot *snapshot);
+#define proc_snapshot_destroy libreport_proc_snapshot_destroy
+void proc_snapshot_destroy(struct proc_snapshot *snapshot);
+
+/* Collects the items from /proc/[pid] in one pass: every file is read by
+ * read() into one buffer and the process directory is never reopened.
+ *
+ * @param items A bit set of PROC_SNAPSHOT_*
+ * @return 0 if all items were collected, otherwise -errno of the first item
+ * which could not be collected; the other items are collected anyway.
+ */
+#define proc_snapshot_collect_at libreport_proc_snapshot_collect_at
+int proc_snapshot_collect_at(int pid_proc_fd, unsigned items, struct proc_snapshot *snapshot);
+
+/* Saves the collected items in the files FILENAME_CMDLINE, FILENAME_ENVIRON,
+ * FILENAME_EXECUTABLE, FILENAME_PWD, FILENAME_ROOTDIR (if it is not "/"),
+ * FILENAME_OPEN_FDS, FILENAME_NAMESPACES and FILENAME_MOUNTINFO.
+ */
+#define proc_snapshot_save libreport_proc_snapshot_save
+void proc_snapshot_save(const struct proc_snapshot *snapshot, struct dump_dir *dd);
+
 enum
 {
     MOUNTINFO_INDEX_MOUNT_ID,
@@ -810,6 +945,42 @@ void mountinfo_destroy(struct mountinfo *mntnf);
 #define get_mountinfo_for_mount_point libreport_get_mountinfo_for_mount_point
 int get_mountinfo_for_mount_point(FILE *fin, struct mountinfo *mntnf, const char *mnt_point);
 
+/* All lines of a mountinfo file parsed at once
+ *
+ * The items of mt_mounts point to mt_text, do not call mountinfo_destroy() on
+ * them. Lines with less than 10 fields are skipped.
+ */
+struct mountinfo_table
+{
+    struct mountinfo *mt_mounts;
+    size_t mt_count;
+    char *mt_text;
+    GHashTable *mt_by_mount_point; ///< the first mount of every mount point
+    GHashTable *mt_by_mount_id;
+};
+
+#define mountinfo_table_parse libreport_mountinfo_table_parse
+struct mountinfo_table *mountinfo_table_parse(const char *text);
+/* @return NULL and sets errno if /proc/[pid]/mountinfo can't be read */
+#define mountinfo_table_load_at libreport_mountinfo_table_load_at
+struct mountinfo_table *mountinfo_table_load_at(int pid_proc_fd);
+#define mountinfo_table_free libreport_mountinfo_table_free
+void mountinfo_table_free(struct mountinfo_table *table);
+/* Returns the same line as get_mountinfo_for_mount_point() or NULL */
+#define mountinfo_table_find_mount_point libreport_mountinfo_table_find_mount_point
+const struct mountinfo *mountinfo_table_find_mount_point(const struct mountinfo_table *table,
+                                                         const char *mnt_point);
+#define mountinfo_table_find_mount_id libreport_mountinfo_table_find_mount_id
+const struct mountinfo *mountinfo_table_find_mount_id(const struct mountinfo_table *table,
+                                                      unsigned long mount_id);
+/* Compares the mount source and root of / of a process with the ones of init
+ *
+ * @return 1 if they differ, 0 if they are the same, -ENOKEY if a table has no /
+ */
+#define mountinfo_table_has_own_root libreport_mountinfo_table_has_own_root
+int mountinfo_table_has_own_root(const struct mountinfo_table *pid_table,
+                                 const struct mountinfo_table *init_table);
+
 /* Takes ptr to time_t, or NULL if you want to use current time.
  * Returns "YYYY-MM-DD-hh:mm:ss" string.
  */
@@ -835,6 +1006,9 @@ enum {
     MAKEDESC_WHITELIST      = (1 << 3),
     /* Include all URLs from FILENAME_REPORTED_TO element in the description text */
     MAKEDESC_SHOW_URLS      = (1 << 4),
+    /* Include text elements bigger than max_text_size among the multi-liners,
+     * cut at the last line end within max_text_size */
+    MAKEDESC_TRUNCATE_TEXT  = (1 << 5),
 };
 #define make_description libreport_make_description
 char *make_description(problem_data_t *problem_data, char **names_to_skip, unsigned max_text_size, unsigned desc_flags);
@@ -975,6 +1149,70 @@ const char *get_user_setting(const char *name);
  */
 #define load_forbidden_words libreport_load_forbidden_words
 GList *load_words_from_file(const char *filename);
+
+/* Words which should not be reported and words which contain
+ * the forbidden ones but are harmless, e.g. "keyboard" for "key"
+ */
+#define FORBIDDEN_WORDS_BLACKLLIST "forbidden_words.conf"
+#define FORBIDDEN_WORDS_WHITELIST "ignored_words.conf"
+
+/* Multi-pattern search (Aho-Corasick) for many words in one pass over text */
+struct word_scanner;
+
+struct word_match
+{
+    size_t wm_start; /* byte offset of the first matched byte */
+    size_t wm_end;   /* byte offset behind the last matched byte */
+    unsigned wm_word; /* index of the word in the list given to word_scanner_new() */
+};
+
+enum {
+    /* ASCII letters only, other bytes must match exactly */
+    WORD_SCANNER_CASE_INSENSITIVE = 1 << 0,
+};
+
+/* Compiles a list of words (char *); empty words are ignored */
+#define word_scanner_new libreport_word_scanner_new
+struct word_scanner *word_scanner_new(GList *words, int flags);
+#define word_scanner_free libreport_word_scanner_free
+void word_scanner_free(struct word_scanner *scanner);
+/* Returns a malloced array of occurrences of the scanner's words in text
+ * ordered by their offsets and stores its length in count. Occurrences of
+ * one word never overlap. Occurrences which lie within an occurrence of
+ * a word of the ignored scanner are left out; ignored can be NULL.
+ */
+#define word_scanner_find libreport_word_scanner_find
+struct word_match *word_scanner_find(const struct word_scanner *scanner,
+                                     const struct word_scanner *ignored,
+                                     const char *text, size_t len, size_t *count);
+
+/* Scanners compiled from FORBIDDEN_WORDS_BLACKLLIST and FORBIDDEN_WORDS_WHITELIST
+ * on the first use; the word lists are case sensitive.
+ */
+#define get_forbidden_words_scanner libreport_get_forbidden_words_scanner
+const struct word_scanner *get_forbidden_words_scanner(void);
+#define get_ignored_words_scanner libreport_get_ignored_words_scanner
+const struct word_scanner *get_ignored_words_scanner(void);
+/* Forgets the compiled scanners, the word lists are read again on the next use */
+#define reset_sensitive_words_scanners libreport_reset_sensitive_words_scanners
+void reset_sensitive_words_scanners(void);
+
+struct sensitive_data_item
+{
+    char *sdi_name;
+    struct word_match *sdi_matches;
+    size_t sdi_count;
+};
+
+/* Searches all text items for forbidden words without user interaction.
+ * Returns a list of struct sensitive_data_item ordered by item names,
+ * only the items containing a forbidden word are listed.
+ */
+#define problem_data_find_sensitive_data libreport_problem_data_find_sensitive_data
+GList *problem_data_find_sensitive_data(problem_data_t *problem_data);
+#define sensitive_data_item_free libreport_sensitive_data_item_free
+void sensitive_data_item_free(struct sensitive_data_item *item);
+
 #define get_file_list libreport_get_file_list
 GList *get_file_list(const char *path, const char *ext);
 #define free_file_list libreport_free_file_list
@@ -1016,6 +1254,32 @@ struct dump_dir *open_directory_for_writing(
                          const char *dump_dir_name,
                          bool (*ask_continue)(const char *, const char *));
 
+/* Index of the reported_to file of a dump directory, see struct dump_dir */
+struct reported_to_index;
+#define reported_to_index_new libreport_reported_to_index_new
+struct reported_to_index *reported_to_index_new(void);
+#define reported_to_index_free libreport_reported_to_index_free
+void reported_to_index_free(struct reported_to_index *index);
+/* Indexes the lines appended since the last call or the whole file if it was
+ * replaced
+ *
+ * @return 0 on success, -errno otherwise (-ENOENT if there is no file)
+ */
+#define reported_to_index_update libreport_reported_to_index_update
+int reported_to_index_update(struct reported_to_index *index, int dir_fd);
+#define reported_to_index_contains libreport_reported_to_index_contains
+bool reported_to_index_contains(const struct reported_to_index *index, const char *line);
+/* @return The last result of the label like find_in_reported_to_data() */
+#define reported_to_index_find libreport_reported_to_index_find
+report_result_t *reported_to_index_find(const struct reported_to_index *index, const char *report_label);
+/* Appends the line by O_APPEND write unless it is indexed already
+ *
+ * @return 1 if the line was appended, 0 if it was there, -errno otherwise
+ * (-ENOENT if there is no file, the caller creates it)
+ */
+#define reported_to_index_append libreport_reported_to_index_append
+int reported_to_index_append(struct reported_to_index *index, int dir_fd, const char *line);
+
 // Files bigger than this are never considered to be text.
 //
 // Started at 64k limit. But _some_ limit is necessary:
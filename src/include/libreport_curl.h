@@ -41,6 +41,8 @@ typedef struct post_state {
     /* SSH key files */
     const char  *client_ssh_public_keyfile;
     const char  *client_ssh_private_keyfile;
+    /* POST_CONTENT_ENCODING_*, the server must accept compressed bodies */
+    int         content_encoding;
     /* Results of POST transaction: */
     int         http_resp_code;
     /* cast from CURLcode enum.
@@ -75,7 +77,61 @@ enum {
     POST_DATA_FROMFILE_AS_FORM_DATA = -4,
     POST_DATA_STRING_AS_FORM_DATA = -5,
     POST_DATA_GET = -6,
+    /* data points to struct post_stream */
+    POST_DATA_FROMSTREAM_PUT = -7,
+    POST_DATA_FROMSTREAM_AS_FORM_DATA = -8,
+    POST_DATA_FROMSTREAM = -9,
 };
+
+/* Compression of request bodies.
+ *
+ * Applies to POST_DATA_STRING, POST_DATA_STRING_AS_FORM_DATA and blobs of
+ * known size. The body is compressed while it is being sent, so it is sent
+ * with "Transfer-Encoding: chunked". Bodies shorter than
+ * POST_CONTENT_ENCODING_MIN_SIZE and encodings libreport was built without
+ * are sent as they are.
+ */
+enum {
+    POST_CONTENT_ENCODING_IDENTITY = 0,
+    POST_CONTENT_ENCODING_GZIP,
+    POST_CONTENT_ENCODING_ZSTD,
+};
+
+#define POST_CONTENT_ENCODING_MIN_SIZE 1024
+
+/* Parses the value of CompressRequests= options: no, gzip, zstd or yes (the
+ * best available one). Returns -1 for unknown values.
+ */
+int post_content_encoding_from_string(const char *str);
+
+/* Returns non-zero if libreport can produce the encoding */
+int post_content_encoding_supported(int encoding);
+
+/* Compresses size bytes of data in the same way post() does it.
+ * Returns a malloced buffer or NULL if the encoding is not supported.
+ */
+char *post_encode_body(int encoding, const char *data, size_t size, size_t *encoded_size);
+
+/* Writes the uploaded data to fd and returns 0 on success.
+ *
+ * The function is called in a child process while the data are being sent,
+ * once for every attempt to send them, so it must be able to produce the
+ * same data again.
+ */
+typedef int (*post_stream_fn)(int fd, void *param);
+
+/* Data of unknown size produced while they are being uploaded */
+struct post_stream
+{
+    post_stream_fn ps_produce;
+    void *ps_param;
+    const char *ps_name;        ///< file name announced to the server
+    off_t ps_size;              ///< size of the data, 0 if not known in advance
+};
+
+/* Size of the pipe buffer between the producer and the upload */
+#define POST_STREAM_BUFFER_SIZE (1024 * 1024)
+
 int
 post(post_state_t *state,
                 const char *url,
@@ -83,6 +139,29 @@ post(post_state_t *state,
                 const char **additional_headers,
                 const char *data,
                 off_t data_size);
+
+/* Default limit of parallel connections used by post_multi() */
+#define POST_MULTI_DEFAULT_CONNECTIONS 8
+
+/* Performs count POST transactions to the same url concurrently.
+ *
+ * The requests go through a single curl multi handle, so connections are
+ * reused between them, HTTP/2 multiplexing is used if the server supports it
+ * and no more than max_connections (0 for the default) are opened at once.
+ *
+ * data[i] is sent and the results are stored in states[i] in the same way
+ * post() does it. If data[i] is NULL, nothing is sent for it.
+ */
+void
+post_multi(post_state_t **states,
+                unsigned count,
+                const char *url,
+                const char *content_type,
+                const char **additional_headers,
+                const char *const *data,
+                off_t data_size,
+                unsigned max_connections);
+
 static inline int
 get(post_state_t *state,
                 const char *url,
@@ -132,6 +211,16 @@ post_file_as_form(post_state_t *state,
     return post(state, url, content_type, additional_headers,
                      filename, POST_DATA_FROMFILE_AS_FORM_DATA);
 }
+static inline int
+post_stream_as_form(post_state_t *state,
+                const char *url,
+                const char *content_type,
+                const char **additional_headers,
+                const struct post_stream *stream)
+{
+    return post(state, url, content_type, additional_headers,
+                     (const char *)stream, POST_DATA_FROMSTREAM_AS_FORM_DATA);
+}
 
 enum {
     UPLOAD_FILE_NOFLAGS = 0,
@@ -156,6 +245,46 @@ char *upload_file_ext(post_state_t *post_state,
                 const char *filename,
                 int flags);
 
+/* Uploads data produced by stream to url, the same way upload_file_ext()
+ * does it, with stream->ps_name as the file name.
+ *
+ * The protocol must accept data of unknown size, i.e. it must not be scp.
+ */
+#define upload_stream_ext libreport_upload_stream_ext
+char *upload_stream_ext(post_state_t *post_state,
+                const char *url,
+                const struct post_stream *stream,
+                int flags);
+
+struct upload_chunked_options
+{
+    off_t uco_chunk_size;       ///< bytes
+    unsigned uco_parallel;      ///< chunks sent at once if the server accepts ranges
+    const char *uco_journal;    ///< resume journal, NULL if the upload can't be resumed
+};
+
+/* Uploads filename to url like upload_file_ext(), but in chunks.
+ *
+ * Every chunk is sent by a separate HTTP PUT with "Content-Range" and
+ * RFC 3230 "Digest: SHA=..." headers and failed chunks are sent again.
+ * The chunks confirmed by the server are recorded in the journal, so an
+ * interrupted upload of the same file continues where it stopped.
+ *
+ * The first chunk is sent alone. The server must answer it by 308 or with
+ * "Accept-Ranges: bytes", then up to uco_parallel chunks are sent at once.
+ * Otherwise the server may ignore Content-Range and the file is sent again
+ * by a single PUT.
+ *
+ * URLs other than http(s) and files not larger than a chunk are uploaded
+ * by upload_file_ext().
+ */
+#define upload_file_chunked libreport_upload_file_chunked
+char *upload_file_chunked(post_state_t *post_state,
+                const char *url,
+                const char *filename,
+                const struct upload_chunked_options *options,
+                int flags);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,171 @@
+/*
+    Copyright (C) 2026  ABRT team
+    Copyright (C) 2026  RedHat Inc
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+/*
+ * Operation metrics
+ *
+ * A fixed registry of counters and histograms updated by atomic operations.
+ * The metrics are disabled unless the environment variable
+ * LIBREPORT_METRICS_FILE names a file. In that case, every process using
+ * libreport (abrtd, event handlers, reporters, ...) adds its metrics to the
+ * file when it exits. The file is in the Prometheus text exposition format,
+ * so it can be put in node_exporter's textfile collector directory:
+ *
+ *   LIBREPORT_METRICS_FILE=/var/lib/node_exporter/textfile/libreport.prom
+ *
+ * 'report-cli --metrics json' prints the file as JSON.
+ *
+ * A disabled metric costs a test of a global variable.
+ */
+#ifndef LIBREPORT_METRICS_H_
+#define LIBREPORT_METRICS_H_
+
+#include "libreport_types.h"
+#include "trace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LIBREPORT_METRICS_COUNTERS(X) \
+    X(dump_dirs_created, "Problem directories created") \
+    X(events_run, "Events run on problem directories") \
+    X(event_handlers_run, "Event handlers spawned") \
+    X(event_handler_failures, "Event handlers exited with non-zero status") \
+    X(http_requests, "HTTP requests") \
+    X(http_failures, "HTTP requests failed or answered with status 400 or higher") \
+    X(http_retries, "HTTP requests repeated after a failure") \
+    X(uploaded_bytes, "Bytes sent in HTTP requests") \
+    X(reports, "Report results recorded in reported_to")
+
+#define LIBREPORT_METRICS_HISTOGRAMS(X) \
+    X(dump_dir_lock_wait, "Time spent waiting for the lock of a problem directory") \
+    X(event_run, "Run time of events") \
+    X(http_request, "Run time of HTTP requests")
+
+enum metric_counter
+{
+#define METRIC_COUNTER_ENUM(name, help) METRIC_##name,
+    LIBREPORT_METRICS_COUNTERS(METRIC_COUNTER_ENUM)
+#undef METRIC_COUNTER_ENUM
+    METRIC_COUNTER_COUNT,
+};
+
+enum metric_histogram
+{
+#define METRIC_HISTOGRAM_ENUM(name, help) METRIC_##name,
+    LIBREPORT_METRICS_HISTOGRAMS(METRIC_HISTOGRAM_ENUM)
+#undef METRIC_HISTOGRAM_ENUM
+    METRIC_HISTOGRAM_COUNT,
+};
+
+/* Upper bounds of the histogram buckets are 0.001, 0.005, 0.01, 0.05, 0.1,
+ * 0.5, 1, 5, 10, 60 seconds and +Inf
+ */
+#define METRICS_BUCKETS 11
+
+struct metrics_histogram
+{
+    unsigned long long mh_buckets[METRICS_BUCKETS]; ///< not cumulative
+    unsigned long long mh_count;
+    unsigned long long mh_sum_ns;
+};
+
+struct metrics_snapshot
+{
+    unsigned long long ms_counters[METRIC_COUNTER_COUNT];
+    struct metrics_histogram ms_histograms[METRIC_HISTOGRAM_COUNT];
+};
+
+#define g_metrics_enabled libreport_g_metrics_enabled
+extern int g_metrics_enabled;
+
+/* Enables the metrics, they are added to path by metrics_flush().
+ * NULL disables them.
+ */
+#define metrics_enable libreport_metrics_enable
+void metrics_enable(const char *path);
+
+/* Thread safe */
+#define metrics_counter_add libreport_metrics_counter_add
+void metrics_counter_add(enum metric_counter counter, unsigned long long value);
+
+/* Thread safe */
+#define metrics_observe libreport_metrics_observe
+void metrics_observe(enum metric_histogram histogram, unsigned long long ns);
+
+/* Copies the metrics of the current process */
+#define metrics_get_snapshot libreport_metrics_get_snapshot
+void metrics_get_snapshot(struct metrics_snapshot *snapshot);
+
+#define metrics_reset libreport_metrics_reset
+void metrics_reset(void);
+
+/* Parses a file written by metrics_write_prometheus(), unknown lines are
+ * ignored
+ *
+ * @return 0 on success, -errno if the file can't be read
+ */
+#define metrics_load_snapshot libreport_metrics_load_snapshot
+int metrics_load_snapshot(const char *path, struct metrics_snapshot *snapshot);
+
+#define metrics_write_prometheus libreport_metrics_write_prometheus
+void metrics_write_prometheus(int fd, const struct metrics_snapshot *snapshot);
+
+/* Writes one JSON object, e.g.:
+ *
+ *   {"dump_dirs_created":2,...,"event_run":{"buckets":{"0.001":0,...,"+Inf":3},"count":3,"sum":1.5},...}
+ *
+ * Buckets are cumulative like in the Prometheus format.
+ */
+#define metrics_write_json libreport_metrics_write_json
+void metrics_write_json(int fd, const struct metrics_snapshot *snapshot);
+
+/* Adds the metrics of the current process to the file of metrics_enable()
+ * and resets them. The metrics are kept if they can't be added. Called when
+ * the process exits.
+ *
+ * @return 0 on success or if the metrics are disabled, -errno otherwise
+ */
+#define metrics_flush libreport_metrics_flush
+int metrics_flush(void);
+
+#define METRIC_ADD(name, value) \
+    do { \
+        if (g_metrics_enabled) \
+            metrics_counter_add(METRIC_##name, (value)); \
+    } while (0)
+#define METRIC_INC(name) METRIC_ADD(name, 1)
+
+/* METRIC_TIMER_BEGIN() declares the start time of the histogram in the current
+ * scope, METRIC_TIMER_END() may be used more times
+ */
+#define METRIC_TIMER_BEGIN(name) \
+    const unsigned long long metric_##name##_begin = g_metrics_enabled ? trace_now() : 0
+#define METRIC_TIMER_END(name) \
+    do { \
+        if (g_metrics_enabled && metric_##name##_begin != 0) \
+            metrics_observe(METRIC_##name, trace_now() - metric_##name##_begin); \
+    } while (0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -129,6 +129,15 @@ static inline GList *problem_data_get_all_elements(problem_data_t *problem_data)
  */
 void problem_data_get_osinfo(problem_data_t *problem_data, map_string_t *osinfo);
 
+/**
+  @brief Sends the problem data to abrtd which creates a new problem directory
+
+  Binary items are passed to abrtd as file descriptors. If abrtd refuses
+  them, the problem data are sent again without the binary items.
+
+  @param problem_data Problem data object to send
+  @return 0 on success, non-zero otherwise
+ */
 int problem_data_send_to_abrt(problem_data_t* problem_data);
 
 /* Conversions between in-memory and on-disk formats */
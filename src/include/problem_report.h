@@ -180,13 +180,15 @@ typedef struct problem_report_settings problem_report_settings_t;
 /*
  * Type of buffer used by Problem report
  */
-typedef FILE problem_report_buffer;
+struct strbuf;
+typedef struct strbuf problem_report_buffer;
 
 /*
  * Wrapper for the proble buffer's formated output function.
  */
+struct strbuf *libreport_strbuf_append_strf(struct strbuf *strbuf, const char *format, ...);
 #define problem_report_buffer_printf(buf, fmt, ...)\
-    fprintf((buf), (fmt), ##__VA_ARGS__)
+    libreport_strbuf_append_strf((buf), (fmt), ##__VA_ARGS__)
 
 
 /*
@@ -236,6 +238,20 @@ const char *problem_report_get_description(const problem_report_t *self);
 const char *problem_report_get_section(const problem_report_t *self,
         const char *section_name);
 
+/*
+ * Writes a section to a file descriptor
+ *
+ * Large descriptions can be passed on without any copying.
+ *
+ * @param self Problem report
+ * @param section_name Name of the section
+ * @param fd File descriptor
+ * @return Zero on success, -ENOENT if there is no such section or negative
+ * errno value if writing fails
+ */
+int problem_report_write_section(const problem_report_t *self,
+        const char *section_name, int fd);
+
 /*
  * Get GList of the problem data items that are to be attached
  *
@@ -327,6 +343,10 @@ int problem_formatter_load_string(problem_formatter_t* self, const char *fmt);
 /*
  * Loads a problem format from a file.
  *
+ * Compiled formats are cached for the whole process, the file is parsed again
+ * only if it has been modified since the last load. "-" stands for stdin,
+ * which is never cached.
+ *
  * @param self Problem formatter
  * @param pat Path to the format file
  * @return Zero on success or number of warnings (e.g. missing section,
@@ -0,0 +1,144 @@
+/*
+    Copyright (C) 2026  ABRT team
+    Copyright (C) 2026  RedHat Inc
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+/*
+ * Persistent queue of reporting events which could not be run because
+ * the reporting target was unreachable.
+ *
+ * The queue is an append-only journal of text records, one per line:
+ *
+ *   A <uuid> <event> <dump dir path>    - queued
+ *   R <uuid> <event> <attempts> <time>  - failed, retry after time
+ *   D <uuid> <event> <attempts>         - done
+ *   G <uuid> <event> <attempts>         - failed too many times, gave up
+ *
+ * Every record is written by a single write() and synced, a torn record at
+ * the end of the file (a crash) is ignored when the journal is loaded.
+ * Finished entries are dropped from the journal at the end of every drain.
+ */
+#ifndef LIBREPORT_REPORT_QUEUE_H_
+#define LIBREPORT_REPORT_QUEUE_H_
+
+#include "libreport_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Can be overridden by LIBREPORT_DEBUG_REPORT_QUEUE_PATH */
+#define REPORT_QUEUE_PATH LOCALSTATEDIR"/spool/libreport/report-queue"
+
+enum report_queue_entry_state
+{
+    REPORT_QUEUE_PENDING,
+    REPORT_QUEUE_DONE,
+    REPORT_QUEUE_GAVE_UP,
+};
+
+struct report_queue_entry
+{
+    char *rqe_uuid;           ///< uuid of the problem, the queue holds one entry per uuid and event
+    char *rqe_event;
+    char *rqe_dump_dir;
+    unsigned rqe_attempts;    ///< number of failed runs
+    time_t rqe_next_attempt;  ///< do not run before this time, 0 means now
+    enum report_queue_entry_state rqe_state;
+};
+
+typedef struct report_queue report_queue_t;
+
+/* Opens the queue journal and loads its entries, creates the journal if
+ * it does not exist.
+ *
+ * @param path Journal path or NULL for the default one
+ * @return NULL on errors (already logged)
+ */
+#define report_queue_open libreport_report_queue_open
+report_queue_t *report_queue_open(const char *path);
+
+#define report_queue_close libreport_report_queue_close
+void report_queue_close(report_queue_t *queue);
+
+/* Adds a new entry to the queue. The uuid is read from the dump dir.
+ *
+ * @return 0 if the entry was queued, 1 if a pending entry for the same
+ * problem and event already exists, negative errno value on errors
+ */
+#define report_queue_add libreport_report_queue_add
+int report_queue_add(report_queue_t *queue, const char *dump_dir_name, const char *event);
+
+/* Returns the entries ordered by the time they were queued in. The list and
+ * the entries are owned by the queue and valid until the next call of
+ * a queue function.
+ */
+#define report_queue_get_entries libreport_report_queue_get_entries
+GList *report_queue_get_entries(report_queue_t *queue);
+
+/* Runs the event of the entry, returns 0 on success. It is called in a child
+ * process and may die.
+ */
+typedef int (*report_queue_run_fn)(const struct report_queue_entry *entry, void *param);
+
+struct report_queue_drain_options
+{
+    unsigned rqd_concurrency;    ///< maximum of events run at once
+    unsigned rqd_max_attempts;   ///< give up after that many failures, 0 never
+    unsigned rqd_base_delay;     ///< seconds, delay after the first failure
+    unsigned rqd_max_delay;      ///< seconds, upper bound of the delay
+};
+
+#define REPORT_QUEUE_DEFAULT_CONCURRENCY 4
+#define REPORT_QUEUE_DEFAULT_MAX_ATTEMPTS 10
+#define REPORT_QUEUE_DEFAULT_BASE_DELAY 60
+#define REPORT_QUEUE_DEFAULT_MAX_DELAY (6 * 60 * 60)
+
+#define report_queue_drain_options_init libreport_report_queue_drain_options_init
+void report_queue_drain_options_init(struct report_queue_drain_options *options);
+
+/* Returns the delay before the next run of an entry which failed 'attempts'
+ * times: base_delay doubled with every further failure, at most max_delay.
+ */
+#define report_queue_backoff libreport_report_queue_backoff
+unsigned report_queue_backoff(unsigned attempts, unsigned base_delay, unsigned max_delay);
+
+/* Runs all pending entries whose time has come, rqd_concurrency of them at
+ * once, and records the results in the journal. reported_to of the dump dirs
+ * is left to the reporters.
+ *
+ * Only one process drains the queue at a time, the call returns -EAGAIN
+ * immediately if the queue is being drained by somebody else.
+ *
+ * @param run Function running the entries, NULL runs the entry's event
+ * by run_event_on_dir_name()
+ * @param next_attempt Set to the time of the earliest pending entry, or 0
+ * if there are no pending entries, if not NULL
+ * @return Number of pending entries left in the queue, negative errno value
+ * on errors
+ */
+#define report_queue_drain libreport_report_queue_drain
+int report_queue_drain(report_queue_t *queue,
+                       const struct report_queue_drain_options *options,
+                       report_queue_run_fn run, void *param,
+                       time_t *next_attempt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,135 @@
+/*
+    Copyright (C) 2026  ABRT team
+    Copyright (C) 2026  RedHat Inc
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+/*
+ * Trace points of the core operations
+ *
+ * Every trace point records the latency of the operation in a histogram of
+ * the process and, if libreport was built with <sys/sdt.h>, fires the USDT
+ * probe libreport:<name> with the operation's argument (a path, an element
+ * name or an URL) and the latency in nanoseconds:
+ *
+ *   stap -e 'probe process("libreport.so*").mark("dd_lock") { println(user_string($arg1), " ", $arg2) }'
+ *
+ * The histograms have log-linear buckets with 8 sub-buckets per power of
+ * two, i.e. the reported percentiles are within 12.5% of the real values.
+ * If the environment variable LIBREPORT_TRACE_DUMP names a file ("-" for
+ * stderr), the histograms are appended to it when the process exits.
+ *
+ * The trace points are compiled out by ./configure --disable-tracing.
+ */
+#ifndef LIBREPORT_TRACE_H_
+#define LIBREPORT_TRACE_H_
+
+#include "libreport_types.h"
+#include "trace_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LIBREPORT_TRACE_POINTS(X) \
+    X(dd_opendir) \
+    X(dd_lock) \
+    X(dd_close) \
+    X(dd_load_text) \
+    X(dd_save) \
+    X(problem_data_load) \
+    X(spawn_command) \
+    X(consume_command_output) \
+    X(post)
+
+enum trace_point
+{
+#define TRACE_POINT_ENUM(name) TRACE_POINT_##name,
+    LIBREPORT_TRACE_POINTS(TRACE_POINT_ENUM)
+#undef TRACE_POINT_ENUM
+    TRACE_POINT_COUNT,
+};
+
+struct trace_stats
+{
+    unsigned long ts_count;
+    unsigned long long ts_min_ns;
+    unsigned long long ts_max_ns;
+    unsigned long long ts_mean_ns;
+    unsigned long long ts_p50_ns;
+    unsigned long long ts_p90_ns;
+    unsigned long long ts_p99_ns;
+};
+
+/* @return Name of the trace point, NULL for invalid points */
+#define trace_point_name libreport_trace_point_name
+const char *trace_point_name(enum trace_point point);
+
+/* @return CLOCK_MONOTONIC in nanoseconds */
+#define trace_now libreport_trace_now
+unsigned long long trace_now(void);
+
+/* Adds the latency to the histogram of the point, thread safe */
+#define trace_record libreport_trace_record
+void trace_record(enum trace_point point, unsigned long long ns);
+
+/* @return false if nothing was recorded for the point */
+#define trace_get_stats libreport_trace_get_stats
+bool trace_get_stats(enum trace_point point, struct trace_stats *stats);
+
+/* Writes one JSON object per trace point with any records, e.g.:
+ *
+ *   {"pid":123,"point":"dd_lock","count":10,"min_ns":...,"mean_ns":...,"p50_ns":...,"p90_ns":...,"p99_ns":...,"max_ns":...}
+ */
+#define trace_dump libreport_trace_dump
+void trace_dump(int fd);
+
+#define trace_reset libreport_trace_reset
+void trace_reset(void);
+
+/* @return false if libreport was built with --disable-tracing */
+#define trace_enabled libreport_trace_enabled
+bool trace_enabled(void);
+
+#if LIBREPORT_ENABLE_TRACING
+# if LIBREPORT_HAVE_SYS_SDT_H
+#  include <sys/sdt.h>
+#  define TRACE_PROBE(name, arg, ns) STAP_PROBE2(libreport, name, arg, ns)
+# else
+#  define TRACE_PROBE(name, arg, ns) do { } while (0)
+# endif
+
+/* TRACE_BEGIN() declares the start time of the point in the current scope,
+ * TRACE_END() may be used more times, e.g. on every return path.
+ */
+# define TRACE_BEGIN(name) \
+    const unsigned long long trace_##name##_begin = trace_now()
+# define TRACE_END(name, arg) \
+    do { \
+        const unsigned long long trace_ns = trace_now() - trace_##name##_begin; \
+        trace_record(TRACE_POINT_##name, trace_ns); \
+        TRACE_PROBE(name, arg, trace_ns); \
+    } while (0)
+#else
+# define TRACE_BEGIN(name) do { } while (0)
+# define TRACE_END(name, arg) do { } while (0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -65,6 +65,7 @@ struct ureport_server_config
     char *ur_username;    ///< username for basic HTTP auth
     char *ur_password;    ///< password for basic HTTP auth
     map_string_t *ur_http_headers; ///< Additional HTTP headers
+    int ur_content_encoding; ///< POST_CONTENT_ENCODING_* of request bodies
 
     struct ureport_preferences ur_prefs; ///< configuration for uReport generation
 };
@@ -197,6 +198,19 @@ ureport_server_response_save_in_dump_dir(struct ureport_server_response *resp,
                                          const char *dump_dir_path,
                                          struct ureport_server_config *config);
 
+/*
+ * Save response in files of an opened dump dir
+ *
+ * @param resp Parsed server response
+ * @param dd Dump dir opened for writing
+ * @param config Configuration used in communication
+ */
+#define ureport_server_response_save_in_dd libreport_ureport_server_response_save_in_dd
+void
+ureport_server_response_save_in_dd(struct ureport_server_response *resp,
+                                   struct dump_dir *dd,
+                                   struct ureport_server_config *config);
+
 /*
  * Build URL to submitted uReport
  *
@@ -242,6 +256,24 @@ ureport_do_post(const char *json, struct ureport_server_config *config,
 struct ureport_server_response *
 ureport_submit(const char *json_ureport, struct ureport_server_config *config);
 
+/*
+ * Submit many uReports on server at once
+ *
+ * The uReports are sent concurrently over shared (keep-alive or HTTP/2)
+ * connections, which is much faster than calling ureport_submit() in a loop.
+ *
+ * @param json_ureports Sent data, NULL items are skipped
+ * @param count Number of items in json_ureports
+ * @param config Configuration used in communication
+ * @param max_connections Limit of open connections, 0 for the default
+ * @return Malloced array of count malloced, parsed server responses. An item
+ *         is NULL if the corresponding uReport was skipped or not submitted.
+ */
+#define ureport_submit_batch libreport_ureport_submit_batch
+struct ureport_server_response **
+ureport_submit_batch(const char *const *json_ureports, unsigned count,
+                     struct ureport_server_config *config, unsigned max_connections);
+
 /*
  * Build a new uReport attachement from give arguments
  *
@@ -295,6 +327,40 @@ ureport_from_dump_dir(const char *dump_dir_path);
 char *ureport_from_dump_dir_ext(const char *dump_dir_path,
                                 const struct ureport_preferences *preferences);
 
+/*
+ * Build uReport from an opened dump dir
+ *
+ * The dump dir is read while dd keeps it locked, so the caller can check
+ * and update it before and after without opening it again.
+ *
+ * @param dd Dump dir opened by the caller
+ * @param preferences uReport generation configuration (or NULL)
+ * @return Malloced JSON string
+ */
+#define ureport_from_dd libreport_ureport_from_dd
+char *ureport_from_dd(struct dump_dir *dd,
+                      const struct ureport_preferences *preferences);
+
+/*
+ * Build uReports from many dump dirs in parallel
+ *
+ * Each uReport is built in a worker process, so a dump dir which can't be
+ * processed never affects the others nor the caller, regardless of
+ * UREPORT_PREF_FLAG_RETURN_ON_FAILURE.
+ *
+ * @param dump_dir_paths FS paths to dump dirs
+ * @param count Number of items in dump_dir_paths
+ * @param preferences uReport generation configuration (or NULL)
+ * @param workers Number of worker processes, 0 for number of online CPUs
+ * @return Malloced array of count malloced JSON strings. An item is NULL
+ *         if the uReport could not be built.
+ */
+#define ureport_from_dump_dirs libreport_ureport_from_dump_dirs
+char **
+ureport_from_dump_dirs(const char *const *dump_dir_paths, unsigned count,
+                       const struct ureport_preferences *preferences,
+                       unsigned workers);
+
 #ifdef __cplusplus
 }
 #endif
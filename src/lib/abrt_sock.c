@@ -27,18 +27,28 @@
  */
 static int connect_to_abrtd_socket()
 {
+    const char *socket_file = getenv("LIBREPORT_DEBUG_ABRT_SOCKET");
+    if (socket_file == NULL)
+        socket_file = SOCKET_FILE;
+
+    struct sockaddr_un local;
+    memset(&local, 0, sizeof(local));
+    if (strlen(socket_file) >= sizeof(local.sun_path))
+    {
+        error_msg("Socket path '%s' is too long", socket_file);
+        return -1;
+    }
+
     int socketfd = xsocket(AF_UNIX, SOCK_STREAM, 0);
     if (socketfd == -1)
         return -1;
     /*close_on_exec_on(socketfd); - not needed, we are closing it soon */
-    struct sockaddr_un local;
-    memset(&local, 0, sizeof(local));
     local.sun_family = AF_UNIX;
-    strcpy(local.sun_path, SOCKET_FILE);
+    strcpy(local.sun_path, socket_file);
     int r = connect(socketfd, (struct sockaddr*)&local, sizeof(local));
     if (r != 0)
     {
-        VERB1 pwarn_msg("Can't connect to '%s'", SOCKET_FILE);
+        VERB1 pwarn_msg("Can't connect to '%s'", socket_file);
         close(socketfd);
         return -1;
     }
@@ -46,6 +56,35 @@ static int connect_to_abrtd_socket()
     return socketfd;
 }
 
+/* returns: HTTP status code of abrtd's response
+ * -1 on error
+ */
+static int read_response_status(int socketfd)
+{
+    char response[64];
+    int r = full_read(socketfd, response, sizeof(response) - 1);
+    if (r < 0)
+        return -1;
+
+    log_notice("Response via socket:'%.*s'", r, response);
+    /*  0123456789...  */
+    /* "HTTP/1.1 200 " */
+    if (r < 13)
+        return -1;
+    response[5] = '1';
+    response[7] = '1';
+    if (strncmp(response, "HTTP/1.1 ", strlen("HTTP/1.1 ")) == 0
+        && isdigit(response[9])
+        && isdigit(response[10])
+        && isdigit(response[11])
+        && response[12] == ' ')
+    {
+        return (response[9] - '0') * 100 + (response[10] - '0') * 10 + (response[11] - '0');
+    }
+
+    return -1;
+}
+
 static int connect_to_abrtd_and_call_DeleteDebugDump(const char *dump_dir_name)
 {
     int result = -1; /* error so far */
@@ -57,24 +96,7 @@ static int connect_to_abrtd_and_call_DeleteDebugDump(const char *dump_dir_name)
         full_write(socketfd, " HTTP/1.1\r\n\r\n", strlen(" HTTP/1.1\r\n\r\n"));
         shutdown(socketfd, SHUT_WR);
 
-        char response[64];
-        int r = full_read(socketfd, response, sizeof(response) - 1);
-        if (r >= 0)
-        {
-            log_notice("Response via socket:'%.*s'", r, response);
-            /*  0123456789...  */
-            /* "HTTP/1.1 200 " */
-            response[5] = '1';
-            response[7] = '1';
-            if (strncmp(response, "HTTP/1.1 ", strlen("HTTP/1.1 ")) == 0
-                && isdigit(response[9])
-                && isdigit(response[10])
-                && isdigit(response[11])
-                && response[12] == ' ')
-            {
-                result = (response[9] - '0') * 100 + (response[10] - '0') * 10 + (response[11] - '0');
-            }
-        }
+        result = read_response_status(socketfd);
     }
 
     close(socketfd);
@@ -82,58 +104,184 @@ static int connect_to_abrtd_and_call_DeleteDebugDump(const char *dump_dir_name)
     return result;
 }
 
-int problem_data_send_to_abrt(problem_data_t* problem_data)
+/* The text items are sent as "name=value\0" records.
+ *
+ * The binary items are passed as descriptors of the files opened for reading
+ * if the request is "PUT /fds". Such an item is the record "name\0" without
+ * '=' whose first byte carries the descriptor in SCM_RIGHTS, so abrtd can copy
+ * (or reflink) the file without reading it through the socket.
+ */
+#define PUT_REQUEST     "PUT / HTTP/1.1\r\n\r\n"
+#define PUT_FDS_REQUEST "PUT /fds HTTP/1.1\r\n\r\n"
+
+/* returns: 0 on success
+ * -errno on error
+ */
+static int send_fd_record(int socketfd, const char *name, int fd)
+{
+    struct iovec iov = { .iov_base = (void *)name, .iov_len = strlen(name) + 1 };
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    ssize_t r;
+    do
+        r = sendmsg(socketfd, &msg, 0);
+    while (r < 0 && errno == EINTR);
+
+    if (r < 0)
+        return -errno;
+
+    /* The descriptor went with the first byte, send the rest of the name */
+    const size_t rest = iov.iov_len - r;
+    if (rest != 0 && full_write(socketfd, name + r, rest) != (ssize_t)rest)
+        return -EIO;
+
+    return 0;
+}
+
+/* returns: HTTP status code of abrtd's response
+ * -1 on error
+ */
+static int send_problem_data(problem_data_t *problem_data, bool pass_fds)
 {
-    int result = 1; /* error so far */
     int socketfd = connect_to_abrtd_socket();
-    if (socketfd != -1)
+    if (socketfd == -1)
+        return -1;
+
+    int result = -1; /* error so far */
+
+    /* the request and name, '=', value and '\0' of every text item */
+    struct iovec *iov = xmalloc(sizeof(*iov) * (1 + 4 * g_hash_table_size(problem_data)));
+    int iovcnt = 0;
+    size_t size = 0;
+    GList *binary_items = NULL;
+
+    const char *request = pass_fds ? PUT_FDS_REQUEST : PUT_REQUEST;
+    iov[iovcnt].iov_base = (void *)request;
+    iov[iovcnt++].iov_len = strlen(request);
+    size += strlen(request);
+
+    GHashTableIter iter;
+    char *name;
+    struct problem_item *value;
+    g_hash_table_iter_init(&iter, problem_data);
+    while (g_hash_table_iter_next(&iter, (void**)&name, (void**)&value))
     {
-        GHashTableIter iter;
-        char *name;
-        struct problem_item *value;
-        g_hash_table_iter_init(&iter, problem_data);
+        if ((value->flags & CD_FLAG_BIN) && !pass_fds)
+        {
+            log_warning("Skipping binary file %s", name);
+            continue;
+        }
 
-        full_write(socketfd, "PUT / HTTP/1.1\r\n\r\n", strlen("PUT / HTTP/1.1\r\n\r\n"));
-        while (g_hash_table_iter_next(&iter, (void**)&name, (void**)&value))
+        /* only files should contain '/' and those are handled earlier */
+        if (name[0] == '.' || strchr(name, '/'))
         {
-            if (value->flags & CD_FLAG_BIN)
-            {
-                /* sending files over the socket is not implemented yet */
-                log_warning("Skipping binary file %s", name);
-                continue;
-            }
-
-            /* only files should contain '/' and those are handled earlier */
-            if (name[0] == '.' || strchr(name, '/'))
-            {
-                error_msg("Problem data field name contains disallowed chars: '%s'", name);
-                continue;
-            }
-
-            char* msg = xasprintf("%s=%s", name, value->content);
-            full_write(socketfd, msg, strlen(msg)+1 /* yes, +1 coz we want to send the trailing 0 */);
-            free(msg);
+            error_msg("Problem data field name contains disallowed chars: '%s'", name);
+            continue;
         }
-        shutdown(socketfd, SHUT_WR);
 
-        char response[64];
-        int r = full_read(socketfd, response, sizeof(response) - 1);
-        if (r >= 0)
+        if (value->flags & CD_FLAG_BIN)
         {
-            log_notice("Response via socket:'%.*s'", r, response);
-            /*  0123456789...  */
-            /* "HTTP/1.1 200 " */
-            response[5] = '1';
-            response[7] = '1';
-            result = strncmp(response, "HTTP/1.1 201 ", strlen("HTTP/1.1 201 "));
+            binary_items = g_list_prepend(binary_items, name);
+            continue;
         }
 
-        close(socketfd);
+        iov[iovcnt].iov_base = name;
+        iov[iovcnt++].iov_len = strlen(name);
+        iov[iovcnt].iov_base = (void *)"=";
+        iov[iovcnt++].iov_len = 1;
+        iov[iovcnt].iov_base = value->content;
+        iov[iovcnt++].iov_len = strlen(value->content);
+        /* yes, we want to send the trailing 0 */
+        iov[iovcnt].iov_base = (void *)"";
+        iov[iovcnt++].iov_len = 1;
+        size += strlen(name) + strlen(value->content) + 2;
+    }
+
+    if (full_writev(socketfd, iov, iovcnt) != (ssize_t)size)
+    {
+        perror_msg("Can't send problem data to abrtd");
+        goto ret;
+    }
+
+    for (GList *item = binary_items; item; item = g_list_next(item))
+    {
+        name = item->data;
+        const char *path = problem_data_get_content_or_NULL(problem_data, name);
+
+        int fd = open(path, O_RDONLY | O_NOFOLLOW | O_NOCTTY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            perror_msg("Skipping binary file %s, can't open '%s'", name, path);
+            continue;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+        {
+            error_msg("Skipping binary file %s, '%s' is not a regular file", name, path);
+            close(fd);
+            continue;
+        }
+
+        const int r = send_fd_record(socketfd, name, fd);
+        close(fd);
+        if (r != 0)
+        {
+            error_msg("Can't pass binary file %s to abrtd: %s", name, strerror(-r));
+            goto ret;
+        }
     }
 
+    shutdown(socketfd, SHUT_WR);
+
+    result = read_response_status(socketfd);
+
+ret:
+    g_list_free(binary_items);
+    free(iov);
+    close(socketfd);
+
     return result;
 }
 
+int problem_data_send_to_abrt(problem_data_t* problem_data)
+{
+    bool has_binary_items = false;
+
+    GHashTableIter iter;
+    struct problem_item *value;
+    g_hash_table_iter_init(&iter, problem_data);
+    while (!has_binary_items && g_hash_table_iter_next(&iter, NULL, (void**)&value))
+        has_binary_items = value->flags & CD_FLAG_BIN;
+
+    int status = send_problem_data(problem_data, has_binary_items);
+    if (has_binary_items && status >= 400 && status < 500)
+    {
+        /* abrtd which doesn't know the request refuses it */
+        log_notice("abrtd doesn't accept binary files, sending the problem without them");
+        status = send_problem_data(problem_data, /*pass_fds*/false);
+    }
+
+    return status != 201;
+}
+
 int delete_dump_dir_possibly_using_abrtd(const char *dump_dir_name)
 {
     INITIALIZE_LIBREPORT();
@@ -43,6 +43,8 @@ struct abrt_xmlrpc *abrt_xmlrpc_new_client(const char *url, int ssl_verify)
     xmlrpc_env_init(&env);
 
     struct abrt_xmlrpc *ax = xzalloc(sizeof(struct abrt_xmlrpc));
+    ax->ax_url = xstrdup(url);
+    ax->ax_ssl_verify = ssl_verify;
 
     /* This should be done at program startup, once. We do it in main */
     /* xmlrpc_client_setup_global_const(&env); */
@@ -70,6 +72,12 @@ struct abrt_xmlrpc *abrt_xmlrpc_new_client(const char *url, int ssl_verify)
     curl_parms.user_agent        = "abrt";
 #endif
 
+    /* TLSSessionCache (see tls_session_cache.h) cannot be consulted here:
+     * xmlrpc-c creates the curl handle itself and struct
+     * xmlrpc_curl_xportparms has no member which would let us reach
+     * the handle or its SSL_CTX.
+     */
+
     proxies = get_proxy_list(url);
     /* Use the first proxy from the list */
     if (proxies)
@@ -122,6 +130,7 @@ void abrt_xmlrpc_free_client(struct abrt_xmlrpc *ax)
 
     g_list_free(ax->ax_session_params);
 
+    free(ax->ax_url);
     free(ax);
 }
 
@@ -138,8 +147,10 @@ void abrt_xmlrpc_client_add_session_param_string(xmlrpc_env *env, struct abrt_xm
     ax->ax_session_params = g_list_append(ax->ax_session_params, new_ses_param);
 }
 
-/* internal helper function */
-static xmlrpc_value *abrt_xmlrpc_call_params_internal(xmlrpc_env *env, struct abrt_xmlrpc *ax, const char *method, xmlrpc_value *params)
+/* internal helper function
+ * Returns the array of call arguments: params extended by the session params
+ */
+static xmlrpc_value *abrt_xmlrpc_call_array(xmlrpc_env *env, struct abrt_xmlrpc *ax, xmlrpc_value *params)
 {
     xmlrpc_value *array = xmlrpc_array_new(env);
     if (env->fault_occurred)
@@ -172,13 +183,21 @@ static xmlrpc_value *abrt_xmlrpc_call_params_internal(xmlrpc_env *env, struct ab
     if (env->fault_occurred)
         abrt_xmlrpc_die(env);
 
+    if (destroy_params)
+        xmlrpc_DECREF(params);
+
+    return array;
+}
+
+/* internal helper function */
+static xmlrpc_value *abrt_xmlrpc_call_params_internal(xmlrpc_env *env, struct abrt_xmlrpc *ax, const char *method, xmlrpc_value *params)
+{
+    xmlrpc_value *array = abrt_xmlrpc_call_array(env, ax, params);
+
     xmlrpc_value *result = NULL;
     xmlrpc_client_call2(env, ax->ax_client, ax->ax_server_info, method,
                         array, &result);
 
-    if (destroy_params)
-        xmlrpc_DECREF(params);
-
     xmlrpc_DECREF(array);
     return result;
 }
@@ -301,3 +320,256 @@ xmlrpc_value *abrt_xmlrpc_call(struct abrt_xmlrpc *ax,
 
     return result;
 }
+
+char *abrt_xmlrpc_serialize_call(xmlrpc_env *env, struct abrt_xmlrpc *ax,
+                                 const char *method, xmlrpc_value *params,
+                                 size_t *size)
+{
+    xmlrpc_value *array = abrt_xmlrpc_call_array(env, ax, params);
+
+    xmlrpc_mem_block *xml = xmlrpc_mem_block_new(env, 0);
+    if (env->fault_occurred)
+        abrt_xmlrpc_die(env);
+
+    xmlrpc_serialize_call(env, xml, method, array);
+    xmlrpc_DECREF(array);
+    if (env->fault_occurred)
+        abrt_xmlrpc_die(env);
+
+    *size = XMLRPC_MEMBLOCK_SIZE(char, xml);
+    char *call = xstrndup(XMLRPC_MEMBLOCK_CONTENTS(char, xml), *size);
+    XMLRPC_MEMBLOCK_FREE(char, xml);
+
+    return call;
+}
+
+xmlrpc_value *abrt_xmlrpc_parse_response(xmlrpc_env *env, const char *xml, size_t size)
+{
+    xmlrpc_env_init(env);
+
+    xmlrpc_value *result = NULL;
+    int fault_code = 0;
+    const char *fault_string = NULL;
+    xmlrpc_parse_response2(env, xml, size, &result, &fault_code, &fault_string);
+    if (env->fault_occurred)
+        return NULL;
+
+    if (fault_string != NULL)
+    {
+        xmlrpc_env_set_fault(env, fault_code, fault_string);
+        xmlrpc_strfree(fault_string);
+        return NULL;
+    }
+
+    return result;
+}
+
+struct abrt_xmlrpc_multicall
+{
+    struct abrt_xmlrpc *am_ax;
+    xmlrpc_value *am_calls;     ///< array of {methodName, params} structs
+};
+
+struct abrt_xmlrpc_multicall *abrt_xmlrpc_multicall_new(struct abrt_xmlrpc *ax)
+{
+    xmlrpc_env env;
+    xmlrpc_env_init(&env);
+
+    struct abrt_xmlrpc_multicall *mc = xmalloc(sizeof(*mc));
+    mc->am_ax = ax;
+    mc->am_calls = abrt_xmlrpc_array_new(&env);
+
+    return mc;
+}
+
+void abrt_xmlrpc_multicall_free(struct abrt_xmlrpc_multicall *mc)
+{
+    if (!mc)
+        return;
+
+    xmlrpc_DECREF(mc->am_calls);
+    free(mc);
+}
+
+unsigned abrt_xmlrpc_multicall_size(struct abrt_xmlrpc_multicall *mc)
+{
+    xmlrpc_env env;
+    xmlrpc_env_init(&env);
+
+    int size = xmlrpc_array_size(&env, mc->am_calls);
+    if (env.fault_occurred)
+        abrt_xmlrpc_die(&env);
+
+    return size;
+}
+
+unsigned abrt_xmlrpc_multicall_add(struct abrt_xmlrpc_multicall *mc,
+                                   const char *method, const char *format, ...)
+{
+    xmlrpc_env env;
+    xmlrpc_env_init(&env);
+
+    xmlrpc_value *param = NULL;
+    const char *suffix;
+
+    va_list args;
+    va_start(args, format);
+    xmlrpc_build_value_va(&env, format, args, &param, &suffix);
+    va_end(args);
+    if (env.fault_occurred)
+        abrt_xmlrpc_die(&env);
+
+    if (*suffix != '\0')
+        error_msg_and_die("Bug: junk after the argument specifier: '%s'", suffix);
+
+    xmlrpc_value *array = abrt_xmlrpc_call_array(&env, mc->am_ax, param);
+    xmlrpc_DECREF(param);
+
+    xmlrpc_value *call = xmlrpc_build_value(&env, "{s:s,s:V}",
+                                            "methodName", method,
+                                            "params", array);
+    xmlrpc_DECREF(array);
+    if (env.fault_occurred)
+        abrt_xmlrpc_die(&env);
+
+    const unsigned index = abrt_xmlrpc_multicall_size(mc);
+
+    xmlrpc_array_append_item(&env, mc->am_calls, call);
+    xmlrpc_DECREF(call);
+    if (env.fault_occurred)
+        abrt_xmlrpc_die(&env);
+
+    return index;
+}
+
+/* internal helper function
+ * Performs the calls one by one and returns their results in the format
+ * of system.multicall: [value] or {faultCode, faultString}
+ */
+static xmlrpc_value *abrt_xmlrpc_multicall_perform_sequentially(struct abrt_xmlrpc_multicall *mc)
+{
+    xmlrpc_env env;
+    xmlrpc_env_init(&env);
+
+    xmlrpc_value *results = abrt_xmlrpc_array_new(&env);
+
+    const unsigned count = abrt_xmlrpc_multicall_size(mc);
+    for (unsigned i = 0; i < count; ++i)
+    {
+        xmlrpc_value *call = NULL;
+        const char *method = NULL;
+        xmlrpc_value *array = NULL;
+        xmlrpc_array_read_item(&env, mc->am_calls, i, &call);
+        if (!env.fault_occurred)
+            xmlrpc_decompose_value(&env, call, "{s:s,s:A,*}",
+                                   "methodName", &method,
+                                   "params", &array);
+        if (env.fault_occurred)
+            abrt_xmlrpc_die(&env);
+
+        xmlrpc_env call_env;
+        xmlrpc_env_init(&call_env);
+
+        xmlrpc_value *result = NULL;
+        xmlrpc_client_call2(&call_env, mc->am_ax->ax_client, mc->am_ax->ax_server_info,
+                            method, array, &result);
+
+        xmlrpc_value *item;
+        if (call_env.fault_occurred)
+        {
+            /* A transport failure would fail the multicall as a whole too */
+            if (call_env.fault_code == XMLRPC_NETWORK_ERROR)
+                abrt_xmlrpc_die(&call_env);
+
+            item = xmlrpc_build_value(&env, "{s:i,s:s}",
+                                      "faultCode", call_env.fault_code,
+                                      "faultString", call_env.fault_string);
+        }
+        else
+        {
+            item = xmlrpc_build_value(&env, "(V)", result);
+            xmlrpc_DECREF(result);
+        }
+        if (env.fault_occurred)
+            abrt_xmlrpc_die(&env);
+
+        xmlrpc_array_append_item(&env, results, item);
+        if (env.fault_occurred)
+            abrt_xmlrpc_die(&env);
+
+        xmlrpc_DECREF(item);
+        xmlrpc_env_clean(&call_env);
+        xmlrpc_strfree(method);
+        xmlrpc_DECREF(array);
+        xmlrpc_DECREF(call);
+    }
+
+    return results;
+}
+
+xmlrpc_value *abrt_xmlrpc_multicall_perform(struct abrt_xmlrpc_multicall *mc)
+{
+    struct abrt_xmlrpc *ax = mc->am_ax;
+
+    const unsigned count = abrt_xmlrpc_multicall_size(mc);
+    if (count <= 1 || ax->ax_no_multicall)
+        return abrt_xmlrpc_multicall_perform_sequentially(mc);
+
+    xmlrpc_env env;
+    xmlrpc_env_init(&env);
+
+    xmlrpc_value *args = xmlrpc_build_value(&env, "(V)", mc->am_calls);
+    if (env.fault_occurred)
+        abrt_xmlrpc_die(&env);
+
+    log_debug("Sending %u calls in system.multicall", count);
+
+    xmlrpc_value *results = NULL;
+    xmlrpc_client_call2(&env, ax->ax_client, ax->ax_server_info, "system.multicall",
+                        args, &results);
+    xmlrpc_DECREF(args);
+
+    if (!env.fault_occurred)
+        return results;
+
+    if (env.fault_code == XMLRPC_NETWORK_ERROR)
+        abrt_xmlrpc_die(&env);
+
+    log_notice("system.multicall failed, sending the calls one by one: (%d) %s",
+               env.fault_code, env.fault_string);
+    xmlrpc_env_clean(&env);
+
+    ax->ax_no_multicall = 1;
+    return abrt_xmlrpc_multicall_perform_sequentially(mc);
+}
+
+xmlrpc_value *abrt_xmlrpc_multicall_result(xmlrpc_env *env, xmlrpc_value *results,
+                                           unsigned index)
+{
+    xmlrpc_env_init(env);
+
+    xmlrpc_value *item = NULL;
+    xmlrpc_array_read_item(env, results, index, &item);
+    if (env->fault_occurred)
+        return NULL;
+
+    xmlrpc_value *result = NULL;
+    if (xmlrpc_value_type(item) == XMLRPC_TYPE_STRUCT)
+    {
+        int fault_code = 0;
+        const char *fault_string = NULL;
+        xmlrpc_decompose_value(env, item, "{s:i,s:s,*}",
+                               "faultCode", &fault_code,
+                               "faultString", &fault_string);
+        if (!env->fault_occurred)
+        {
+            xmlrpc_env_set_fault(env, fault_code, fault_string);
+            xmlrpc_strfree(fault_string);
+        }
+    }
+    else
+        xmlrpc_array_read_item(env, item, 0, &result);
+
+    xmlrpc_DECREF(item);
+    return result;
+}
@@ -37,6 +37,9 @@ struct abrt_xmlrpc {
     xmlrpc_client *ax_client;
     xmlrpc_server_info *ax_server_info;
     GList *ax_session_params;
+    char *ax_url;
+    int ax_ssl_verify;
+    int ax_no_multicall;        ///< the server doesn't know system.multicall
 };
 
 xmlrpc_value *abrt_xmlrpc_array_new(xmlrpc_env *env);
@@ -63,6 +66,47 @@ xmlrpc_value *abrt_xmlrpc_call_params(xmlrpc_env *env, struct abrt_xmlrpc *ax,
 xmlrpc_value *abrt_xmlrpc_call_full(xmlrpc_env *enf, struct abrt_xmlrpc *ax,
                                    const char *method, const char *format, ...);
 
+/* Returns the XML of the method call with the session params in the same
+ * way abrt_xmlrpc_call_params() would send it, for callers which send
+ * the call by other means than xmlrpc-c.
+ */
+char *abrt_xmlrpc_serialize_call(xmlrpc_env *env, struct abrt_xmlrpc *ax,
+                                 const char *method, xmlrpc_value *params,
+                                 size_t *size);
+
+/* Parses the XML of a method response, faults are reported in env */
+xmlrpc_value *abrt_xmlrpc_parse_response(xmlrpc_env *env, const char *xml, size_t size);
+
+/* Independent calls sent in a single request by system.multicall
+ *
+ * Usage:
+ *   struct abrt_xmlrpc_multicall *mc = abrt_xmlrpc_multicall_new(ax);
+ *   unsigned get = abrt_xmlrpc_multicall_add(mc, "Bug.get", "{s:(i)}", "ids", id);
+ *   unsigned comments = abrt_xmlrpc_multicall_add(mc, "Bug.comments", "{s:(i)}", "ids", id);
+ *   xmlrpc_value *results = abrt_xmlrpc_multicall_perform(mc);
+ *   xmlrpc_value *bug = abrt_xmlrpc_multicall_result(&env, results, get);
+ *
+ * The calls are sent one by one if the server doesn't support multicalls
+ * and a batch of a single call is sent as a plain call.
+ */
+struct abrt_xmlrpc_multicall;
+
+struct abrt_xmlrpc_multicall *abrt_xmlrpc_multicall_new(struct abrt_xmlrpc *ax);
+void abrt_xmlrpc_multicall_free(struct abrt_xmlrpc_multicall *mc);
+unsigned abrt_xmlrpc_multicall_size(struct abrt_xmlrpc_multicall *mc);
+
+/* Returns index of the call's result */
+unsigned abrt_xmlrpc_multicall_add(struct abrt_xmlrpc_multicall *mc,
+                                   const char *method, const char *format, ...);
+
+/* Dies if the request fails, faults of the calls are left to
+ * abrt_xmlrpc_multicall_result() */
+xmlrpc_value *abrt_xmlrpc_multicall_perform(struct abrt_xmlrpc_multicall *mc);
+
+/* Returns the result of the call at index or NULL and its fault in env */
+xmlrpc_value *abrt_xmlrpc_multicall_result(xmlrpc_env *env, xmlrpc_value *results,
+                                           unsigned index);
+
 #ifdef __cplusplus
 }
 #endif
@@ -18,6 +18,7 @@
 */
 
 #include "internal_libreport.h"
+#include "metrics.h"
 #include <errno.h>
 
 #define NEW_PD_SUFFIX ".new"
@@ -146,6 +147,8 @@ struct dump_dir *create_dump_dir(const char *base_dir_name, const char *type, ui
     dd_rename(dd, new_path);
     free(new_path);
 
+    METRIC_INC(dump_dirs_created);
+
  ret:
     free(problem_id);
     return dd;
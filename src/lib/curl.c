@@ -20,6 +20,20 @@
 #include "client.h"
 #include "libreport_curl.h"
 #include "proxies.h"
+#include "tls_session_cache.h"
+#include "trace.h"
+#include "metrics.h"
+
+#if HAVE_ZLIB
+# include <zlib.h>
+#else
+# define HAVE_ZLIB 0
+#endif
+#if HAVE_ZSTD
+# include <zstd.h>
+#else
+# define HAVE_ZSTD 0
+#endif
 
 /*
  * Utility functions
@@ -92,6 +106,8 @@ CURLcode curl_easy_perform_with_proxy(CURL *handle, const char *url)
         {
             xcurl_easy_setopt_ptr(handle, CURLOPT_PROXY, li->data);
             log_notice("Connecting to %s (using proxy server %s)", url, (const char *)li->data);
+            if (li != proxy_list)
+                METRIC_INC(http_retries);
             curl_err = curl_easy_perform(handle);
         }
     }
@@ -233,6 +249,440 @@ static size_t fread_with_reporting(void *ptr, size_t size, size_t nmemb, void *u
     return fread(ptr, size, nmemb, fp);
 }
 
+/* Data of POST_DATA_FROMSTREAM_* transactions. The producer runs in a child
+ * process and writes the data to a pipe which is read by the upload, so the
+ * data never have to be stored as a whole. The pipe is the only buffer
+ * between the producer and the upload: the producer blocks when the pipe is
+ * full and the upload waits for data when it is empty.
+ */
+struct stream_reader
+{
+    const struct post_stream *stream;
+    int fd;             ///< read end of the pipe
+    pid_t pid;          ///< producer, 0 if not running
+    off_t read;
+    time_t last_t;
+    time_t report_interval;
+};
+
+static bool stream_reader_start(struct stream_reader *r)
+{
+    int pipefd[2];
+    if (pipe(pipefd) != 0)
+    {
+        perror_msg("pipe");
+        return false;
+    }
+    close_on_exec_on(pipefd[0]);
+#ifdef F_SETPIPE_SZ
+    /* Let the producer run ahead of the network, the default pipe buffer
+     * is 64KiB. Failure is not fatal, the upload is just more bursty. */
+    if (fcntl(pipefd[1], F_SETPIPE_SZ, POST_STREAM_BUFFER_SIZE) < 0)
+        log_debug("Can't resize the stream pipe: %s", strerror(errno));
+#endif
+
+    fflush(NULL);
+    r->pid = fork();
+    if (r->pid < 0)
+    {
+        perror_msg("fork");
+        r->pid = 0;
+        close(pipefd[0]);
+        close(pipefd[1]);
+        return false;
+    }
+
+    if (r->pid == 0)
+    {
+        /* child */
+        close(pipefd[0]);
+        /* Die quietly if the upload was interrupted */
+        signal(SIGPIPE, SIG_DFL);
+        int ret = r->stream->ps_produce(pipefd[1], r->stream->ps_param);
+        _exit(ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    close(pipefd[1]);
+    r->fd = pipefd[0];
+    r->read = 0;
+    r->last_t = time(NULL);
+    r->report_interval = 15;
+    return true;
+}
+
+/* Closes the pipe and waits for the producer.
+ * Returns false if the producer failed.
+ */
+static bool stream_reader_stop(struct stream_reader *r)
+{
+    if (r->pid == 0)
+        return true;
+
+    /* Unblocks the producer if the upload did not read all data */
+    close(r->fd);
+    r->fd = -1;
+
+    int status;
+    safe_waitpid(r->pid, &status, 0);
+    r->pid = 0;
+
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/* "read local data from a stream" callback */
+static size_t stream_read(void *ptr, size_t size, size_t nmemb, void *userdata)
+{
+    struct stream_reader *r = userdata;
+
+    if (r->pid == 0)
+        return 0;
+
+    ssize_t n = safe_read(r->fd, ptr, size * nmemb);
+    if (n < 0)
+    {
+        perror_msg("Can't read the uploaded data");
+        return CURL_READFUNC_ABORT;
+    }
+
+    if (n == 0)
+    {
+        /* Do not finish the upload if the data are incomplete, the server
+         * must not take a truncated file for a valid one.
+         */
+        if (!stream_reader_stop(r))
+        {
+            error_msg(_("Failed to generate the uploaded data"));
+            return CURL_READFUNC_ABORT;
+        }
+        return 0;
+    }
+
+    r->read += n;
+
+    /* Report the progress like fread_with_reporting() does */
+    time_t t = time(NULL);
+    if ((t - r->last_t) >= r->report_interval)
+    {
+        r->last_t = t;
+        r->report_interval *= 2;
+        log(_("Uploaded: %llu kbytes"), (unsigned long long)r->read / 1024);
+    }
+
+    return n;
+}
+
+/* curl rewinds the data when it has to send them again, e.g. after
+ * an authentication round trip. The stream can't seek, but it can be
+ * produced again from the beginning.
+ */
+static int stream_seek(void *userdata, curl_off_t offset, int origin)
+{
+    struct stream_reader *r = userdata;
+
+    if (offset != 0 || origin != SEEK_SET)
+        return CURL_SEEKFUNC_CANTSEEK;
+
+    if (r->pid != 0 && r->read == 0)
+        return CURL_SEEKFUNC_OK;
+
+    log_debug("Restarting the uploaded stream");
+    stream_reader_stop(r);
+    return stream_reader_start(r) ? CURL_SEEKFUNC_OK : CURL_SEEKFUNC_FAIL;
+}
+
+/* Compressed request bodies. The body is compressed directly into the
+ * buffers curl asks to fill, so no compressed copy of it is ever made.
+ */
+#define BODY_ENCODER_SEGMENTS 3
+
+struct body_encoder
+{
+    int encoding;
+    /* Plain body, form data are framed by the multipart boundaries */
+    const char *segment[BODY_ENCODER_SEGMENTS];
+    size_t segment_size[BODY_ENCODER_SEGMENTS];
+    unsigned segment_count;
+    unsigned next_segment;
+    char *boundary;             ///< malloced parts of the multipart framing
+    char *preamble;
+    char *epilogue;
+    bool finished;
+    off_t plain_size;
+    off_t encoded_size;
+#if HAVE_ZLIB
+    z_stream zs;
+    bool zs_initialized;
+#endif
+#if HAVE_ZSTD
+    ZSTD_CCtx *zcs;
+    ZSTD_inBuffer zin;
+#endif
+};
+
+static const char *const s_content_encodings[] = {
+    [POST_CONTENT_ENCODING_IDENTITY] = "identity",
+    [POST_CONTENT_ENCODING_GZIP] = "gzip",
+    [POST_CONTENT_ENCODING_ZSTD] = "zstd",
+};
+
+int post_content_encoding_supported(int encoding)
+{
+    switch (encoding)
+    {
+    case POST_CONTENT_ENCODING_IDENTITY:
+        return 1;
+    case POST_CONTENT_ENCODING_GZIP:
+        return HAVE_ZLIB;
+    case POST_CONTENT_ENCODING_ZSTD:
+        return HAVE_ZSTD;
+    }
+
+    return 0;
+}
+
+int post_content_encoding_from_string(const char *str)
+{
+    if (str == NULL || str[0] == '\0' || strcasecmp(str, "identity") == 0)
+        return POST_CONTENT_ENCODING_IDENTITY;
+
+    for (int i = 0; i < (int)ARRAY_SIZE(s_content_encodings); ++i)
+        if (strcasecmp(str, s_content_encodings[i]) == 0)
+            return i;
+
+    const int enabled = string_to_bool(str);
+    if (enabled)
+        return post_content_encoding_supported(POST_CONTENT_ENCODING_ZSTD)
+                ? POST_CONTENT_ENCODING_ZSTD
+                : POST_CONTENT_ENCODING_GZIP;
+
+    /* string_to_bool() can't tell 'no' from garbage */
+    if (strcasecmp(str, "no") == 0 || strcasecmp(str, "off") == 0
+        || strcasecmp(str, "false") == 0 || strcmp(str, "0") == 0)
+        return POST_CONTENT_ENCODING_IDENTITY;
+
+    return -1;
+}
+
+static void body_encoder_add_segment(struct body_encoder *enc, const char *data, size_t size)
+{
+    enc->segment[enc->segment_count] = data;
+    enc->segment_size[enc->segment_count] = size;
+    enc->segment_count++;
+    enc->plain_size += size;
+}
+
+/* Returns false if the encoder can't be used */
+static bool body_encoder_reset(struct body_encoder *enc)
+{
+    enc->next_segment = 0;
+    enc->finished = false;
+    enc->encoded_size = 0;
+
+    switch (enc->encoding)
+    {
+#if HAVE_ZLIB
+    case POST_CONTENT_ENCODING_GZIP:
+        if (enc->zs_initialized)
+            return deflateReset(&enc->zs) == Z_OK;
+
+        /* 16 + MAX_WBITS makes zlib write the gzip header and trailer */
+        if (deflateInit2(&enc->zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS,
+                         /*memLevel:*/ 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            return false;
+        enc->zs_initialized = true;
+        enc->zs.avail_in = 0;
+        return true;
+#endif
+#if HAVE_ZSTD
+    case POST_CONTENT_ENCODING_ZSTD:
+        if (enc->zcs == NULL)
+        {
+            enc->zcs = ZSTD_createCCtx();
+            if (enc->zcs == NULL)
+                return false;
+        }
+        else
+            ZSTD_CCtx_reset(enc->zcs, ZSTD_reset_session_only);
+        /* Lets the server allocate the whole buffer at once */
+        ZSTD_CCtx_setPledgedSrcSize(enc->zcs, enc->plain_size);
+        enc->zin.src = NULL;
+        enc->zin.size = enc->zin.pos = 0;
+        return true;
+#endif
+    }
+
+    return false;
+}
+
+static void body_encoder_destroy(struct body_encoder *enc)
+{
+#if HAVE_ZLIB
+    if (enc->zs_initialized)
+        deflateEnd(&enc->zs);
+#endif
+#if HAVE_ZSTD
+    ZSTD_freeCCtx(enc->zcs);
+#endif
+    free(enc->boundary);
+    free(enc->preamble);
+    free(enc->epilogue);
+    memset(enc, 0, sizeof(*enc));
+}
+
+/* Starts compressing data, the multipart form in the same shape as the one
+ * curl builds for POST_DATA_STRING_AS_FORM_DATA if form_type is not NULL.
+ */
+static bool body_encoder_init(struct body_encoder *enc, int encoding,
+                const char *data, size_t size, const char *form_type)
+{
+    memset(enc, 0, sizeof(*enc));
+    enc->encoding = encoding;
+
+    if (form_type != NULL)
+    {
+        enc->boundary = xasprintf("------------------------libreport%08x%08x",
+                                  (unsigned)getpid(), (unsigned)time(NULL));
+        enc->preamble = xasprintf("--%s\r\n"
+                "Content-Disposition: form-data; name=\"file\"; filename=\"*buffer*\"\r\n"
+                "Content-Type: %s\r\n"
+                "\r\n",
+                enc->boundary, form_type);
+        enc->epilogue = xasprintf("\r\n--%s--\r\n", enc->boundary);
+        body_encoder_add_segment(enc, enc->preamble, strlen(enc->preamble));
+    }
+
+    body_encoder_add_segment(enc, data, size);
+
+    if (enc->epilogue != NULL)
+        body_encoder_add_segment(enc, enc->epilogue, strlen(enc->epilogue));
+
+    if (!body_encoder_reset(enc))
+    {
+        body_encoder_destroy(enc);
+        return false;
+    }
+
+    return true;
+}
+
+/* Fills buf with the next part of the compressed body.
+ * Returns the number of bytes, 0 at the end of the body and -1 on error.
+ */
+static ssize_t body_encoder_read(struct body_encoder *enc, char *buf, size_t size)
+{
+    size_t produced = 0;
+
+    while (!enc->finished && produced < size)
+    {
+        switch (enc->encoding)
+        {
+#if HAVE_ZLIB
+        case POST_CONTENT_ENCODING_GZIP:
+            if (enc->zs.avail_in == 0 && enc->next_segment < enc->segment_count)
+            {
+                enc->zs.next_in = (Bytef *)enc->segment[enc->next_segment];
+                enc->zs.avail_in = enc->segment_size[enc->next_segment];
+                enc->next_segment++;
+            }
+
+            enc->zs.next_out = (Bytef *)buf + produced;
+            enc->zs.avail_out = size - produced;
+            const bool zs_last = enc->next_segment >= enc->segment_count;
+            int zr = deflate(&enc->zs, zs_last ? Z_FINISH : Z_NO_FLUSH);
+            if (zr == Z_STREAM_ERROR)
+                return -1;
+            produced = size - enc->zs.avail_out;
+            if (zr == Z_STREAM_END)
+                enc->finished = true;
+            break;
+#endif
+#if HAVE_ZSTD
+        case POST_CONTENT_ENCODING_ZSTD:
+            if (enc->zin.pos == enc->zin.size && enc->next_segment < enc->segment_count)
+            {
+                enc->zin.src = enc->segment[enc->next_segment];
+                enc->zin.size = enc->segment_size[enc->next_segment];
+                enc->zin.pos = 0;
+                enc->next_segment++;
+            }
+
+            ZSTD_outBuffer zout = { .dst = buf, .size = size, .pos = produced };
+            const bool zstd_last = enc->next_segment >= enc->segment_count;
+            size_t remaining = ZSTD_compressStream2(enc->zcs, &zout, &enc->zin,
+                                                    zstd_last ? ZSTD_e_end : ZSTD_e_continue);
+            if (ZSTD_isError(remaining))
+            {
+                log_notice("zstd: %s", ZSTD_getErrorName(remaining));
+                return -1;
+            }
+            produced = zout.pos;
+            if (zstd_last && remaining == 0)
+                enc->finished = true;
+            break;
+#endif
+        default:
+            return -1;
+        }
+    }
+
+    enc->encoded_size += produced;
+    return produced;
+}
+
+/* "read compressed body" callback */
+static size_t body_encoder_curl_read(void *ptr, size_t size, size_t nmemb, void *userdata)
+{
+    ssize_t r = body_encoder_read(userdata, ptr, size * nmemb);
+    if (r < 0)
+    {
+        error_msg(_("Failed to compress the request body"));
+        return CURL_READFUNC_ABORT;
+    }
+
+    return r;
+}
+
+/* curl rewinds the body when it has to send it again, the compression starts
+ * over */
+static int body_encoder_curl_seek(void *userdata, curl_off_t offset, int origin)
+{
+    if (offset != 0 || origin != SEEK_SET)
+        return CURL_SEEKFUNC_CANTSEEK;
+
+    return body_encoder_reset(userdata) ? CURL_SEEKFUNC_OK : CURL_SEEKFUNC_FAIL;
+}
+
+char *post_encode_body(int encoding, const char *data, size_t size, size_t *encoded_size)
+{
+    struct body_encoder enc;
+    if (!post_content_encoding_supported(encoding)
+        || encoding == POST_CONTENT_ENCODING_IDENTITY
+        || !body_encoder_init(&enc, encoding, data, size, /*form_type:*/ NULL))
+        return NULL;
+
+    char *encoded = NULL;
+    size_t encoded_len = 0;
+    FILE *out = open_memstream(&encoded, &encoded_len);
+    if (out == NULL)
+        die_out_of_memory();
+
+    char block[64 * 1024];
+    ssize_t r;
+    while ((r = body_encoder_read(&enc, block, sizeof(block))) > 0)
+        fwrite(block, 1, r, out);
+    body_encoder_destroy(&enc);
+    fclose(out);
+
+    if (r < 0)
+    {
+        free(encoded);
+        return NULL;
+    }
+
+    *encoded_size = encoded_len;
+    return encoded;
+}
+
 static int curl_debug(CURL *handle, curl_infotype it, char *buf, size_t bufsize, void *unused)
 {
     if (logmode == 0)
@@ -294,31 +744,76 @@ static int curl_debug(CURL *handle, curl_infotype it, char *buf, size_t bufsize,
     return 0;
 }
 
-int
-post(post_state_t *state,
-                const char *url,
+/* Resources of a single POST transaction */
+struct post_request
+{
+    post_state_t *state;
+    CURL *handle;
+    struct curl_httppost *post;
+    FILE *data_file;
+    off_t data_left;            ///< bytes of data_file to send in a chunk
+    struct stream_reader stream;
+    struct body_encoder encoder;   ///< used if encoder.segment_count != 0
+    FILE *body_stream;
+    struct curl_slist *httpheader_list;
+};
+
+/* Sets up compression of the body if it was asked for and it is worth it */
+static bool
+post_request_init_encoder(struct post_request *req,
                 const char *content_type,
-                const char **additional_headers,
                 const char *data,
                 off_t data_size)
 {
-    INITIALIZE_LIBREPORT();
+    const int encoding = req->state->content_encoding;
+    if (encoding == POST_CONTENT_ENCODING_IDENTITY)
+        return false;
 
-    CURLcode curl_err;
-    long response_code;
-    post_state_t localstate;
+    if (data_size != POST_DATA_STRING
+        && data_size != POST_DATA_STRING_AS_FORM_DATA
+        && data_size < 0)
+        return false;
 
-    log_debug("%s('%s','%s')", __func__, url, data);
+    const size_t size = data_size >= 0 ? (size_t)data_size : strlen(data);
+    if (size < POST_CONTENT_ENCODING_MIN_SIZE)
+        return false;
 
-    if (!state)
+    if (!post_content_encoding_supported(encoding))
     {
-        memset(&localstate, 0, sizeof(localstate));
-        state = &localstate;
+        log_notice("Compression '%s' is not supported, sending the request body uncompressed",
+                   (unsigned)encoding < ARRAY_SIZE(s_content_encodings) ? s_content_encodings[encoding] : "?");
+        return false;
     }
 
-    state->curl_result = state->http_resp_code = response_code = -1;
+    const char *form_type = data_size == POST_DATA_STRING_AS_FORM_DATA ? content_type : NULL;
+    if (!body_encoder_init(&req->encoder, encoding, data, size, form_type))
+    {
+        log_notice("Can't initialize compression, sending the request body uncompressed");
+        return false;
+    }
+
+    return true;
+}
+
+/* Creates and configures a curl handle for the transaction.
+ * Returns false if the transaction can't be performed (file open error, etc).
+ * req must be released by post_request_cleanup() in both cases.
+ */
+static bool
+post_request_init(struct post_request *req,
+                post_state_t *state,
+                const char *url,
+                const char *content_type,
+                const char **additional_headers,
+                const char *data,
+                off_t data_size)
+{
+    memset(req, 0, sizeof(*req));
+    req->state = state;
+
+    state->curl_result = state->http_resp_code = -1;
 
-    CURL *handle = xcurl_easy_init();
+    CURL *handle = req->handle = xcurl_easy_init();
 
     // Buffer[CURL_ERROR_SIZE] curl stores human readable error messages in.
     // This may be more helpful than just return code from curl_easy_perform.
@@ -357,39 +852,64 @@ post(post_state_t *state,
     if (state->client_ssh_private_keyfile)
         xcurl_easy_setopt_ptr(handle, CURLOPT_SSH_PRIVATE_KEYFILE, state->client_ssh_private_keyfile);
 
-    if (data_size != POST_DATA_FROMFILE_PUT && data_size != POST_DATA_GET)
+    if (data_size != POST_DATA_FROMFILE_PUT
+        && data_size != POST_DATA_FROMSTREAM_PUT
+        && data_size != POST_DATA_GET)
     {
         // Do a HTTP POST. This also makes curl use
         // a "Content-Type: application/x-www-form-urlencoded" header.
         // (This is by far the most commonly used POST method).
         xcurl_easy_setopt_long(handle, CURLOPT_POST, 1);
     }
-    // else (only POST_DATA_FROMFILE_PUT): do HTTP PUT.
+    // else (only POST_DATA_FROM{FILE,STREAM}_PUT): do HTTP PUT.
 
-    struct curl_httppost *post = NULL;
     struct curl_httppost *last = NULL;
-    FILE *data_file = NULL;
-    FILE *body_stream = NULL;
-    struct curl_slist *httpheader_list = NULL;
 
     // Supply data...
-    if (data_size == POST_DATA_FROMFILE
+    if (post_request_init_encoder(req, content_type, data, data_size))
+    {
+        // ...compressed on the fly, the size is not known in advance
+        xcurl_easy_setopt_ptr(handle, CURLOPT_READFUNCTION, (const void*)body_encoder_curl_read);
+        xcurl_easy_setopt_ptr(handle, CURLOPT_READDATA, &req->encoder);
+        xcurl_easy_setopt_ptr(handle, CURLOPT_SEEKFUNCTION, (const void*)body_encoder_curl_seek);
+        xcurl_easy_setopt_ptr(handle, CURLOPT_SEEKDATA, &req->encoder);
+
+        char *encoding_header = xasprintf("Content-Encoding: %s", s_content_encodings[req->encoder.encoding]);
+        req->httpheader_list = curl_slist_append(req->httpheader_list, encoding_header);
+        free(encoding_header);
+        if (req->httpheader_list)
+            req->httpheader_list = curl_slist_append(req->httpheader_list, "Transfer-Encoding: chunked");
+        if (!req->httpheader_list)
+            error_msg_and_die("out of memory");
+
+        // The form is framed by the encoder, not by curl
+        if (req->encoder.boundary)
+        {
+            char *content_type_header = xasprintf("Content-Type: multipart/form-data; boundary=%s",
+                                                  req->encoder.boundary);
+            req->httpheader_list = curl_slist_append(req->httpheader_list, content_type_header);
+            free(content_type_header);
+            if (!req->httpheader_list)
+                error_msg_and_die("out of memory");
+        }
+    }
+    else if (data_size == POST_DATA_FROMFILE
      || data_size == POST_DATA_FROMFILE_PUT
     ) {
         // ...from a file
-        data_file = fopen(data, "r");
-        if (!data_file)
+        req->data_file = fopen(data, "r");
+        if (!req->data_file)
         {
             perror_msg("Can't open '%s'", data);
-            goto ret; // return -1
+            return false;
         }
 
-        xcurl_easy_setopt_ptr(handle, CURLOPT_READDATA, data_file);
+        xcurl_easy_setopt_ptr(handle, CURLOPT_READDATA, req->data_file);
         // Want to use custom read function
         xcurl_easy_setopt_ptr(handle, CURLOPT_READFUNCTION, (const void*)fread_with_reporting);
-        fseeko(data_file, 0, SEEK_END);
-        off_t sz = ftello(data_file);
-        fseeko(data_file, 0, SEEK_SET);
+        fseeko(req->data_file, 0, SEEK_END);
+        off_t sz = ftello(req->data_file);
+        fseeko(req->data_file, 0, SEEK_SET);
         if (data_size == POST_DATA_FROMFILE)
         {
             // Without this, curl would send "Content-Length: -1"
@@ -410,30 +930,30 @@ post(post_state_t *state,
         else basename = data;
 #if 0
         // Simple way, without custom reader function
-        CURLFORMcode curlform_err = curl_formadd(&post, &last,
+        CURLFORMcode curlform_err = curl_formadd(&req->post, &last,
                         CURLFORM_PTRNAME, "file", // element name
                         CURLFORM_FILE, data, // filename to read from
                         CURLFORM_CONTENTTYPE, content_type,
                         CURLFORM_FILENAME, basename, // filename to put in the form
                         CURLFORM_END);
 #else
-        data_file = fopen(data, "r");
-        if (!data_file)
+        req->data_file = fopen(data, "r");
+        if (!req->data_file)
         {
             perror_msg("Can't open '%s'", data);
-            goto ret; // return -1
+            return false;
         }
         // Want to use custom read function
         xcurl_easy_setopt_ptr(handle, CURLOPT_READFUNCTION, (const void*)fread_with_reporting);
         // Need to know file size
-        fseeko(data_file, 0, SEEK_END);
-        off_t sz = ftello(data_file);
-        fseeko(data_file, 0, SEEK_SET);
+        fseeko(req->data_file, 0, SEEK_END);
+        off_t sz = ftello(req->data_file);
+        fseeko(req->data_file, 0, SEEK_SET);
         // Create formdata
-        CURLFORMcode curlform_err = curl_formadd(&post, &last,
+        CURLFORMcode curlform_err = curl_formadd(&req->post, &last,
                         CURLFORM_PTRNAME, "file", // element name
                         // use CURLOPT_READFUNCTION for reading, pass data_file as its last param:
-                        CURLFORM_STREAM, data_file,
+                        CURLFORM_STREAM, req->data_file,
                         CURLFORM_CONTENTSLENGTH, (long)sz, // a must if we use CURLFORM_STREAM option
 //FIXME: what if file size doesn't fit in long?
                         CURLFORM_CONTENTTYPE, content_type,
@@ -443,11 +963,62 @@ post(post_state_t *state,
         if (curlform_err != 0)
 //FIXME:
             error_msg_and_die("out of memory or read error (curl_formadd error code: %d)", (int)curlform_err);
-        xcurl_easy_setopt_ptr(handle, CURLOPT_HTTPPOST, post);
+        xcurl_easy_setopt_ptr(handle, CURLOPT_HTTPPOST, req->post);
+    }
+    else if (data_size == POST_DATA_FROMSTREAM_PUT
+          || data_size == POST_DATA_FROMSTREAM_AS_FORM_DATA
+          || data_size == POST_DATA_FROMSTREAM)
+    {
+        // ...from a producer, the size is not known in advance
+        req->stream.stream = (const struct post_stream *)data;
+        if (!stream_reader_start(&req->stream))
+            return false;
+
+        xcurl_easy_setopt_ptr(handle, CURLOPT_READFUNCTION, (const void*)stream_read);
+        xcurl_easy_setopt_ptr(handle, CURLOPT_SEEKFUNCTION, (const void*)stream_seek);
+        xcurl_easy_setopt_ptr(handle, CURLOPT_SEEKDATA, &req->stream);
+
+        if (data_size == POST_DATA_FROMSTREAM_PUT)
+        {
+            // Unknown CURLOPT_INFILESIZE_LARGE makes curl use
+            // "Transfer-Encoding: chunked" for HTTP
+            xcurl_easy_setopt_ptr(handle, CURLOPT_READDATA, &req->stream);
+            xcurl_easy_setopt_long(handle, CURLOPT_UPLOAD, 1);
+        }
+        else if (data_size == POST_DATA_FROMSTREAM)
+        {
+            xcurl_easy_setopt_ptr(handle, CURLOPT_READDATA, &req->stream);
+            if (req->stream.stream->ps_size > 0)
+                xcurl_easy_setopt_off_t(handle, CURLOPT_POSTFIELDSIZE_LARGE, req->stream.stream->ps_size);
+            else
+            {
+                req->httpheader_list = curl_slist_append(req->httpheader_list, "Transfer-Encoding: chunked");
+                if (!req->httpheader_list)
+                    error_msg_and_die("out of memory");
+            }
+        }
+        else
+        {
+            CURLFORMcode curlform_err = curl_formadd(&req->post, &last,
+                            CURLFORM_PTRNAME, "file", // element name
+                            // use CURLOPT_READFUNCTION for reading, pass the reader as its last param;
+                            // without CURLFORM_CONTENTSLENGTH the form must be sent chunked
+                            CURLFORM_STREAM, &req->stream,
+                            CURLFORM_CONTENTTYPE, content_type,
+                            CURLFORM_FILENAME, req->stream.stream->ps_name, // filename to put in the form
+                            CURLFORM_END);
+            if (curlform_err != 0)
+                error_msg_and_die("out of memory or read error (curl_formadd error code: %d)", (int)curlform_err);
+            xcurl_easy_setopt_ptr(handle, CURLOPT_HTTPPOST, req->post);
+
+            req->httpheader_list = curl_slist_append(req->httpheader_list, "Transfer-Encoding: chunked");
+            if (!req->httpheader_list)
+                error_msg_and_die("out of memory");
+        }
     }
     else if (data_size == POST_DATA_STRING_AS_FORM_DATA)
     {
-        CURLFORMcode curlform_err = curl_formadd(&post, &last,
+        CURLFORMcode curlform_err = curl_formadd(&req->post, &last,
                         CURLFORM_PTRNAME, "file", // element name
                         // curl bug - missing filename
                         // http://curl.haxx.se/mail/lib-2011-07/0176.html
@@ -463,7 +1034,7 @@ post(post_state_t *state,
                         CURLFORM_END);
         if (curlform_err != 0)
             error_msg_and_die("out of memory or read error (curl_formadd error code: %d)", (int)curlform_err);
-        xcurl_easy_setopt_ptr(handle, CURLOPT_HTTPPOST, post);
+        xcurl_easy_setopt_ptr(handle, CURLOPT_HTTPPOST, req->post);
     }
     else if (data_size != POST_DATA_GET)
     {
@@ -478,30 +1049,32 @@ post(post_state_t *state,
 
     // Override "Content-Type:"
     if (data_size != POST_DATA_FROMFILE_AS_FORM_DATA
-        && data_size != POST_DATA_STRING_AS_FORM_DATA)
+        && data_size != POST_DATA_FROMSTREAM_AS_FORM_DATA
+        && data_size != POST_DATA_STRING_AS_FORM_DATA
+        && req->encoder.boundary == NULL)
     {
         char *content_type_header = xasprintf("Content-Type: %s", content_type);
         // Note: curl_slist_append() copies content_type_header
-        httpheader_list = curl_slist_append(httpheader_list, content_type_header);
-        if (!httpheader_list)
+        req->httpheader_list = curl_slist_append(req->httpheader_list, content_type_header);
+        if (!req->httpheader_list)
             error_msg_and_die("out of memory");
         free(content_type_header);
     }
 
     for (; additional_headers && *additional_headers; additional_headers++)
     {
-        httpheader_list = curl_slist_append(httpheader_list, *additional_headers);
-        if (!httpheader_list)
+        req->httpheader_list = curl_slist_append(req->httpheader_list, *additional_headers);
+        if (!req->httpheader_list)
             error_msg_and_die("out of memory");
     }
 
     // Add User-Agent: ABRT/N.M
-    httpheader_list = curl_slist_append(httpheader_list, "User-Agent: ABRT/"VERSION);
-    if (!httpheader_list)
+    req->httpheader_list = curl_slist_append(req->httpheader_list, "User-Agent: ABRT/"VERSION);
+    if (!req->httpheader_list)
         error_msg_and_die("out of memory");
 
-    if (httpheader_list)
-        xcurl_easy_setopt_ptr(handle, CURLOPT_HTTPHEADER, httpheader_list);
+    if (req->httpheader_list)
+        xcurl_easy_setopt_ptr(handle, CURLOPT_HTTPHEADER, req->httpheader_list);
 
 // Disabled: was observed to also handle "305 Use proxy" redirect,
 // apparently with POST->GET remapping - which server didn't like at all.
@@ -531,10 +1104,10 @@ post(post_state_t *state,
     }
     if (state->flags & POST_WANT_BODY)
     {
-        body_stream = open_memstream(&state->body, &state->body_size);
-        if (!body_stream)
+        req->body_stream = open_memstream(&state->body, &state->body_size);
+        if (!req->body_stream)
             error_msg_and_die("out of memory");
-        xcurl_easy_setopt_ptr(handle, CURLOPT_WRITEDATA, body_stream);
+        xcurl_easy_setopt_ptr(handle, CURLOPT_WRITEDATA, req->body_stream);
     }
     if (!(state->flags & POST_WANT_SSL_VERIFY))
     {
@@ -551,9 +1124,58 @@ post(post_state_t *state,
     if (state->cert_authority_cert_path)
         xcurl_easy_setopt_ptr(handle, CURLOPT_CAINFO, state->cert_authority_cert_path);
 
-    // This is the place where everything happens.
+    // Resume TLS sessions negotiated by the previous reporter runs
+    tls_session_cache_attach(handle, url, state->client_cert_path);
+
+    return true;
+}
+
+/* Counts the performed transaction in the metrics */
+static void
+post_request_count_metrics(struct post_request *req, CURLcode curl_err)
+{
+    if (!g_metrics_enabled)
+        return;
+
+    METRIC_INC(http_requests);
+
+    long response_code = 0;
+    if (curl_err == CURLE_OK)
+        curl_easy_getinfo(req->handle, CURLINFO_RESPONSE_CODE, &response_code);
+    if (curl_err != CURLE_OK || response_code >= 400)
+        METRIC_INC(http_failures);
+
+#if LIBCURL_VERSION_NUM >= 0x073700 /* 7.55.0 */
+    curl_off_t uploaded = 0;
+    if (curl_easy_getinfo(req->handle, CURLINFO_SIZE_UPLOAD_T, &uploaded) == CURLE_OK && uploaded > 0)
+        METRIC_ADD(uploaded_bytes, uploaded);
+#else
+    double uploaded = 0;
+    if (curl_easy_getinfo(req->handle, CURLINFO_SIZE_UPLOAD, &uploaded) == CURLE_OK && uploaded > 0)
+        METRIC_ADD(uploaded_bytes, uploaded);
+#endif
+}
+
+/* Records results of the performed transaction in req->state.
+ * Returns HTTP response code or -1 on error.
+ */
+static long
+post_request_finish(struct post_request *req, CURLcode curl_err)
+{
+    post_state_t *state = req->state;
+    long response_code = -1;
+
+    // The server might have answered before it received all data
+    if (!stream_reader_stop(&req->stream) && curl_err == CURLE_OK)
+    {
+        error_msg(_("Failed to generate the uploaded data"));
+        curl_err = CURLE_READ_ERROR;
+    }
+
+    post_request_count_metrics(req, curl_err);
+
     // Here errors are not limited to "out of memory", can't just die.
-    state->curl_result = curl_err = curl_easy_perform_with_proxy(handle, url);
+    state->curl_result = curl_err;
     if (curl_err)
     {
         log_info("curl_easy_perform: error %d", (int)curl_err);
@@ -562,34 +1184,621 @@ post(post_state_t *state,
             state->curl_error_msg = check_curl_error(curl_err, "curl_easy_perform");
             log_debug("curl_easy_perform: error_msg: %s", state->curl_error_msg);
         }
-        goto ret;
+        return response_code;
     }
 
+    if (req->encoder.segment_count != 0)
+        log_info("Request body compressed by %s from %llu to %llu bytes",
+                 s_content_encodings[req->encoder.encoding],
+                 (unsigned long long)req->encoder.plain_size,
+                 (unsigned long long)req->encoder.encoded_size);
+
     // curl-7.20.1 doesn't do it, we get NULL body in the log message below
     // unless we fflush the body memstream ourself
-    if (body_stream)
-        fflush(body_stream);
+    if (req->body_stream)
+        fflush(req->body_stream);
 
     // Headers/body are already saved (if requested), extract more info
-    curl_err = curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &response_code);
+    curl_err = curl_easy_getinfo(req->handle, CURLINFO_RESPONSE_CODE, &response_code);
     die_if_curl_error(curl_err);
     state->http_resp_code = response_code;
     log_debug("after curl_easy_perform: response_code:%ld body:'%s'", response_code, state->body);
 
- ret:
-    curl_easy_cleanup(handle);
-    if (httpheader_list)
-        curl_slist_free_all(httpheader_list);
-    if (body_stream)
-        fclose(body_stream);
-    if (data_file)
-        fclose(data_file);
-    if (post)
-        curl_formfree(post);
+    return response_code;
+}
+
+static void
+post_request_cleanup(struct post_request *req)
+{
+    if (req->handle)
+        curl_easy_cleanup(req->handle);
+    if (req->httpheader_list)
+        curl_slist_free_all(req->httpheader_list);
+    if (req->body_stream)
+        fclose(req->body_stream);
+    if (req->data_file)
+        fclose(req->data_file);
+    stream_reader_stop(&req->stream);
+    if (req->encoder.segment_count != 0)
+        body_encoder_destroy(&req->encoder);
+    if (req->post)
+        curl_formfree(req->post);
+}
 
+int
+post(post_state_t *state,
+                const char *url,
+                const char *content_type,
+                const char **additional_headers,
+                const char *data,
+                off_t data_size)
+{
+    INITIALIZE_LIBREPORT();
+
+    TRACE_BEGIN(post);
+    METRIC_TIMER_BEGIN(http_request);
+
+    long response_code = -1;
+    post_state_t localstate;
+
+    if (data_size == POST_DATA_FROMSTREAM_PUT
+        || data_size == POST_DATA_FROMSTREAM_AS_FORM_DATA
+        || data_size == POST_DATA_FROMSTREAM)
+        log_debug("%s('%s',stream '%s')", __func__, url, ((const struct post_stream *)data)->ps_name);
+    else
+        log_debug("%s('%s','%s')", __func__, url, data);
+
+    if (!state)
+    {
+        memset(&localstate, 0, sizeof(localstate));
+        state = &localstate;
+    }
+
+    struct post_request req;
+    if (post_request_init(&req, state, url, content_type, additional_headers, data, data_size))
+    {
+        // This is the place where everything happens.
+        CURLcode curl_err = curl_easy_perform_with_proxy(req.handle, url);
+        response_code = post_request_finish(&req, curl_err);
+    }
+    post_request_cleanup(&req);
+
+    METRIC_TIMER_END(http_request);
+    TRACE_END(post, url);
     return response_code;
 }
 
+void
+post_multi(post_state_t **states,
+                unsigned count,
+                const char *url,
+                const char *content_type,
+                const char **additional_headers,
+                const char *const *data,
+                off_t data_size,
+                unsigned max_connections)
+{
+    INITIALIZE_LIBREPORT();
+
+    log_debug("%s('%s', %u requests)", __func__, url, count);
+
+    CURLM *multi = curl_multi_init();
+    if (!multi)
+        error_msg_and_die("Can't create curl multi handle");
+
+    if (max_connections == 0)
+        max_connections = POST_MULTI_DEFAULT_CONNECTIONS;
+
+    // Multiplex over HTTP/2 if the server can, otherwise keep up to
+    // max_connections persistent HTTP/1.1 connections busy
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, (long)CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)max_connections);
+    curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long)max_connections);
+
+    // Unlike curl_easy_perform_with_proxy() we can't retry the whole batch
+    // with every proxy, use the first one as abrt_xmlrpc_new_client() does
+    GList *proxy_list = get_proxy_list(url);
+    if (proxy_list)
+        log_notice("Connecting to %s (using proxy server %s)", url, (const char *)proxy_list->data);
+    else
+        log_notice("Connecting to %s", url);
+
+    struct post_request *reqs = xzalloc(count * sizeof(reqs[0]));
+    for (unsigned i = 0; i < count; ++i)
+    {
+        if (data[i] == NULL)
+        {
+            states[i]->curl_result = states[i]->http_resp_code = -1;
+            continue;
+        }
+
+        if (!post_request_init(&reqs[i], states[i], url, content_type, additional_headers, data[i], data_size))
+            continue;
+
+        if (proxy_list)
+            xcurl_easy_setopt_ptr(reqs[i].handle, CURLOPT_PROXY, proxy_list->data);
+        // Prefer waiting for a multiplexed stream over opening a new connection
+        xcurl_easy_setopt_long(reqs[i].handle, CURLOPT_PIPEWAIT, 1);
+        xcurl_easy_setopt_ptr(reqs[i].handle, CURLOPT_PRIVATE, &reqs[i]);
+
+        CURLMcode mc = curl_multi_add_handle(multi, reqs[i].handle);
+        if (mc != CURLM_OK)
+            error_msg_and_die("curl_multi_add_handle: %s", curl_multi_strerror(mc));
+    }
+
+    int running = 0;
+    do
+    {
+        CURLMcode mc = curl_multi_perform(multi, &running);
+        if (mc == CURLM_OK && running)
+            mc = curl_multi_wait(multi, NULL, 0, 1000, NULL);
+
+        if (mc != CURLM_OK)
+        {
+            // Transfers which are not finished keep curl_result == -1
+            error_msg("curl_multi_perform: %s", curl_multi_strerror(mc));
+            break;
+        }
+
+        int msgs_left;
+        CURLMsg *msg;
+        while ((msg = curl_multi_info_read(multi, &msgs_left)) != NULL)
+        {
+            if (msg->msg != CURLMSG_DONE)
+                continue;
+
+            struct post_request *req = NULL;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&req);
+            post_request_finish(req, msg->data.result);
+        }
+    }
+    while (running);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        if (reqs[i].handle)
+            curl_multi_remove_handle(multi, reqs[i].handle);
+        post_request_cleanup(&reqs[i]);
+    }
+
+    free(reqs);
+    list_free_with_free(proxy_list);
+    curl_multi_cleanup(multi);
+}
+
+/*
+ * Chunked uploads
+ */
+
+/* A chunk is sent again this many times before the upload fails */
+#define UPLOAD_CHUNK_ATTEMPTS 3
+
+struct upload_chunk
+{
+    unsigned index;
+    off_t offset;
+    off_t length;
+    char sha1[SHA1_RESULT_LEN * 2 + 1];
+    struct timespec started;
+    struct post_request req;
+    post_state_t *state;
+};
+
+/* "read local data from a file" callback of chunks, sends only
+ * req->data_left bytes */
+static size_t fread_chunk(void *ptr, size_t size, size_t nmemb, void *userdata)
+{
+    struct post_request *req = userdata;
+
+    size_t len = size * nmemb;
+    if ((off_t)len > req->data_left)
+        len = req->data_left;
+
+    size_t r = fread(ptr, 1, len, req->data_file);
+    if (r != len)
+    {
+        perror_msg("Can't read the uploaded file");
+        return CURL_READFUNC_ABORT;
+    }
+
+    req->data_left -= r;
+    return r;
+}
+
+/* Digest of the chunk, RFC 3230 "Digest: SHA=<base64 of SHA-1>" */
+static char *chunk_digest(int fd, off_t offset, off_t length, char *hex)
+{
+    sha1_ctx_t ctx;
+    sha1_begin(&ctx);
+
+    char buf[64 * 1024];
+    while (length > 0)
+    {
+        ssize_t r = pread(fd, buf, MIN((off_t)sizeof(buf), length), offset);
+        if (r <= 0)
+        {
+            perror_msg("Can't read the uploaded file");
+            return NULL;
+        }
+        sha1_hash(&ctx, buf, r);
+        offset += r;
+        length -= r;
+    }
+
+    uint8_t sha1[SHA1_RESULT_LEN];
+    sha1_end(&ctx, sha1);
+    *bin2hex(hex, (const char *)sha1, SHA1_RESULT_LEN) = '\0';
+
+    char *b64 = encode_base64(sha1, SHA1_RESULT_LEN);
+    char *header = xasprintf("Digest: SHA=%s", b64);
+    free(b64);
+    return header;
+}
+
+/* Prepares a PUT of the chunk to url */
+static bool upload_chunk_start(struct upload_chunk *chunk, post_state_t *parent,
+                const char *url, const char *filename, int fd, off_t total)
+{
+    free_post_state(chunk->state);
+    chunk->state = new_post_state(parent->flags | POST_WANT_HEADERS | POST_WANT_ERROR_MSG);
+    chunk->state->username = parent->username;
+    chunk->state->password = parent->password;
+    chunk->state->client_cert_path = parent->client_cert_path;
+    chunk->state->client_key_path = parent->client_key_path;
+    chunk->state->cert_authority_cert_path = parent->cert_authority_cert_path;
+
+    char *digest = chunk_digest(fd, chunk->offset, chunk->length, chunk->sha1);
+    if (!digest)
+        return false;
+
+    char *range = xasprintf("Content-Range: bytes %llu-%llu/%llu",
+                (unsigned long long)chunk->offset,
+                (unsigned long long)(chunk->offset + chunk->length - 1),
+                (unsigned long long)total);
+    const char *headers[] = { range, digest, NULL };
+
+    // POST_DATA_GET sets neither data nor the method, the chunk is set below
+    bool ok = post_request_init(&chunk->req, chunk->state, url,
+                "application/octet-stream", headers, NULL, POST_DATA_GET);
+    free(range);
+    free(digest);
+    if (!ok)
+        return false;
+
+    chunk->req.data_file = fopen(filename, "r");
+    if (!chunk->req.data_file || fseeko(chunk->req.data_file, chunk->offset, SEEK_SET) != 0)
+    {
+        perror_msg("Can't open '%s'", filename);
+        return false;
+    }
+    chunk->req.data_left = chunk->length;
+
+    CURL *handle = chunk->req.handle;
+    xcurl_easy_setopt_long(handle, CURLOPT_UPLOAD, 1);
+    xcurl_easy_setopt_off_t(handle, CURLOPT_INFILESIZE_LARGE, chunk->length);
+    xcurl_easy_setopt_ptr(handle, CURLOPT_READFUNCTION, (const void*)fread_chunk);
+    xcurl_easy_setopt_ptr(handle, CURLOPT_READDATA, &chunk->req);
+    xcurl_easy_setopt_ptr(handle, CURLOPT_PRIVATE, chunk);
+
+    log_debug("Sending chunk %u (%s)", chunk->index, chunk->sha1);
+    clock_gettime(CLOCK_MONOTONIC, &chunk->started);
+    return true;
+}
+
+/* Loads the journal and marks the chunks it records as sent. A journal of
+ * a different file, URL or chunk size is started again.
+ *
+ * Journal format:
+ *   <file size> <file mtime> <chunk size> <URL>
+ *   <index of sent chunk> <SHA-1 of the chunk>
+ *   ...
+ */
+static int upload_journal_open(const char *path, const char *url,
+                const struct stat *st, off_t chunk_size,
+                bool *sent, unsigned count)
+{
+    int fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        perror_msg("Can't open upload journal '%s', the upload can't be resumed", path);
+        return -1;
+    }
+
+    char *header = xasprintf("%llu %lld %llu %s\n",
+                (unsigned long long)st->st_size,
+                (long long)st->st_mtime,
+                (unsigned long long)chunk_size,
+                url);
+
+    char *journal = xmalloc_read(fd, NULL);
+    if (journal && prefixcmp(journal, header) == 0)
+    {
+        unsigned resumed = 0;
+        char *line = journal + strlen(header);
+        char *eol;
+        /* A torn last line (crash) has no '\n' and is ignored */
+        while ((eol = strchr(line, '\n')) != NULL)
+        {
+            *eol = '\0';
+            unsigned index;
+            if (sscanf(line, "%u ", &index) == 1 && index < count && !sent[index])
+            {
+                sent[index] = true;
+                ++resumed;
+            }
+            line = eol + 1;
+        }
+        if (resumed)
+            log(_("Resuming upload, %u of %u chunks were already sent"), resumed, count);
+    }
+    else if (ftruncate(fd, 0) != 0 || full_write(fd, header, strlen(header)) < 0)
+    {
+        perror_msg("Can't write upload journal '%s'", path);
+        close(fd);
+        fd = -1;
+    }
+
+    free(journal);
+    free(header);
+    return fd;
+}
+
+static void upload_journal_record(int fd, const struct upload_chunk *chunk)
+{
+    if (fd < 0)
+        return;
+
+    /* A single write, so that a crash leaves at most a torn last line */
+    char *line = xasprintf("%u %s\n", chunk->index, chunk->sha1);
+    if (full_write(fd, line, strlen(line)) < 0 || fdatasync(fd) != 0)
+        perror_msg("Can't write upload journal");
+    free(line);
+}
+
+/* Unlike whole file uploads, HTTP errors are failures. The results of
+ * a failed chunk are stored in state the way post() does it. 308 is
+ * "Resume Incomplete" of resumable upload servers.
+ */
+static bool upload_chunk_failed(const post_state_t *chunk_state, post_state_t *state)
+{
+    const int code = chunk_state->http_resp_code;
+    if (chunk_state->curl_result == 0 && ((code >= 200 && code < 300) || code == 308))
+        return false;
+
+    state->curl_result = chunk_state->curl_result;
+    state->http_resp_code = code;
+    free(state->curl_error_msg);
+    state->curl_error_msg = xstrdup(chunk_state->curl_error_msg);
+
+    if (state->curl_result == 0)
+    {
+        state->curl_result = (code == 401 || code == 403) ? CURLE_LOGIN_DENIED : CURLE_HTTP_RETURNED_ERROR;
+        free(state->curl_error_msg);
+        state->curl_error_msg = xasprintf("HTTP code %d", code);
+    }
+    return true;
+}
+
+/* @return true if the server confirmed it accepts ranges by 308 or by
+ * "Accept-Ranges: bytes" */
+static bool upload_chunk_ranges_accepted(post_state_t *chunk_state)
+{
+    if (chunk_state->http_resp_code == 308)
+        return true;
+
+    const char *ranges = find_header_in_post_state(chunk_state, "Accept-Ranges:");
+    return ranges && strstr(ranges, "bytes");
+}
+
+/* Sends filename in chunks by PUT requests with Content-Range, results are
+ * stored in state like post() does it. Chunks which were sent according to
+ * the journal are skipped.
+ *
+ * A server which ignores Content-Range would store every chunk as the whole
+ * file. Hence the first chunk is sent alone and the rest follows only if
+ * the server confirms it accepts ranges.
+ *
+ * @return false if the server doesn't accept ranges and the file has to be
+ * sent at once, true otherwise (also on failures)
+ */
+static bool upload_chunks(post_state_t *state, const char *url, const char *filename,
+                const struct upload_chunked_options *options)
+{
+    state->curl_result = state->http_resp_code = -1;
+
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        perror_msg("Can't open '%s'", filename);
+        if (fd >= 0)
+            close(fd);
+        return true;
+    }
+
+    const off_t chunk_size = options->uco_chunk_size;
+    const unsigned count = MAX((st.st_size + chunk_size - 1) / chunk_size, 1);
+    bool *sent = xzalloc(count * sizeof(sent[0]));
+
+    int journal_fd = -1;
+    if (options->uco_journal)
+        journal_fd = upload_journal_open(options->uco_journal, url, &st, chunk_size, sent, count);
+
+    off_t sent_bytes = 0;
+    for (unsigned i = 0; i < count; ++i)
+        if (sent[i])
+            sent_bytes += MIN(chunk_size, st.st_size - (off_t)i * chunk_size);
+
+    CURLM *multi = curl_multi_init();
+    if (!multi)
+        error_msg_and_die("Can't create curl multi handle");
+
+    const unsigned parallel = MAX(options->uco_parallel, 1);
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, (long)CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)parallel);
+
+    GList *proxy_list = get_proxy_list(url);
+    if (proxy_list)
+        log_notice("Connecting to %s (using proxy server %s)", url, (const char *)proxy_list->data);
+    else
+        log_notice("Connecting to %s", url);
+
+    struct upload_chunk *chunks = xzalloc(parallel * sizeof(chunks[0]));
+    unsigned *attempts = xzalloc(count * sizeof(attempts[0]));
+    GList *queue = NULL;
+    for (unsigned i = 0; i < count; ++i)
+        if (!sent[i])
+            queue = g_list_prepend(queue, GUINT_TO_POINTER(i));
+    queue = g_list_reverse(queue);
+
+    /* The chunks in the journal were accepted by a server which confirmed
+     * ranges; otherwise the first chunk goes alone, then up to parallel at
+     * once */
+    bool ranges_accepted = sent_bytes > 0;
+    bool ranges_unsupported = false;
+    unsigned window = ranges_accepted ? parallel : 1;
+    unsigned running = 0;
+    bool failed = false;
+    while (!failed && (queue || running))
+    {
+        for (unsigned i = 0; i < window && queue; ++i)
+        {
+            struct upload_chunk *chunk = &chunks[i];
+            if (chunk->req.handle)
+                continue;
+
+            const unsigned index = GPOINTER_TO_UINT(queue->data);
+            queue = g_list_delete_link(queue, queue);
+            chunk->index = index;
+            chunk->offset = (off_t)index * chunk_size;
+            chunk->length = MIN(chunk_size, st.st_size - chunk->offset);
+
+            if (!upload_chunk_start(chunk, state, url, filename, fd, st.st_size))
+            {
+                post_request_cleanup(&chunk->req);
+                memset(&chunk->req, 0, sizeof(chunk->req));
+                state->curl_result = -1;
+                failed = true;
+                break;
+            }
+
+            if (proxy_list)
+                xcurl_easy_setopt_ptr(chunk->req.handle, CURLOPT_PROXY, proxy_list->data);
+            CURLMcode mc = curl_multi_add_handle(multi, chunk->req.handle);
+            if (mc != CURLM_OK)
+                error_msg_and_die("curl_multi_add_handle: %s", curl_multi_strerror(mc));
+            ++running;
+        }
+
+        int still_running = 0;
+        CURLMcode mc = curl_multi_perform(multi, &still_running);
+        if (mc == CURLM_OK && still_running)
+            mc = curl_multi_wait(multi, NULL, 0, 1000, NULL);
+        if (mc != CURLM_OK)
+        {
+            error_msg("curl_multi_perform: %s", curl_multi_strerror(mc));
+            failed = true;
+            break;
+        }
+
+        int msgs_left;
+        CURLMsg *msg;
+        while ((msg = curl_multi_info_read(multi, &msgs_left)) != NULL)
+        {
+            if (msg->msg != CURLMSG_DONE)
+                continue;
+
+            struct upload_chunk *chunk = NULL;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&chunk);
+            post_request_finish(&chunk->req, msg->data.result);
+            curl_multi_remove_handle(multi, chunk->req.handle);
+            post_request_cleanup(&chunk->req);
+            memset(&chunk->req, 0, sizeof(chunk->req));
+            --running;
+
+            if (failed)
+                continue;
+
+            if (upload_chunk_failed(chunk->state, state))
+            {
+                if (++attempts[chunk->index] < UPLOAD_CHUNK_ATTEMPTS
+                    && state->curl_result != CURLE_LOGIN_DENIED)
+                {
+                    log_warning(_("Failed to upload chunk %u of %u, retrying"), chunk->index + 1, count);
+                    METRIC_INC(http_retries);
+                    queue = g_list_prepend(queue, GUINT_TO_POINTER(chunk->index));
+                    continue;
+                }
+                failed = true;
+                continue;
+            }
+
+            if (!ranges_accepted)
+            {
+                if (!upload_chunk_ranges_accepted(chunk->state))
+                {
+                    log_notice("The server doesn't accept ranges, sending '%s' at once", filename);
+                    ranges_unsupported = failed = true;
+                    continue;
+                }
+                ranges_accepted = true;
+                window = parallel;
+            }
+
+            upload_journal_record(journal_fd, chunk);
+            sent_bytes += chunk->length;
+
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            double seconds = (now.tv_sec - chunk->started.tv_sec)
+                           + (now.tv_nsec - chunk->started.tv_nsec) / 1e9;
+            log(_("Uploaded: %llu of %llu kbytes (chunk %u of %u, %.0f kbytes/s)"),
+                    (unsigned long long)sent_bytes / 1024,
+                    (unsigned long long)st.st_size / 1024,
+                    chunk->index + 1, count,
+                    seconds > 0 ? chunk->length / 1024 / seconds : 0.0);
+        }
+    }
+
+    for (unsigned i = 0; i < parallel; ++i)
+    {
+        if (chunks[i].req.handle)
+        {
+            curl_multi_remove_handle(multi, chunks[i].req.handle);
+            post_request_cleanup(&chunks[i].req);
+        }
+        free_post_state(chunks[i].state);
+    }
+    free(chunks);
+    free(attempts);
+    g_list_free(queue);
+    list_free_with_free(proxy_list);
+    curl_multi_cleanup(multi);
+
+    if (journal_fd >= 0)
+    {
+        close(journal_fd);
+        /* Nothing to resume */
+        if (!failed || ranges_unsupported)
+            unlink(options->uco_journal);
+    }
+    else if (failed && !ranges_unsupported && options->uco_journal)
+        log_warning(_("The upload can't be resumed"));
+
+    if (!failed)
+    {
+        state->curl_result = 0;
+        state->http_resp_code = 200;
+        free(state->curl_error_msg);
+        state->curl_error_msg = NULL;
+    }
+
+    free(sent);
+    close(fd);
+
+    return !ranges_unsupported;
+}
+
 /* Unlike post_file(),
  * this function will use PUT, not POST if url is "http(s)://..."
  */
@@ -602,7 +1811,12 @@ char *upload_file(const char *url, const char *filename)
     return retval;
 }
 
-char *upload_file_ext(post_state_t *state, const char *url, const char *filename, int flags)
+/* Uploads data read from a file or a stream, data_size is
+ * POST_DATA_FROMFILE_PUT or POST_DATA_FROMSTREAM_PUT.
+ */
+static char *upload_ext(post_state_t *state, const char *url, const char *filename,
+                const char *data, off_t data_size,
+                const struct upload_chunked_options *chunked, int flags)
 {
     /* we don't want to print the whole url as it may contain password
      * rhbz#856960
@@ -664,13 +1878,14 @@ char *upload_file_ext(post_state_t *state, const char *url, const char *filename
     /* Do not include the path part of the URL as it can contain sensitive data
      * in case of typos */
     log(_("Sending %s to %s//%s"), filename, scheme, hostname);
-    post(state,
+    if (!chunked || !upload_chunks(state, whole_url, filename, chunked))
+        post(state,
                 whole_url,
                 /*content_type:*/ "application/octet-stream",
                 /*additional_headers:*/ NULL,
-                /*data:*/ filename,
-                POST_DATA_FROMFILE_PUT
-    );
+                data,
+                data_size
+        );
 
     dup2(stdin_bck, 0);
 
@@ -733,3 +1948,29 @@ finito:
 
     return whole_url;
 }
+
+char *upload_file_ext(post_state_t *state, const char *url, const char *filename, int flags)
+{
+    return upload_ext(state, url, filename, filename, POST_DATA_FROMFILE_PUT, NULL, flags);
+}
+
+char *upload_stream_ext(post_state_t *state, const char *url, const struct post_stream *stream, int flags)
+{
+    return upload_ext(state, url, stream->ps_name, (const char *)stream, POST_DATA_FROMSTREAM_PUT, NULL, flags);
+}
+
+char *upload_file_chunked(post_state_t *state, const char *url, const char *filename,
+                const struct upload_chunked_options *options, int flags)
+{
+    /* Content-Range is HTTP only, files smaller than a chunk gain nothing */
+    struct stat st;
+    if (options->uco_chunk_size <= 0
+        || (prefixcmp(url, "http://") != 0 && prefixcmp(url, "https://") != 0)
+        || (stat(filename, &st) == 0 && st.st_size <= options->uco_chunk_size))
+    {
+        log_debug("Not uploading '%s' in chunks", filename);
+        return upload_file_ext(state, url, filename, flags);
+    }
+
+    return upload_ext(state, url, filename, filename, POST_DATA_FROMFILE_PUT, options, flags);
+}
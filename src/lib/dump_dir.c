@@ -19,6 +19,8 @@
 #include <sys/utsname.h>
 #include <libtar.h>
 #include "internal_libreport.h"
+#include "trace.h"
+#include "metrics.h"
 
 // Locking logic:
 //
@@ -419,7 +421,7 @@ static const char *dd_check(struct dump_dir *dd)
     return NULL;
 }
 
-static int dd_lock(struct dump_dir *dd, unsigned sleep_usec, int flags)
+static int dd_do_lock(struct dump_dir *dd, unsigned sleep_usec, int flags)
 {
     if (dd->locked)
         error_msg_and_die("Locking bug on '%s'", dd->dd_dirname);
@@ -481,6 +483,16 @@ static int dd_lock(struct dump_dir *dd, unsigned sleep_usec, int flags)
     return 0;
 }
 
+static int dd_lock(struct dump_dir *dd, unsigned sleep_usec, int flags)
+{
+    TRACE_BEGIN(dd_lock);
+    METRIC_TIMER_BEGIN(dump_dir_lock_wait);
+    const int r = dd_do_lock(dd, sleep_usec, flags);
+    METRIC_TIMER_END(dump_dir_lock_wait);
+    TRACE_END(dd_lock, dd->dd_dirname);
+    return r;
+}
+
 static void dd_unlock(struct dump_dir *dd)
 {
     if (dd->locked)
@@ -527,6 +539,8 @@ void dd_close(struct dump_dir *dd)
     if (!dd)
         return;
 
+    TRACE_BEGIN(dd_close);
+
     dd_unlock(dd);
 
     if (dd->dd_fd >= 0)
@@ -536,6 +550,10 @@ void dd_close(struct dump_dir *dd)
 
     dd_clear_next_file(dd);
 
+    reported_to_index_free(dd->dd_reported_to);
+
+    TRACE_END(dd_close, dd->dd_dirname);
+
     free(dd->dd_type);
     free(dd->dd_dirname);
     free(dd);
@@ -1072,8 +1090,11 @@ struct dump_dir *dd_fdopendir(struct dump_dir *dd, int flags)
 
 struct dump_dir *dd_opendir(const char *dir, int flags)
 {
+    TRACE_BEGIN(dd_opendir);
     struct dump_dir *dd = dd_init();
-    return dd_do_open(dd, dir, flags);
+    dd = dd_do_open(dd, dir, flags);
+    TRACE_END(dd_opendir, dir);
+    return dd;
 }
 
 /* Create a fresh empty debug dump dir which is owned bu the calling user. If
@@ -1785,6 +1806,8 @@ static int create_new_file_at(int dir_fd, int omode, const char *name, uid_t uid
 
 static bool save_binary_file_at(int dir_fd, const char *name, const char* data, unsigned size, uid_t uid, gid_t gid, mode_t mode)
 {
+    TRACE_BEGIN(dd_save);
+
     const int fd = create_new_file_at(dir_fd, O_WRONLY, name, uid, gid, mode);
     if (fd < 0)
         goto fail;
@@ -1794,9 +1817,11 @@ static bool save_binary_file_at(int dir_fd, const char *name, const char* data,
     if (r != size)
         goto fail;
 
+    TRACE_END(dd_save, name);
     return true;
 
 fail:
+    TRACE_END(dd_save, name);
     error_msg("Can't save file '%s'", name);
     return false;
 
@@ -1807,6 +1832,8 @@ char* dd_load_text_ext(const struct dump_dir *dd, const char *name, unsigned fla
 //    if (!dd->locked)
 //        error_msg_and_die("dump_dir is not opened"); /* bug */
 
+    TRACE_BEGIN(dd_load_text);
+
     if (!dd_validate_element_name(name))
     {
         error_msg("Cannot load text. '%s' is not a valid file name", name);
@@ -1820,7 +1847,9 @@ char* dd_load_text_ext(const struct dump_dir *dd, const char *name, unsigned fla
     if (strcmp(name, "release") == 0)
         name = FILENAME_OS_RELEASE;
 
-    return load_text_file_at(dd->dd_fd, name, flags);
+    char *text = load_text_file_at(dd->dd_fd, name, flags);
+    TRACE_END(dd_load_text, name);
+    return text;
 }
 
 char* dd_load_text(const struct dump_dir *dd, const char *name)
@@ -2121,16 +2150,41 @@ int dd_get_next_file(struct dump_dir *dd, char **short_name, char **full_name)
 
 /* reported_to handling */
 
+/* The index is created on demand and kept until dd_close() */
+static struct reported_to_index *dd_get_reported_to_index(struct dump_dir *dd)
+{
+    if (dd->dd_reported_to == NULL)
+        dd->dd_reported_to = reported_to_index_new();
+
+    return dd->dd_reported_to;
+}
+
+/* Returns true if the line was added, false if it was already there */
+static bool dd_append_reported_to(struct dump_dir *dd, const char *line)
+{
+    const int r = reported_to_index_append(dd_get_reported_to_index(dd), dd->dd_fd, line);
+    if (r == -ENOENT)
+    {
+        /* The first line, the file gets the ownership and mode of dd */
+        char *reported_to = xasprintf("%s\n", line);
+        dd_save_text(dd, FILENAME_REPORTED_TO, reported_to);
+        free(reported_to);
+        return true;
+    }
+
+    if (r < 0)
+        error_msg("Can't add '%s' to '%s': %s", line, FILENAME_REPORTED_TO, strerror(-r));
+
+    return r > 0;
+}
+
 void add_reported_to(struct dump_dir *dd, const char *line)
 {
     if (!dd->locked)
         error_msg_and_die("dump_dir is not opened"); /* bug */
 
-    char *reported_to = dd_load_text_ext(dd, FILENAME_REPORTED_TO, DD_FAIL_QUIETLY_ENOENT | DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE);
-    if (add_reported_to_data(&reported_to, line))
-        dd_save_text(dd, FILENAME_REPORTED_TO, reported_to);
-
-    free(reported_to);
+    if (dd_append_reported_to(dd, line))
+        METRIC_INC(reports);
 }
 
 void add_reported_to_entry(struct dump_dir *dd, struct report_result *result)
@@ -2138,24 +2192,27 @@ void add_reported_to_entry(struct dump_dir *dd, struct report_result *result)
     if (!dd->locked)
         error_msg_and_die("dump_dir is not opened"); /* bug */
 
-    char *reported_to = dd_load_text_ext(dd, FILENAME_REPORTED_TO, DD_FAIL_QUIETLY_ENOENT | DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE);
-    if (add_reported_to_entry_data(&reported_to, result))
-        dd_save_text(dd, FILENAME_REPORTED_TO, reported_to);
+    char *line = format_reported_to_entry(result);
+    if (line == NULL)
+        return;
 
-    free(reported_to);
+    if (dd_append_reported_to(dd, line))
+        METRIC_INC(reports);
+    free(line);
 }
 
 report_result_t *find_in_reported_to(struct dump_dir *dd, const char *report_label)
 {
-    char *reported_to = dd_load_text_ext(dd, FILENAME_REPORTED_TO,
-                DD_FAIL_QUIETLY_ENOENT | DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE);
-    if (!reported_to)
+    struct reported_to_index *index = dd_get_reported_to_index(dd);
+    const int r = reported_to_index_update(index, dd->dd_fd);
+    if (r != 0)
+    {
+        if (r != -ENOENT)
+            error_msg("Can't read '%s': %s", FILENAME_REPORTED_TO, strerror(-r));
         return NULL;
+    }
 
-    report_result_t *result = find_in_reported_to_data(reported_to, report_label);
-
-    free(reported_to);
-    return result;
+    return reported_to_index_find(index, report_label);
 }
 
 GList *read_entire_reported_to(struct dump_dir *dd)
@@ -2406,12 +2463,12 @@ int dd_copy_file_unpack(struct dump_dir *dd, const char *name, const char *sourc
 }
 
 /* flags - for future needs */
-int dd_create_archive(struct dump_dir *dd, const char *archive_name,
-        const_string_vector_const_ptr_t exclude_elements, int flags)
+/* Writes .tar.gz archive to archive_fd, or to a new file archive_name if
+ * archive_fd is negative.
+ */
+static int dd_gzip_archive(struct dump_dir *dd, const char *archive_name, int archive_fd,
+        const_string_vector_const_ptr_t exclude_elements)
 {
-    if (suffixcmp(archive_name, ".tar.gz") != 0)
-        return -ENOSYS;
-
     int result = 0;
     pid_t child;
     TAR* tar = NULL;
@@ -2431,7 +2488,9 @@ int dd_create_archive(struct dump_dir *dd, const char *archive_name,
         close(pipe_from_parent_to_child[1]);
         xmove_fd(pipe_from_parent_to_child[0], 0);
 
-        int fd = open(archive_name, O_WRONLY | O_CREAT | O_EXCL, 0600);
+        int fd = archive_fd;
+        if (fd < 0)
+            fd = open(archive_name, O_WRONLY | O_CREAT | O_EXCL, 0600);
         if (fd < 0)
         {
             /* This r might interfer with exit status of gzip, but it is
@@ -2444,7 +2503,8 @@ int dd_create_archive(struct dump_dir *dd, const char *archive_name,
             exit(result);
         }
 
-        xmove_fd(fd, 1);
+        if (fd != 1)
+            xmove_fd(fd, 1);
         execlp("gzip", "gzip", NULL);
         perror_msg_and_die("Can't execute '%s'", "gzip");
     }
@@ -2521,6 +2581,21 @@ finito:
     return result;
 }
 
+int dd_create_archive(struct dump_dir *dd, const char *archive_name,
+        const_string_vector_const_ptr_t exclude_elements, int flags)
+{
+    if (suffixcmp(archive_name, ".tar.gz") != 0)
+        return -ENOSYS;
+
+    return dd_gzip_archive(dd, archive_name, /*create archive_name*/-1, exclude_elements);
+}
+
+int dd_write_archive(struct dump_dir *dd, int fd,
+        const_string_vector_const_ptr_t exclude_elements, int flags)
+{
+    return dd_gzip_archive(dd, "problem.tar.gz", fd, exclude_elements);
+}
+
 off_t dd_copy_fd(struct dump_dir *dd, const char *name, int fd, int copy_flags, off_t maxsize)
 {
     if (!dd_validate_element_name(name))
@@ -0,0 +1,444 @@
+/*
+    Copyright (C) 2026  ABRT team
+    Copyright (C) 2026  RedHat Inc
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <sys/file.h>
+
+#include "internal_libreport.h"
+#include "dup_search_cache.h"
+
+/* A file holds searches for one duphash, anything bigger is not ours */
+#define DUP_SEARCH_CACHE_MAX_FILE_SIZE (64 * 1024)
+
+#define DUP_SEARCH_CACHE_LOCK ".lock"
+#define DUP_SEARCH_CACHE_STATS "stats"
+
+struct dup_search_cache
+{
+    char *dsc_dir;
+    char *dsc_tracker;
+    unsigned dsc_ttl;
+    /* Counted by this process, for the log */
+    unsigned dsc_hits;
+    unsigned dsc_misses;
+    /* Not yet added to the stats file, lookups don't take the lock */
+    unsigned dsc_pending_hits;
+    unsigned dsc_pending_misses;
+};
+
+static char *cache_dir_path(void)
+{
+    const char *dir = getenv("LIBREPORT_DEBUG_DUP_SEARCH_CACHE_DIR");
+    if (dir != NULL)
+        return xstrdup(dir);
+
+    if (geteuid() == 0)
+        return xstrdup(DUP_SEARCH_CACHE_DIR);
+
+    return concat_path_file(g_get_user_cache_dir(), "libreport/dup-search");
+}
+
+dup_search_cache_t *dup_search_cache_open(const char *tracker_url, unsigned ttl)
+{
+    if (ttl == 0)
+        return NULL;
+
+    char *dir = cache_dir_path();
+    /* Planted results could redirect reports to somebody else's bug */
+    if (!create_private_cache_dir(dir, 022))
+    {
+        log_debug("Duplicate search cache disabled");
+        free(dir);
+        return NULL;
+    }
+
+    dup_search_cache_t *cache = xzalloc(sizeof(*cache));
+    cache->dsc_dir = dir;
+    cache->dsc_tracker = xstrdup(tracker_url);
+    cache->dsc_ttl = ttl;
+
+    return cache;
+}
+
+static int cache_lock(dup_search_cache_t *cache)
+{
+    char *path = concat_path_file(cache->dsc_dir, DUP_SEARCH_CACHE_LOCK);
+    int fd = open(path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0)
+        log_debug("Can't open '%s': %s", path, strerror(errno));
+    else if (flock(fd, LOCK_EX) != 0)
+    {
+        log_debug("Can't lock '%s': %s", path, strerror(errno));
+        close(fd);
+        fd = -1;
+    }
+    free(path);
+    return fd;
+}
+
+static void cache_unlock(int lock_fd)
+{
+    if (lock_fd < 0)
+        return;
+
+    flock(lock_fd, LOCK_UN);
+    close(lock_fd);
+}
+
+/* Lookups read the files without locking, never expose a partially
+ * written one */
+static bool cache_write_file(const char *path, const char *data, size_t size)
+{
+    char *tmp = xasprintf("%s.XXXXXX", path);
+    int fd = mkstemp(tmp);
+    if (fd < 0)
+    {
+        log_debug("Can't create '%s': %s", tmp, strerror(errno));
+        free(tmp);
+        return false;
+    }
+
+    const bool ok = full_write(fd, data, size) == (ssize_t)size;
+    close(fd);
+
+    if (!ok || rename(tmp, path) != 0)
+    {
+        log_debug("Can't write '%s': %s", path, strerror(errno));
+        unlink(tmp);
+        free(tmp);
+        return false;
+    }
+
+    free(tmp);
+    return true;
+}
+
+static char *cache_read_file(const char *path)
+{
+    int fd = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+
+    char *data = NULL;
+    struct stat sb;
+    if (fstat(fd, &sb) == 0
+        && S_ISREG(sb.st_mode)
+        && sb.st_uid == geteuid()
+        && sb.st_size <= DUP_SEARCH_CACHE_MAX_FILE_SIZE)
+    {
+        data = xmalloc(sb.st_size + 1);
+        ssize_t r = full_read(fd, data, sb.st_size);
+        if (r < 0)
+        {
+            free(data);
+            data = NULL;
+        }
+        else
+            data[r] = '\0';
+    }
+    else
+        log_debug("Ignoring duplicate search cache file '%s'", path);
+
+    close(fd);
+    return data;
+}
+
+/* Every counter is a line "<name> <value>" */
+static void cache_read_stats(dup_search_cache_t *cache, struct dup_search_cache_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+    char *path = concat_path_file(cache->dsc_dir, DUP_SEARCH_CACHE_STATS);
+    char *data = cache_read_file(path);
+    free(path);
+    if (data == NULL)
+        return;
+
+    for (char *line = data; *line != '\0'; )
+    {
+        char *end = strchrnul(line, '\n');
+        const bool last = *end == '\0';
+        *end = '\0';
+
+        char name[32];
+        unsigned long value;
+        if (sscanf(line, "%31s %lu", name, &value) == 2)
+        {
+            if (strcmp(name, "hits") == 0)
+                stats->dscs_hits = value;
+            else if (strcmp(name, "misses") == 0)
+                stats->dscs_misses = value;
+            else if (strcmp(name, "stores") == 0)
+                stats->dscs_stores = value;
+            else if (strcmp(name, "invalidations") == 0)
+                stats->dscs_invalidations = value;
+        }
+
+        if (last)
+            break;
+        line = end + 1;
+    }
+
+    free(data);
+}
+
+/* Adds the pending lookups too, must be called with the lock held */
+static void cache_update_stats(dup_search_cache_t *cache, unsigned long stores, unsigned long invalidations)
+{
+    struct dup_search_cache_stats stats;
+    cache_read_stats(cache, &stats);
+
+    char *data = xasprintf("hits %lu\nmisses %lu\nstores %lu\ninvalidations %lu\n",
+                           stats.dscs_hits + cache->dsc_pending_hits,
+                           stats.dscs_misses + cache->dsc_pending_misses,
+                           stats.dscs_stores + stores,
+                           stats.dscs_invalidations + invalidations);
+
+    char *path = concat_path_file(cache->dsc_dir, DUP_SEARCH_CACHE_STATS);
+    if (cache_write_file(path, data, strlen(data)))
+    {
+        cache->dsc_pending_hits = 0;
+        cache->dsc_pending_misses = 0;
+    }
+    free(path);
+    free(data);
+}
+
+bool dup_search_cache_get_stats(dup_search_cache_t *cache, struct dup_search_cache_stats *stats)
+{
+    if (!cache)
+        return false;
+
+    cache_read_stats(cache, stats);
+    stats->dscs_hits += cache->dsc_pending_hits;
+    stats->dscs_misses += cache->dsc_pending_misses;
+    return true;
+}
+
+void dup_search_cache_close(dup_search_cache_t *cache)
+{
+    if (!cache)
+        return;
+
+    if (cache->dsc_pending_hits + cache->dsc_pending_misses > 0)
+    {
+        int lock_fd = cache_lock(cache);
+        if (lock_fd >= 0)
+        {
+            cache_update_stats(cache, 0, 0);
+            cache_unlock(lock_fd);
+        }
+    }
+
+    if (cache->dsc_hits + cache->dsc_misses > 0)
+    {
+        struct dup_search_cache_stats stats;
+        if (dup_search_cache_get_stats(cache, &stats))
+        {
+            const unsigned long total = stats.dscs_hits + stats.dscs_misses;
+            log_info("Duplicate search cache: %u hits, %u misses, overall hit rate %lu%% of %lu searches",
+                     cache->dsc_hits, cache->dsc_misses,
+                     total ? stats.dscs_hits * 100 / total : 0, total);
+        }
+    }
+
+    free(cache->dsc_tracker);
+    free(cache->dsc_dir);
+    free(cache);
+}
+
+static char *cache_file_path(dup_search_cache_t *cache, const char *duphash)
+{
+    char *key = xasprintf("%s\n%s", cache->dsc_tracker, duphash);
+    char sha1[SHA1_RESULT_LEN*2 + 1];
+    char *path = concat_path_file(cache->dsc_dir, str_to_sha1str(sha1, key));
+    free(key);
+    return path;
+}
+
+/* NULL and "" are different searches */
+static void cache_search_key(char *sha1, const char *product, const char *version, const char *component)
+{
+    char *key = xasprintf("%c%s\n%c%s\n%c%s",
+                          product ? '+' : '-', product ? product : "",
+                          version ? '+' : '-', version ? version : "",
+                          component ? '+' : '-', component ? component : "");
+    str_to_sha1str(sha1, key);
+    free(key);
+}
+
+/* Splits "<key> <time> <ids>" of line, which is modified */
+static bool cache_parse_line(char *line, char **key, time_t *stored, char **ids)
+{
+    char *time_str = strchr(line, ' ');
+    if (time_str == NULL)
+        return false;
+    *time_str++ = '\0';
+
+    char *ids_str = strchr(time_str, ' ');
+    if (ids_str == NULL)
+        return false;
+    *ids_str++ = '\0';
+
+    char *end;
+    errno = 0;
+    long long t = strtoll(time_str, &end, 10);
+    if (errno || end == time_str || *end != '\0')
+        return false;
+
+    *key = line;
+    *stored = t;
+    *ids = ids_str;
+    return true;
+}
+
+static bool cache_is_fresh(dup_search_cache_t *cache, time_t stored, time_t now)
+{
+    /* Entries from future come from a wrong clock, do not trust them */
+    return stored <= now && now - stored < (time_t)cache->dsc_ttl;
+}
+
+bool dup_search_cache_lookup(dup_search_cache_t *cache, const char *product,
+                             const char *version, const char *component,
+                             const char *duphash, GList **ids)
+{
+    if (!cache)
+        return false;
+
+    char key[SHA1_RESULT_LEN*2 + 1];
+    cache_search_key(key, product, version, component);
+
+    char *path = cache_file_path(cache, duphash);
+    char *data = cache_read_file(path);
+    free(path);
+
+    bool hit = false;
+    const time_t now = time(NULL);
+    for (char *line = data; line != NULL && *line != '\0' && !hit; )
+    {
+        char *end = strchrnul(line, '\n');
+        char *next = *end != '\0' ? end + 1 : end;
+        *end = '\0';
+
+        char *line_key, *line_ids;
+        time_t stored;
+        if (cache_parse_line(line, &line_key, &stored, &line_ids)
+            && strcmp(line_key, key) == 0
+            && cache_is_fresh(cache, stored, now))
+        {
+            hit = true;
+            *ids = NULL;
+            if (strcmp(line_ids, "-") != 0)
+                *ids = parse_list(line_ids);
+        }
+
+        line = next;
+    }
+    free(data);
+
+    log_debug("Duplicate search cache %s for duphash '%s'", hit ? "hit" : "miss", duphash);
+
+    /* Written to the stats file by the next store, invalidation or close */
+    if (hit)
+    {
+        ++cache->dsc_hits;
+        ++cache->dsc_pending_hits;
+    }
+    else
+    {
+        ++cache->dsc_misses;
+        ++cache->dsc_pending_misses;
+    }
+
+    return hit;
+}
+
+void dup_search_cache_store(dup_search_cache_t *cache, const char *product,
+                            const char *version, const char *component,
+                            const char *duphash, GList *ids)
+{
+    if (!cache)
+        return;
+
+    char key[SHA1_RESULT_LEN*2 + 1];
+    cache_search_key(key, product, version, component);
+
+    int lock_fd = cache_lock(cache);
+    if (lock_fd < 0)
+        return;
+
+    char *path = cache_file_path(cache, duphash);
+    char *data = cache_read_file(path);
+
+    /* Keep the other fresh searches */
+    struct strbuf *content = strbuf_new();
+    const time_t now = time(NULL);
+    for (char *line = data; line != NULL && *line != '\0'; )
+    {
+        char *end = strchrnul(line, '\n');
+        char *next = *end != '\0' ? end + 1 : end;
+        *end = '\0';
+
+        char *line_key, *line_ids;
+        time_t stored;
+        if (cache_parse_line(line, &line_key, &stored, &line_ids)
+            && strcmp(line_key, key) != 0
+            && cache_is_fresh(cache, stored, now))
+        {
+            strbuf_append_strf(content, "%s %lld %s\n", line_key, (long long)stored, line_ids);
+        }
+
+        line = next;
+    }
+    free(data);
+
+    strbuf_append_strf(content, "%s %lld ", key, (long long)now);
+    if (ids == NULL)
+        strbuf_append_char(content, '-');
+    for (GList *id = ids; id != NULL; id = g_list_next(id))
+        strbuf_append_strf(content, "%s%s", (const char *)id->data, g_list_next(id) ? "," : "");
+    strbuf_append_char(content, '\n');
+
+    if (content->len <= DUP_SEARCH_CACHE_MAX_FILE_SIZE)
+        cache_write_file(path, content->buf, content->len);
+
+    cache_update_stats(cache, 1, 0);
+    cache_unlock(lock_fd);
+
+    strbuf_free(content);
+    free(path);
+}
+
+void dup_search_cache_invalidate(dup_search_cache_t *cache, const char *duphash)
+{
+    if (!cache)
+        return;
+
+    int lock_fd = cache_lock(cache);
+    if (lock_fd < 0)
+        return;
+
+    char *path = cache_file_path(cache, duphash);
+    if (unlink(path) == 0)
+        log_debug("Forgot duplicate searches for duphash '%s'", duphash);
+    else if (errno != ENOENT)
+        log_debug("Can't remove '%s': %s", path, strerror(errno));
+    free(path);
+
+    cache_update_stats(cache, 0, 1);
+    cache_unlock(lock_fd);
+}
@@ -15,6 +15,8 @@
     with this program; if not, write to the Free Software Foundation, Inc.,
     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 */
+#include <pthread.h>
+#include <sys/syscall.h>
 #include "internal_libreport.h"
 
 /* If s is a string with only printable ASCII chars
@@ -83,55 +85,88 @@ static char *append_escaped(char *start, const char *s)
     }
 }
 
-static char* get_escaped_at(int dir_fd, const char *name, char separator)
+/* Reads the whole file into the buffer, the previous content is dropped.
+ * A limit of 0 means no limit.
+ *
+ * @return 0 on success, -errno otherwise
+ */
+static int read_proc_file_at(int dir_fd, const char *name, struct strbuf *buf, size_t limit)
 {
-    char *escaped = NULL;
+    strbuf_clear(buf);
+
+    const int fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -errno;
 
-    int fd = openat(dir_fd, name, O_RDONLY);
-    if (fd >= 0)
+    int r = 0;
+    while (limit == 0 || (size_t)buf->len < limit)
     {
-        char *dst = NULL;
-        unsigned total_esc_len = 0;
-        while (total_esc_len < 1024 * 1024) /* paranoia check */
-        {
-            /* read and escape one block */
-            char buffer[4 * 1024 + 1];
-            int len = read(fd, buffer, sizeof(buffer) - 1);
-            if (len <= 0)
-                break;
-            buffer[len] = '\0';
-
-            /* string CC can expand into '\xNN\xNN' and thus needs len*4 + 3 bytes,
-             * including terminating NUL.
-             * We add +1 for possible \n added at the very end.
-             */
-            escaped = xrealloc(escaped, total_esc_len + len*4 + 4);
-            char *src = buffer;
-            dst = escaped + total_esc_len;
-            while (1)
-            {
-                /* escape till next NUL char */
-                char *d = append_escaped(dst, src);
-                total_esc_len += (d - dst);
-                dst = d;
-                src += strlen(src) + 1;
-                if ((src - buffer) >= len)
-                    break;
-                *dst++ = separator;
-            }
+        /* /proc files are read by pages */
+        if ((size_t)(buf->alloc - buf->len) < 4 * 1024 + 1)
+            strbuf_reserve(buf, buf->alloc * 2 + 4 * 1024);
 
-        }
+        size_t size = buf->alloc - buf->len - 1;
+        if (limit != 0 && size > limit - buf->len)
+            size = limit - buf->len;
 
-        if (dst)
+        const ssize_t len = read(fd, buf->buf + buf->len, size);
+        if (len < 0)
         {
-            if (separator == '\n')
-                *dst++ = separator;
-            *dst = '\0';
+            if (errno == EINTR)
+                continue;
+            r = -errno;
+            break;
         }
+        if (len == 0)
+            break;
+        buf->len += len;
+    }
 
-        close(fd);
+    buf->buf[buf->len] = '\0';
+    close(fd);
+    return r;
+}
+
+/* Escapes the NUL separated strings and joins them by the separator */
+static char *escape_strings(const char *data, size_t len, char separator)
+{
+    if (len == 0)
+        return NULL;
+
+    /* string CC can expand into '\xNN\xNN' and thus needs len*4 + 3 bytes,
+     * including terminating NUL.
+     * We add +1 for possible \n added at the very end.
+     */
+    char *escaped = xmalloc(len * 4 + 4);
+    char *dst = escaped;
+    const char *src = data;
+    while (1)
+    {
+        /* escape till next NUL char */
+        dst = append_escaped(dst, src);
+        src += strlen(src) + 1;
+        if ((size_t)(src - data) >= len)
+            break;
+        *dst++ = separator;
     }
 
+    if (separator == '\n')
+        *dst++ = separator;
+    *dst = '\0';
+
+    return escaped;
+}
+
+static char* get_escaped_at(int dir_fd, const char *name, char separator)
+{
+    struct strbuf *buf = strbuf_new();
+    char *escaped = NULL;
+
+    /* paranoia check */
+    if (read_proc_file_at(dir_fd, name, buf, 1024 * 1024) == 0)
+        escaped = escape_strings(buf->buf, buf->len, separator);
+
+    strbuf_free(buf);
     return escaped;
 }
 
@@ -239,12 +274,172 @@ int get_fsgid(const char *proc_pid_status)
     return get_proc_fs_id(proc_pid_status, /*GID*/'G');
 }
 
-int dump_fd_info_at(int pid_proc_fd, FILE *dest)
+/* Workers are started only for processes with more descriptors */
+#define FD_INFO_FDS_PER_WORKER 8192
+#define FD_INFO_MAX_WORKERS 8
+
+struct linux_dirent64
+{
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+/* Makes room for size more characters, grows the buffer exponentially */
+static void strbuf_reserve_more(struct strbuf *buf, size_t size)
+{
+    if ((size_t)(buf->alloc - buf->len) <= size)
+        strbuf_reserve(buf, (buf->len + size) * 2);
+}
+
+static int compare_fds(const void *lhs, const void *rhs)
+{
+    return *(const int *)lhs - *(const int *)rhs;
+}
+
+/* Lists the directory by getdents64() in 64 KiB blocks, readdir() would use
+ * 32 KiB ones and allocate a DIR.
+ *
+ * @return Number of descriptors or -errno, *fds is malloced and sorted
+ */
+static long list_fds_at(int proc_fd_dir_fd, int **fds)
+{
+    const size_t buf_size = 64 * 1024;
+    char *buf = xmalloc(buf_size);
+    size_t alloc = 0;
+    long count = 0;
+
+    *fds = NULL;
+    while (1)
+    {
+        const long len = syscall(SYS_getdents64, proc_fd_dir_fd, buf, buf_size);
+        if (len < 0)
+        {
+            count = -errno;
+            free(*fds);
+            *fds = NULL;
+            break;
+        }
+        if (len == 0)
+            break;
+
+        for (long pos = 0; pos < len; )
+        {
+            const struct linux_dirent64 *dent = (const struct linux_dirent64 *)(buf + pos);
+            pos += dent->d_reclen;
+
+            if (!isdigit(dent->d_name[0]))
+                continue;
+
+            if ((size_t)count == alloc)
+            {
+                alloc = alloc ? alloc * 2 : 256;
+                *fds = xrealloc(*fds, alloc * sizeof(**fds));
+            }
+            (*fds)[count++] = atoi(dent->d_name);
+        }
+    }
+
+    free(buf);
+
+    if (count > 0)
+        qsort(*fds, count, sizeof(**fds), compare_fds);
+
+    return count;
+}
+
+struct fd_info_range
+{
+    int fir_fd_dir_fd;          ///< /proc/[pid]/fd
+    int fir_fdinfo_dir_fd;      ///< /proc/[pid]/fdinfo
+    const int *fir_fds;
+    unsigned fir_count;
+    bool fir_first;             ///< the range starts the output
+    struct strbuf *fir_out;
+};
+
+/* Appends "fd:path" lines each followed by the content of fdinfo/fd, the
+ * blocks are delimited by empty lines. Both the link and the fdinfo file are
+ * read right into the output buffer.
+ */
+static void *dump_fd_info_range(void *param)
+{
+    struct fd_info_range *range = param;
+    struct strbuf *out = range->fir_out;
+
+    for (unsigned i = 0; i < range->fir_count; ++i)
+    {
+        char name[sizeof(int) * 3 + 2];
+        const int name_len = snprintf(name, sizeof(name), "%d", range->fir_fds[i]);
+
+        /* "\nFD:PATH\n" */
+        strbuf_reserve_more(out, name_len + PATH_MAX + 4);
+        char *p = out->buf + out->len;
+        if (i != 0 || !range->fir_first)
+            *p++ = '\n';
+        p = stpcpy(p, name);
+        *p++ = ':';
+        const ssize_t link_len = readlinkat(range->fir_fd_dir_fd, name, p, PATH_MAX);
+        /* the descriptor has been closed in the mean time */
+        if (link_len < 0)
+            p = stpcpy(p, "(null)");
+        else
+            p += link_len;
+        *p++ = '\n';
+        *p = '\0';
+        out->len = p - out->buf;
+
+        /* Use the directory entry from /proc/[pid]/fd with /proc/[pid]/fdinfo */
+        const int fd = openat(range->fir_fdinfo_dir_fd, name, O_NOFOLLOW | O_CLOEXEC | O_RDONLY);
+        if (fd < 0)
+            continue;
+
+        const int start = out->len;
+        while (1)
+        {
+            strbuf_reserve_more(out, 4 * 1024);
+            const ssize_t len = read(fd, out->buf + out->len, out->alloc - out->len - 1);
+            if (len < 0 && errno == EINTR)
+                continue;
+            if (len <= 0)
+                break;
+            out->len += len;
+        }
+        close(fd);
+
+        /* in case the last line is not terminated, terminate it */
+        if (out->len > start && out->buf[out->len - 1] != '\n')
+            out->buf[out->len++] = '\n';
+        out->buf[out->len] = '\0';
+    }
+
+    return NULL;
+}
+
+static unsigned fd_info_workers(unsigned count, unsigned workers)
+{
+    if (workers == 0)
+    {
+        const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = count / FD_INFO_FDS_PER_WORKER + 1;
+        if (cpus > 0 && workers > (unsigned long)cpus)
+            workers = cpus;
+    }
+
+    if (workers > FD_INFO_MAX_WORKERS)
+        workers = FD_INFO_MAX_WORKERS;
+    if (workers > count)
+        workers = count;
+
+    return workers ? workers : 1;
+}
+
+int dump_fd_info_bulk_at(int pid_proc_fd, struct strbuf *dest, unsigned max_fds, unsigned workers)
 {
-    DIR *proc_fd_dir = NULL;
     int proc_fdinfo_fd = -1;
-    const char *fddelim = "";
-    struct dirent *dent = NULL;
+    int *fds = NULL;
     int r = 0;
 
     int proc_fd_dir_fd = openat(pid_proc_fd, "fd", O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
@@ -254,73 +449,77 @@ int dump_fd_info_at(int pid_proc_fd, FILE *dest)
         goto dumpfd_cleanup;
     }
 
-    proc_fd_dir = fdopendir(proc_fd_dir_fd);
-    if (!proc_fd_dir)
+    proc_fdinfo_fd = openat(pid_proc_fd, "fdinfo", O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC | O_PATH);
+    if (proc_fdinfo_fd < 0)
     {
         r = -errno;
         goto dumpfd_cleanup;
     }
 
-    proc_fdinfo_fd = openat(pid_proc_fd, "fdinfo", O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC | O_PATH);
-    if (proc_fdinfo_fd < 0)
+    const long total = list_fds_at(proc_fd_dir_fd, &fds);
+    if (total < 0)
     {
-        r = -errno;
+        r = total;
         goto dumpfd_cleanup;
     }
 
-    while (1)
+    const unsigned count = (max_fds && (unsigned long)total > max_fds) ? max_fds : total;
+    workers = fd_info_workers(count, workers);
+
+    struct fd_info_range ranges[FD_INFO_MAX_WORKERS];
+    pthread_t threads[FD_INFO_MAX_WORKERS];
+    bool started[FD_INFO_MAX_WORKERS] = { false };
+    unsigned first = 0;
+    for (unsigned i = 0; i < workers; ++i)
     {
-        errno = 0;
-        dent = readdir(proc_fd_dir);
-        if (dent == NULL)
-        {
-            if (errno > 0)
-            {
-                r = -errno;
-                goto dumpfd_cleanup;
-            }
-            break;
-        }
-        else if (dot_or_dotdot(dent->d_name))
-            continue;
+        const unsigned size = count / workers + (i < count % workers);
+        ranges[i].fir_fd_dir_fd = proc_fd_dir_fd;
+        ranges[i].fir_fdinfo_dir_fd = proc_fdinfo_fd;
+        ranges[i].fir_fds = fds + first;
+        ranges[i].fir_count = size;
+        ranges[i].fir_first = (first == 0) && dest->len == 0;
+        /* the first range is appended right to the destination */
+        ranges[i].fir_out = i == 0 ? dest : strbuf_new();
+        first += size;
+
+        if (i != 0)
+            started[i] = pthread_create(&threads[i], NULL, dump_fd_info_range, &ranges[i]) == 0;
+    }
 
-        FILE *fdinfo = NULL;
-        char *fdname = NULL;
-        char line[LINE_MAX];
-        int fd;
+    dump_fd_info_range(&ranges[0]);
 
-        fdname = malloc_readlinkat(dirfd(proc_fd_dir), dent->d_name);
+    for (unsigned i = 1; i < workers; ++i)
+    {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+        else
+            dump_fd_info_range(&ranges[i]);
 
-        fprintf(dest, "%s%s:%s\n", fddelim, dent->d_name, fdname);
-        fddelim = "\n";
+        strbuf_append_strn(dest, ranges[i].fir_out->buf, ranges[i].fir_out->len);
+        strbuf_free(ranges[i].fir_out);
+    }
 
-        /* Use the directory entry from /proc/[pid]/fd with /proc/[pid]/fdinfo */
-        fd = openat(proc_fdinfo_fd, dent->d_name, O_NOFOLLOW|O_CLOEXEC|O_RDONLY);
-        if (fd < 0)
-            goto dumpfd_next_fd;
+    if (count < (unsigned long)total)
+        strbuf_append_strf(dest, "\n%lu more file descriptors are not listed\n", total - count);
 
-        fdinfo = fdopen(fd, "re");
-        if (fdinfo == NULL)
-            goto dumpfd_next_fd;
+dumpfd_cleanup:
+    free(fds);
+    if (proc_fd_dir_fd >= 0)
+        close(proc_fd_dir_fd);
+    if (proc_fdinfo_fd >= 0)
+        close(proc_fdinfo_fd);
 
-        while (fgets(line, sizeof(line)-1, fdinfo))
-        {
-            /* in case the line is not terminated, terminate it */
-            char *eol = strchrnul(line, '\n');
-            eol[0] = '\n';
-            eol[1] = '\0';
-            fputs(line, dest);
-        }
-        fclose(fdinfo);
+    return r;
+}
 
-dumpfd_next_fd:
-        free(fdname);
-    }
+int dump_fd_info_at(int pid_proc_fd, FILE *dest)
+{
+    struct strbuf *info = strbuf_new();
 
-dumpfd_cleanup:
-    closedir(proc_fd_dir);
-    close(proc_fdinfo_fd);
+    const int r = dump_fd_info_bulk_at(pid_proc_fd, info, /*no limit*/0, /*workers*/1);
+    fwrite(info->buf, 1, info->len, dest);
 
+    strbuf_free(info);
     return r;
 }
 
@@ -548,6 +747,20 @@ int dump_namespace_diff_ext(const char *dest_filename, pid_t base_pid, pid_t tes
     return r;
 }
 
+static void format_namespace_diff(const struct ns_ids *base_ids, const struct ns_ids *tested_ids,
+                                  struct strbuf *dest)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(libreport_proc_namespaces); ++i)
+    {
+        const char *status = "unknown";
+
+        if (base_ids->nsi_ids[i] != PROC_NS_UNSUPPORTED)
+            status = base_ids->nsi_ids[i] == tested_ids->nsi_ids[i] ? "default" : "own";
+
+        strbuf_append_strf(dest, "%s : %s\n", libreport_proc_namespaces[i], status);
+    }
+}
+
 int dump_namespace_diff_at(int base_pid_proc_fd, int tested_pid_proc_fd, FILE *dest)
 {
     struct ns_ids base_ids;
@@ -565,15 +778,10 @@ int dump_namespace_diff_at(int base_pid_proc_fd, int tested_pid_proc_fd, FILE *d
         return -2;
     }
 
-    for (size_t i = 0; i < ARRAY_SIZE(libreport_proc_namespaces); ++i)
-    {
-        const char *status = "unknown";
-
-        if (base_ids.nsi_ids[i] != PROC_NS_UNSUPPORTED)
-            status = base_ids.nsi_ids[i] == tested_ids.nsi_ids[i] ? "default" : "own";
-
-        fprintf(dest, "%s : %s\n", libreport_proc_namespaces[i], status);
-    }
+    struct strbuf *diff = strbuf_new();
+    format_namespace_diff(&base_ids, &tested_ids, diff);
+    fputs(diff->buf, dest);
+    strbuf_free(diff);
 
     return 0;
 }
@@ -761,7 +969,182 @@ get_mount_info_cleanup:
     return r;
 }
 
-static int proc_ns_eq(struct ns_ids *lhs_ids, struct ns_ids *rhs_ids, int neg)
+/* Terminates the word at *pos, a word ends with a space not preceded by
+ * a backslash like in _read_mountinfo_word().
+ *
+ * @return The word or NULL if *pos is behind the end of the line
+ */
+static char *mountinfo_split_word(char **pos, char *end_of_line)
+{
+    char *const word = *pos;
+    if (word > end_of_line)
+        return NULL;
+
+    char *p = word;
+    char pre_c = 0;
+    while (p < end_of_line && (pre_c == '\\' || *p != ' '))
+        pre_c = *p++;
+
+    *p = '\0';
+    *pos = p + 1;
+    return word;
+}
+
+static bool mountinfo_parse_line(char *line, char *end_of_line, struct mountinfo *mntnf)
+{
+    char *pos = line;
+    for (unsigned fn = 0; fn < ARRAY_SIZE(mntnf->mntnf_items); ++fn)
+    {
+        char *word = mountinfo_split_word(&pos, end_of_line);
+        if (word == NULL)
+            return false;
+
+        mntnf->mntnf_items[fn] = word;
+        if (fn != MOUNTINFO_INDEX_OPTIONAL_FIELDS)
+            continue;
+
+        /* Join the optional fields back, they end with '-' */
+        char *prev_end = NULL;
+        while (strcmp(word, "-") != 0)
+        {
+            if (prev_end != NULL)
+                *prev_end = ' ';
+            prev_end = word + strlen(word);
+
+            word = mountinfo_split_word(&pos, end_of_line);
+            if (word == NULL)
+                return false;
+        }
+
+        /* No optional fields */
+        if (prev_end == NULL)
+            *word = '\0';
+    }
+
+    return true;
+}
+
+/* Takes ownership of text */
+static struct mountinfo_table *mountinfo_table_parse_text(char *text)
+{
+    struct mountinfo_table *table = xzalloc(sizeof(*table));
+    table->mt_text = text;
+
+    size_t alloc = 0;
+    unsigned line_no = 0;
+    for (char *line = text; *line != '\0'; )
+    {
+        char *const end_of_line = strchrnul(line, '\n');
+        char *const next = *end_of_line != '\0' ? end_of_line + 1 : end_of_line;
+        ++line_no;
+
+        if (table->mt_count == alloc)
+        {
+            alloc = alloc * 2 + 32;
+            table->mt_mounts = xrealloc(table->mt_mounts, alloc * sizeof(*table->mt_mounts));
+        }
+
+        if (mountinfo_parse_line(line, end_of_line, &table->mt_mounts[table->mt_count]))
+            ++table->mt_count;
+        else
+            log_notice("Mountinfo line %u does not have enough fields", line_no);
+
+        line = next;
+    }
+
+    /* The table is complete, the array is not going to be reallocated */
+    table->mt_by_mount_point = g_hash_table_new(g_str_hash, g_str_equal);
+    table->mt_by_mount_id = g_hash_table_new(g_direct_hash, g_direct_equal);
+    for (size_t i = 0; i < table->mt_count; ++i)
+    {
+        struct mountinfo *mntnf = &table->mt_mounts[i];
+
+        /* The first one wins like in get_mountinfo_for_mount_point() */
+        if (g_hash_table_lookup(table->mt_by_mount_point, MOUNTINFO_MOUNT_POINT((*mntnf))) == NULL)
+            g_hash_table_insert(table->mt_by_mount_point, MOUNTINFO_MOUNT_POINT((*mntnf)), mntnf);
+
+        char *id_end;
+        errno = 0;
+        const unsigned long id = strtoul(mntnf->mntnf_items[MOUNTINFO_INDEX_MOUNT_ID], &id_end, 10);
+        if (errno == 0 && id_end != mntnf->mntnf_items[MOUNTINFO_INDEX_MOUNT_ID] && *id_end == '\0')
+            g_hash_table_insert(table->mt_by_mount_id, GUINT_TO_POINTER(id), mntnf);
+    }
+
+    return table;
+}
+
+struct mountinfo_table *mountinfo_table_parse(const char *text)
+{
+    return mountinfo_table_parse_text(xstrdup(text));
+}
+
+static struct mountinfo_table *mountinfo_table_load(int dir_fd, const char *name)
+{
+    struct strbuf *buf = strbuf_new();
+    const int r = read_proc_file_at(dir_fd, name, buf, /*no limit*/0);
+    if (r != 0)
+    {
+        strbuf_free(buf);
+        errno = -r;
+        return NULL;
+    }
+
+    return mountinfo_table_parse_text(strbuf_free_nobuf(buf));
+}
+
+struct mountinfo_table *mountinfo_table_load_at(int pid_proc_fd)
+{
+    return mountinfo_table_load(pid_proc_fd, "mountinfo");
+}
+
+void mountinfo_table_free(struct mountinfo_table *table)
+{
+    if (table == NULL)
+        return;
+
+    g_hash_table_destroy(table->mt_by_mount_id);
+    g_hash_table_destroy(table->mt_by_mount_point);
+    free(table->mt_mounts);
+    free(table->mt_text);
+    free(table);
+}
+
+const struct mountinfo *mountinfo_table_find_mount_point(const struct mountinfo_table *table,
+                                                         const char *mnt_point)
+{
+    return g_hash_table_lookup(table->mt_by_mount_point, mnt_point);
+}
+
+const struct mountinfo *mountinfo_table_find_mount_id(const struct mountinfo_table *table,
+                                                      unsigned long mount_id)
+{
+    return g_hash_table_lookup(table->mt_by_mount_id, GUINT_TO_POINTER(mount_id));
+}
+
+int mountinfo_table_has_own_root(const struct mountinfo_table *pid_table,
+                                 const struct mountinfo_table *init_table)
+{
+    const struct mountinfo *pid_root = mountinfo_table_find_mount_point(pid_table, "/");
+    if (pid_root == NULL)
+    {
+        log_notice("cannot get mount info for [pid]'s /");
+        return -ENOKEY;
+    }
+
+    const struct mountinfo *system_root = mountinfo_table_find_mount_point(init_table, "/");
+    if (system_root == NULL)
+    {
+        log_notice("cannot get line for / from /proc/1/mountinfo");
+        return -ENOKEY;
+    }
+
+    /* Compare the fields 10 (mount source) and 4 (root). */
+    /* See man 5 proc for more details. */
+    return (   strcmp(MOUNTINFO_MOUNT_SOURCE((*system_root)), MOUNTINFO_MOUNT_SOURCE((*pid_root))) != 0
+            || strcmp(MOUNTINFO_ROOT        ((*system_root)), MOUNTINFO_ROOT        ((*pid_root))) != 0);
+}
+
+static int proc_ns_eq(const struct ns_ids *lhs_ids, const struct ns_ids *rhs_ids, int neg)
 {
     for (size_t i = 0; i < ARRAY_SIZE(lhs_ids->nsi_ids); ++i)
         if (    lhs_ids->nsi_ids[i] != PROC_NS_UNSUPPORTED
@@ -772,28 +1155,24 @@ static int proc_ns_eq(struct ns_ids *lhs_ids, struct ns_ids *rhs_ids, int neg)
     return 0;
 }
 
-static int get_process_ppid_at(int pid_proc_fd, pid_t *ppid)
+static int get_process_ppid_at(int pid_proc_fd, pid_t *ppid, struct strbuf *buf)
 {
-    int r = 0;
-    const int stat_fd = openat(pid_proc_fd, "stat", O_RDONLY | O_CLOEXEC);
-    if (stat_fd < 0)
+    if (read_proc_file_at(pid_proc_fd, "stat", buf, /*no limit*/0) != 0)
     {
-        pwarn_msg("Failed to open stat file");
+        pwarn_msg("Failed to read stat file");
         return -1;
     }
 
-    FILE *const stat_file = xfdopen(stat_fd, "r");
-    const int p = fscanf(stat_file, "%*d %*s %*c %d", ppid);
+    /* The command name in parentheses may contain spaces and parentheses */
+    const char *comm_end = strrchr(buf->buf, ')');
+    const int p = comm_end ? sscanf(comm_end + 1, " %*c %d", ppid) : 0;
     if (p != 1)
     {
         log_notice("Failed to parse stat line %d\n", p);
-        r = -2;
+        return -2;
     }
 
-    if (stat_file != NULL)
-        fclose(stat_file);
-
-    return r;
+    return 0;
 }
 
 int get_pid_of_container(pid_t pid, pid_t *init_pid)
@@ -806,7 +1185,8 @@ int get_pid_of_container(pid_t pid, pid_t *init_pid)
     return r;
 }
 
-int get_pid_of_container_at(int pid_proc_fd, pid_t *init_pid)
+static int get_pid_of_container_for_ids(int pid_proc_fd, const struct ns_ids *pid_ids,
+                                        pid_t *init_pid, struct strbuf *buf)
 {
     int r = 0;
     pid_t ppid = 0;
@@ -817,17 +1197,9 @@ int get_pid_of_container_at(int pid_proc_fd, pid_t *init_pid)
         return -4;
     }
 
-    struct ns_ids pid_ids;
-    if (get_ns_ids_at(cpid_proc_fd, &pid_ids) != 0)
-    {
-        log_notice("Failed to get process's IDs");
-        close(cpid_proc_fd);
-        return -1;
-    }
-
     while (1)
     {
-        if (get_process_ppid_at(cpid_proc_fd, &ppid) != 0)
+        if (get_process_ppid_at(cpid_proc_fd, &ppid, buf) != 0)
         {
             r = -1;
             break;
@@ -854,7 +1226,7 @@ int get_pid_of_container_at(int pid_proc_fd, pid_t *init_pid)
         }
 
         /* If any pid's  NS differs from parent's NS, then parent is pid's container. */
-        if (proc_ns_eq(&pid_ids, &ppid_ids, 0) != 0)
+        if (proc_ns_eq(pid_ids, &ppid_ids, 0) != 0)
         {
             close(ppid_proc_fd);
             break;
@@ -872,6 +1244,22 @@ int get_pid_of_container_at(int pid_proc_fd, pid_t *init_pid)
     return r;
 }
 
+int get_pid_of_container_at(int pid_proc_fd, pid_t *init_pid)
+{
+    struct ns_ids pid_ids;
+    if (get_ns_ids_at(pid_proc_fd, &pid_ids) != 0)
+    {
+        log_notice("Failed to get process's IDs");
+        return -1;
+    }
+
+    struct strbuf *buf = strbuf_new();
+    const int r = get_pid_of_container_for_ids(pid_proc_fd, &pid_ids, init_pid, buf);
+    strbuf_free(buf);
+
+    return r;
+}
+
 int open_proc_pid_dir(pid_t pid)
 {
     static char proc_dir_path[sizeof("/proc/%lu") + sizeof(long)*3];
@@ -886,63 +1274,28 @@ int open_proc_pid_dir(pid_t pid)
 int process_has_own_root_at(int pid_proc_fd)
 {
     int r = -1;
-    struct mountinfo pid_root;
-    errno = 0;
-    int mnt_fd = openat(pid_proc_fd, "mountinfo", O_RDONLY);
-    if (mnt_fd < 0)
+    struct mountinfo_table *pid_table = mountinfo_table_load_at(pid_proc_fd);
+    if (pid_table == NULL)
     {
         r = -errno;
-        pnotice_msg("failed to open '/proc/[pid]/mountinfo'");
+        pnotice_msg("failed to read '/proc/[pid]/mountinfo'");
         return r;
     }
 
-    FILE *fin = fdopen(mnt_fd, "r");
-    if (fin == NULL)
+    struct mountinfo_table *init_table = mountinfo_table_load(AT_FDCWD, "/proc/1/mountinfo");
+    if (init_table == NULL)
     {
-        /* This can happen only if there is a bug or we ran out of memory */
         r = -errno;
-        notice_msg("fdopen(openat([pid's fd], mountinfo))");
+        pnotice_msg("failed to read '/proc/1/mountinfo'");
 
-        close(mnt_fd);
+        mountinfo_table_free(pid_table);
         return r;
     }
 
-    r = get_mountinfo_for_mount_point(fin, &pid_root, "/");
-    fclose(fin);
-    if (r)
-    {
-        log_notice("cannot get mount info for [pid]'s /");
-        return -ENOKEY;
-    }
-
-    struct mountinfo system_root;
-    fin = fopen("/proc/1/mountinfo", "r");
-    if (fin == NULL)
-    {
-        r = -errno;
-        pnotice_msg("fopen(/proc/1/mountinfo)");
-
-        mountinfo_destroy(&pid_root);
-        return r;
-    }
+    r = mountinfo_table_has_own_root(pid_table, init_table);
 
-    r = get_mountinfo_for_mount_point(fin, &system_root, "/");
-    fclose(fin);
-    if (r)
-    {
-        mountinfo_destroy(&pid_root);
-
-        log_notice("cannot get line for / from /proc/1/mountinfo");
-        return -ENOKEY;
-    }
-
-    /* Compare the fields 10 (mount source) and 4 (root). */
-    /* See man 5 proc for more details. */
-    r = (   strcmp(MOUNTINFO_MOUNT_SOURCE(system_root), MOUNTINFO_MOUNT_SOURCE(pid_root)) != 0
-         || strcmp(MOUNTINFO_ROOT        (system_root), MOUNTINFO_ROOT        (pid_root)) != 0);
-
-    mountinfo_destroy(&system_root);
-    mountinfo_destroy(&pid_root);
+    mountinfo_table_free(init_table);
+    mountinfo_table_free(pid_table);
 
     return r;
 }
@@ -961,3 +1314,166 @@ int process_has_own_root(pid_t pid)
 
     return ret;
 }
+
+void proc_snapshot_init(struct proc_snapshot *snapshot)
+{
+    memset(snapshot, 0, sizeof(*snapshot));
+    snapshot->ps_buffer = strbuf_new();
+    snapshot->ps_fd_workers = 1;
+}
+
+static void proc_snapshot_clear(struct proc_snapshot *snapshot)
+{
+    free(snapshot->ps_cmdline);
+    free(snapshot->ps_environ);
+    free(snapshot->ps_executable);
+    free(snapshot->ps_cwd);
+    free(snapshot->ps_rootdir);
+    free(snapshot->ps_open_fds);
+    free(snapshot->ps_mountinfo);
+    mountinfo_table_free(snapshot->ps_mounts);
+
+    struct strbuf *const buffer = snapshot->ps_buffer;
+    const unsigned max_fds = snapshot->ps_max_fds;
+    const unsigned fd_workers = snapshot->ps_fd_workers;
+    memset(snapshot, 0, sizeof(*snapshot));
+    snapshot->ps_buffer = buffer;
+    snapshot->ps_max_fds = max_fds;
+    snapshot->ps_fd_workers = fd_workers;
+}
+
+void proc_snapshot_destroy(struct proc_snapshot *snapshot)
+{
+    proc_snapshot_clear(snapshot);
+    strbuf_free(snapshot->ps_buffer);
+    snapshot->ps_buffer = NULL;
+}
+
+/* @return 0 on success, -errno otherwise */
+static int proc_snapshot_escaped_at(int pid_proc_fd, const char *name, char separator,
+                                    struct strbuf *buf, char **dest)
+{
+    /* paranoia check, as in get_escaped_at() */
+    const int r = read_proc_file_at(pid_proc_fd, name, buf, 1024 * 1024);
+    if (r == 0)
+        *dest = escape_strings(buf->buf, buf->len, separator);
+
+    return r;
+}
+
+/* @return 0 on success, -errno otherwise */
+static int proc_snapshot_readlink_at(int pid_proc_fd, const char *name, char **dest)
+{
+    *dest = malloc_readlinkat(pid_proc_fd, name);
+    return *dest ? 0 : -errno;
+}
+
+int proc_snapshot_collect_at(int pid_proc_fd, unsigned items, struct proc_snapshot *snapshot)
+{
+    proc_snapshot_clear(snapshot);
+
+    struct strbuf *buf = snapshot->ps_buffer;
+    int r = 0;
+
+    /* Container detection compares the namespaces with the parents' ones */
+    if (items & PROC_SNAPSHOT_CONTAINER)
+        items |= PROC_SNAPSHOT_NAMESPACES;
+
+    for (unsigned item = 1; item & PROC_SNAPSHOT_ALL; item <<= 1)
+    {
+        if (!(items & item))
+            continue;
+
+        int err = 0;
+        switch (item)
+        {
+            case PROC_SNAPSHOT_CMDLINE:
+                err = proc_snapshot_escaped_at(pid_proc_fd, "cmdline", ' ', buf, &snapshot->ps_cmdline);
+                break;
+            case PROC_SNAPSHOT_ENVIRON:
+                err = proc_snapshot_escaped_at(pid_proc_fd, "environ", '\n', buf, &snapshot->ps_environ);
+                break;
+            case PROC_SNAPSHOT_EXECUTABLE:
+                snapshot->ps_executable = get_executable_at(pid_proc_fd);
+                err = snapshot->ps_executable ? 0 : -errno;
+                break;
+            case PROC_SNAPSHOT_CWD:
+                err = proc_snapshot_readlink_at(pid_proc_fd, "cwd", &snapshot->ps_cwd);
+                break;
+            case PROC_SNAPSHOT_ROOTDIR:
+                err = proc_snapshot_readlink_at(pid_proc_fd, "root", &snapshot->ps_rootdir);
+                break;
+            case PROC_SNAPSHOT_OPEN_FDS:
+            {
+                struct strbuf *info = strbuf_new();
+                err = dump_fd_info_bulk_at(pid_proc_fd, info, snapshot->ps_max_fds,
+                                         snapshot->ps_fd_workers);
+                snapshot->ps_open_fds = strbuf_free_nobuf(info);
+                break;
+            }
+            case PROC_SNAPSHOT_NAMESPACES:
+                if (get_ns_ids_at(pid_proc_fd, &snapshot->ps_ns_ids) != 0
+                    || get_ns_ids(1, &snapshot->ps_init_ns_ids) != 0)
+                    err = errno ? -errno : -EIO;
+                break;
+            case PROC_SNAPSHOT_MOUNTINFO:
+                err = read_proc_file_at(pid_proc_fd, "mountinfo", buf, /*no limit*/0);
+                if (err == 0)
+                {
+                    snapshot->ps_mountinfo = xstrndup(buf->buf, buf->len);
+                    snapshot->ps_mounts = mountinfo_table_parse(snapshot->ps_mountinfo);
+                }
+                break;
+            case PROC_SNAPSHOT_CONTAINER:
+                /* The namespaces were collected before, the bit is lower */
+                if (!(snapshot->ps_items & PROC_SNAPSHOT_NAMESPACES))
+                    err = -ENOKEY;
+                else if (get_pid_of_container_for_ids(pid_proc_fd, &snapshot->ps_ns_ids,
+                                                      &snapshot->ps_container_pid, buf) != 0)
+                    err = -ESRCH;
+                break;
+        }
+
+        if (err == 0)
+            snapshot->ps_items |= item;
+        else
+        {
+            log_notice("Failed to collect process item %#x: %s", item, strerror(-err));
+            if (r == 0)
+                r = err;
+        }
+    }
+
+    return r;
+}
+
+void proc_snapshot_save(const struct proc_snapshot *snapshot, struct dump_dir *dd)
+{
+    const struct {
+        unsigned item;
+        const char *name;
+        const char *value;
+    } texts[] = {
+        { PROC_SNAPSHOT_CMDLINE,    FILENAME_CMDLINE,    snapshot->ps_cmdline },
+        { PROC_SNAPSHOT_ENVIRON,    FILENAME_ENVIRON,    snapshot->ps_environ },
+        { PROC_SNAPSHOT_EXECUTABLE, FILENAME_EXECUTABLE, snapshot->ps_executable },
+        { PROC_SNAPSHOT_CWD,        FILENAME_PWD,        snapshot->ps_cwd },
+        { PROC_SNAPSHOT_OPEN_FDS,   FILENAME_OPEN_FDS,   snapshot->ps_open_fds },
+        { PROC_SNAPSHOT_MOUNTINFO,  FILENAME_MOUNTINFO,  snapshot->ps_mountinfo },
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(texts); ++i)
+        if ((snapshot->ps_items & texts[i].item) && texts[i].value != NULL)
+            dd_save_text(dd, texts[i].name, texts[i].value);
+
+    if ((snapshot->ps_items & PROC_SNAPSHOT_ROOTDIR) && strcmp(snapshot->ps_rootdir, "/") != 0)
+        dd_save_text(dd, FILENAME_ROOTDIR, snapshot->ps_rootdir);
+
+    if (snapshot->ps_items & PROC_SNAPSHOT_NAMESPACES)
+    {
+        struct strbuf *diff = strbuf_new();
+        format_namespace_diff(&snapshot->ps_init_ns_ids, &snapshot->ps_ns_ids, diff);
+        dd_save_text(dd, FILENAME_NAMESPACES, diff->buf);
+        strbuf_free(diff);
+    }
+}
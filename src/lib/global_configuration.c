@@ -22,10 +22,12 @@
 
 #define OPT_NAME_SCRUBBED_VARIABLES "ScrubbedENVVariables"
 #define OPT_NAME_EXCLUDED_ELEMENTS "AlwaysExcludedElements"
+#define OPT_NAME_TLS_SESSION_CACHE "TLSSessionCache"
 
 static const char *const s_recognized_options[] = {
     OPT_NAME_SCRUBBED_VARIABLES,
     OPT_NAME_EXCLUDED_ELEMENTS,
+    OPT_NAME_TLS_SESSION_CACHE,
     NULL,
 };
 
@@ -180,3 +182,17 @@ void set_global_stop_on_not_reportable(bool enabled, int flags/*unused - persist
     else
         xsetenv(STOP_ON_NOT_REPORTABLE, "0");
 }
+
+bool get_global_tls_session_cache(void)
+{
+    /* post() is called also from programs which never load the global
+     * configuration, the cache is an optimization so do not abort() there */
+    if (NULL == s_global_settings)
+        return false;
+
+    int enabled = 0;
+    if (!try_get_map_string_item_as_bool(s_global_settings, OPT_NAME_TLS_SESSION_CACHE, &enabled))
+        return false;
+
+    return enabled;
+}
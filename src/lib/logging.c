@@ -16,6 +16,9 @@
     with this program; if not, write to the Free Software Foundation, Inc.,
     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 */
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
 #include <syslog.h>
 /* Suppress automatic CODE_* fields as we handle those here */
 #define SD_JOURNAL_SUPPRESS_LOCATION
@@ -46,6 +49,9 @@ void set_xfunc_diemode(enum libreport_diemode mode)
  */
 void xfunc_die(void)
 {
+    /* Don't lose the messages waiting for the writer thread */
+    log_async_flush();
+
     char *const envmode = getenv("LIBREPORT_DIEMODE");
     if (   xfunc_diemode == DIEMODE_ABORT
         || (envmode != NULL && strcmp("abort", envmode) == 0))
@@ -70,18 +76,544 @@ static bool should_log(int level)
 }
 
 
-static void log_handler(int level,
-                        const char *format,
-                        va_list p,
-                        const char *strerr, /* perror messages */
-                        int flags,
-                        const char *file,
-                        int line,
-                        const char *func)
+/* Asynchronous logging
+ *
+ * The logging threads are producers and the writer thread is the only
+ * consumer of a bounded ring of messages. Every cell of the ring carries a
+ * sequence number telling whether the cell is free for the enqueue position
+ * 'pos' (seq == pos) or holds the message for the dequeue position 'pos'
+ * (seq == pos + 1). Producers claim enqueue positions by CAS, so a logging
+ * thread never waits for another one nor for the writer.
+ *
+ * The writer sleeps in read() of an eventfd. Before that it announces itself
+ * in 'sleeping' and checks the ring once more, producers write to the eventfd
+ * only if they see the announcement, which keeps the fast path free of
+ * system calls without losing wakeups.
+ */
+#define LOG_RING_DEFAULT_SIZE 1024
+#define LOG_BATCH_SIZE 64
+
+#define JOURNAL_MESSAGE "MESSAGE="
+
+struct log_entry
 {
-    if (!logmode || !should_log(level))
+    int le_level;
+    int le_flags;
+    /* __FILE__ and __func__ of the call site, see log_wrapper() */
+    const char *le_file;
+    int le_line;
+    const char *le_func;
+    unsigned le_prefix_len;
+    unsigned le_len;            ///< message without prefix and eol
+    unsigned le_eol_len;
+    /* "<prefix>: " JOURNAL_MESSAGE "<message><eol>\0" */
+    char le_buf[];
+};
+
+struct log_cell
+{
+    unsigned long lc_seq;
+    struct log_entry *lc_entry;
+};
+
+static struct
+{
+    struct log_cell *ring;
+    unsigned long mask;
+    unsigned long enqueue_pos;      ///< claimed by producers
+    unsigned long dequeue_pos;      ///< owned by the writer thread
+    unsigned long written_pos;      ///< protected by 'lock'
+    bool running;
+    bool stopping;
+    int producers;                  ///< threads in log_async_push()
+    int sleeping;                   ///< the writer waits for wakeup_fd
+    int wakeup_fd;
+    pthread_t writer;
+    pthread_mutex_t lock;
+    pthread_cond_t written;
+} s_async = {
+    .wakeup_fd = -1,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .written = PTHREAD_COND_INITIALIZER,
+};
+
+static pthread_once_t s_async_once = PTHREAD_ONCE_INIT;
+
+static const char *log_entry_message(const struct log_entry *entry)
+{
+    return entry->le_buf + entry->le_prefix_len + strlen(JOURNAL_MESSAGE);
+}
+
+/* Doesn't use xmalloc(), the caller logs synchronously on failure */
+static struct log_entry *log_entry_new(int level, int flags,
+                                       const char *file, int line, const char *func,
+                                       const char *msg, unsigned prefix_len,
+                                       unsigned len, unsigned eol_len)
+{
+    const size_t size = prefix_len + strlen(JOURNAL_MESSAGE) + len + eol_len + 1;
+    struct log_entry *entry = malloc(sizeof(*entry) + size);
+    if (entry == NULL)
+        return NULL;
+
+    entry->le_level = level;
+    entry->le_flags = flags;
+    entry->le_file = file;
+    entry->le_line = line;
+    entry->le_func = func;
+    entry->le_prefix_len = prefix_len;
+    entry->le_len = len;
+    entry->le_eol_len = eol_len;
+
+    char *p = mempcpy(entry->le_buf, msg, prefix_len);
+    p = stpcpy(p, JOURNAL_MESSAGE);
+    memcpy(p, msg + prefix_len, len + eol_len);
+    p[len + eol_len] = '\0';
+
+    return entry;
+}
+
+static bool log_ring_push(struct log_entry *entry)
+{
+    unsigned long pos = __atomic_load_n(&s_async.enqueue_pos, __ATOMIC_RELAXED);
+    for (;;)
+    {
+        struct log_cell *cell = &s_async.ring[pos & s_async.mask];
+        const unsigned long seq = __atomic_load_n(&cell->lc_seq, __ATOMIC_ACQUIRE);
+        const long diff = (long)(seq - pos);
+
+        if (diff == 0)
+        {
+            /* On failure, pos is updated to the current enqueue position */
+            if (__atomic_compare_exchange_n(&s_async.enqueue_pos, &pos, pos + 1,
+                                            /*weak*/ true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                cell->lc_entry = entry;
+                __atomic_store_n(&cell->lc_seq, pos + 1, __ATOMIC_RELEASE);
+                return true;
+            }
+        }
+        else if (diff < 0)
+            /* The writer hasn't freed the cell yet, the ring is full */
+            return false;
+        else
+            pos = __atomic_load_n(&s_async.enqueue_pos, __ATOMIC_RELAXED);
+    }
+}
+
+static bool log_ring_ready(void)
+{
+    const struct log_cell *cell = &s_async.ring[s_async.dequeue_pos & s_async.mask];
+    return __atomic_load_n(&cell->lc_seq, __ATOMIC_ACQUIRE) == s_async.dequeue_pos + 1;
+}
+
+static struct log_entry *log_ring_pop(void)
+{
+    if (!log_ring_ready())
+        return NULL;
+
+    struct log_cell *cell = &s_async.ring[s_async.dequeue_pos & s_async.mask];
+    struct log_entry *entry = cell->lc_entry;
+    /* Free the cell for the next round of the ring */
+    __atomic_store_n(&cell->lc_seq, s_async.dequeue_pos + s_async.mask + 1, __ATOMIC_RELEASE);
+    ++s_async.dequeue_pos;
+
+    return entry;
+}
+
+static void log_writer_wakeup(void)
+{
+    if (__atomic_exchange_n(&s_async.sleeping, 0, __ATOMIC_SEQ_CST))
+        eventfd_write(s_async.wakeup_fd, 1);
+}
+
+static void log_entry_send_to_journal(const struct log_entry *entry)
+{
+    char priority[sizeof("PRIORITY=") + sizeof(int) * 3];
+    char code_line[sizeof("CODE_LINE=") + sizeof(int) * 3];
+    char *code_file = alloca(sizeof("CODE_FILE=") + strlen(entry->le_file));
+    char *code_func = alloca(sizeof("CODE_FUNC=") + strlen(entry->le_func));
+
+    struct iovec iov[] = {
+        { .iov_base = (char *)entry->le_buf + entry->le_prefix_len,
+          .iov_len = strlen(JOURNAL_MESSAGE) + entry->le_len },
+        { .iov_base = priority,
+          .iov_len = sprintf(priority, "PRIORITY=%d", entry->le_level) },
+        { .iov_base = code_file,
+          .iov_len = sprintf(code_file, "CODE_FILE=%s", entry->le_file) },
+        { .iov_base = code_line,
+          .iov_len = sprintf(code_line, "CODE_LINE=%d", entry->le_line) },
+        { .iov_base = code_func,
+          .iov_len = sprintf(code_func, "CODE_FUNC=%s", entry->le_func) },
+        { .iov_base = (char *)"SYSLOG_FACILITY=1",
+          .iov_len = strlen("SYSLOG_FACILITY=1") },
+    };
+
+    sd_journal_sendv(iov, ARRAY_SIZE(iov));
+}
+
+/* The stderr lines of the whole batch go out in a single writev(), journal
+ * doesn't accept more entries at once, so they are sent one by one but
+ * still off the logging threads.
+ */
+static void log_entries_write(struct log_entry **entries, unsigned count)
+{
+    struct iovec iov[2 * LOG_BATCH_SIZE];
+    int iovcnt = 0;
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        struct log_entry *entry = entries[i];
+        if (!(entry->le_flags & LOGMODE_STDIO))
+            continue;
+
+        if (entry->le_prefix_len)
+        {
+            iov[iovcnt].iov_base = entry->le_buf;
+            iov[iovcnt].iov_len = entry->le_prefix_len;
+            ++iovcnt;
+        }
+        iov[iovcnt].iov_base = (char *)log_entry_message(entry);
+        iov[iovcnt].iov_len = entry->le_len + entry->le_eol_len;
+        ++iovcnt;
+    }
+
+    if (iovcnt)
+        full_writev(STDERR_FILENO, iov, iovcnt);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        struct log_entry *entry = entries[i];
+
+        if (entry->le_flags & LOGMODE_SYSLOG)
+            syslog(entry->le_level, "%.*s", (int)entry->le_len, log_entry_message(entry));
+
+        if (entry->le_flags & LOGMODE_JOURNAL)
+            log_entry_send_to_journal(entry);
+    }
+}
+
+static void *log_writer_thread(void *arg)
+{
+    struct log_entry *batch[LOG_BATCH_SIZE];
+
+    for (;;)
+    {
+        unsigned count = 0;
+        struct log_entry *entry;
+        while (count < LOG_BATCH_SIZE && (entry = log_ring_pop()) != NULL)
+            batch[count++] = entry;
+
+        if (count)
+        {
+            log_entries_write(batch, count);
+            for (unsigned i = 0; i < count; ++i)
+                free(batch[i]);
+
+            pthread_mutex_lock(&s_async.lock);
+            s_async.written_pos = s_async.dequeue_pos;
+            pthread_cond_broadcast(&s_async.written);
+            pthread_mutex_unlock(&s_async.lock);
+            continue;
+        }
+
+        __atomic_store_n(&s_async.sleeping, 1, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (log_ring_ready())
+        {
+            __atomic_store_n(&s_async.sleeping, 0, __ATOMIC_SEQ_CST);
+            continue;
+        }
+
+        /* All producers are gone and the ring is empty */
+        if (__atomic_load_n(&s_async.stopping, __ATOMIC_SEQ_CST))
+            break;
+
+        eventfd_t value;
+        eventfd_read(s_async.wakeup_fd, &value);
+        __atomic_store_n(&s_async.sleeping, 0, __ATOMIC_SEQ_CST);
+    }
+
+    return NULL;
+}
+
+/* @return false if the message must be written synchronously, the queued
+ * messages are written by then */
+static bool log_async_push(int level, int flags,
+                           const char *file, int line, const char *func,
+                           const char *msg, unsigned prefix_len,
+                           unsigned len, unsigned eol_len)
+{
+    if (!__atomic_load_n(&s_async.running, __ATOMIC_RELAXED))
+        return false;
+
+    /* log_async_stop() waits for us before it releases the ring */
+    __atomic_add_fetch(&s_async.producers, 1, __ATOMIC_SEQ_CST);
+
+    bool queued = false;
+    if (__atomic_load_n(&s_async.running, __ATOMIC_SEQ_CST))
+    {
+        struct log_entry *entry = log_entry_new(level, flags, file, line, func,
+                                                msg, prefix_len, len, eol_len);
+        if (entry != NULL)
+        {
+            queued = log_ring_push(entry);
+            if (queued)
+            {
+                __atomic_thread_fence(__ATOMIC_SEQ_CST);
+                log_writer_wakeup();
+            }
+            else
+                free(entry);
+        }
+    }
+
+    __atomic_sub_fetch(&s_async.producers, 1, __ATOMIC_SEQ_CST);
+
+    /* The synchronous write must not overtake the queued messages */
+    if (!queued)
+        log_async_flush();
+
+    return queued;
+}
+
+static void log_ring_free(void)
+{
+    struct log_entry *entry;
+    while ((entry = log_ring_pop()) != NULL)
+        free(entry);
+
+    free(s_async.ring);
+    s_async.ring = NULL;
+}
+
+/* Rate limiting, see log_set_rate_limit()
+ *
+ * Call sites are identified by __FILE__ and __LINE__ and kept in a small
+ * open addressing table. When the probed slots are taken by other call
+ * sites, the first one is reused and its count of suppressed messages is
+ * lost.
+ */
+#define LOG_RATELIMIT_SLOTS 256
+#define LOG_RATELIMIT_PROBES 8
+
+struct log_ratelimit_slot
+{
+    const char *rs_file;
+    int rs_line;
+    time_t rs_begin;
+    unsigned rs_count;
+    unsigned rs_suppressed;
+};
+
+static unsigned s_ratelimit_burst;
+static unsigned s_ratelimit_interval;
+static pthread_mutex_t s_ratelimit_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct log_ratelimit_slot s_ratelimit[LOG_RATELIMIT_SLOTS];
+
+void log_set_rate_limit(unsigned burst, unsigned interval)
+{
+    pthread_mutex_lock(&s_ratelimit_lock);
+    memset(s_ratelimit, 0, sizeof(s_ratelimit));
+    s_ratelimit_interval = interval;
+    __atomic_store_n(&s_ratelimit_burst, burst, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&s_ratelimit_lock);
+}
+
+/* @param suppressed Set to the number of messages dropped in the previous
+ * interval of the call site
+ * @return false if the message is over the limit
+ */
+static bool log_ratelimit(const char *file, int line, unsigned *suppressed)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    const unsigned long hash = ((unsigned long)file >> 3) * 31 + line;
+
+    pthread_mutex_lock(&s_ratelimit_lock);
+
+    struct log_ratelimit_slot *slot = NULL;
+    for (unsigned i = 0; i < LOG_RATELIMIT_PROBES && slot == NULL; ++i)
+    {
+        struct log_ratelimit_slot *probe = &s_ratelimit[(hash + i) % LOG_RATELIMIT_SLOTS];
+        if (probe->rs_file == NULL || (probe->rs_file == file && probe->rs_line == line))
+            slot = probe;
+    }
+    if (slot == NULL)
+    {
+        slot = &s_ratelimit[hash % LOG_RATELIMIT_SLOTS];
+        slot->rs_file = NULL;
+    }
+    if (slot->rs_file == NULL)
+    {
+        memset(slot, 0, sizeof(*slot));
+        slot->rs_file = file;
+        slot->rs_line = line;
+        slot->rs_begin = ts.tv_sec;
+    }
+
+    *suppressed = 0;
+    if (ts.tv_sec - slot->rs_begin >= s_ratelimit_interval)
+    {
+        *suppressed = slot->rs_suppressed;
+        slot->rs_begin = ts.tv_sec;
+        slot->rs_count = 0;
+        slot->rs_suppressed = 0;
+    }
+
+    const bool allowed = slot->rs_count < s_ratelimit_burst;
+    if (allowed)
+        ++slot->rs_count;
+    else
+        ++slot->rs_suppressed;
+
+    pthread_mutex_unlock(&s_ratelimit_lock);
+    return allowed;
+}
+
+/* fork() may happen while another thread holds the locks, or while the
+ * writer thread, which the child doesn't get, has messages in the ring.
+ * The child therefore drops the ring and logs synchronously.
+ */
+static void log_atfork_prepare(void)
+{
+    pthread_mutex_lock(&s_ratelimit_lock);
+    pthread_mutex_lock(&s_async.lock);
+}
+
+static void log_atfork_parent(void)
+{
+    pthread_mutex_unlock(&s_async.lock);
+    pthread_mutex_unlock(&s_ratelimit_lock);
+}
+
+static void log_atfork_child(void)
+{
+    pthread_mutex_init(&s_ratelimit_lock, NULL);
+    pthread_mutex_init(&s_async.lock, NULL);
+    pthread_cond_init(&s_async.written, NULL);
+
+    if (!s_async.running)
+        return;
+
+    s_async.running = false;
+    s_async.producers = 0;
+    /* The parent's messages, the parent writes them */
+    s_async.dequeue_pos = s_async.enqueue_pos;
+    free(s_async.ring);
+    s_async.ring = NULL;
+    close(s_async.wakeup_fd);
+    s_async.wakeup_fd = -1;
+}
+
+static void log_async_init_once(void)
+{
+    pthread_atfork(log_atfork_prepare, log_atfork_parent, log_atfork_child);
+    atexit(log_async_stop);
+}
+
+int log_async_start(unsigned ring_size)
+{
+    if (s_async.running)
+        return 0;
+
+    if (ring_size == 0)
+        ring_size = LOG_RING_DEFAULT_SIZE;
+
+    /* Positions are masked, the size must be a power of two */
+    unsigned long size = 2;
+    while (size < ring_size)
+        size <<= 1;
+
+    s_async.ring = xmalloc(size * sizeof(*s_async.ring));
+    for (unsigned long i = 0; i < size; ++i)
+    {
+        s_async.ring[i].lc_seq = i;
+        s_async.ring[i].lc_entry = NULL;
+    }
+    s_async.mask = size - 1;
+    s_async.enqueue_pos = 0;
+    s_async.dequeue_pos = 0;
+    s_async.written_pos = 0;
+    s_async.stopping = false;
+    s_async.sleeping = 0;
+
+    s_async.wakeup_fd = eventfd(0, EFD_CLOEXEC);
+    if (s_async.wakeup_fd < 0)
+    {
+        const int r = -errno;
+        perror_msg("Can't create eventfd for the logging thread");
+        log_ring_free();
+        return r;
+    }
+
+    pthread_once(&s_async_once, log_async_init_once);
+
+    /* Signals are for the other threads */
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    const int r = pthread_create(&s_async.writer, NULL, log_writer_thread, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (r != 0)
+    {
+        errno = r;
+        perror_msg("Can't start the logging thread");
+        close(s_async.wakeup_fd);
+        s_async.wakeup_fd = -1;
+        log_ring_free();
+        return -r;
+    }
+
+    __atomic_store_n(&s_async.running, true, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void log_async_flush(void)
+{
+    if (!__atomic_load_n(&s_async.running, __ATOMIC_ACQUIRE)
+        || pthread_equal(pthread_self(), s_async.writer))
         return;
 
+    const unsigned long target = __atomic_load_n(&s_async.enqueue_pos, __ATOMIC_SEQ_CST);
+    log_writer_wakeup();
+
+    pthread_mutex_lock(&s_async.lock);
+    while ((long)(s_async.written_pos - target) < 0)
+        pthread_cond_wait(&s_async.written, &s_async.lock);
+    pthread_mutex_unlock(&s_async.lock);
+}
+
+void log_async_stop(void)
+{
+    if (!__atomic_load_n(&s_async.running, __ATOMIC_ACQUIRE)
+        || pthread_equal(pthread_self(), s_async.writer))
+        return;
+
+    /* New messages are written synchronously, wait for the queued ones */
+    __atomic_store_n(&s_async.running, false, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&s_async.producers, __ATOMIC_SEQ_CST) != 0)
+        sched_yield();
+
+    __atomic_store_n(&s_async.stopping, true, __ATOMIC_SEQ_CST);
+    eventfd_write(s_async.wakeup_fd, 1);
+    pthread_join(s_async.writer, NULL);
+
+    close(s_async.wakeup_fd);
+    s_async.wakeup_fd = -1;
+    log_ring_free();
+}
+
+
+static void log_emit(int level,
+                     const char *format,
+                     va_list p,
+                     const char *strerr, /* perror messages */
+                     int flags,
+                     const char *file,
+                     int line,
+                     const char *func)
+{
     /* This is ugly and costs +60 bytes compared to multiple
      * fprintf's, but is guaranteed to do a single write.
      * This is needed for e.g. when multiple children
@@ -134,6 +666,12 @@ static void log_handler(int level,
     }
     strcpy(&msg[used], msg_eol);
 
+    /* The custom logger stays on this thread, it needn't be thread safe */
+    if ((flags & (LOGMODE_STDIO | LOGMODE_SYSLOG | LOGMODE_JOURNAL))
+        && log_async_push(level, flags, file, line, func, msg, prefix_len,
+                          used - prefix_len, msgeol_len))
+        flags &= ~(LOGMODE_STDIO | LOGMODE_SYSLOG | LOGMODE_JOURNAL);
+
     if (flags & LOGMODE_STDIO) {
         full_write(STDERR_FILENO, msg, used + msgeol_len);
     }
@@ -157,6 +695,42 @@ static void log_handler(int level,
     }
 }
 
+static void log_emitf(int level, int flags, const char *file, int line,
+                      const char *func, const char *format, ...)
+{
+    va_list p;
+
+    va_start(p, format);
+    log_emit(level, format, p, NULL, flags, file, line, func);
+    va_end(p);
+}
+
+static void log_handler(int level,
+                        const char *format,
+                        va_list p,
+                        const char *strerr, /* perror messages */
+                        int flags,
+                        const char *file,
+                        int line,
+                        const char *func)
+{
+    if (!logmode || !should_log(level))
+        return;
+
+    if (__atomic_load_n(&s_ratelimit_burst, __ATOMIC_RELAXED))
+    {
+        unsigned suppressed;
+        if (!log_ratelimit(file, line, &suppressed))
+            return;
+
+        if (suppressed)
+            log_emitf(level, flags, file, line, func,
+                      "%u messages from %s:%d were suppressed", suppressed, file, line);
+    }
+
+    log_emit(level, format, p, strerr, flags, file, line, func);
+}
+
 void log_wrapper(int level,
                  const char *file,
                  int line,
@@ -18,60 +18,126 @@
 */
 #include "internal_libreport.h"
 
-static bool rejected_name(const char *name, char **v, int flags)
+/* Items printed first, in this order */
+static const char *const list_order[] = {
+        FILENAME_REASON    ,
+        FILENAME_TIME      ,
+        FILENAME_CMDLINE   ,
+        FILENAME_PACKAGE   ,
+        FILENAME_UID       ,
+        FILENAME_COUNT     ,
+        NULL
+};
+
+/*
+ * The description is generated from a plan: the items that pass
+ * names_to_skip and the flags, sorted and with the length of their text
+ * computed only once. The one-liners, the file infos and the multi-liners
+ * are then printed by simple walks over the plan.
+ */
+struct description_item
+{
+    const char *di_name;
+    struct problem_item *di_item;
+    size_t di_text_len;     ///< length of the content of text items
+    int di_rank;            ///< index in list_order, or INT_MAX
+};
+
+static int description_item_cmp(const void *lhs, const void *rhs)
+{
+    const struct description_item *l = lhs;
+    const struct description_item *r = rhs;
+
+    if (l->di_rank != r->di_rank)
+        return l->di_rank < r->di_rank ? -1 : 1;
+
+    return strcmp(l->di_name, r->di_name);
+}
+
+/* Returns the number of items stored in *plan */
+static unsigned build_description_plan(problem_data_t *problem_data, char **names_to_skip,
+                                       unsigned desc_flags, struct description_item **plan)
 {
-    bool r = is_in_string_list(name, (const char *const *)v);
-    if (flags & MAKEDESC_WHITELIST)
-         r = !r;
-    return r;
+    GHashTable *skip = NULL;
+    if (names_to_skip)
+    {
+        skip = g_hash_table_new(g_str_hash, g_str_equal);
+        for (char **name = names_to_skip; *name; ++name)
+            g_hash_table_add(skip, *name);
+    }
+
+    const bool whitelist = (desc_flags & MAKEDESC_WHITELIST);
+
+    struct description_item *items = xmalloc((g_hash_table_size(problem_data) + 1) * sizeof(*items));
+    unsigned count = 0;
+
+    GHashTableIter iter;
+    g_hash_table_iter_init(&iter, problem_data);
+    const char *name;
+    struct problem_item *item;
+    while (g_hash_table_iter_next(&iter, (gpointer *)&name, (gpointer *)&item))
+    {
+        /* Skip items we are not interested in */
+        if (skip && g_hash_table_contains(skip, name) != whitelist)
+            continue;
+
+        if (!item)
+            continue;
+
+        if ((desc_flags & MAKEDESC_SHOW_ONLY_LIST) && !(item->flags & CD_FLAG_LIST))
+            continue;
+
+        struct description_item *di = items + count++;
+        di->di_name = name;
+        di->di_item = item;
+        di->di_text_len = (item->flags & CD_FLAG_TXT) ? strlen(item->content) : 0;
+        di->di_rank = index_of_string_in_list(name, list_order);
+        if (di->di_rank < 0)
+            di->di_rank = INT_MAX;
+    }
+
+    if (skip)
+        g_hash_table_destroy(skip);
+
+    qsort(items, count, sizeof(*items), description_item_cmp);
+
+    *plan = items;
+    return count;
 }
 
-static
-char *make_description_item_multiline(const char *name, const char *content)
+/* Prints content (at most len bytes of it) in the format:
+ * NAME:
+ * :LINE1
+ * :LINE2
+ */
+static void append_item_multiline(struct strbuf *buf, const char *name, const char *content, size_t len)
 {
-    char *eol = strchr(content, '\n');
-    if (!eol)
-        return NULL;
+    const char *const end = content + len;
 
-    struct strbuf *buf = strbuf_new();
     strbuf_append_str(buf, name);
-    strbuf_append_str(buf, ":\n");
+    strbuf_append_strn(buf, ":\n", 2);
     for (;;)
     {
-        eol = strchrnul(content, '\n');
-        strbuf_append_strf(buf, ":%.*s\n", (int)(eol - content), content);
-        if (*eol == '\0' || eol[1] == '\0')
+        const char *eol = memchr(content, '\n', end - content);
+        if (!eol)
+            eol = end;
+        strbuf_append_char(buf, ':');
+        strbuf_append_strn(buf, content, eol - content);
+        strbuf_append_char(buf, '\n');
+        if (eol == end || eol + 1 == end)
             break;
         content = eol + 1;
     }
-
-    return strbuf_free_nobuf(buf);
 }
 
-static int list_cmp(const char *s1, const char *s2)
+/* Returns the length of the longest prefix of content not longer than
+ * max_size ending at the end of a line, or max_size if the first line is
+ * longer than that.
+ */
+static size_t truncated_text_len(const char *content, size_t max_size)
 {
-    static const char *const list_order[] = {
-            FILENAME_REASON    ,
-            FILENAME_TIME      ,
-            FILENAME_CMDLINE   ,
-            FILENAME_PACKAGE   ,
-            FILENAME_UID       ,
-            FILENAME_COUNT     ,
-            NULL
-    };
-    int s1_index = index_of_string_in_list(s1, list_order);
-    int s2_index = index_of_string_in_list(s2, list_order);
-
-    if(s1_index < 0 && s2_index < 0)
-        return strcmp(s1, s2);
-
-    if(s1_index < 0)
-        return 1;
-
-    if(s2_index < 0)
-        return -1;
-
-    return s1_index - s2_index;
+    const char *eol = memrchr(content, '\n', max_size);
+    return eol ? (size_t)(eol - content + 1) : max_size;
 }
 
 char *make_description(problem_data_t *problem_data, char **names_to_skip,
@@ -84,36 +150,21 @@ char *make_description(problem_data_t *problem_data, char **names_to_skip,
     const char *type = problem_data_get_content_or_NULL(problem_data,
                                                             FILENAME_TYPE);
 
-    GList *list = g_hash_table_get_keys(problem_data);
-    list = g_list_sort(list, (GCompareFunc)list_cmp);
-    GList *l;
+    struct description_item *plan = NULL;
+    const unsigned plan_size = build_description_plan(problem_data, names_to_skip, desc_flags, &plan);
 
     /* Print one-liners. Format:
      * NAME1: <maybe more spaces>VALUE1
      * NAME2: <maybe more spaces>VALUE2
      */
     bool empty = true;
-    l = list;
-    while (l)
+    for (unsigned i = 0; i < plan_size; ++i)
     {
-        const char *key = l->data;
-        l = l->next;
-
-        /* Skip items we are not interested in */
-//TODO: optimize by doing this once, not 3 times:
-        if (names_to_skip
-            && rejected_name(key, names_to_skip, desc_flags))
-            continue;
-
-        struct problem_item *item = g_hash_table_lookup(problem_data, key);
-        if (!item)
-            continue;
-
-        if ((desc_flags & MAKEDESC_SHOW_ONLY_LIST) && !(item->flags & CD_FLAG_LIST))
-            continue;
+        const char *key = plan[i].di_name;
+        struct problem_item *item = plan[i].di_item;
 
         if ((item->flags & CD_FLAG_TXT)
-         && !strchr(item->content, '\n')
+         && !memchr(item->content, '\n', plan[i].di_text_len)
         ) {
             char *formatted = problem_item_format(item);
             char *output = formatted ? formatted : item->content;
@@ -191,26 +242,13 @@ char *make_description(problem_data_t *problem_data, char **names_to_skip,
          * In many cases, it is useful to know how big binary files are
          * (for example, helps with diagnosing bug upload problems)
          */
-        l = list;
-        while (l)
+        for (unsigned i = 0; i < plan_size; ++i)
         {
-            const char *key = l->data;
-            l = l->next;
-
-            /* Skip items we are not interested in */
-            if (names_to_skip
-                && rejected_name(key, names_to_skip, desc_flags))
-                continue;
-
-            struct problem_item *item = g_hash_table_lookup(problem_data, key);
-            if (!item)
-                continue;
-
-            if ((desc_flags & MAKEDESC_SHOW_ONLY_LIST) && !(item->flags & CD_FLAG_LIST))
-                continue;
+            const char *key = plan[i].di_name;
+            struct problem_item *item = plan[i].di_item;
 
             if ((item->flags & CD_FLAG_BIN)
-             || ((item->flags & CD_FLAG_TXT) && strlen(item->content) > max_text_size)
+             || ((item->flags & CD_FLAG_TXT) && plan[i].di_text_len > max_text_size)
             ) {
                 if (append_empty_line)
                     strbuf_append_char(buf_dsc, '\n');
@@ -245,47 +283,46 @@ char *make_description(problem_data_t *problem_data, char **names_to_skip,
          * :LINE2
          * :LINE3
          */
-        l = list;
-        while (l)
+        const bool is_kerneloops = type && strcmp(type, "Kerneloops") == 0;
+        for (unsigned i = 0; i < plan_size; ++i)
         {
-            const char *key = l->data;
-            l = l->next;
+            const char *key = plan[i].di_name;
+            struct problem_item *item = plan[i].di_item;
+            const size_t text_len = plan[i].di_text_len;
 
-            /* Skip items we are not interested in */
-            if (names_to_skip
-                && rejected_name(key, names_to_skip, desc_flags))
+            if (!(item->flags & CD_FLAG_TXT)
+                || !memchr(item->content, '\n', text_len))
                 continue;
 
-            struct problem_item *item = g_hash_table_lookup(problem_data, key);
-            if (!item)
-                continue;
+            size_t len = text_len;
+            if (text_len > max_text_size
+                && !(is_kerneloops && strcmp(key, FILENAME_BACKTRACE) == 0))
+            {
+                if (!(desc_flags & MAKEDESC_TRUNCATE_TEXT))
+                    continue;
 
-            if ((desc_flags & MAKEDESC_SHOW_ONLY_LIST) && !(item->flags & CD_FLAG_LIST))
-                continue;
+                /* Print only the beginning straight from the content */
+                len = truncated_text_len(item->content, max_text_size);
+            }
 
-            if ((item->flags & CD_FLAG_TXT)
-                && (strlen(item->content) <= max_text_size
-                    || (!strcmp(type, "Kerneloops") && !strcmp(key, FILENAME_BACKTRACE))))
-            {
-                char *formatted = problem_item_format(item);
-                char *output = make_description_item_multiline(key, formatted ? formatted : item->content);
+            if (!empty)
+                strbuf_append_char(buf_dsc, '\n');
 
-                if (output)
-                {
-                    if (!empty)
-                        strbuf_append_str(buf_dsc, "\n");
+            char *formatted = (len == text_len) ? problem_item_format(item) : NULL;
+            if (formatted)
+                append_item_multiline(buf_dsc, key, formatted, strlen(formatted));
+            else
+                append_item_multiline(buf_dsc, key, item->content, len);
+            free(formatted);
 
-                    strbuf_append_str(buf_dsc, output);
-                    empty = false;
-                    free(output);
-                }
+            if (len != text_len)
+                strbuf_append_strf(buf_dsc, "[truncated to %zu of %zu bytes]\n", len, text_len);
 
-                free(formatted);
-            }
+            empty = false;
         }
     }
 
-    g_list_free(list);
+    free(plan);
 
     return strbuf_free_nobuf(buf_dsc);
 }
@@ -0,0 +1,407 @@
+/*
+    Copyright (C) 2026  ABRT team
+    Copyright (C) 2026  RedHat Inc
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <pthread.h>
+#include <sys/file.h>
+#include "internal_libreport.h"
+#include "metrics.h"
+
+#define METRICS_PREFIX "libreport_"
+
+int g_metrics_enabled;
+
+static char *s_path;
+static struct metrics_snapshot s_metrics;
+
+struct metric_def
+{
+    const char *md_name;
+    const char *md_help;
+};
+
+static const struct metric_def s_counters[] = {
+#define METRIC_DEF(name, help) { #name, help },
+    LIBREPORT_METRICS_COUNTERS(METRIC_DEF)
+};
+
+static const struct metric_def s_histograms[] = {
+    LIBREPORT_METRICS_HISTOGRAMS(METRIC_DEF)
+#undef METRIC_DEF
+};
+
+/* The bounds are written as strings, the files must not depend on
+ * LC_NUMERIC
+ */
+static const char *const s_bound_names[METRICS_BUCKETS] = {
+    "0.001", "0.005", "0.01", "0.05", "0.1", "0.5", "1", "5", "10", "60", "+Inf",
+};
+
+static const unsigned long long s_bound_ns[METRICS_BUCKETS - 1] = {
+    1000000ULL, 5000000ULL, 10000000ULL, 50000000ULL, 100000000ULL,
+    500000000ULL, 1000000000ULL, 5000000000ULL, 10000000000ULL, 60000000000ULL,
+};
+
+/* The child would add the metrics of the parent again */
+static void metrics_atfork_child(void)
+{
+    metrics_reset();
+}
+
+void metrics_enable(const char *path)
+{
+    static bool s_atfork_registered;
+    if (path != NULL && !s_atfork_registered)
+    {
+        pthread_atfork(NULL, NULL, metrics_atfork_child);
+        s_atfork_registered = true;
+    }
+
+    free(s_path);
+    s_path = path ? xstrdup(path) : NULL;
+    g_metrics_enabled = (s_path != NULL);
+}
+
+void metrics_counter_add(enum metric_counter counter, unsigned long long value)
+{
+    if ((unsigned)counter >= METRIC_COUNTER_COUNT)
+        return;
+
+    __atomic_add_fetch(&s_metrics.ms_counters[counter], value, __ATOMIC_RELAXED);
+}
+
+void metrics_observe(enum metric_histogram histogram, unsigned long long ns)
+{
+    if ((unsigned)histogram >= METRIC_HISTOGRAM_COUNT)
+        return;
+
+    unsigned bucket = 0;
+    while (bucket < METRICS_BUCKETS - 1 && ns > s_bound_ns[bucket])
+        ++bucket;
+
+    struct metrics_histogram *h = &s_metrics.ms_histograms[histogram];
+    __atomic_add_fetch(&h->mh_buckets[bucket], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&h->mh_count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&h->mh_sum_ns, ns, __ATOMIC_RELAXED);
+}
+
+void metrics_get_snapshot(struct metrics_snapshot *snapshot)
+{
+    const unsigned long long *src = (const unsigned long long *)&s_metrics;
+    unsigned long long *dst = (unsigned long long *)snapshot;
+    for (size_t i = 0; i < sizeof(*snapshot) / sizeof(*dst); ++i)
+        dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+}
+
+void metrics_reset(void)
+{
+    memset(&s_metrics, 0, sizeof(s_metrics));
+}
+
+/* Subtracts the snapshot, keeps the values added since it was taken */
+static void metrics_subtract(const struct metrics_snapshot *snapshot)
+{
+    const unsigned long long *src = (const unsigned long long *)snapshot;
+    unsigned long long *dst = (unsigned long long *)&s_metrics;
+    for (size_t i = 0; i < sizeof(*snapshot) / sizeof(*dst); ++i)
+        __atomic_sub_fetch(&dst[i], src[i], __ATOMIC_RELAXED);
+}
+
+static void metrics_snapshot_add(struct metrics_snapshot *dst, const struct metrics_snapshot *src)
+{
+    const unsigned long long *s = (const unsigned long long *)src;
+    unsigned long long *d = (unsigned long long *)dst;
+    for (size_t i = 0; i < sizeof(*dst) / sizeof(*d); ++i)
+        d[i] += s[i];
+}
+
+static bool metrics_snapshot_is_empty(const struct metrics_snapshot *snapshot)
+{
+    const unsigned long long *s = (const unsigned long long *)snapshot;
+    for (size_t i = 0; i < sizeof(*snapshot) / sizeof(*s); ++i)
+        if (s[i] != 0)
+            return false;
+
+    return true;
+}
+
+/* Parses seconds written by "%llu.%09llu" */
+static unsigned long long parse_seconds_ns(const char *value)
+{
+    char *end;
+    unsigned long long ns = strtoull(value, &end, 10) * 1000000000ULL;
+    if (*end == '.')
+    {
+        unsigned long long scale = 100000000ULL;
+        for (++end; isdigit(*end) && scale != 0; ++end, scale /= 10)
+            ns += (*end - '0') * scale;
+    }
+
+    return ns;
+}
+
+/* @return Rest of the string if it starts with prefix, NULL otherwise */
+static const char *skip_prefix(const char *str, const char *prefix)
+{
+    const size_t len = strlen(prefix);
+    return strncmp(str, prefix, len) == 0 ? str + len : NULL;
+}
+
+static void metrics_parse_histogram_line(struct metrics_histogram *h, const char *suffix,
+                                         const char *value)
+{
+    const char *le = skip_prefix(suffix, "_bucket{le=\"");
+    if (le != NULL)
+    {
+        for (unsigned i = 0; i < METRICS_BUCKETS; ++i)
+        {
+            const char *rest = skip_prefix(le, s_bound_names[i]);
+            if (rest != NULL && strcmp(rest, "\"}") == 0)
+            {
+                h->mh_buckets[i] = strtoull(value, NULL, 10);
+                return;
+            }
+        }
+    }
+    else if (strcmp(suffix, "_sum") == 0)
+        h->mh_sum_ns = parse_seconds_ns(value);
+    else if (strcmp(suffix, "_count") == 0)
+        h->mh_count = strtoull(value, NULL, 10);
+}
+
+static void metrics_parse_line(struct metrics_snapshot *snapshot, char *line)
+{
+    if (line[0] == '#')
+        return;
+
+    char *space = strrchr(line, ' ');
+    if (space == NULL)
+        return;
+    *space = '\0';
+    const char *value = space + 1;
+
+    const char *name = skip_prefix(line, METRICS_PREFIX);
+    if (name == NULL)
+        return;
+
+    for (unsigned i = 0; i < METRIC_COUNTER_COUNT; ++i)
+    {
+        const char *suffix = skip_prefix(name, s_counters[i].md_name);
+        if (suffix != NULL && strcmp(suffix, "_total") == 0)
+        {
+            snapshot->ms_counters[i] = strtoull(value, NULL, 10);
+            return;
+        }
+    }
+
+    for (unsigned i = 0; i < METRIC_HISTOGRAM_COUNT; ++i)
+    {
+        const char *suffix = skip_prefix(name, s_histograms[i].md_name);
+        if (suffix != NULL)
+            suffix = skip_prefix(suffix, "_seconds");
+        if (suffix != NULL)
+        {
+            metrics_parse_histogram_line(&snapshot->ms_histograms[i], suffix, value);
+            return;
+        }
+    }
+}
+
+int metrics_load_snapshot(const char *path, struct metrics_snapshot *snapshot)
+{
+    memset(snapshot, 0, sizeof(*snapshot));
+
+    char *text = xmalloc_open_read_close(path, NULL);
+    if (text == NULL)
+        return -errno;
+
+    char *saveptr = NULL;
+    for (char *line = strtok_r(text, "\n", &saveptr); line; line = strtok_r(NULL, "\n", &saveptr))
+        metrics_parse_line(snapshot, line);
+
+    free(text);
+
+    /* The file has cumulative buckets */
+    for (unsigned i = 0; i < METRIC_HISTOGRAM_COUNT; ++i)
+    {
+        unsigned long long *buckets = snapshot->ms_histograms[i].mh_buckets;
+        for (unsigned b = METRICS_BUCKETS - 1; b > 0; --b)
+            buckets[b] = buckets[b] > buckets[b - 1] ? buckets[b] - buckets[b - 1] : 0;
+    }
+
+    return 0;
+}
+
+void metrics_write_prometheus(int fd, const struct metrics_snapshot *snapshot)
+{
+    struct strbuf *buf = strbuf_new();
+
+    for (unsigned i = 0; i < METRIC_COUNTER_COUNT; ++i)
+    {
+        const char *name = s_counters[i].md_name;
+        strbuf_append_strf(buf,
+                "# HELP "METRICS_PREFIX"%s_total %s\n"
+                "# TYPE "METRICS_PREFIX"%s_total counter\n"
+                METRICS_PREFIX"%s_total %llu\n",
+                name, s_counters[i].md_help, name, name, snapshot->ms_counters[i]);
+    }
+
+    for (unsigned i = 0; i < METRIC_HISTOGRAM_COUNT; ++i)
+    {
+        const char *name = s_histograms[i].md_name;
+        const struct metrics_histogram *h = &snapshot->ms_histograms[i];
+        strbuf_append_strf(buf,
+                "# HELP "METRICS_PREFIX"%s_seconds %s\n"
+                "# TYPE "METRICS_PREFIX"%s_seconds histogram\n",
+                name, s_histograms[i].md_help, name);
+
+        unsigned long long cumulative = 0;
+        for (unsigned b = 0; b < METRICS_BUCKETS; ++b)
+        {
+            cumulative += h->mh_buckets[b];
+            strbuf_append_strf(buf, METRICS_PREFIX"%s_seconds_bucket{le=\"%s\"} %llu\n",
+                               name, s_bound_names[b], cumulative);
+        }
+
+        strbuf_append_strf(buf,
+                METRICS_PREFIX"%s_seconds_sum %llu.%09llu\n"
+                METRICS_PREFIX"%s_seconds_count %llu\n",
+                name, h->mh_sum_ns / 1000000000ULL, h->mh_sum_ns % 1000000000ULL,
+                name, h->mh_count);
+    }
+
+    full_write(fd, buf->buf, buf->len);
+    strbuf_free(buf);
+}
+
+void metrics_write_json(int fd, const struct metrics_snapshot *snapshot)
+{
+    struct strbuf *buf = strbuf_new();
+    strbuf_append_char(buf, '{');
+
+    for (unsigned i = 0; i < METRIC_COUNTER_COUNT; ++i)
+        strbuf_append_strf(buf, "%s\"%s\":%llu",
+                           i ? "," : "", s_counters[i].md_name, snapshot->ms_counters[i]);
+
+    for (unsigned i = 0; i < METRIC_HISTOGRAM_COUNT; ++i)
+    {
+        const struct metrics_histogram *h = &snapshot->ms_histograms[i];
+        strbuf_append_strf(buf, ",\"%s\":{\"buckets\":{", s_histograms[i].md_name);
+
+        unsigned long long cumulative = 0;
+        for (unsigned b = 0; b < METRICS_BUCKETS; ++b)
+        {
+            cumulative += h->mh_buckets[b];
+            strbuf_append_strf(buf, "%s\"%s\":%llu", b ? "," : "", s_bound_names[b], cumulative);
+        }
+
+        strbuf_append_strf(buf, "},\"count\":%llu,\"sum\":%llu.%09llu}",
+                           h->mh_count, h->mh_sum_ns / 1000000000ULL, h->mh_sum_ns % 1000000000ULL);
+    }
+
+    strbuf_append_str(buf, "}\n");
+    full_write(fd, buf->buf, buf->len);
+    strbuf_free(buf);
+}
+
+/* Replaces the file by a temporary file, readers never see a partial file */
+static int metrics_save(const char *path, const struct metrics_snapshot *snapshot)
+{
+    char *tmp = xasprintf("%s.XXXXXX", path);
+    int r = 0;
+
+    const int fd = mkstemp(tmp);
+    if (fd < 0)
+    {
+        r = -errno;
+        perror_msg("Can't create '%s'", tmp);
+        goto ret;
+    }
+
+    /* node_exporter usually runs as an other user */
+    fchmod(fd, 0644);
+    metrics_write_prometheus(fd, snapshot);
+    close(fd);
+
+    if (rename(tmp, path) != 0)
+    {
+        r = -errno;
+        perror_msg("Can't rename '%s' to '%s'", tmp, path);
+        unlink(tmp);
+    }
+
+ ret:
+    free(tmp);
+    return r;
+}
+
+int metrics_flush(void)
+{
+    if (!g_metrics_enabled)
+        return 0;
+
+    struct metrics_snapshot own;
+    metrics_get_snapshot(&own);
+    if (metrics_snapshot_is_empty(&own))
+        return 0;
+
+    /* Serializes the read-add-write cycles of all processes */
+    char *lock_path = xasprintf("%s.lock", s_path);
+    int r = 0;
+    const int lock_fd = open(lock_path, O_RDONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (lock_fd < 0 || flock(lock_fd, LOCK_EX) != 0)
+    {
+        r = -errno;
+        perror_msg("Can't lock '%s'", lock_path);
+        goto ret;
+    }
+
+    struct metrics_snapshot total;
+    r = metrics_load_snapshot(s_path, &total);
+    if (r != 0 && r != -ENOENT)
+    {
+        /* Don't reset the metrics of the other processes */
+        error_msg("Can't read '%s': %s", s_path, strerror(-r));
+        goto ret;
+    }
+
+    metrics_snapshot_add(&total, &own);
+    r = metrics_save(s_path, &total);
+    /* Keep the metrics for the next attempt if they weren't saved */
+    if (r == 0)
+        metrics_subtract(&own);
+
+ ret:
+    if (lock_fd >= 0)
+        close(lock_fd);
+    free(lock_path);
+    return r;
+}
+
+static void __attribute__((constructor)) metrics_init(void)
+{
+    const char *path = getenv("LIBREPORT_METRICS_FILE");
+    if (path == NULL || path[0] == '\0')
+        return;
+
+    metrics_enable(path);
+}
+
+static void __attribute__((destructor)) metrics_flush_at_exit(void)
+{
+    metrics_flush();
+}
@@ -17,6 +17,7 @@
     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 */
 #include "internal_libreport.h"
+#include "trace.h"
 
 static void free_problem_item(void *ptr)
 {
@@ -496,6 +497,8 @@ int problem_data_load_dump_dir_element(struct dump_dir *dd, const char *name, ch
 
 void problem_data_load_from_dump_dir(problem_data_t *problem_data, struct dump_dir *dd, char **excluding)
 {
+    TRACE_BEGIN(problem_data_load);
+
     char *short_name;
     char *full_name;
 
@@ -562,6 +565,8 @@ void problem_data_load_from_dump_dir(problem_data_t *problem_data, struct dump_d
         free(short_name);
         free(full_name);
     }
+
+    TRACE_END(problem_data_load, dd->dd_dirname);
 }
 
 problem_data_t *create_problem_data_from_dump_dir(struct dump_dir *dd)
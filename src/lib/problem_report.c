@@ -153,45 +153,6 @@ split_string_on_char(const char *str, char ch)
     return g_list_reverse(list);
 }
 
-static int
-compare_item_name(const char *lookup, const char *name)
-{
-    if (lookup[0] == '-')
-        lookup++;
-    else if (strncmp(lookup, "%bare_", 6) == 0)
-        lookup += 6;
-    return strcmp(lookup, name);
-}
-
-static int
-is_item_name_in_section(const section_t *lookup, const char *name)
-{
-    if (g_list_find_custom(lookup->items, name, (GCompareFunc)compare_item_name))
-        return 0; /* "found it!" */
-    return 1;
-}
-
-static bool is_explicit_or_forbidden(const char *name, GList *comment_fmt_spec);
-
-static int
-is_explicit_or_forbidden_child(const section_t *master_section, const char *name)
-{
-    if (is_explicit_or_forbidden(name, master_section->children))
-        return 0; /* "found it!" */
-    return 1;
-}
-
-/* For example: 'package' belongs to '%oneline', but 'package' is used in
- * 'Version of component', so it is not very helpful to include that file once
- * more in another section
- */
-static bool
-is_explicit_or_forbidden(const char *name, GList *comment_fmt_spec)
-{
-    return    g_list_find_custom(comment_fmt_spec, name, (GCompareFunc)is_item_name_in_section)
-           || g_list_find_custom(comment_fmt_spec, name, (GCompareFunc)is_explicit_or_forbidden_child);
-}
-
 static GList*
 load_stream(FILE *fp)
 {
@@ -301,41 +262,389 @@ load_stream(FILE *fp)
 }
 
 
+/* Compiled format
+ *
+ * Generating a report from the parsed sections would mean to search all
+ * sections for every element printed by %oneline, %multiline, %text or
+ * attached by %binary. The parsed sections are therefore compiled into a
+ * flat list of operations with pre-resolved item kinds and a set of all
+ * explicitly mentioned or forbidden elements. A report is then generated by
+ * a single linear pass over the operations.
+ *
+ * For example:
+ *
+ * |%summary:: Hello, world
+ * |%attach:: %binary, -core
+ * |Problem description:: %bare_comment
+ * |
+ * |Package:: package
+ *
+ * is compiled to:
+ *
+ *   FOP_ATTACH   { FIK_BINARY '%binary' }
+ *   FOP_SUMMARY  'Hello, world'
+ *   FOP_SECTION  'description'
+ *   FOP_ITEMS    'Problem description' { FIK_ELEMENT 'comment' (bare) }
+ *   FOP_TEXT     ''
+ *   FOP_ITEMS    'Package' { FIK_ELEMENT 'package' }
+ *
+ * with the explicit set { 'Hello, world', '%binary', 'core', 'comment', 'package' }.
+ *
+ * Compiled formats are immutable and shared by all formatters that loaded
+ * the same file.
+ */
+enum format_op_code
+{
+    FOP_SUMMARY,    ///< format fop_text as a percented string into %summary
+    FOP_ATTACH,     ///< attach fop_items
+    FOP_SECTION,    ///< print the following operations into section fop_text
+    FOP_TEXT,       ///< print the line fop_text (can be empty)
+    FOP_ITEMS,      ///< print fop_items under the title fop_text
+};
+
+enum format_item_kind
+{
+    FIK_ELEMENT,            ///< problem element fi_name
+    FIK_SHORT_BACKTRACE,    ///< %short_backtrace
+    FIK_REPORTER,           ///< %reporter
+    FIK_ONELINE,            ///< %oneline
+    FIK_MULTILINE,          ///< %multiline
+    FIK_TEXT,               ///< %text
+    FIK_BINARY,             ///< %binary (only in %attach)
+    FIK_UNKNOWN,            ///< unsupported specifier fi_name
+};
+
+struct format_item
+{
+    const char *fi_name;            ///< points to the parsed section
+    enum format_item_kind fi_kind;
+    bool fi_print_name;             ///< false for %bare_ items
+};
+
+struct format_op
+{
+    enum format_op_code fop_code;
+    const char *fop_text;           ///< points to the parsed section
+    struct format_item *fop_items;
+    unsigned fop_items_count;
+};
+
+struct format_program
+{
+    unsigned fp_refcount;
+    GList *fp_sections;             ///< parsed sections (struct section_t)
+    struct format_op *fp_ops;
+    unsigned fp_ops_count;
+    GHashTable *fp_explicit;        ///< set of explicitly mentioned or forbidden elements
+};
+
+/* 'package' belongs to '%oneline', but 'package' is used in 'Version of
+ * component', so it is not very helpful to include that file once more in
+ * another section. Neither "-name" items can be included.
+ */
+static void
+format_program_add_explicit_items(struct format_program *self, GList *items)
+{
+    for (GList *iter = items; iter; iter = g_list_next(iter))
+    {
+        const char *name = iter->data;
+        if (name[0] == '-')
+            name++;
+        else if (strncmp(name, "%bare_", strlen("%bare_")) == 0)
+            name += strlen("%bare_");
+
+        g_hash_table_add(self->fp_explicit, (gpointer)name);
+    }
+}
+
+static struct format_op *
+format_program_append_op(struct format_program *self, enum format_op_code code, const char *text)
+{
+    self->fp_ops = xrealloc(self->fp_ops, (self->fp_ops_count + 1) * sizeof(*self->fp_ops));
+
+    struct format_op *op = self->fp_ops + self->fp_ops_count++;
+    op->fop_code = code;
+    op->fop_text = text;
+    op->fop_items = NULL;
+    op->fop_items_count = 0;
+
+    return op;
+}
+
+static void
+format_op_compile_items(struct format_op *op, GList *items, bool attach)
+{
+    op->fop_items = xmalloc((g_list_length(items) + 1) * sizeof(*op->fop_items));
+
+    for (GList *iter = items; iter; iter = g_list_next(iter))
+    {
+        const char *name = iter->data;
+        if (name[0] == '-') /* "-name", ignore it */
+            continue;
+
+        struct format_item *item = op->fop_items + op->fop_items_count++;
+        item->fi_name = name;
+        item->fi_kind = FIK_ELEMENT;
+        item->fi_print_name = true;
+
+        if (!attach && strncmp(name, "%bare_", strlen("%bare_")) == 0)
+        {
+            item->fi_name = name + strlen("%bare_");
+            item->fi_print_name = false;
+        }
+
+        if (item->fi_name[0] != '%')
+            continue;
+
+        const char *specifier = item->fi_name + 1;
+        /* Compat with previously-existed ad-hockery: %short_backtrace, %reporter */
+        if (!attach && strcmp(specifier, "short_backtrace") == 0)
+            item->fi_kind = FIK_SHORT_BACKTRACE;
+        else if (!attach && strcmp(specifier, "reporter") == 0)
+            item->fi_kind = FIK_REPORTER;
+        else if (strcmp(specifier, "oneline") == 0)
+            item->fi_kind = FIK_ONELINE;
+        else if (strcmp(specifier, "multiline") == 0)
+            item->fi_kind = FIK_MULTILINE;
+        else if (strcmp(specifier, "text") == 0)
+            item->fi_kind = FIK_TEXT;
+        else if (attach && strcmp(specifier, "binary") == 0)
+            item->fi_kind = FIK_BINARY;
+        else
+            item->fi_kind = FIK_UNKNOWN;
+    }
+}
+
+static struct format_program *
+format_program_compile(GList *sections)
+{
+    struct format_program *self = xzalloc(sizeof(*self));
+    self->fp_refcount = 1;
+    self->fp_sections = sections;
+    self->fp_explicit = g_hash_table_new(g_str_hash, g_str_equal);
+
+    for (GList *iter = sections; iter; iter = g_list_next(iter))
+    {
+        section_t *section = (section_t *)iter->data;
+
+        format_program_add_explicit_items(self, section->items);
+        for (GList *child = section->children; child; child = g_list_next(child))
+            format_program_add_explicit_items(self, ((section_t *)child->data)->items);
+
+        /* %summary is something special */
+        if (strcmp(section->name, "%summary") == 0)
+        {
+            format_program_append_op(self, FOP_SUMMARY, (const char *)section->items->data);
+            continue;
+        }
+
+        /* %attach as well */
+        if (strcmp(section->name, "%attach") == 0)
+        {
+            struct format_op *op = format_program_append_op(self, FOP_ATTACH, NULL);
+            format_op_compile_items(op, section->items, /*attach*/true);
+            continue;
+        }
+
+        /* %description or a custom section (e.g. %additional_info) */
+        format_program_append_op(self, FOP_SECTION, section->name + 1);
+        for (GList *child = section->children; child; child = g_list_next(child))
+        {
+            section_t *sec = (section_t *)child->data;
+            if (sec->items == NULL)
+            {
+                format_program_append_op(self, FOP_TEXT, sec->name);
+                continue;
+            }
+
+            struct format_op *op = format_program_append_op(self, FOP_ITEMS, sec->name);
+            format_op_compile_items(op, sec->items, /*attach*/false);
+        }
+    }
+
+    return self;
+}
+
+static struct format_program *
+format_program_ref(struct format_program *self)
+{
+    if (self != NULL)
+        ++self->fp_refcount;
+
+    return self;
+}
+
+static void
+format_program_unref(struct format_program *self)
+{
+    if (self == NULL || --self->fp_refcount != 0)
+        return;
+
+    for (unsigned i = 0; i < self->fp_ops_count; ++i)
+        free(self->fp_ops[i].fop_items);
+    free(self->fp_ops);
+    self->fp_ops = DESTROYED_POINTER;
+
+    g_hash_table_destroy(self->fp_explicit);
+    self->fp_explicit = DESTROYED_POINTER;
+
+    g_list_free_full(self->fp_sections, (GDestroyNotify)section_free);
+    self->fp_sections = DESTROYED_POINTER;
+
+    free(self);
+}
+
+/* Compiled format files are cached for the whole process, a file is loaded
+ * again only if it changed since the last load.
+ */
+struct format_cache_entry
+{
+    dev_t fce_dev;
+    ino_t fce_ino;
+    off_t fce_size;
+    struct timespec fce_mtime;
+    struct format_program *fce_program;
+};
+
+static GHashTable *s_format_cache;
+
+static void
+format_cache_entry_free(struct format_cache_entry *self)
+{
+    format_program_unref(self->fce_program);
+    free(self);
+}
+
+static bool
+format_cache_entry_matches(const struct format_cache_entry *self, const struct stat *st)
+{
+    return self->fce_dev == st->st_dev
+        && self->fce_ino == st->st_ino
+        && self->fce_size == st->st_size
+        && self->fce_mtime.tv_sec == st->st_mtim.tv_sec
+        && self->fce_mtime.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+static struct format_program *
+format_cache_load(const char *path)
+{
+    if (s_format_cache == NULL)
+        s_format_cache = g_hash_table_new_full(g_str_hash, g_str_equal, free,
+                                               (GDestroyNotify)format_cache_entry_free);
+
+    struct format_cache_entry *entry = g_hash_table_lookup(s_format_cache, path);
+
+    struct stat st;
+    if (entry != NULL && stat(path, &st) == 0 && format_cache_entry_matches(entry, &st))
+    {
+        log_debug("Using cached problem format '%s'", path);
+        return format_program_ref(entry->fce_program);
+    }
+
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+        return NULL;
+
+    /* The opened file is what is parsed, not what was at path a while ago */
+    if (fstat(fileno(fp), &st) != 0)
+    {
+        perror_msg("Can't stat '%s'", path);
+        fclose(fp);
+        return NULL;
+    }
+
+    struct format_program *program = format_program_compile(load_stream(fp));
+    fclose(fp);
+
+    entry = xmalloc(sizeof(*entry));
+    entry->fce_dev = st.st_dev;
+    entry->fce_ino = st.st_ino;
+    entry->fce_size = st.st_size;
+    entry->fce_mtime = st.st_mtim;
+    entry->fce_program = format_program_ref(program);
+    g_hash_table_replace(s_format_cache, xstrdup(path), entry);
+
+    return program;
+}
+
+/* State of a single report generation */
+struct format_context
+{
+    problem_data_t *fc_data;
+    const struct format_program *fc_program;
+    problem_report_settings_t *fc_settings;
+    GList *fc_implicit_names;   ///< sorted names of elements not in fp_explicit
+    bool fc_implicit_ready;
+};
+
+/* Returns sorted names of elements that are neither explicitly mentioned nor
+ * forbidden in the format. The list is built on the first use and shared by
+ * all %oneline, %multiline, %text and %binary items.
+ */
+static GList *
+format_context_get_implicit_names(struct format_context *ctx)
+{
+    if (ctx->fc_implicit_ready)
+        return ctx->fc_implicit_names;
+
+    GHashTableIter iter;
+    g_hash_table_iter_init(&iter, ctx->fc_data);
+    const char *name;
+    while (g_hash_table_iter_next(&iter, (gpointer *)&name, NULL))
+    {
+        if (!g_hash_table_contains(ctx->fc_program->fp_explicit, name))
+            ctx->fc_implicit_names = g_list_prepend(ctx->fc_implicit_names, (gpointer)name);
+    }
+
+    ctx->fc_implicit_names = g_list_sort(ctx->fc_implicit_names, (GCompareFunc)strcmp);
+    ctx->fc_implicit_ready = true;
+
+    return ctx->fc_implicit_names;
+}
+
+static void
+format_context_destroy(struct format_context *ctx)
+{
+    g_list_free(ctx->fc_implicit_names); /* names themselves are not freed */
+}
+
+
 /* Summary generation */
 
 #define MAX_OPT_DEPTH 10
 static int
-format_percented_string(const char *str, problem_data_t *pd, FILE *result)
+format_percented_string(const char *str, problem_data_t *pd, struct strbuf *result)
 {
-    long old_pos[MAX_OPT_DEPTH] = { 0 };
+    int old_pos[MAX_OPT_DEPTH] = { 0 };
     int okay[MAX_OPT_DEPTH] = { 1 };
-    long len = 0;
     int opt_depth = 1;
 
     while (*str) {
+        /* Copy runs of ordinary characters at once */
+        const size_t plain = strcspn(str, "\\[]%");
+        if (plain != 0)
+        {
+            strbuf_append_strn(result, str, plain);
+            str += plain;
+            continue;
+        }
+
         switch (*str) {
-        default:
-            putc(*str, result);
-            len++;
-            str++;
-            break;
         case '\\':
             if (str[1])
                 str++;
-            putc(*str, result);
-            len++;
+            strbuf_append_char(result, *str);
             str++;
             break;
         case '[':
             if (str[1] == '[' && opt_depth < MAX_OPT_DEPTH)
             {
-                old_pos[opt_depth] = len;
+                old_pos[opt_depth] = result->len;
                 okay[opt_depth] = 1;
                 opt_depth++;
                 str += 2;
             } else {
-                putc(*str, result);
-                len++;
+                strbuf_append_char(result, *str);
                 str++;
             }
             break;
@@ -345,14 +654,13 @@ format_percented_string(const char *str, problem_data_t *pd, FILE *result)
                 opt_depth--;
                 if (!okay[opt_depth])
                 {
-                    if (fseek(result, old_pos[opt_depth], SEEK_SET) < 0)
-                        perror_msg_and_die("fseek");
-                    len = old_pos[opt_depth];
+                    /* Drop the optional part */
+                    result->len = old_pos[opt_depth];
+                    result->buf[result->len] = '\0';
                 }
                 str += 2;
             } else {
-                putc(*str, result);
-                len++;
+                strbuf_append_char(result, *str);
                 str++;
             }
             break;
@@ -368,10 +676,7 @@ format_percented_string(const char *str, problem_data_t *pd, FILE *result)
             *nextpercent = '%';
 
             if (item && (item->flags & CD_FLAG_TXT))
-            {
-                fputs(item->content, result);
-                len += strlen(item->content);
-            }
+                strbuf_append_str(result, item->content);
             else
                 okay[opt_depth - 1] = 0;
             str = nextpercent + 1;
@@ -397,37 +702,42 @@ format_percented_string(const char *str, problem_data_t *pd, FILE *result)
 static int
 append_text(struct strbuf *result, const char *item_name, const char *content, bool print_item_name)
 {
-    char *eol = strchrnul(content, '\n');
+    const char *eol = strchrnul(content, '\n');
     if (eol[0] == '\0' || eol[1] == '\0')
     {
         /* one-liner */
-        int pad = 16 - (strlen(item_name) + 2);
-        if (pad < 0)
-            pad = 0;
         if (print_item_name)
-            strbuf_append_strf(result,
-                    eol[0] == '\0' ? "%s: %*s%s\n" : "%s: %*s%s",
-                    item_name, pad, "", content
-            );
-        else
-            strbuf_append_strf(result,
-                    eol[0] == '\0' ? "%s\n" : "%s",
-                    content
-            );
+        {
+            int pad = 16 - (strlen(item_name) + 2);
+            if (pad < 0)
+                pad = 0;
+            strbuf_append_str(result, item_name);
+            strbuf_append_strn(result, ":                ", 2 + pad);
+        }
+        strbuf_append_str(result, content);
+        if (eol[0] == '\0')
+            strbuf_append_char(result, '\n');
+    }
+    else if (!print_item_name)
+    {
+        /* multi-line %bare_item is copied as is, only with the last line
+         * terminated */
+        const size_t len = strlen(content);
+        strbuf_append_strn(result, content, len);
+        if (content[len - 1] != '\n')
+            strbuf_append_char(result, '\n');
     }
     else
     {
-        /* multi-line item */
-        if (print_item_name)
-            strbuf_append_strf(result, "%s:\n", item_name);
+        /* multi-line item, every line is prefixed with a colon */
+        strbuf_append_str(result, item_name);
+        strbuf_append_strn(result, ":\n", 2);
         for (;;)
         {
             eol = strchrnul(content, '\n');
-            strbuf_append_strf(result,
-                    /* For %bare_multiline_item, we don't want to print colons */
-                    (print_item_name ? ":%.*s\n" : "%.*s\n"),
-                    (int)(eol - content), content
-            );
+            strbuf_append_char(result, ':');
+            strbuf_append_strn(result, content, eol - content);
+            strbuf_append_char(result, '\n');
             if (eol[0] == '\0' || eol[1] == '\0')
                 break;
             content = eol + 1;
@@ -518,52 +828,47 @@ append_short_backtrace(struct strbuf *result, problem_data_t *problem_data, bool
 }
 
 static int
-append_item(struct strbuf *result, const char *item_name, problem_data_t *pd, GList *comment_fmt_spec, problem_report_settings_t *settings)
+append_item(struct strbuf *result, const struct format_item *fi, struct format_context *ctx)
 {
-    bool print_item_name = (strncmp(item_name, "%bare_", strlen("%bare_")) != 0);
-    if (!print_item_name)
-        item_name += strlen("%bare_");
+    problem_data_t *pd = ctx->fc_data;
+    const bool print_item_name = fi->fi_print_name;
 
-    if (item_name[0] != '%')
+    switch (fi->fi_kind)
     {
-        struct problem_item *item = problem_data_get_item_or_NULL(pd, item_name);
-        if (!item)
-            return 0; /* "I did not print anything" */
-        if (!(item->flags & CD_FLAG_TXT))
+        case FIK_ELEMENT:
+        {
+            struct problem_item *item = problem_data_get_item_or_NULL(pd, fi->fi_name);
+            if (!item)
+                return 0; /* "I did not print anything" */
+            if (!(item->flags & CD_FLAG_TXT))
+                return 0; /* "I did not print anything" */
+
+            char *formatted = problem_item_format(item);
+            char *content = formatted ? formatted : item->content;
+            append_text(result, fi->fi_name, content, print_item_name);
+            free(formatted);
+            return 1; /* "I printed something" */
+        }
+        case FIK_SHORT_BACKTRACE:
+            return append_short_backtrace(result, pd, print_item_name, ctx->fc_settings);
+        case FIK_REPORTER:
+            return append_text(result, "reporter", PACKAGE"-"VERSION, print_item_name);
+        case FIK_ONELINE:
+        case FIK_MULTILINE:
+        case FIK_TEXT:
+            break;
+        default:
+            log("Unknown or unsupported element specifier '%s'", fi->fi_name);
             return 0; /* "I did not print anything" */
-
-        char *formatted = problem_item_format(item);
-        char *content = formatted ? formatted : item->content;
-        append_text(result, item_name, content, print_item_name);
-        free(formatted);
-        return 1; /* "I printed something" */
     }
 
-    /* Special item name */
-
-    /* Compat with previously-existed ad-hockery: %short_backtrace */
-    if (strcmp(item_name, "%short_backtrace") == 0)
-        return append_short_backtrace(result, pd, print_item_name, settings);
-
-    /* Compat with previously-existed ad-hockery: %reporter */
-    if (strcmp(item_name, "%reporter") == 0)
-        return append_text(result, "reporter", PACKAGE"-"VERSION, print_item_name);
-
     /* %oneline,%multiline,%text */
-    bool oneline   = (strcmp(item_name+1, "oneline"  ) == 0);
-    bool multiline = (strcmp(item_name+1, "multiline") == 0);
-    bool text      = (strcmp(item_name+1, "text"     ) == 0);
-    if (!oneline && !multiline && !text)
-    {
-        log("Unknown or unsupported element specifier '%s'", item_name);
-        return 0; /* "I did not print anything" */
-    }
-
+    const bool text = (fi->fi_kind == FIK_TEXT);
+    bool oneline = (fi->fi_kind == FIK_ONELINE);
     int printed = 0;
 
     /* Iterate over _sorted_ items */
-    GList *sorted_names = g_hash_table_get_keys(pd);
-    sorted_names = g_list_sort(sorted_names, (GCompareFunc)strcmp);
+    GList *sorted_names = format_context_get_implicit_names(ctx);
 
     /* %text => do as if %oneline, then repeat as if %multiline */
     if (text)
@@ -582,9 +887,6 @@ append_item(struct strbuf *result, const char *item_name, problem_data_t *pd, GL
         if (!(item->flags & CD_FLAG_TXT))
             continue;
 
-        if (is_explicit_or_forbidden(name, comment_fmt_spec))
-            continue;
-
         char *formatted = problem_item_format(item);
         char *content = formatted ? formatted : item->content;
         char *eol = strchrnul(content, '\n');
@@ -597,222 +899,155 @@ append_item(struct strbuf *result, const char *item_name, problem_data_t *pd, GL
     {
         /* %text, and we just did %oneline. Repeat as if %multiline */
         oneline = 0;
-        /*multiline = 1; - not checked in fact, so why bother setting? */
         goto again;
     }
 
-    g_list_free(sorted_names); /* names themselves are not freed */
-
     return printed;
 }
 
-#define add_to_section_output(format, ...) \
-    do { \
-    for (; empty_lines > 0; --empty_lines) fputc('\n', result); \
-    empty_lines = 0; \
-    fprintf(result, format, __VA_ARGS__); \
-    } while (0)
-
 static void
-format_section(section_t *section, problem_data_t *pd, GList *comment_fmt_spec, FILE *result, problem_report_settings_t *settings)
+flush_empty_lines(struct strbuf *result, int empty_lines)
+{
+    for (; empty_lines > 0; --empty_lines)
+        strbuf_append_char(result, '\n');
+}
+
+/* Executes the operations of a section, returns the first operation that
+ * does not belong to the section.
+ *
+ * Items are rendered directly into the section buffer. If none of them
+ * prints anything, the title is taken back.
+ */
+static const struct format_op *
+format_section(const struct format_op *op, const struct format_op *end, struct format_context *ctx, struct strbuf *result)
 {
     int empty_lines = -1;
 
-    for (GList *iter = section->children; iter; iter = g_list_next(iter))
+    for (; op != end && (op->fop_code == FOP_ITEMS || op->fop_code == FOP_TEXT); ++op)
     {
-        section_t *child = (section_t *)iter->data;
-        if (child->items)
+        if (result == NULL)
+            continue;
+
+        if (op->fop_code == FOP_ITEMS)
         {
             /* "Text: item[,item]..." */
-            struct strbuf *output = strbuf_new();
-            GList *item = child->items;
-            while (item)
+            const int rollback_len = result->len;
+            flush_empty_lines(result, empty_lines);
+            if (op->fop_text[0] != '\0')
             {
-                const char *str = item->data;
-                item = item->next;
-                if (str[0] == '-') /* "-name", ignore it */
-                    continue;
-                append_item(output, str, pd, comment_fmt_spec, settings);
+                strbuf_append_str(result, op->fop_text);
+                strbuf_append_strn(result, ":\n", 2);
             }
 
-            if (output->len != 0)
-                add_to_section_output((child->name[0] ? "%s:\n%s" : "%s%s"),
-                                      child->name, output->buf);
+            const int items_len = result->len;
+            for (unsigned i = 0; i < op->fop_items_count; ++i)
+                append_item(result, op->fop_items + i, ctx);
 
-            strbuf_free(output);
+            if (result->len != items_len)
+                empty_lines = 0;
+            else
+            {
+                result->len = rollback_len;
+                result->buf[result->len] = '\0';
+            }
         }
         else
         {
             /* Just "Text" (can be "") */
 
             /* Filter out trailint empty lines */
-            if (child->name[0] != '\0')
-                add_to_section_output("%s\n", child->name);
+            if (op->fop_text[0] != '\0')
+            {
+                flush_empty_lines(result, empty_lines);
+                empty_lines = 0;
+                strbuf_append_str(result, op->fop_text);
+                strbuf_append_char(result, '\n');
+            }
             /* Do not count empty lines, if output wasn't yet produced */
             else if (empty_lines >= 0)
                 ++empty_lines;
         }
     }
+
+    return op;
 }
 
 static GList *
-get_special_items(const char *item_name, problem_data_t *pd, GList *comment_fmt_spec)
+get_special_items(const struct format_item *fi, struct format_context *ctx)
 {
     /* %oneline,%multiline,%text,%binary */
-    bool oneline   = (strcmp(item_name+1, "oneline"  ) == 0);
-    bool multiline = (strcmp(item_name+1, "multiline") == 0);
-    bool text      = (strcmp(item_name+1, "text"     ) == 0);
-    bool binary    = (strcmp(item_name+1, "binary"   ) == 0);
-    if (!oneline && !multiline && !text && !binary)
+    bool oneline   = (fi->fi_kind == FIK_ONELINE);
+    bool text      = (fi->fi_kind == FIK_TEXT);
+    bool binary    = (fi->fi_kind == FIK_BINARY);
+    if (fi->fi_kind == FIK_UNKNOWN)
     {
-        log("Unknown or unsupported element specifier '%s'", item_name);
+        log("Unknown or unsupported element specifier '%s'", fi->fi_name);
         return NULL;
     }
 
-    log_debug("Special item_name '%s', iterating for attach...", item_name);
+    log_debug("Special item_name '%s', iterating for attach...", fi->fi_name);
     GList *result = 0;
 
     /* Iterate over _sorted_ items */
-    GList *sorted_names = g_hash_table_get_keys(pd);
-    sorted_names = g_list_sort(sorted_names, (GCompareFunc)strcmp);
-
-    GList *l = sorted_names;
-    while (l)
+    for (GList *l = format_context_get_implicit_names(ctx); l; l = g_list_next(l))
     {
         const char *name = l->data;
-        l = l->next;
-        struct problem_item *item = g_hash_table_lookup(pd, name);
+        struct problem_item *item = g_hash_table_lookup(ctx->fc_data, name);
         if (!item)
             continue; /* paranoia, won't happen */
 
-        if (is_explicit_or_forbidden(name, comment_fmt_spec))
-            continue;
-
         if ((item->flags & CD_FLAG_TXT) && !binary)
         {
             char *content = item->content;
             char *eol = strchrnul(content, '\n');
             bool is_oneline = (eol[0] == '\0' || eol[1] == '\0');
             if (text || oneline == is_oneline)
-                result = g_list_append(result, xstrdup(name));
+                result = g_list_prepend(result, xstrdup(name));
         }
         else if ((item->flags & CD_FLAG_BIN) && binary)
-            result = g_list_append(result, xstrdup(name));
+            result = g_list_prepend(result, xstrdup(name));
     }
 
-    g_list_free(sorted_names); /* names themselves are not freed */
-
+    log_debug("...Done iterating over '%s' for attach", fi->fi_name);
 
-    log_debug("...Done iterating over '%s' for attach", item_name);
-
-    return result;
+    return g_list_reverse(result);
 }
 
 static GList *
-get_attached_files(problem_data_t *pd, GList *items, GList *comment_fmt_spec)
+get_attached_files(const struct format_op *op, struct format_context *ctx)
 {
     GList *result = NULL;
-    GList *item = items;
-    while (item != NULL)
+    for (unsigned i = 0; i < op->fop_items_count; ++i)
     {
-        const char *item_name = item->data;
-        item = item->next;
-        if (item_name[0] == '-') /* "-name", ignore it */
-            continue;
-
-        if (item_name[0] != '%')
+        const struct format_item *fi = op->fop_items + i;
+        if (fi->fi_kind == FIK_ELEMENT)
         {
-            result = g_list_append(result, xstrdup(item_name));
+            result = g_list_prepend(result, xstrdup(fi->fi_name));
             continue;
         }
 
-        GList *special = get_special_items(item_name, pd, comment_fmt_spec);
+        GList *special = get_special_items(fi, ctx);
         if (special == NULL)
         {
-            log_notice("No attachment found for '%s'", item_name);
+            log_notice("No attachment found for '%s'", fi->fi_name);
             continue;
         }
 
-        result = g_list_concat(result, special);
+        result = g_list_concat(g_list_reverse(special), result);
     }
 
-    return result;
-}
-
-/*
- * Problem Report - memor stream
- *
- * A wrapper for POSIX memory stream.
- *
- * A memory stream is presented as FILE *.
- *
- * A memory stream is associated with a pointer to written data and a pointer
- * to size of the written data.
- *
- * This structure holds all of the used pointers.
- */
-struct memstream_buffer
-{
-    char *msb_buffer;
-    size_t msb_size;
-    FILE *msb_stream;
-};
-
-static struct memstream_buffer *
-memstream_buffer_new()
-{
-    struct memstream_buffer *self = xmalloc(sizeof(*self));
-
-    self->msb_buffer = NULL;
-    self->msb_stream = open_memstream(&(self->msb_buffer), &(self->msb_size));
-
-    return self;
-}
-
-static void
-memstream_buffer_free(struct memstream_buffer *self)
-{
-    if (self == NULL)
-        return;
-
-    fclose(self->msb_stream);
-    self->msb_stream = DESTROYED_POINTER;
-
-    free(self->msb_buffer);
-    self->msb_buffer = DESTROYED_POINTER;
-
-    free(self);
+    return g_list_reverse(result);
 }
 
-static FILE *
-memstream_get_stream(struct memstream_buffer *self)
-{
-    assert(self != NULL);
-
-    return self->msb_stream;
-}
-
-static const char *
-memstream_get_string(struct memstream_buffer *self)
-{
-    assert(self != NULL);
-    assert(self->msb_stream != NULL);
-
-    fflush(self->msb_stream);
-    self->msb_buffer[self->msb_size] = '\0';
-
-    return self->msb_buffer;
-}
-
-
 /*
  * Problem Report
  *
  * The formated strings are internaly stored in "buffer"s. If a programer wants
- * to get a formated section data, a getter function extracts those data from
- * the apropriate buffer and returns them in form of null-terminated string.
+ * to get a formated section data, a getter function returns the buffer's
+ * string directly, without any copying.
  *
- * Each section has own buffer.
+ * Each section has own buffer. The formatter renders straight into the
+ * buffers, so a section is never copied from a temporary buffer.
  *
  * There are three common sections that are always present:
  * 1. summary
@@ -829,19 +1064,23 @@ memstream_get_string(struct memstream_buffer *self)
  */
 struct problem_report
 {
-    struct memstream_buffer *pr_sec_summ; ///< %summary buffer
-    struct memstream_buffer *pr_sec_desc; ///< %description buffer
+    struct strbuf    *pr_sec_summ;        ///< %summary buffer
+    struct strbuf    *pr_sec_desc;        ///< %description buffer
     GList            *pr_attachments;     ///< %attach - list of file names
     GHashTable       *pr_sec_custom;      ///< map : %(custom section) -> buffer
 };
 
+/* Descriptions are rarely shorter */
+#define PR_DESCRIPTION_INITIAL_SIZE (4 * 1024)
+
 static problem_report_t *
 problem_report_new()
 {
     problem_report_t *self = xmalloc(sizeof(*self));
 
-    self->pr_sec_summ = memstream_buffer_new();
-    self->pr_sec_desc = memstream_buffer_new();
+    self->pr_sec_summ = strbuf_new();
+    self->pr_sec_desc = strbuf_new();
+    strbuf_reserve(self->pr_sec_desc, PR_DESCRIPTION_INITIAL_SIZE);
     self->pr_attachments = NULL;
     self->pr_sec_custom = NULL;
 
@@ -855,7 +1094,7 @@ problem_report_initialize_custom_sections(problem_report_t *self)
     assert(self->pr_sec_custom == NULL);
 
     self->pr_sec_custom = g_hash_table_new_full(g_str_hash, g_str_equal, free,
-                                                (GDestroyNotify)memstream_buffer_free);
+                                                (GDestroyNotify)strbuf_free);
 }
 
 static void
@@ -884,11 +1123,11 @@ problem_report_add_custom_section(problem_report_t *self, const char *name)
     }
 
     log_debug("Problem report enriched with section : '%s'", name);
-    g_hash_table_insert(self->pr_sec_custom, xstrdup(name), memstream_buffer_new());
+    g_hash_table_insert(self->pr_sec_custom, xstrdup(name), strbuf_new());
     return 0;
 }
 
-static struct memstream_buffer *
+static struct strbuf *
 problem_report_get_section_buffer(const problem_report_t *self, const char *section_name)
 {
     if (self->pr_sec_custom == NULL)
@@ -897,7 +1136,7 @@ problem_report_get_section_buffer(const problem_report_t *self, const char *sect
         return NULL;
     }
 
-    return (struct memstream_buffer *)g_hash_table_lookup(self->pr_sec_custom, section_name);
+    return (struct strbuf *)g_hash_table_lookup(self->pr_sec_custom, section_name);
 }
 
 problem_report_buffer *
@@ -907,13 +1146,12 @@ problem_report_get_buffer(const problem_report_t *self, const char *section_name
     assert(section_name != NULL);
 
     if (strcmp(PR_SEC_SUMMARY, section_name) == 0)
-        return memstream_get_stream(self->pr_sec_summ);
+        return self->pr_sec_summ;
 
     if (strcmp(PR_SEC_DESCRIPTION, section_name) == 0)
-        return memstream_get_stream(self->pr_sec_desc);
+        return self->pr_sec_desc;
 
-    struct memstream_buffer *buf = problem_report_get_section_buffer(self, section_name);
-    return buf == NULL ? NULL : memstream_get_stream(buf);
+    return problem_report_get_section_buffer(self, section_name);
 }
 
 const char *
@@ -921,7 +1159,7 @@ problem_report_get_summary(const problem_report_t *self)
 {
     assert(self != NULL);
 
-    return memstream_get_string(self->pr_sec_summ);
+    return self->pr_sec_summ->buf;
 }
 
 const char *
@@ -929,7 +1167,7 @@ problem_report_get_description(const problem_report_t *self)
 {
     assert(self != NULL);
 
-    return memstream_get_string(self->pr_sec_desc);
+    return self->pr_sec_desc->buf;
 }
 
 const char *
@@ -938,12 +1176,28 @@ problem_report_get_section(const problem_report_t *self, const char *section_nam
     assert(self != NULL);
     assert(section_name);
 
-    struct memstream_buffer *buf = problem_report_get_section_buffer(self, section_name);
+    struct strbuf *buf = problem_report_get_section_buffer(self, section_name);
 
     if (buf == NULL)
         return NULL;
 
-    return memstream_get_string(buf);
+    return buf->buf;
+}
+
+int
+problem_report_write_section(const problem_report_t *self, const char *section_name, int fd)
+{
+    assert(self != NULL);
+    assert(section_name != NULL);
+
+    struct strbuf *buf = problem_report_get_buffer(self, section_name);
+    if (buf == NULL)
+        return -ENOENT;
+
+    if (full_write(fd, buf->buf, buf->len) != (ssize_t)buf->len)
+        return -errno;
+
+    return 0;
 }
 
 static void
@@ -969,10 +1223,10 @@ problem_report_free(problem_report_t *self)
     if (self == NULL)
         return;
 
-    memstream_buffer_free(self->pr_sec_summ);
+    strbuf_free(self->pr_sec_summ);
     self->pr_sec_summ = DESTROYED_POINTER;
 
-    memstream_buffer_free(self->pr_sec_desc);
+    strbuf_free(self->pr_sec_desc);
     self->pr_sec_desc = DESTROYED_POINTER;
 
     g_list_free_full(self->pr_attachments, free);
@@ -1032,7 +1286,7 @@ extra_section_name_cmp(struct extra_section *lhs, const char *rhs)
  */
 struct problem_formatter
 {
-    GList *pf_sections;         ///< parsed sections (struct section_t)
+    struct format_program *pf_program;  ///< compiled format (shared, see s_format_cache)
     GList *pf_extra_sections;   ///< user configured sections (struct extra_section)
     char  *pf_default_summary;  ///< default summary format
     problem_report_settings_t pf_settings; ///< settings for report generating
@@ -1076,8 +1330,8 @@ problem_formatter_free(problem_formatter_t *self)
     if (self == NULL)
         return;
 
-    g_list_free_full(self->pf_sections, (GDestroyNotify)section_free);
-    self->pf_sections = DESTROYED_POINTER;
+    format_program_unref(self->pf_program);
+    self->pf_program = DESTROYED_POINTER;
 
     g_list_free_full(self->pf_extra_sections, (GDestroyNotify)extra_section_free);
     self->pf_extra_sections = DESTROYED_POINTER;
@@ -1130,7 +1384,8 @@ problem_formatter_validate(problem_formatter_t *self)
         log_debug("Validating extra section : '%s'", section->pfes_name);
 
         if (   (PFFF_REQUIRED & section->pfes_flags)
-            && NULL == g_list_find_custom(self->pf_sections, section->pfes_name, (GCompareFunc)section_name_cmp))
+            && (self->pf_program == NULL
+                || NULL == g_list_find_custom(self->pf_program->fp_sections, section->pfes_name, (GCompareFunc)section_name_cmp)))
         {
             log_warning("Problem format misses required section : '%s'", section->pfes_name);
             ++retval;
@@ -1141,7 +1396,8 @@ problem_formatter_validate(problem_formatter_t *self)
      * known, i.e. each section is either one of the common sections (summary,
      * description, attach) or is present in the (struct extra_section)s.
      */
-    for (GList *iter = self->pf_sections; iter; iter = g_list_next(iter))
+    GList *sections = self->pf_program ? self->pf_program->fp_sections : NULL;
+    for (GList *iter = sections; iter; iter = g_list_next(iter))
     {
         section_t *section = (section_t *)iter->data;
 
@@ -1168,7 +1424,8 @@ problem_formatter_load_string(problem_formatter_t *self, const char *fmt)
             return -ENOMEM;
         }
 
-        self->pf_sections = load_stream(fp);
+        format_program_unref(self->pf_program);
+        self->pf_program = format_program_compile(load_stream(fp));
         fclose(fp);
     }
 
@@ -1178,18 +1435,18 @@ problem_formatter_load_string(problem_formatter_t *self, const char *fmt)
 int
 problem_formatter_load_file(problem_formatter_t *self, const char *path)
 {
-    FILE *fp = stdin;
-    if (strcmp(path, "-") != 0)
+    struct format_program *program;
+    if (strcmp(path, "-") == 0)
+        program = format_program_compile(load_stream(stdin));
+    else
     {
-        fp = fopen(path, "r");
-        if (!fp)
+        program = format_cache_load(path);
+        if (program == NULL)
             return -ENOENT;
     }
 
-    self->pf_sections = load_stream(fp);
-
-    if (fp != stdin)
-        fclose(fp);
+    format_program_unref(self->pf_program);
+    self->pf_program = program;
 
     return problem_formatter_validate(self);
 }
@@ -1205,37 +1462,55 @@ problem_formatter_generate_report(const problem_formatter_t *self, problem_data_
     for (GList *iter = self->pf_extra_sections; iter; iter = g_list_next(iter))
         problem_report_add_custom_section(pr, ((struct extra_section *)iter->data)->pfes_name);
 
-    bool has_summary = false;
-    for (GList *iter = self->pf_sections; iter; iter = g_list_next(iter))
+    struct format_context ctx = {
+        .fc_data = data,
+        .fc_program = self->pf_program,
+        .fc_settings = &settings,
+    };
+
+    const struct format_op *op = NULL;
+    const struct format_op *end = NULL;
+    if (self->pf_program != NULL)
     {
-        section_t *section = (section_t *)iter->data;
+        op = self->pf_program->fp_ops;
+        end = op + self->pf_program->fp_ops_count;
+    }
 
-        /* %summary is something special */
-        if (strcmp(section->name, "%summary") == 0)
-        {
-            has_summary = true;
-            format_percented_string((const char *)section->items->data, data,
-                                    problem_report_get_buffer(pr, PR_SEC_SUMMARY));
-        }
-        /* %attach as well */
-        else if (strcmp(section->name, "%attach") == 0)
-        {
-            problem_report_set_attachments(pr, get_attached_files(data, section->items, self->pf_sections));
-        }
-        else /* %description or a custom section (e.g. %additional_info) */
+    bool has_summary = false;
+    while (op != end)
+    {
+        switch (op->fop_code)
         {
-            FILE *buffer = problem_report_get_buffer(pr, section->name + 1);
-
-            if (buffer != NULL)
+            case FOP_SUMMARY:
+                has_summary = true;
+                format_percented_string(op->fop_text, data,
+                                        problem_report_get_buffer(pr, PR_SEC_SUMMARY));
+                ++op;
+                break;
+            case FOP_ATTACH:
+                problem_report_set_attachments(pr, get_attached_files(op, &ctx));
+                ++op;
+                break;
+            case FOP_SECTION:
             {
-                log_debug("Formatting section : '%s'", section->name);
-                format_section(section, data, self->pf_sections, buffer, &settings);
+                struct strbuf *buffer = problem_report_get_buffer(pr, op->fop_text);
+
+                if (buffer != NULL)
+                    log_debug("Formatting section : '%%%s'", op->fop_text);
+                else
+                    log_warning("Unsupported section '%%%s'", op->fop_text);
+
+                op = format_section(op + 1, end, &ctx, buffer);
+                break;
             }
-            else
-                log_warning("Unsupported section '%s'", section->name);
+            default:
+                /* FOP_TEXT and FOP_ITEMS are consumed by format_section() */
+                assert(!"Operation outside of a section");
         }
     }
 
+    format_context_destroy(&ctx);
+
     if (!has_summary) {
         log_debug("Problem format misses section '%%summary'. Using the default one : '%s'.",
                     self->pf_default_summary);
@@ -119,6 +119,38 @@ ssize_t full_write_str(int fd, const char *buf)
     return full_write(fd, buf, strlen(buf));
 }
 
+ssize_t full_writev(int fd, struct iovec *iov, int iovcnt)
+{
+    ssize_t total = 0;
+
+    while (iovcnt > 0)
+    {
+        ssize_t r = writev(fd, iov, iovcnt > IOV_MAX ? IOV_MAX : iovcnt);
+        if (r < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            /* the same as full_write() */
+            return total ? total : r;
+        }
+
+        total += r;
+        while (iovcnt > 0 && (size_t)r >= iov->iov_len)
+        {
+            r -= iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+        if (iovcnt > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + r;
+            iov->iov_len -= r;
+        }
+    }
+
+    return total;
+}
+
 /* Read (potentially big) files in one go. File size is estimated
  * by stat. Extra '\0' byte is appended.
  */
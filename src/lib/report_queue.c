@@ -0,0 +1,667 @@
+/*
+    Copyright (C) 2026  ABRT team
+    Copyright (C) 2026  RedHat Inc
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <sys/file.h>
+
+#include "internal_libreport.h"
+#include "report_queue.h"
+
+struct report_queue
+{
+    char *rq_path;
+    char *rq_drain_lock_path;
+    int rq_fd;              ///< the journal opened for appending
+    GList *rq_entries;      ///< struct report_queue_entry in queue order
+    GHashTable *rq_index;   ///< "uuid event" -> the latest entry
+};
+
+static void report_queue_entry_free(struct report_queue_entry *entry)
+{
+    if (!entry)
+        return;
+
+    free(entry->rqe_uuid);
+    free(entry->rqe_event);
+    free(entry->rqe_dump_dir);
+    free(entry);
+}
+
+static void report_queue_clear(report_queue_t *queue)
+{
+    g_hash_table_remove_all(queue->rq_index);
+    g_list_free_full(queue->rq_entries, (GDestroyNotify)report_queue_entry_free);
+    queue->rq_entries = NULL;
+}
+
+static struct report_queue_entry *report_queue_find(report_queue_t *queue,
+                const char *uuid, const char *event)
+{
+    char *key = xasprintf("%s %s", uuid, event);
+    struct report_queue_entry *entry = g_hash_table_lookup(queue->rq_index, key);
+    free(key);
+    return entry;
+}
+
+/* Splits the next space delimited field off */
+static char *next_field(char **str)
+{
+    char *field = *str;
+    char *end = strchrnul(field, ' ');
+    if (end == field)
+        return NULL;
+
+    if (*end != '\0')
+        *end++ = '\0';
+
+    *str = end;
+    return field;
+}
+
+/* Applies one journal line on the in-memory state, the line is modified */
+static void report_queue_apply_record(report_queue_t *queue, char *line)
+{
+    const char type = line[0];
+    char *str = line + 1;
+    if (*str++ != ' ')
+        goto malformed;
+
+    char *uuid = next_field(&str);
+    char *event = next_field(&str);
+    if (uuid == NULL || event == NULL)
+        goto malformed;
+
+    if (type == 'A')
+    {
+        if (*str == '\0')
+            goto malformed;
+
+        struct report_queue_entry *entry = xzalloc(sizeof(*entry));
+        entry->rqe_uuid = xstrdup(uuid);
+        entry->rqe_event = xstrdup(event);
+        entry->rqe_dump_dir = xstrdup(str);
+        entry->rqe_state = REPORT_QUEUE_PENDING;
+
+        queue->rq_entries = g_list_append(queue->rq_entries, entry);
+        g_hash_table_replace(queue->rq_index, xasprintf("%s %s", uuid, event), entry);
+        return;
+    }
+
+    struct report_queue_entry *entry = report_queue_find(queue, uuid, event);
+    if (entry == NULL)
+        goto malformed;
+
+    char *attempts = next_field(&str);
+    if (attempts == NULL)
+        goto malformed;
+    entry->rqe_attempts = strtoul(attempts, NULL, 10);
+
+    switch (type)
+    {
+        case 'R':
+            entry->rqe_state = REPORT_QUEUE_PENDING;
+            entry->rqe_next_attempt = strtoll(str, NULL, 10);
+            return;
+        case 'D':
+            entry->rqe_state = REPORT_QUEUE_DONE;
+            return;
+        case 'G':
+            entry->rqe_state = REPORT_QUEUE_GAVE_UP;
+            return;
+    }
+
+ malformed:
+    log_warning(_("Ignoring malformed report queue record '%s'"), line);
+}
+
+/* Locks the journal. Compaction replaces the journal file, so reopen it
+ * if our descriptor points to the replaced one.
+ */
+static int report_queue_lock(report_queue_t *queue)
+{
+    for (;;)
+    {
+        if (flock(queue->rq_fd, LOCK_EX) != 0)
+            return -errno;
+
+        struct stat fd_st;
+        struct stat path_st;
+        if (fstat(queue->rq_fd, &fd_st) == 0
+            && stat(queue->rq_path, &path_st) == 0
+            && fd_st.st_dev == path_st.st_dev
+            && fd_st.st_ino == path_st.st_ino)
+            return 0;
+
+        close(queue->rq_fd);
+        queue->rq_fd = open(queue->rq_path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+        if (queue->rq_fd < 0)
+        {
+            perror_msg("Can't open '%s'", queue->rq_path);
+            return -errno;
+        }
+    }
+}
+
+static void report_queue_unlock(report_queue_t *queue)
+{
+    flock(queue->rq_fd, LOCK_UN);
+}
+
+/* Re-reads the journal, must be called with the journal locked */
+static int report_queue_load(report_queue_t *queue)
+{
+    report_queue_clear(queue);
+
+    if (lseek(queue->rq_fd, 0, SEEK_SET) < 0)
+        return -errno;
+
+    size_t size = INT_MAX;
+    char *data = xmalloc_read(queue->rq_fd, &size);
+    if (data == NULL)
+    {
+        perror_msg("Can't read '%s'", queue->rq_path);
+        return -EIO;
+    }
+
+    /* A crash in the middle of an append leaves a torn record behind,
+     * cut it off so that the next record starts on a new line
+     */
+    char *last_nl = memrchr(data, '\n', size);
+    size_t valid = last_nl ? last_nl - data + 1 : 0;
+    if (valid != size)
+    {
+        log_warning(_("Dropping incomplete record at the end of '%s'"), queue->rq_path);
+        if (ftruncate(queue->rq_fd, valid) != 0)
+            perror_msg("Can't truncate '%s'", queue->rq_path);
+    }
+    data[valid] = '\0';
+
+    char *line = data;
+    while (*line != '\0')
+    {
+        char *nl = strchr(line, '\n');
+        *nl = '\0';
+        if (*line != '\0')
+            report_queue_apply_record(queue, line);
+        line = nl + 1;
+    }
+
+    free(data);
+    return 0;
+}
+
+/* Writes one record to the journal and applies it, must be called with
+ * the journal locked
+ */
+static int report_queue_append(report_queue_t *queue, const char *fmt, ...)
+{
+    va_list p;
+    va_start(p, fmt);
+    char *record = xvasprintf(fmt, p);
+    va_end(p);
+
+    /* The whole record in a single write, so that it is either complete
+     * or torn at the end of the journal
+     */
+    char *line = xasprintf("%s\n", record);
+    const ssize_t len = strlen(line);
+    int r = 0;
+    if (full_write(queue->rq_fd, line, len) != len || fdatasync(queue->rq_fd) != 0)
+    {
+        r = -errno;
+        perror_msg("Can't write to '%s'", queue->rq_path);
+    }
+    else
+        report_queue_apply_record(queue, record);
+
+    free(line);
+    free(record);
+    return r;
+}
+
+/* Rewrites the journal to contain only pending entries, must be called with
+ * the journal locked
+ */
+static void report_queue_compact(report_queue_t *queue)
+{
+    struct strbuf *buf = strbuf_new();
+    unsigned dropped = 0;
+    for (GList *iter = queue->rq_entries; iter; iter = g_list_next(iter))
+    {
+        struct report_queue_entry *entry = iter->data;
+        if (entry->rqe_state != REPORT_QUEUE_PENDING)
+        {
+            ++dropped;
+            continue;
+        }
+
+        strbuf_append_strf(buf, "A %s %s %s\n", entry->rqe_uuid, entry->rqe_event, entry->rqe_dump_dir);
+        if (entry->rqe_attempts != 0)
+            strbuf_append_strf(buf, "R %s %s %u %lld\n", entry->rqe_uuid, entry->rqe_event,
+                               entry->rqe_attempts, (long long)entry->rqe_next_attempt);
+    }
+
+    if (dropped == 0)
+        goto ret;
+
+    char *tmp = xasprintf("%s.XXXXXX", queue->rq_path);
+    int fd = mkstemp(tmp);
+    if (fd < 0)
+    {
+        perror_msg("Can't create '%s'", tmp);
+        free(tmp);
+        goto ret;
+    }
+
+    /* Lock the new journal before it replaces the old one, so that nobody
+     * can append to it until we are done
+     */
+    bool ok = full_write(fd, buf->buf, buf->len) == (ssize_t)buf->len
+            && fsync(fd) == 0
+            && flock(fd, LOCK_EX) == 0;
+    if (!ok || rename(tmp, queue->rq_path) != 0)
+    {
+        perror_msg("Can't compact '%s'", queue->rq_path);
+        unlink(tmp);
+        close(fd);
+    }
+    else
+    {
+        log_info("Dropped %u finished entries from '%s'", dropped, queue->rq_path);
+        /* Releases the lock of the old journal, the others will notice
+         * it was replaced
+         */
+        close(queue->rq_fd);
+        queue->rq_fd = fd;
+        if (fcntl(fd, F_SETFL, O_APPEND) != 0 || close_on_exec_on(fd) != 0)
+            perror_msg("Can't set flags of '%s'", queue->rq_path);
+    }
+
+    free(tmp);
+
+ ret:
+    strbuf_free(buf);
+}
+
+report_queue_t *report_queue_open(const char *path)
+{
+    if (path == NULL)
+    {
+        path = getenv("LIBREPORT_DEBUG_REPORT_QUEUE_PATH");
+        if (path == NULL)
+            path = REPORT_QUEUE_PATH;
+    }
+
+    int fd = open(path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0 && errno == ENOENT)
+    {
+        /* The first use, the spool directory does not exist yet */
+        char *dir = xstrndup(path, strrchr(path, '/') ? strrchr(path, '/') - path : 0);
+        if (dir[0] != '\0' && mkdir(dir, 0755) != 0 && errno != EEXIST)
+            perror_msg("Can't create '%s'", dir);
+        free(dir);
+        fd = open(path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+    }
+    if (fd < 0)
+    {
+        perror_msg("Can't open '%s'", path);
+        return NULL;
+    }
+
+    report_queue_t *queue = xzalloc(sizeof(*queue));
+    queue->rq_path = xstrdup(path);
+    queue->rq_drain_lock_path = xasprintf("%s.lock", path);
+    queue->rq_fd = fd;
+    queue->rq_index = g_hash_table_new_full(g_str_hash, g_str_equal, free, NULL);
+
+    if (report_queue_lock(queue) != 0)
+    {
+        report_queue_close(queue);
+        return NULL;
+    }
+
+    const int r = report_queue_load(queue);
+    report_queue_unlock(queue);
+
+    if (r != 0)
+    {
+        report_queue_close(queue);
+        return NULL;
+    }
+
+    return queue;
+}
+
+void report_queue_close(report_queue_t *queue)
+{
+    if (!queue)
+        return;
+
+    report_queue_clear(queue);
+    g_hash_table_destroy(queue->rq_index);
+    if (queue->rq_fd >= 0)
+        close(queue->rq_fd);
+    free(queue->rq_drain_lock_path);
+    free(queue->rq_path);
+    free(queue);
+}
+
+GList *report_queue_get_entries(report_queue_t *queue)
+{
+    return queue->rq_entries;
+}
+
+int report_queue_add(report_queue_t *queue, const char *dump_dir_name, const char *event)
+{
+    if (event[0] == '\0' || strpbrk(event, " \t\n") != NULL || strchr(dump_dir_name, '\n') != NULL)
+        return -EINVAL;
+
+    /* The queue is drained from a different working directory */
+    char *dump_dir_path = realpath(dump_dir_name, NULL);
+    if (dump_dir_path == NULL)
+    {
+        perror_msg("Can't resolve '%s'", dump_dir_name);
+        return -ENOENT;
+    }
+
+    struct dump_dir *dd = dd_opendir(dump_dir_path, DD_OPEN_READONLY);
+    if (!dd)
+    {
+        free(dump_dir_path);
+        return -ENOENT;
+    }
+
+    char *uuid = dd_load_text_ext(dd, FILENAME_UUID,
+            DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE | DD_FAIL_QUIETLY_ENOENT);
+    dd_close(dd);
+
+    if (uuid != NULL)
+        strtrim(uuid);
+
+    /* Not every problem has an uuid, the path identifies it as well */
+    if (uuid == NULL || uuid[0] == '\0' || strpbrk(uuid, " \t\n") != NULL)
+    {
+        free(uuid);
+        char sha1[SHA1_RESULT_LEN*2 + 1];
+        uuid = xstrdup(str_to_sha1str(sha1, dump_dir_path));
+    }
+
+    int r = report_queue_lock(queue);
+    if (r != 0)
+        goto ret;
+
+    r = report_queue_load(queue);
+    if (r == 0)
+    {
+        struct report_queue_entry *entry = report_queue_find(queue, uuid, event);
+        if (entry != NULL && entry->rqe_state == REPORT_QUEUE_PENDING)
+        {
+            log_notice("'%s' is already queued for '%s'", dump_dir_path, event);
+            r = 1;
+        }
+        else
+            r = report_queue_append(queue, "A %s %s %s", uuid, event, dump_dir_path);
+    }
+
+    report_queue_unlock(queue);
+
+ ret:
+    free(uuid);
+    free(dump_dir_path);
+    return r;
+}
+
+void report_queue_drain_options_init(struct report_queue_drain_options *options)
+{
+    options->rqd_concurrency = REPORT_QUEUE_DEFAULT_CONCURRENCY;
+    options->rqd_max_attempts = REPORT_QUEUE_DEFAULT_MAX_ATTEMPTS;
+    options->rqd_base_delay = REPORT_QUEUE_DEFAULT_BASE_DELAY;
+    options->rqd_max_delay = REPORT_QUEUE_DEFAULT_MAX_DELAY;
+}
+
+unsigned report_queue_backoff(unsigned attempts, unsigned base_delay, unsigned max_delay)
+{
+    if (attempts == 0)
+        return 0;
+
+    unsigned delay = base_delay;
+    while (--attempts != 0 && delay < max_delay)
+        delay = delay > max_delay / 2 ? max_delay : delay * 2;
+
+    return delay < max_delay ? delay : max_delay;
+}
+
+static int run_entry_event(const struct report_queue_entry *entry, void *param)
+{
+    struct run_event_state *run_state = new_run_event_state();
+    int r = run_event_on_dir_name(run_state, entry->rqe_dump_dir, entry->rqe_event);
+    if (r == 0 && run_state->children_count == 0)
+    {
+        error_msg(_("No actions are found for event '%s'"), entry->rqe_event);
+        r = 1;
+    }
+    free_run_event_state(run_state);
+    return r;
+}
+
+/* Records the result of an entry run, must be called with the journal locked */
+static void report_queue_finish_entry(report_queue_t *queue, struct report_queue_entry *entry,
+                bool success, const struct report_queue_drain_options *options)
+{
+    if (success)
+    {
+        /* The reporter records its result in reported_to itself */
+        log_notice("'%s' reported by '%s' from the queue after %u failed attempts",
+                   entry->rqe_dump_dir, entry->rqe_event, entry->rqe_attempts);
+        report_queue_append(queue, "D %s %s %u", entry->rqe_uuid, entry->rqe_event, entry->rqe_attempts);
+        return;
+    }
+
+    const unsigned attempts = entry->rqe_attempts + 1;
+    if (options->rqd_max_attempts != 0 && attempts >= options->rqd_max_attempts)
+    {
+        error_msg(_("Giving up reporting '%s' by '%s' after %u attempts"),
+                  entry->rqe_dump_dir, entry->rqe_event, attempts);
+        report_queue_append(queue, "G %s %s %u", entry->rqe_uuid, entry->rqe_event, attempts);
+        return;
+    }
+
+    const time_t next = time(NULL)
+            + report_queue_backoff(attempts, options->rqd_base_delay, options->rqd_max_delay);
+    log_notice("Reporting '%s' by '%s' failed, attempt %u, next one at %lld",
+               entry->rqe_dump_dir, entry->rqe_event, attempts, (long long)next);
+    report_queue_append(queue, "R %s %s %u %lld", entry->rqe_uuid, entry->rqe_event,
+                        attempts, (long long)next);
+}
+
+struct drain_job
+{
+    pid_t pid;
+    struct report_queue_entry *entry;
+};
+
+int report_queue_drain(report_queue_t *queue,
+                       const struct report_queue_drain_options *options,
+                       report_queue_run_fn run, void *param,
+                       time_t *next_attempt)
+{
+    struct report_queue_drain_options defaults;
+    if (options == NULL)
+    {
+        report_queue_drain_options_init(&defaults);
+        options = &defaults;
+    }
+
+    if (run == NULL)
+        run = run_entry_event;
+
+    const unsigned concurrency = options->rqd_concurrency ? options->rqd_concurrency : 1;
+
+    int drain_fd = open(queue->rq_drain_lock_path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (drain_fd < 0)
+    {
+        perror_msg("Can't open '%s'", queue->rq_drain_lock_path);
+        return -errno;
+    }
+
+    if (flock(drain_fd, LOCK_EX | LOCK_NB) != 0)
+    {
+        const int r = -errno;
+        if (errno == EWOULDBLOCK)
+            log_notice("'%s' is being drained by another process", queue->rq_path);
+        close(drain_fd);
+        return r == -EWOULDBLOCK ? -EAGAIN : r;
+    }
+
+    /* Entries stay valid until the end because only the drainer reloads
+     * the journal and nobody else drains it now
+     */
+    int r = report_queue_lock(queue);
+    if (r == 0)
+    {
+        r = report_queue_load(queue);
+        report_queue_unlock(queue);
+    }
+    if (r != 0)
+        goto ret;
+
+    const time_t now = time(NULL);
+    GList *ready = NULL;
+    for (GList *iter = queue->rq_entries; iter; iter = g_list_next(iter))
+    {
+        struct report_queue_entry *entry = iter->data;
+        if (entry->rqe_state == REPORT_QUEUE_PENDING && entry->rqe_next_attempt <= now)
+            ready = g_list_prepend(ready, entry);
+    }
+    ready = g_list_reverse(ready);
+
+    struct drain_job *jobs = xzalloc(sizeof(*jobs) * concurrency);
+    unsigned running = 0;
+    GList *next = ready;
+    while (next || running)
+    {
+        while (next && running < concurrency)
+        {
+            struct report_queue_entry *entry = next->data;
+            next = g_list_next(next);
+
+            if (access(entry->rqe_dump_dir, F_OK) != 0)
+            {
+                log_notice("'%s' does not exist anymore", entry->rqe_dump_dir);
+                if (report_queue_lock(queue) == 0)
+                {
+                    report_queue_append(queue, "G %s %s %u", entry->rqe_uuid, entry->rqe_event, entry->rqe_attempts);
+                    report_queue_unlock(queue);
+                }
+                continue;
+            }
+
+            /* Do not let children flush our buffers */
+            fflush(NULL);
+
+            pid_t pid = fork();
+            if (pid < 0)
+            {
+                perror_msg("fork");
+                break;
+            }
+
+            if (pid == 0)
+            {
+                close(drain_fd);
+                _exit(run(entry, param) == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+            }
+
+            unsigned slot = 0;
+            while (jobs[slot].pid != 0)
+                ++slot;
+            jobs[slot].pid = pid;
+            jobs[slot].entry = entry;
+            ++running;
+        }
+
+        if (running == 0)
+            break;
+
+        int status;
+        pid_t pid = safe_waitpid(-1, &status, 0);
+        if (pid < 0)
+        {
+            perror_msg("waitpid");
+            break;
+        }
+
+        for (unsigned slot = 0; slot < concurrency; ++slot)
+        {
+            if (jobs[slot].pid != pid)
+                continue;
+
+            const bool success = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+            if (report_queue_lock(queue) == 0)
+            {
+                report_queue_finish_entry(queue, jobs[slot].entry, success, options);
+                report_queue_unlock(queue);
+            }
+
+            jobs[slot].pid = 0;
+            --running;
+            break;
+        }
+    }
+
+    /* Only after waitpid() failures */
+    for (unsigned slot = 0; slot < concurrency; ++slot)
+        if (jobs[slot].pid != 0)
+            safe_waitpid(jobs[slot].pid, NULL, 0);
+
+    free(jobs);
+    g_list_free(ready);
+
+    r = report_queue_lock(queue);
+    if (r != 0)
+        goto ret;
+
+    /* Pick up entries added while we were draining, the compaction
+     * must not drop them
+     */
+    r = report_queue_load(queue);
+    if (r == 0)
+        report_queue_compact(queue);
+    report_queue_unlock(queue);
+    if (r != 0)
+        goto ret;
+
+    time_t earliest = 0;
+    for (GList *iter = queue->rq_entries; iter; iter = g_list_next(iter))
+    {
+        struct report_queue_entry *entry = iter->data;
+        if (entry->rqe_state != REPORT_QUEUE_PENDING)
+            continue;
+
+        ++r;
+        if (earliest == 0 || entry->rqe_next_attempt < earliest)
+            earliest = entry->rqe_next_attempt ? entry->rqe_next_attempt : now;
+    }
+
+    if (next_attempt)
+        *next_attempt = earliest;
+
+ ret:
+    flock(drain_fd, LOCK_UN);
+    close(drain_fd);
+    return r;
+}
@@ -45,18 +45,18 @@ int add_reported_to_data(char **reported_to, const char *line)
     return 1;
 }
 
-int add_reported_to_entry_data(char **reported_to, struct report_result *result)
+char *format_reported_to_entry(const struct report_result *result)
 {
     if (NULL == result->label || result->label[0] == '\0')
     {
         log_warning(_("Report result label mustn't be empty string."));
-        return -EINVAL;
+        return NULL;
     }
 
     if (strchr(result->label, ':') != NULL)
     {
         log_warning(_("Report result label mustn't contain ':' character."));
-        return -EINVAL;
+        return NULL;
     }
 
     struct strbuf *buf = strbuf_new();
@@ -78,8 +78,17 @@ int add_reported_to_entry_data(char **reported_to, struct report_result *result)
     if (result->msg != NULL)
         strbuf_append_strf(buf, " MSG=%s", result->msg);
 
-    const int r = add_reported_to_data(reported_to, buf->buf);
-    strbuf_free(buf);
+    return strbuf_free_nobuf(buf);
+}
+
+int add_reported_to_entry_data(char **reported_to, struct report_result *result)
+{
+    char *line = format_reported_to_entry(result);
+    if (line == NULL)
+        return -EINVAL;
+
+    const int r = add_reported_to_data(reported_to, line);
+    free(line);
 
     return r;
 }
@@ -225,3 +234,236 @@ report_result_t *find_in_reported_to_data(const char *reported_to, const char *r
 
     return result;
 }
+
+/* The index keeps every line of reported_to in a hash table for
+ * de-duplication and the last line of every label for look ups. The file is
+ * only appended to, so every update reads just the new lines. A file replaced
+ * by dd_save_text() or modified in other way is detected by the inode, size
+ * and the last indexed bytes, and is indexed again.
+ */
+#define REPORTED_TO_INDEX_TAIL 64
+
+struct reported_to_index
+{
+    dev_t rti_dev;
+    ino_t rti_ino;
+    off_t rti_size;             ///< indexed bytes
+    bool rti_unterminated;      ///< the last indexed line has no '\n'
+    char rti_tail[REPORTED_TO_INDEX_TAIL]; ///< the last indexed bytes
+    size_t rti_tail_len;
+    GHashTable *rti_lines;      ///< all lines, the keys are the values
+    GHashTable *rti_labels;     ///< label -> the last line of the label
+};
+
+struct reported_to_index *reported_to_index_new(void)
+{
+    struct reported_to_index *index = xzalloc(sizeof(*index));
+    index->rti_lines = g_hash_table_new_full(g_str_hash, g_str_equal, free, NULL);
+    index->rti_labels = g_hash_table_new_full(g_str_hash, g_str_equal, free, NULL);
+    return index;
+}
+
+void reported_to_index_free(struct reported_to_index *index)
+{
+    if (index == NULL)
+        return;
+
+    g_hash_table_destroy(index->rti_labels);
+    g_hash_table_destroy(index->rti_lines);
+    free(index);
+}
+
+static void reported_to_index_clear(struct reported_to_index *index)
+{
+    /* The labels point to the lines */
+    g_hash_table_remove_all(index->rti_labels);
+    g_hash_table_remove_all(index->rti_lines);
+
+    index->rti_dev = 0;
+    index->rti_ino = 0;
+    index->rti_size = 0;
+    index->rti_unterminated = false;
+    index->rti_tail_len = 0;
+}
+
+static void reported_to_index_add_line(struct reported_to_index *index, const char *line, size_t len)
+{
+    if (len == 0)
+        return;
+
+    char *stored = xstrndup(line, len);
+    char *known = g_hash_table_lookup(index->rti_lines, stored);
+    if (known != NULL)
+    {
+        free(stored);
+        stored = known;
+    }
+    else
+        g_hash_table_insert(index->rti_lines, stored, stored);
+
+    const char *label_end = strchr(stored, ':');
+    if (label_end == NULL || label_end == stored)
+    {
+        log_notice("Miss formatted 'reported_to' record '%s'", stored);
+        return;
+    }
+
+    /* The last line of the label wins like in find_in_reported_to_data() */
+    g_hash_table_insert(index->rti_labels, xstrndup(stored, label_end - stored), stored);
+}
+
+/* Reads the file from the offset till the end */
+static int read_from_offset(int fd, off_t offset, struct strbuf *buf)
+{
+    for (;;)
+    {
+        if ((size_t)(buf->alloc - buf->len) < 4 * 1024 + 1)
+            strbuf_reserve(buf, buf->alloc * 2 + 4 * 1024);
+
+        const ssize_t r = pread(fd, buf->buf + buf->len, buf->alloc - buf->len - 1, offset + buf->len);
+        if (r < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -errno;
+        }
+        if (r == 0)
+            break;
+        buf->len += r;
+    }
+
+    buf->buf[buf->len] = '\0';
+    return 0;
+}
+
+int reported_to_index_update(struct reported_to_index *index, int dir_fd)
+{
+    const int fd = openat(dir_fd, FILENAME_REPORTED_TO, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0)
+    {
+        const int r = -errno;
+        reported_to_index_clear(index);
+        return r;
+    }
+
+    int r = 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        r = -errno;
+        reported_to_index_clear(index);
+        goto ret;
+    }
+
+    if (   st.st_dev != index->rti_dev
+        || st.st_ino != index->rti_ino
+        || st.st_size < index->rti_size
+        || (index->rti_unterminated && st.st_size != index->rti_size))
+    {
+        reported_to_index_clear(index);
+        index->rti_dev = st.st_dev;
+        index->rti_ino = st.st_ino;
+    }
+
+    /* Read the new lines together with the last indexed bytes, they must be
+     * the same if the file was only appended to. */
+    struct strbuf *buf = strbuf_new();
+    r = read_from_offset(fd, index->rti_size - index->rti_tail_len, buf);
+    if (r == 0 && ((size_t)buf->len < index->rti_tail_len
+                   || memcmp(buf->buf, index->rti_tail, index->rti_tail_len) != 0))
+    {
+        log_debug("'%s' was rewritten, indexing it again", FILENAME_REPORTED_TO);
+        reported_to_index_clear(index);
+        index->rti_dev = st.st_dev;
+        index->rti_ino = st.st_ino;
+        strbuf_clear(buf);
+        r = read_from_offset(fd, 0, buf);
+    }
+
+    if (r != 0)
+    {
+        reported_to_index_clear(index);
+        strbuf_free(buf);
+        goto ret;
+    }
+
+    const char *p = buf->buf + index->rti_tail_len;
+    const char *const end = buf->buf + buf->len;
+    while (p < end)
+    {
+        const char *line_end = memchr(p, '\n', end - p);
+        if (line_end == NULL)
+        {
+            reported_to_index_add_line(index, p, end - p);
+            index->rti_unterminated = true;
+            break;
+        }
+
+        reported_to_index_add_line(index, p, line_end - p);
+        p = line_end + 1;
+    }
+
+    index->rti_size += buf->len - index->rti_tail_len;
+    index->rti_tail_len = MIN((size_t)buf->len, sizeof(index->rti_tail));
+    memcpy(index->rti_tail, end - index->rti_tail_len, index->rti_tail_len);
+
+    strbuf_free(buf);
+ret:
+    close(fd);
+    return r;
+}
+
+bool reported_to_index_contains(const struct reported_to_index *index, const char *line)
+{
+    return g_hash_table_contains(index->rti_lines, line);
+}
+
+report_result_t *reported_to_index_find(const struct reported_to_index *index, const char *report_label)
+{
+    const char *line = g_hash_table_lookup(index->rti_labels, report_label);
+    if (line == NULL)
+        return NULL;
+
+    return parse_reported_line(line, strlen(report_label));
+}
+
+int reported_to_index_append(struct reported_to_index *index, int dir_fd, const char *line)
+{
+    int r = reported_to_index_update(index, dir_fd);
+    if (r != 0)
+        return r;
+
+    if (reported_to_index_contains(index, line))
+        return 0;
+
+    const int fd = openat(dir_fd, FILENAME_REPORTED_TO, O_WRONLY | O_APPEND | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0)
+        return -errno;
+
+    struct iovec iov[3];
+    int iovcnt = 0;
+    if (index->rti_unterminated)
+    {
+        iov[iovcnt].iov_base = (void *)"\n";
+        iov[iovcnt++].iov_len = 1;
+    }
+    iov[iovcnt].iov_base = (void *)line;
+    iov[iovcnt++].iov_len = strlen(line);
+    iov[iovcnt].iov_base = (void *)"\n";
+    iov[iovcnt++].iov_len = 1;
+
+    const size_t size = index->rti_unterminated + strlen(line) + 1;
+    const ssize_t written = full_writev(fd, iov, iovcnt);
+    r = written < 0 ? -errno : 0;
+    close(fd);
+
+    if (r == 0 && (size_t)written != size)
+        r = -EIO;
+
+    if (r != 0)
+        return r;
+
+    /* Reads only the appended line */
+    r = reported_to_index_update(index, dir_fd);
+    return r == 0 ? 1 : r;
+}
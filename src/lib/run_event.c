@@ -20,6 +20,8 @@
 #include <regex.h>
 #include "client.h"
 #include "internal_libreport.h"
+#include "trace.h"
+#include "metrics.h"
 
 static char *run_event_stdio_log(char *log_line, void *param);
 static void run_event_stdio_error_and_die(const char *error_line, void *param);
@@ -464,6 +466,13 @@ void free_commands(struct run_event_state *state)
     state->command_pid = 0;
 }
 
+/* Can be overridden by LIBREPORT_DEBUG_REPORT_EVENT_CONF */
+static const char *report_event_conf_path(void)
+{
+    const char *path = getenv("LIBREPORT_DEBUG_REPORT_EVENT_CONF");
+    return path ? path : CONF_DIR"/report_event.conf";
+}
+
 int prepare_commands(struct run_event_state *state,
                 const char *dump_dir_name,
                 const char *event
@@ -473,7 +482,7 @@ int prepare_commands(struct run_event_state *state,
     state->children_count = 0;
     strbuf_clear(state->command_output);
 
-    GList *rule_list = load_rule_list(NULL, CONF_DIR"/report_event.conf", /*recursion_depth:*/ 0);
+    GList *rule_list = load_rule_list(NULL, report_event_conf_path(), /*recursion_depth:*/ 0);
     state->rule_list = rule_list;
     return rule_list != NULL;
 }
@@ -483,6 +492,8 @@ int spawn_next_command(struct run_event_state *state,
                 const char *event,
                 unsigned execflags
 ) {
+    TRACE_BEGIN(spawn_command);
+
     char *cmd = pop_next_command(&state->rule_list,
                 NULL,          /* don't return event_name */
                 NULL,          /* NULL dd: we match by... */
@@ -535,6 +546,9 @@ int spawn_next_command(struct run_event_state *state,
     free(env_vec[0]);
     free(env_vec[1]);
     free(env_vec[2]);
+
+    METRIC_INC(event_handlers_run);
+    TRACE_END(spawn_command, cmd);
     free(cmd);
 
     return 0;
@@ -542,6 +556,8 @@ int spawn_next_command(struct run_event_state *state,
 
 int consume_event_command_output(struct run_event_state *state, const char *dump_dir_name)
 {
+    TRACE_BEGIN(consume_command_output);
+
     int r = 0;
     char buf[256];
     errno = 0;
@@ -680,7 +696,10 @@ int consume_event_command_output(struct run_event_state *state, const char *dump
 
     /* Hope that child's stdout fd was set to O_NONBLOCK */
     if (r == -1 && errno == EAGAIN)
+    {
+        TRACE_END(consume_command_output, dump_dir_name);
         return -1;
+    }
 
     strbuf_clear(cmd_output);
 
@@ -691,9 +710,13 @@ int consume_event_command_output(struct run_event_state *state, const char *dump
     if (WIFSIGNALED(state->process_status))
         retval = WTERMSIG(state->process_status) + 128;
 
+    if (retval != 0 && retval != EXIT_STOP_EVENT_RUN)
+        METRIC_INC(event_handler_failures);
+
     if (retval == 0 && state->post_run_callback)
         retval = state->post_run_callback(dump_dir_name, state->post_run_param);
 
+    TRACE_END(consume_command_output, dump_dir_name);
     return retval;
 }
 
@@ -703,6 +726,9 @@ int run_event_on_dir_name(struct run_event_state *state,
                 const char *dump_dir_name,
                 const char *event
 ) {
+    METRIC_INC(events_run);
+    METRIC_TIMER_BEGIN(event_run);
+
     prepare_commands(state, dump_dir_name, event);
 
     /* Execute every command in shell */
@@ -717,6 +743,7 @@ int run_event_on_dir_name(struct run_event_state *state,
 
     free_commands(state);
 
+    METRIC_TIMER_END(event_run);
     return retval;
 }
 
@@ -749,7 +776,7 @@ static char *_list_possible_events(struct dump_dir **dd, problem_data_t *pd, con
 {
     struct strbuf *result = strbuf_new();
 
-    GList *rule_list = load_rule_list(NULL, CONF_DIR"/report_event.conf", /*recursion_depth:*/ 0);
+    GList *rule_list = load_rule_list(NULL, report_event_conf_path(), /*recursion_depth:*/ 0);
 
     unsigned pfx_len = strlen(pfx);
     for (;;)
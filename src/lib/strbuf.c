@@ -233,6 +233,24 @@ struct strbuf *strbuf_append_str(struct strbuf *strbuf, const char *str)
     return strbuf;
 }
 
+struct strbuf *strbuf_append_strn(struct strbuf *strbuf, const char *str, size_t len)
+{
+    char *p = strbuf_grow(strbuf, len);
+    assert(strbuf->len < strbuf->alloc);
+    memcpy(p, str, len);
+    p[len] = '\0';
+    return strbuf;
+}
+
+void strbuf_reserve(struct strbuf *strbuf, size_t size)
+{
+    if ((size_t)strbuf->alloc > size)
+        return;
+
+    strbuf->alloc = size + 1;
+    strbuf->buf = xrealloc(strbuf->buf, strbuf->alloc);
+}
+
 struct strbuf *strbuf_prepend_str(struct strbuf *strbuf, const char *str)
 {
     unsigned cur_len = strbuf->len;
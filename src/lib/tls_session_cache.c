@@ -0,0 +1,290 @@
+/*
+    Copyright (C) 2026  ABRT team
+    Copyright (C) 2026  RedHat Inc
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include "internal_libreport.h"
+#include "tls_session_cache.h"
+
+#ifdef HAVE_OPENSSL
+#include <openssl/ssl.h>
+
+/* Serialized sessions are ~2kB, anything much bigger is not ours */
+#define TLS_SESSION_MAX_SIZE (64 * 1024)
+
+/* Marks stored in the SSL's ex_data slot */
+#define SESSION_LOOKED_UP ((void *)1)
+#define SESSION_COUNTED   ((void *)2)
+
+/* NULL = not checked yet, ERR_PTR = unusable */
+static char *s_cache_dir;
+/* SSL_CTX slot: malloced path of the session file */
+static int s_ctx_path_index = -1;
+/* SSL slot: SESSION_LOOKED_UP or SESSION_COUNTED */
+static int s_ssl_state_index = -1;
+/* curl's own in-memory session cache callback */
+static int (*s_curl_new_session_cb)(SSL *, SSL_SESSION *);
+
+static unsigned s_hits;
+static unsigned s_misses;
+
+static const char *cache_dir(void)
+{
+    if (s_cache_dir)
+        return s_cache_dir != ERR_PTR ? s_cache_dir : NULL;
+
+    s_cache_dir = ERR_PTR;
+
+    const char *dir = getenv("LIBREPORT_DEBUG_TLS_SESSION_CACHE_DIR");
+    if (dir == NULL)
+        dir = TLS_SESSION_CACHE_DIR;
+
+    /* Sessions hold master secrets */
+    if (!create_private_cache_dir(dir, 077))
+    {
+        log_debug("TLS session cache disabled");
+        return NULL;
+    }
+
+    s_cache_dir = xstrdup(dir);
+    return s_cache_dir;
+}
+
+static char *session_file_path(const char *url, const char *client_cert_path)
+{
+    const char *dir = cache_dir();
+    if (dir == NULL)
+        return NULL;
+
+    CURLU *cu = curl_url();
+    if (cu == NULL)
+        return NULL;
+
+    char *path = NULL;
+    char *host = NULL;
+    char *port = NULL;
+    if (curl_url_set(cu, CURLUPART_URL, url, 0) == CURLUE_OK
+        && curl_url_get(cu, CURLUPART_HOST, &host, 0) == CURLUE_OK
+        && curl_url_get(cu, CURLUPART_PORT, &port, CURLU_DEFAULT_PORT) == CURLUE_OK)
+    {
+        /* A session is bound to the client certificate used to negotiate it */
+        char *key = xasprintf("%s:%s\n%s", host, port, client_cert_path ? client_cert_path : "");
+        char sha1[SHA1_RESULT_LEN*2 + 1];
+        path = concat_path_file(dir, str_to_sha1str(sha1, key));
+        free(key);
+    }
+
+    curl_free(port);
+    curl_free(host);
+    curl_url_cleanup(cu);
+    return path;
+}
+
+static SSL_SESSION *load_session(const char *path)
+{
+    int fd = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+
+    SSL_SESSION *session = NULL;
+    struct stat sb;
+    if (fstat(fd, &sb) != 0
+        || !S_ISREG(sb.st_mode)
+        || sb.st_uid != geteuid()
+        || sb.st_size <= 0
+        || sb.st_size > TLS_SESSION_MAX_SIZE)
+    {
+        log_debug("Ignoring TLS session file '%s'", path);
+        goto ret;
+    }
+
+    unsigned char *data = xmalloc(sb.st_size);
+    if (full_read(fd, data, sb.st_size) == sb.st_size)
+    {
+        const unsigned char *p = data;
+        session = d2i_SSL_SESSION(NULL, &p, sb.st_size);
+    }
+    free(data);
+
+    if (session == NULL)
+    {
+        log_debug("Corrupted TLS session file '%s'", path);
+        unlink(path);
+        goto ret;
+    }
+
+    if (!SSL_SESSION_is_resumable(session)
+        || SSL_SESSION_get_time(session) + SSL_SESSION_get_timeout(session) <= time(NULL))
+    {
+        log_debug("Expired TLS session file '%s'", path);
+        SSL_SESSION_free(session);
+        session = NULL;
+        unlink(path);
+    }
+
+ ret:
+    close(fd);
+    return session;
+}
+
+static void store_session(const char *path, SSL_SESSION *session)
+{
+    int len = i2d_SSL_SESSION(session, NULL);
+    if (len <= 0 || len > TLS_SESSION_MAX_SIZE)
+        return;
+
+    unsigned char *data = xmalloc(len);
+    unsigned char *p = data;
+    i2d_SSL_SESSION(session, &p);
+
+    /* Write to a temporary file and rename it to never expose a partially
+     * written session to a concurrently running reporter */
+    char *tmp = xasprintf("%s.XXXXXX", path);
+    int fd = mkstemp(tmp);
+    if (fd < 0)
+    {
+        log_debug("Can't create '%s': %s", tmp, strerror(errno));
+        goto ret;
+    }
+
+    bool ok = full_write(fd, data, len) == len;
+    ok = (close(fd) == 0) && ok;
+    if (!ok || rename(tmp, path) != 0)
+    {
+        log_debug("Can't store TLS session in '%s': %s", path, strerror(errno));
+        unlink(tmp);
+        goto ret;
+    }
+
+    log_debug("Stored TLS session in '%s'", path);
+
+ ret:
+    free(tmp);
+    free(data);
+}
+
+static int new_session_callback(SSL *ssl, SSL_SESSION *session)
+{
+    const char *path = SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), s_ctx_path_index);
+    if (path && SSL_SESSION_is_resumable(session))
+        store_session(path, session);
+
+    /* Let curl keep the session for the other connections of this process,
+     * 0 means the reference was not taken over */
+    return s_curl_new_session_cb ? s_curl_new_session_cb(ssl, session) : 0;
+}
+
+static void info_callback(const SSL *const_ssl, int where, int ret)
+{
+    SSL *ssl = (SSL *)const_ssl;
+    void *state = SSL_get_ex_data(ssl, s_ssl_state_index);
+
+    /* ClientHello is not built yet, so this is the last chance to offer
+     * the stored session. The state prevents lookups on renegotiation. */
+    if ((where & SSL_CB_HANDSHAKE_START) && state == NULL)
+    {
+        SSL_set_ex_data(ssl, s_ssl_state_index, SESSION_LOOKED_UP);
+
+        /* Do not override a session curl found in its own cache */
+        if (SSL_get_session(ssl) != NULL)
+            return;
+
+        const char *path = SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), s_ctx_path_index);
+        SSL_SESSION *session = path ? load_session(path) : NULL;
+        if (session)
+        {
+            SSL_set_session(ssl, session);
+            SSL_SESSION_free(session);
+        }
+    }
+    else if ((where & SSL_CB_HANDSHAKE_DONE) && state == SESSION_LOOKED_UP)
+    {
+        SSL_set_ex_data(ssl, s_ssl_state_index, SESSION_COUNTED);
+
+        if (SSL_session_reused(ssl))
+            ++s_hits;
+        else
+            ++s_misses;
+
+        log_debug("TLS session cache %s: %u hits, %u misses",
+                  SSL_session_reused(ssl) ? "hit" : "miss", s_hits, s_misses);
+    }
+}
+
+static void free_ex_path(void *parent, void *ptr, CRYPTO_EX_DATA *ad, int idx, long argl, void *argp)
+{
+    free(ptr);
+}
+
+static CURLcode ssl_ctx_callback(CURL *handle, void *sslctx, void *client_cert_path)
+{
+    SSL_CTX *ctx = (SSL_CTX *)sslctx;
+
+    const char *url = NULL;
+    if (curl_easy_getinfo(handle, CURLINFO_EFFECTIVE_URL, &url) != CURLE_OK || url == NULL)
+        return CURLE_OK;
+
+    char *path = session_file_path(url, client_cert_path);
+    if (path == NULL)
+        return CURLE_OK;
+
+    /* The context is created for every connection and frees the path */
+    SSL_CTX_set_ex_data(ctx, s_ctx_path_index, path);
+
+    s_curl_new_session_cb = SSL_CTX_sess_get_new_cb(ctx);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_CTX_get_session_cache_mode(ctx) | SSL_SESS_CACHE_CLIENT);
+    SSL_CTX_sess_set_new_cb(ctx, new_session_callback);
+    SSL_CTX_set_info_callback(ctx, info_callback);
+
+    return CURLE_OK;
+}
+
+void tls_session_cache_attach(CURL *handle, const char *url, const char *client_cert_path)
+{
+    if (!get_global_tls_session_cache() || prefixcmp(url, "https://") != 0)
+        return;
+
+    /* The callbacks below work with OpenSSL's SSL_CTX only */
+    const curl_version_info_data *info = curl_version_info(CURLVERSION_NOW);
+    if (info->ssl_version == NULL || prefixcmp(info->ssl_version, "OpenSSL/") != 0)
+    {
+        log_debug("TLS session cache is not supported with curl's '%s'",
+                  info->ssl_version ? info->ssl_version : "no TLS");
+        return;
+    }
+
+    if (s_ctx_path_index < 0)
+    {
+        s_ctx_path_index = SSL_CTX_get_ex_new_index(0, NULL, NULL, NULL, free_ex_path);
+        s_ssl_state_index = SSL_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+        if (s_ctx_path_index < 0 || s_ssl_state_index < 0)
+            return;
+    }
+
+    /* Not fatal: curl may have been built without the option */
+    if (curl_easy_setopt(handle, CURLOPT_SSL_CTX_DATA, client_cert_path) != CURLE_OK
+        || curl_easy_setopt(handle, CURLOPT_SSL_CTX_FUNCTION, ssl_ctx_callback) != CURLE_OK)
+        log_debug("TLS session cache is not supported by curl");
+}
+
+#else
+
+void tls_session_cache_attach(CURL *handle, const char *url, const char *client_cert_path)
+{
+    /* Without OpenSSL we have no access to the sessions */
+}
+
+#endif
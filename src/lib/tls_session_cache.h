@@ -0,0 +1,47 @@
+/*
+    Copyright (C) 2026  ABRT team
+    Copyright (C) 2026  RedHat Inc
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#ifndef TLS_SESSION_CACHE_H_
+#define TLS_SESSION_CACHE_H_
+
+#include <curl/curl.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Directory where TLS sessions are persisted between reporter runs.
+ * Can be overridden by LIBREPORT_DEBUG_TLS_SESSION_CACHE_DIR.
+ */
+#define TLS_SESSION_CACHE_DIR LOCALSTATEDIR"/cache/libreport/tls-sessions"
+
+/* Makes the handle resume TLS sessions stored by previous processes and
+ * store the new ones. Sessions are kept per host, port and client certificate,
+ * client_cert_path must stay valid until the handle is cleaned up.
+ *
+ * Does nothing if the cache is disabled in libreport.conf (TLSSessionCache),
+ * the url is not https, libreport was built without OpenSSL or curl uses
+ * a different TLS back-end. Never fails, the cache is only an optimization.
+ */
+void tls_session_cache_attach(CURL *handle, const char *url, const char *client_cert_path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,214 @@
+/*
+    Copyright (C) 2026  ABRT team
+    Copyright (C) 2026  RedHat Inc
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include "internal_libreport.h"
+#include "trace.h"
+
+/* Log-linear buckets: values below 2^SUB_BITS have their own buckets, the
+ * other ones are split by the most significant bit and the SUB_BITS bits
+ * following it.
+ */
+#define TRACE_SUB_BITS 3
+#define TRACE_SUB_BUCKETS (1 << TRACE_SUB_BITS)
+#define TRACE_BUCKETS ((64 - TRACE_SUB_BITS + 1) * TRACE_SUB_BUCKETS)
+
+struct trace_histogram
+{
+    unsigned long long th_sum_ns;
+    unsigned long long th_min_ns_1;     ///< min + 1, 0 if nothing was recorded
+    unsigned long long th_max_ns;
+    unsigned long th_buckets[TRACE_BUCKETS];
+};
+
+static struct trace_histogram s_histograms[TRACE_POINT_COUNT];
+
+static const char *const s_point_names[] = {
+#define TRACE_POINT_NAME(name) #name,
+    LIBREPORT_TRACE_POINTS(TRACE_POINT_NAME)
+#undef TRACE_POINT_NAME
+};
+
+static unsigned trace_bucket(unsigned long long ns)
+{
+    if (ns < TRACE_SUB_BUCKETS)
+        return ns;
+
+    const unsigned msb = 63 - __builtin_clzll(ns);
+    const unsigned sub = (ns >> (msb - TRACE_SUB_BITS)) & (TRACE_SUB_BUCKETS - 1);
+    return (msb - TRACE_SUB_BITS + 1) * TRACE_SUB_BUCKETS + sub;
+}
+
+/* The highest value falling into the bucket */
+static unsigned long long trace_bucket_max(unsigned bucket)
+{
+    if (bucket < TRACE_SUB_BUCKETS)
+        return bucket;
+
+    const unsigned msb = bucket / TRACE_SUB_BUCKETS + TRACE_SUB_BITS - 1;
+    const unsigned long long sub = bucket % TRACE_SUB_BUCKETS;
+    const unsigned shift = msb - TRACE_SUB_BITS;
+    return ((TRACE_SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+const char *trace_point_name(enum trace_point point)
+{
+    if ((unsigned)point >= TRACE_POINT_COUNT)
+        return NULL;
+
+    return s_point_names[point];
+}
+
+unsigned long long trace_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void trace_record(enum trace_point point, unsigned long long ns)
+{
+    if ((unsigned)point >= TRACE_POINT_COUNT)
+        return;
+
+    struct trace_histogram *h = &s_histograms[point];
+
+    __atomic_add_fetch(&h->th_buckets[trace_bucket(ns)], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&h->th_sum_ns, ns, __ATOMIC_RELAXED);
+
+    unsigned long long min_1 = __atomic_load_n(&h->th_min_ns_1, __ATOMIC_RELAXED);
+    while ((min_1 == 0 || ns + 1 < min_1)
+           && !__atomic_compare_exchange_n(&h->th_min_ns_1, &min_1, ns + 1,
+                                           /*weak*/ true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+
+    unsigned long long max = __atomic_load_n(&h->th_max_ns, __ATOMIC_RELAXED);
+    while (ns > max
+           && !__atomic_compare_exchange_n(&h->th_max_ns, &max, ns,
+                                           /*weak*/ true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+static unsigned long long trace_percentile(const unsigned long *buckets, unsigned long count,
+                                           unsigned percent, unsigned long long max)
+{
+    /* Rank of the value, rounded up */
+    const unsigned long rank = (count * percent + 99) / 100;
+    unsigned long seen = 0;
+    for (unsigned i = 0; i < TRACE_BUCKETS; ++i)
+    {
+        seen += buckets[i];
+        if (seen >= rank)
+        {
+            const unsigned long long value = trace_bucket_max(i);
+            return value < max ? value : max;
+        }
+    }
+
+    return max;
+}
+
+bool trace_get_stats(enum trace_point point, struct trace_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+    if ((unsigned)point >= TRACE_POINT_COUNT)
+        return false;
+
+    /* Records running in parallel make the numbers slightly inconsistent,
+     * percentiles are computed from a copy of the buckets. */
+    struct trace_histogram *h = &s_histograms[point];
+    unsigned long buckets[TRACE_BUCKETS];
+    unsigned long count = 0;
+    for (unsigned i = 0; i < TRACE_BUCKETS; ++i)
+    {
+        buckets[i] = __atomic_load_n(&h->th_buckets[i], __ATOMIC_RELAXED);
+        count += buckets[i];
+    }
+
+    if (count == 0)
+        return false;
+
+    stats->ts_count = count;
+    stats->ts_min_ns = __atomic_load_n(&h->th_min_ns_1, __ATOMIC_RELAXED) - 1;
+    stats->ts_max_ns = __atomic_load_n(&h->th_max_ns, __ATOMIC_RELAXED);
+    stats->ts_mean_ns = __atomic_load_n(&h->th_sum_ns, __ATOMIC_RELAXED) / count;
+    stats->ts_p50_ns = trace_percentile(buckets, count, 50, stats->ts_max_ns);
+    stats->ts_p90_ns = trace_percentile(buckets, count, 90, stats->ts_max_ns);
+    stats->ts_p99_ns = trace_percentile(buckets, count, 99, stats->ts_max_ns);
+
+    return true;
+}
+
+void trace_dump(int fd)
+{
+    struct strbuf *buf = strbuf_new();
+
+    for (unsigned i = 0; i < TRACE_POINT_COUNT; ++i)
+    {
+        struct trace_stats stats;
+        if (!trace_get_stats(i, &stats))
+            continue;
+
+        strbuf_append_strf(buf,
+                "{\"pid\":%ld,\"point\":\"%s\",\"count\":%lu,"
+                "\"min_ns\":%llu,\"mean_ns\":%llu,\"p50_ns\":%llu,"
+                "\"p90_ns\":%llu,\"p99_ns\":%llu,\"max_ns\":%llu}\n",
+                (long)getpid(), s_point_names[i], stats.ts_count,
+                stats.ts_min_ns, stats.ts_mean_ns, stats.ts_p50_ns,
+                stats.ts_p90_ns, stats.ts_p99_ns, stats.ts_max_ns);
+    }
+
+    /* Single write, more processes may append to the same file */
+    if (buf->len)
+        full_write(fd, buf->buf, buf->len);
+
+    strbuf_free(buf);
+}
+
+void trace_reset(void)
+{
+    memset(s_histograms, 0, sizeof(s_histograms));
+}
+
+bool trace_enabled(void)
+{
+    return LIBREPORT_ENABLE_TRACING;
+}
+
+static void __attribute__((destructor)) trace_dump_at_exit(void)
+{
+    const char *path = getenv("LIBREPORT_TRACE_DUMP");
+    if (path == NULL || path[0] == '\0')
+        return;
+
+    if (strcmp(path, "-") == 0)
+    {
+        trace_dump(STDERR_FILENO);
+        return;
+    }
+
+    const int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        perror_msg("Can't open '%s'", path);
+        return;
+    }
+
+    trace_dump(fd);
+    close(fd);
+}
@@ -288,6 +288,17 @@ ureport_server_config_load(struct ureport_server_config *config,
     UREPORT_OPTION_VALUE_FROM_CONF(settings, "URL", config->ur_url, xstrdup);
     UREPORT_OPTION_VALUE_FROM_CONF(settings, "SSLVerify", config->ur_ssl_verify, string_to_bool);
 
+    const char *compress_requests = NULL;
+    UREPORT_OPTION_VALUE_FROM_CONF(settings, "CompressRequests", compress_requests, (const char *));
+    if (compress_requests != NULL)
+    {
+        const int encoding = post_content_encoding_from_string(compress_requests);
+        if (encoding < 0)
+            log_warning("Ignoring unknown CompressRequests value '%s'", compress_requests);
+        else
+            config->ur_content_encoding = encoding;
+    }
+
     const char *http_auth_pref = NULL;
     UREPORT_OPTION_VALUE_FROM_CONF(settings, "HTTPAuth", http_auth_pref, (const char *));
     ureport_server_config_load_basic_auth(config, http_auth_pref);
@@ -325,6 +336,7 @@ ureport_server_config_init(struct ureport_server_config *config)
     config->ur_username = NULL;
     config->ur_password = NULL;
     config->ur_http_headers = new_map_string();
+    config->ur_content_encoding = POST_CONTENT_ENCODING_IDENTITY;
 
     config->ur_prefs.urp_auth_items = NULL;
     config->ur_prefs.urp_flags = 0;
@@ -633,15 +645,11 @@ ureport_server_response_from_reply(post_state_t *post_state,
     return response;
 }
 
-bool
-ureport_server_response_save_in_dump_dir(struct ureport_server_response *resp,
-                                         const char *dump_dir_path,
-                                         struct ureport_server_config *config)
+void
+ureport_server_response_save_in_dd(struct ureport_server_response *resp,
+                                   struct dump_dir *dd,
+                                   struct ureport_server_config *config)
 {
-    struct dump_dir *dd = dd_opendir(dump_dir_path, /* flags */ 0);
-    if (!dd)
-        return false;
-
     if (resp->urr_bthash)
     {
         {
@@ -666,6 +674,18 @@ ureport_server_response_save_in_dump_dir(struct ureport_server_response *resp,
 
     if (resp->urr_solution)
         dd_save_text(dd, FILENAME_NOT_REPORTABLE, resp->urr_solution);
+}
+
+bool
+ureport_server_response_save_in_dump_dir(struct ureport_server_response *resp,
+                                         const char *dump_dir_path,
+                                         struct ureport_server_config *config)
+{
+    struct dump_dir *dd = dd_opendir(dump_dir_path, /* flags */ 0);
+    if (!dd)
+        return false;
+
+    ureport_server_response_save_in_dd(resp, dd, config);
 
     dd_close(dd);
     return true;
@@ -692,10 +712,12 @@ ureport_add_str(struct json_object *ur, const char *key, const char *s)
 }
 
 char *
-ureport_from_dump_dir_ext(const char *dump_dir_path, const struct ureport_preferences *preferences)
+ureport_from_dd(struct dump_dir *dd, const struct ureport_preferences *preferences)
 {
+    /* satyr reads the files by itself, the lock held by dd keeps them
+     * consistent with the auth items loaded below */
     char *error_message;
-    struct sr_report *report = sr_abrt_report_from_dir(dump_dir_path,
+    struct sr_report *report = sr_abrt_report_from_dir(dd->dd_dirname,
                                                        &error_message);
 
     if (!report)
@@ -704,15 +726,12 @@ ureport_from_dump_dir_ext(const char *dump_dir_path, const struct ureport_prefer
             error_msg_and_die("%s", error_message);
 
         log_notice("%s", error_message);
+        free(error_message);
         return NULL;
     }
 
-    if (preferences != NULL && preferences->urp_auth_items != NULL)
+    if (preferences != NULL)
     {
-        struct dump_dir *dd = dd_opendir(dump_dir_path, DD_OPEN_READONLY);
-        if (!dd)
-            xfunc_die(); /* dd_opendir() already printed an error message */
-
         GList *iter = preferences->urp_auth_items;
         for ( ; iter != NULL; iter = g_list_next(iter))
         {
@@ -729,8 +748,6 @@ ureport_from_dump_dir_ext(const char *dump_dir_path, const struct ureport_prefer
             sr_report_add_auth(report, key, value);
             free(value);
         }
-
-        dd_close(dd);
     }
 
     char *json_ureport = sr_report_to_json(report);
@@ -739,15 +756,195 @@ ureport_from_dump_dir_ext(const char *dump_dir_path, const struct ureport_prefer
     return json_ureport;
 }
 
+char *
+ureport_from_dump_dir_ext(const char *dump_dir_path, const struct ureport_preferences *preferences)
+{
+    struct dump_dir *dd = dd_opendir(dump_dir_path, DD_OPEN_READONLY);
+    if (!dd)
+    {
+        if (NULL == preferences || !(preferences->urp_flags & UREPORT_PREF_FLAG_RETURN_ON_FAILURE))
+            xfunc_die(); /* dd_opendir() already printed an error message */
+        return NULL;
+    }
+
+    char *json_ureport = ureport_from_dd(dd, preferences);
+    dd_close(dd);
+
+    return json_ureport;
+}
+
 char *
 ureport_from_dump_dir(const char *dump_dir_path)
 {
     return ureport_from_dump_dir_ext(dump_dir_path, /*no preferences*/NULL);
 }
 
-struct post_state *
-ureport_do_post(const char *json, struct ureport_server_config *config,
-                const char *url_sfx)
+/* A record written by an ureport_from_dump_dirs() worker for every dump dir,
+ * followed by length bytes of JSON
+ */
+struct ureport_worker_record
+{
+    uint32_t index;
+    uint32_t length;   ///< UREPORT_WORKER_FAILED if the uReport was not built
+};
+
+#define UREPORT_WORKER_FAILED UINT32_MAX
+
+static void
+ureport_worker(int fd, unsigned worker, unsigned workers,
+               const char *const *dump_dir_paths, unsigned count,
+               const struct ureport_preferences *preferences)
+{
+    for (unsigned i = worker; i < count; i += workers)
+    {
+        char *json = ureport_from_dump_dir_ext(dump_dir_paths[i], preferences);
+
+        struct ureport_worker_record rec = {
+            .index = i,
+            .length = json ? strlen(json) : UREPORT_WORKER_FAILED,
+        };
+
+        if (full_write(fd, &rec, sizeof(rec)) != sizeof(rec)
+            || (json && full_write(fd, json, rec.length) != rec.length))
+        {
+            perror_msg("Can't pass uReport to the parent");
+            _exit(EXIT_FAILURE);
+        }
+
+        free(json);
+    }
+
+    _exit(EXIT_SUCCESS);
+}
+
+/* Returns false if the worker has no more records */
+static bool
+ureport_read_worker_record(int fd, char **json_ureports, unsigned count)
+{
+    struct ureport_worker_record rec;
+    if (full_read(fd, &rec, sizeof(rec)) != sizeof(rec))
+        return false;
+
+    if (rec.index >= count)
+    {
+        error_msg("uReport worker sent an invalid record");
+        return false;
+    }
+
+    if (rec.length == UREPORT_WORKER_FAILED)
+        return true;
+
+    char *json = xmalloc(rec.length + 1);
+    if (full_read(fd, json, rec.length) != rec.length)
+    {
+        free(json);
+        return false;
+    }
+    json[rec.length] = '\0';
+
+    free(json_ureports[rec.index]);
+    json_ureports[rec.index] = json;
+    return true;
+}
+
+char **
+ureport_from_dump_dirs(const char *const *dump_dir_paths, unsigned count,
+                       const struct ureport_preferences *preferences,
+                       unsigned workers)
+{
+    char **json_ureports = xzalloc(sizeof(char *) * count);
+    if (count == 0)
+        return json_ureports;
+
+    if (workers == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cpus > 0 ? cpus : 1;
+    }
+    if (workers > count)
+        workers = count;
+
+    /* satyr and the die paths of libreport are not thread safe, hence the
+     * uReports are built in forked processes and sent back through pipes
+     */
+    struct ureport_preferences worker_prefs = { .urp_flags = UREPORT_PREF_FLAG_RETURN_ON_FAILURE };
+    if (preferences != NULL)
+    {
+        worker_prefs.urp_auth_items = preferences->urp_auth_items;
+        worker_prefs.urp_flags |= preferences->urp_flags;
+    }
+
+    pid_t *pids = xmalloc(sizeof(pid_t) * workers);
+    struct pollfd *fds = xmalloc(sizeof(struct pollfd) * workers);
+
+    /* Do not let children flush our buffers */
+    fflush(NULL);
+
+    for (unsigned w = 0; w < workers; ++w)
+    {
+        int pipefd[2];
+        xpipe(pipefd);
+
+        pids[w] = fork();
+        if (pids[w] < 0)
+            perror_msg_and_die("fork");
+
+        if (pids[w] == 0)
+        {
+            for (unsigned i = 0; i < w; ++i)
+                close(fds[i].fd);
+            close(pipefd[0]);
+
+            ureport_worker(pipefd[1], w, workers, dump_dir_paths, count, &worker_prefs);
+        }
+
+        close(pipefd[1]);
+        fds[w].fd = pipefd[0];
+        fds[w].events = POLLIN;
+    }
+
+    unsigned running = workers;
+    while (running > 0)
+    {
+        if (poll(fds, workers, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror_msg_and_die("poll");
+        }
+
+        for (unsigned w = 0; w < workers; ++w)
+        {
+            /* Negative fd is ignored by poll() */
+            if (fds[w].fd < 0 || fds[w].revents == 0)
+                continue;
+
+            /* A record is written at once, so it is safe to read it as whole */
+            if (!ureport_read_worker_record(fds[w].fd, json_ureports, count))
+            {
+                close(fds[w].fd);
+                fds[w].fd = -1;
+                --running;
+            }
+        }
+    }
+
+    for (unsigned w = 0; w < workers; ++w)
+    {
+        int status;
+        if (safe_waitpid(pids[w], &status, 0) > 0
+            && !(WIFEXITED(status) && WEXITSTATUS(status) == 0))
+            error_msg("uReport worker %d failed", (int)pids[w]);
+    }
+
+    free(fds);
+    free(pids);
+
+    return json_ureports;
+}
+
+static struct post_state *
+ureport_post_state_new(struct ureport_server_config *config)
 {
     int flags = POST_WANT_BODY | POST_WANT_ERROR_MSG;
 
@@ -755,6 +952,7 @@ ureport_do_post(const char *json, struct ureport_server_config *config,
         flags |= POST_WANT_SSL_VERIFY;
 
     struct post_state *post_state = new_post_state(flags);
+    post_state->content_encoding = config->ur_content_encoding;
 
     if (config->ur_client_cert && config->ur_client_key)
     {
@@ -768,39 +966,73 @@ ureport_do_post(const char *json, struct ureport_server_config *config,
         post_state->password = config->ur_password;
     }
 
+    return post_state;
+}
+
+/* keep_alive - do not ask the server to close the connection, batches
+ * send many requests over a single connection
+ */
+static char **
+ureport_http_headers_new(struct ureport_server_config *config, bool keep_alive)
+{
     char **headers = xmalloc(sizeof(char *) * (3 + size_map_string(config->ur_http_headers)));
-    headers[0] = (char *)"Accept: application/json";
-    headers[1] = (char *)"Connection: close";
-    headers[2] = NULL;
+    unsigned i = 0;
+    headers[i++] = xstrdup("Accept: application/json");
+    if (!keep_alive)
+        headers[i++] = xstrdup("Connection: close");
 
     if (config->ur_http_headers != NULL)
     {
-        unsigned i = 2;
         const char *header;
         const char *value;
         map_string_iter_t iter;
         init_map_string_iter(&iter, config->ur_http_headers);
         while (next_map_string_iter(&iter, &header, &value))
             headers[i++] = xasprintf("%s: %s", header, value);
-        headers[i] = NULL;
     }
+    headers[i] = NULL;
+
+    return headers;
+}
+
+static void
+ureport_http_headers_free(char **headers)
+{
+    for (char **h = headers; *h != NULL; ++h)
+        free(*h);
+    free(headers);
+}
+
+/* Client authentication failed. Try again without client auth.
+ * CURLE_SSL_CONNECT_ERROR - cert not found/server doesnt trust the CA
+ * CURLE_SSL_CERTPROBLEM - malformed certificate/no permission
+ */
+static bool
+ureport_client_auth_failed(struct post_state *post_state, struct ureport_server_config *config)
+{
+    return (post_state->curl_result == CURLE_SSL_CONNECT_ERROR
+            || post_state->curl_result == CURLE_SSL_CERTPROBLEM)
+        && config->ur_client_cert && config->ur_client_key;
+}
 
+struct post_state *
+ureport_do_post(const char *json, struct ureport_server_config *config,
+                const char *url_sfx)
+{
+    struct post_state *post_state = ureport_post_state_new(config);
+    char **headers = ureport_http_headers_new(config, /*keep_alive*/false);
     char *dest_url = concat_path_file(config->ur_url, url_sfx);
 
     post_string_as_form_data(post_state, dest_url, "application/json",
                      (const char **)headers, json);
 
-    /* Client authentication failed. Try again without client auth.
-     * CURLE_SSL_CONNECT_ERROR - cert not found/server doesnt trust the CA
-     * CURLE_SSL_CERTPROBLEM - malformed certificate/no permission
-     */
-    if ((post_state->curl_result == CURLE_SSL_CONNECT_ERROR
-         || post_state->curl_result == CURLE_SSL_CERTPROBLEM)
-            && config->ur_client_cert && config->ur_client_key)
+    if (ureport_client_auth_failed(post_state, config))
     {
         warn_msg("Authentication failed. Retrying unauthenticated.");
+        int flags = post_state->flags;
         free_post_state(post_state);
         post_state = new_post_state(flags);
+        post_state->content_encoding = config->ur_content_encoding;
 
         post_string_as_form_data(post_state, dest_url, "application/json",
                          (const char **)headers, json);
@@ -808,10 +1040,7 @@ ureport_do_post(const char *json, struct ureport_server_config *config,
     }
 
     free(dest_url);
-
-    for (unsigned i = size_map_string(config->ur_http_headers); i != 0; --i)
-        free(headers[i + 1]);
-    free(headers);
+    ureport_http_headers_free(headers);
 
     return post_state;
 }
@@ -833,6 +1062,48 @@ ureport_submit(const char *json, struct ureport_server_config *config)
     return resp;
 }
 
+struct ureport_server_response **
+ureport_submit_batch(const char *const *json_ureports, unsigned count,
+                     struct ureport_server_config *config, unsigned max_connections)
+{
+    struct post_state **states = xmalloc(sizeof(struct post_state *) * count);
+    for (unsigned i = 0; i < count; ++i)
+        states[i] = ureport_post_state_new(config);
+
+    char **headers = ureport_http_headers_new(config, /*keep_alive*/true);
+    char *dest_url = concat_path_file(config->ur_url, UREPORT_SUBMIT_ACTION);
+
+    post_multi(states, count, dest_url, "application/json", (const char **)headers,
+               json_ureports, POST_DATA_STRING_AS_FORM_DATA, max_connections);
+
+    free(dest_url);
+    ureport_http_headers_free(headers);
+
+    struct ureport_server_response **responses = xzalloc(sizeof(struct ureport_server_response *) * count);
+    for (unsigned i = 0; i < count; ++i)
+    {
+        if (json_ureports[i] == NULL)
+        {
+            free_post_state(states[i]);
+            continue;
+        }
+
+        /* Rare, let the regular path do the unauthenticated retry */
+        if (ureport_client_auth_failed(states[i], config))
+        {
+            free_post_state(states[i]);
+            states[i] = ureport_do_post(json_ureports[i], config, UREPORT_SUBMIT_ACTION);
+        }
+
+        responses[i] = ureport_server_response_from_reply(states[i], config);
+        free_post_state(states[i]);
+    }
+
+    free(states);
+
+    return responses;
+}
+
 char *
 ureport_json_attachment_new(const char *bthash, const char *type, const char *data)
 {
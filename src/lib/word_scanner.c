@@ -0,0 +1,375 @@
+/*
+    Copyright (C) 2026  ABRT team
+    Copyright (C) 2026  RedHat Inc
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include "internal_libreport.h"
+
+/*
+ * Aho-Corasick automaton. The trie is stored in an array of nodes, node 0
+ * is the root. Children of a node are kept in a singly linked list of
+ * siblings; the alphabet used by the word lists is small, so the linear
+ * lookup is cheap.
+ */
+#define WS_NONE ((unsigned)-1)
+
+struct ws_node
+{
+    unsigned wn_first_child;
+    unsigned wn_next_sibling;
+    /* The longest proper suffix of this node which is in the trie */
+    unsigned wn_fail;
+    /* The nearest node on the fail chain which ends a word */
+    unsigned wn_output_link;
+    /* Index of the word ending in this node */
+    unsigned wn_word;
+    unsigned char wn_char;
+};
+
+struct word_scanner
+{
+    struct ws_node *ws_nodes;
+    unsigned ws_node_count;
+    unsigned ws_node_alloc;
+    size_t *ws_word_lens;
+    unsigned ws_word_count;
+    int ws_flags;
+};
+
+static inline unsigned char ws_fold(const struct word_scanner *scanner, unsigned char c)
+{
+    if ((scanner->ws_flags & WORD_SCANNER_CASE_INSENSITIVE) && c >= 'A' && c <= 'Z')
+        return c + ('a' - 'A');
+    return c;
+}
+
+static unsigned ws_child(const struct word_scanner *scanner, unsigned node, unsigned char c)
+{
+    for (unsigned child = scanner->ws_nodes[node].wn_first_child;
+         child != WS_NONE;
+         child = scanner->ws_nodes[child].wn_next_sibling)
+    {
+        if (scanner->ws_nodes[child].wn_char == c)
+            return child;
+    }
+
+    return WS_NONE;
+}
+
+static unsigned ws_add_child(struct word_scanner *scanner, unsigned node, unsigned char c)
+{
+    if (scanner->ws_node_count == scanner->ws_node_alloc)
+    {
+        scanner->ws_node_alloc *= 2;
+        scanner->ws_nodes = xrealloc(scanner->ws_nodes,
+                                     scanner->ws_node_alloc * sizeof(*scanner->ws_nodes));
+    }
+
+    const unsigned child = scanner->ws_node_count++;
+    struct ws_node *n = &scanner->ws_nodes[child];
+    n->wn_first_child = WS_NONE;
+    n->wn_next_sibling = scanner->ws_nodes[node].wn_first_child;
+    n->wn_fail = 0;
+    n->wn_output_link = WS_NONE;
+    n->wn_word = WS_NONE;
+    n->wn_char = c;
+    scanner->ws_nodes[node].wn_first_child = child;
+
+    return child;
+}
+
+/* Breadth first walk computing the fail and output links */
+static void ws_link(struct word_scanner *scanner)
+{
+    struct ws_node *nodes = scanner->ws_nodes;
+    unsigned *queue = xmalloc(scanner->ws_node_count * sizeof(*queue));
+    unsigned head = 0;
+    unsigned tail = 0;
+
+    for (unsigned child = nodes[0].wn_first_child; child != WS_NONE; child = nodes[child].wn_next_sibling)
+        queue[tail++] = child;
+
+    while (head < tail)
+    {
+        const unsigned node = queue[head++];
+        for (unsigned child = nodes[node].wn_first_child; child != WS_NONE; child = nodes[child].wn_next_sibling)
+        {
+            queue[tail++] = child;
+
+            unsigned fail = nodes[node].wn_fail;
+            unsigned next;
+            while ((next = ws_child(scanner, fail, nodes[child].wn_char)) == WS_NONE && fail != 0)
+                fail = nodes[fail].wn_fail;
+
+            nodes[child].wn_fail = next != WS_NONE ? next : 0;
+
+            const unsigned f = nodes[child].wn_fail;
+            nodes[child].wn_output_link = nodes[f].wn_word != WS_NONE ? f : nodes[f].wn_output_link;
+        }
+    }
+
+    free(queue);
+}
+
+struct word_scanner *word_scanner_new(GList *words, int flags)
+{
+    struct word_scanner *scanner = xzalloc(sizeof(*scanner));
+    scanner->ws_flags = flags;
+    scanner->ws_node_alloc = 64;
+    scanner->ws_nodes = xmalloc(scanner->ws_node_alloc * sizeof(*scanner->ws_nodes));
+    scanner->ws_node_count = 1;
+    scanner->ws_nodes[0].wn_first_child = WS_NONE;
+    scanner->ws_nodes[0].wn_next_sibling = WS_NONE;
+    scanner->ws_nodes[0].wn_fail = 0;
+    scanner->ws_nodes[0].wn_output_link = WS_NONE;
+    scanner->ws_nodes[0].wn_word = WS_NONE;
+    scanner->ws_nodes[0].wn_char = '\0';
+
+    scanner->ws_word_count = g_list_length(words);
+    scanner->ws_word_lens = xzalloc(scanner->ws_word_count * sizeof(*scanner->ws_word_lens) + 1);
+
+    unsigned index = 0;
+    for (GList *w = words; w; w = g_list_next(w), ++index)
+    {
+        const char *word = w->data;
+        if (word == NULL || word[0] == '\0')
+            continue;
+
+        unsigned node = 0;
+        for (const char *c = word; *c; ++c)
+        {
+            const unsigned char folded = ws_fold(scanner, (unsigned char)*c);
+            unsigned child = ws_child(scanner, node, folded);
+            if (child == WS_NONE)
+                child = ws_add_child(scanner, node, folded);
+            node = child;
+        }
+
+        scanner->ws_word_lens[index] = strlen(word);
+
+        /* The same word listed twice is reported only once */
+        if (scanner->ws_nodes[node].wn_word == WS_NONE)
+            scanner->ws_nodes[node].wn_word = index;
+    }
+
+    ws_link(scanner);
+
+    return scanner;
+}
+
+void word_scanner_free(struct word_scanner *scanner)
+{
+    if (scanner == NULL)
+        return;
+
+    free(scanner->ws_word_lens);
+    free(scanner->ws_nodes);
+    free(scanner);
+}
+
+static int word_match_cmp(const void *a, const void *b)
+{
+    const struct word_match *lhs = a;
+    const struct word_match *rhs = b;
+
+    if (lhs->wm_start != rhs->wm_start)
+        return lhs->wm_start < rhs->wm_start ? -1 : 1;
+    if (lhs->wm_end != rhs->wm_end)
+        return lhs->wm_end < rhs->wm_end ? -1 : 1;
+    return 0;
+}
+
+static struct word_match *ws_scan(const struct word_scanner *scanner,
+                                  const char *text, size_t len, size_t *count)
+{
+    const struct ws_node *nodes = scanner->ws_nodes;
+    struct word_match *matches = NULL;
+    size_t found = 0;
+    size_t alloc = 0;
+
+    /* Occurrences of one word don't overlap each other, the search for the
+     * next one continues behind the end of the previous one. */
+    size_t *next_start = xzalloc(scanner->ws_word_count * sizeof(*next_start) + 1);
+
+    unsigned node = 0;
+    for (size_t i = 0; i < len; ++i)
+    {
+        const unsigned char c = ws_fold(scanner, (unsigned char)text[i]);
+
+        unsigned next;
+        while ((next = ws_child(scanner, node, c)) == WS_NONE && node != 0)
+            node = nodes[node].wn_fail;
+        node = next != WS_NONE ? next : 0;
+
+        unsigned out = nodes[node].wn_word != WS_NONE ? node : nodes[node].wn_output_link;
+        for (; out != WS_NONE; out = nodes[out].wn_output_link)
+        {
+            const unsigned word = nodes[out].wn_word;
+            const size_t start = i + 1 - scanner->ws_word_lens[word];
+            if (start < next_start[word])
+                continue;
+
+            next_start[word] = i + 1;
+
+            if (found == alloc)
+            {
+                alloc = alloc ? alloc * 2 : 16;
+                matches = xrealloc(matches, alloc * sizeof(*matches));
+            }
+
+            matches[found].wm_start = start;
+            matches[found].wm_end = i + 1;
+            matches[found].wm_word = word;
+            ++found;
+        }
+    }
+
+    free(next_start);
+
+    if (found > 1)
+        qsort(matches, found, sizeof(*matches), word_match_cmp);
+
+    *count = found;
+    return matches;
+}
+
+struct word_match *word_scanner_find(const struct word_scanner *scanner,
+                                     const struct word_scanner *ignored,
+                                     const char *text, size_t len, size_t *count)
+{
+    struct word_match *matches = ws_scan(scanner, text, len, count);
+    if (ignored == NULL || *count == 0)
+        return matches;
+
+    size_t ignored_count = 0;
+    struct word_match *ignored_matches = ws_scan(ignored, text, len, &ignored_count);
+
+    /* Both arrays are sorted by the start offset, so a match lies within
+     * an ignored word iff the farthest end of the ignored words starting
+     * at or before it reaches behind its end. */
+    size_t kept = 0;
+    size_t j = 0;
+    size_t ignored_end = 0;
+    bool ignored_seen = false;
+    for (size_t i = 0; i < *count; ++i)
+    {
+        for (; j < ignored_count && ignored_matches[j].wm_start <= matches[i].wm_start; ++j)
+        {
+            if (!ignored_seen || ignored_matches[j].wm_end > ignored_end)
+                ignored_end = ignored_matches[j].wm_end;
+            ignored_seen = true;
+        }
+
+        if (ignored_seen && ignored_end >= matches[i].wm_end)
+            continue;
+
+        matches[kept++] = matches[i];
+    }
+
+    free(ignored_matches);
+
+    *count = kept;
+    return matches;
+}
+
+static struct word_scanner *s_forbidden_words;
+static struct word_scanner *s_ignored_words;
+
+static struct word_scanner *load_word_scanner(const char *filename)
+{
+    GList *words = load_words_from_file(filename);
+    struct word_scanner *scanner = word_scanner_new(words, /*case sensitive*/0);
+    list_free_with_free(words);
+    return scanner;
+}
+
+const struct word_scanner *get_forbidden_words_scanner(void)
+{
+    if (s_forbidden_words == NULL)
+        s_forbidden_words = load_word_scanner(FORBIDDEN_WORDS_BLACKLLIST);
+
+    return s_forbidden_words;
+}
+
+const struct word_scanner *get_ignored_words_scanner(void)
+{
+    if (s_ignored_words == NULL)
+        s_ignored_words = load_word_scanner(FORBIDDEN_WORDS_WHITELIST);
+
+    return s_ignored_words;
+}
+
+void reset_sensitive_words_scanners(void)
+{
+    word_scanner_free(s_forbidden_words);
+    s_forbidden_words = NULL;
+    word_scanner_free(s_ignored_words);
+    s_ignored_words = NULL;
+}
+
+void sensitive_data_item_free(struct sensitive_data_item *item)
+{
+    if (item == NULL)
+        return;
+
+    free(item->sdi_name);
+    free(item->sdi_matches);
+    free(item);
+}
+
+static gint sensitive_data_item_cmp(gconstpointer a, gconstpointer b)
+{
+    return strcmp(((const struct sensitive_data_item *)a)->sdi_name,
+                  ((const struct sensitive_data_item *)b)->sdi_name);
+}
+
+GList *problem_data_find_sensitive_data(problem_data_t *problem_data)
+{
+    const struct word_scanner *forbidden = get_forbidden_words_scanner();
+    const struct word_scanner *ignored = get_ignored_words_scanner();
+
+    GList *result = NULL;
+
+    GHashTableIter iter;
+    gpointer name;
+    gpointer value;
+    g_hash_table_iter_init(&iter, problem_data);
+    while (g_hash_table_iter_next(&iter, &name, &value))
+    {
+        struct problem_item *item = value;
+        if (!(item->flags & CD_FLAG_TXT) || item->content == NULL)
+            continue;
+
+        size_t count = 0;
+        struct word_match *matches = word_scanner_find(forbidden, ignored,
+                                                       item->content, strlen(item->content), &count);
+        if (count == 0)
+        {
+            free(matches);
+            continue;
+        }
+
+        struct sensitive_data_item *found = xmalloc(sizeof(*found));
+        found->sdi_name = xstrdup(name);
+        found->sdi_matches = matches;
+        found->sdi_count = count;
+
+        log_debug("Found %zu sensitive words in '%s'", count, (const char *)name);
+        result = g_list_prepend(result, found);
+    }
+
+    return g_list_sort(result, sensitive_data_item_cmp);
+}
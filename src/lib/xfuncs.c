@@ -388,6 +388,37 @@ int is_regular_file(struct dirent *dent, const char *dirname)
     return r;
 }
 
+/* The parent is shared by all libreport caches, only the cache directory
+ * itself is private. Cached data can hold secrets or can be planted to
+ * redirect reports, so a directory of somebody else is never used.
+ */
+bool create_private_cache_dir(const char *dir, mode_t mode_mask)
+{
+    const char *slash = strrchr(dir, '/');
+    char *parent = xstrndup(dir, slash ? slash - dir : 0);
+    if (parent[0] != '\0' && g_mkdir_with_parents(parent, 0755) != 0)
+        log_debug("Can't create '%s': %s", parent, strerror(errno));
+    free(parent);
+
+    if (mkdir(dir, 0700) != 0 && errno != EEXIST)
+    {
+        log_debug("Can't create '%s': %s", dir, strerror(errno));
+        return false;
+    }
+
+    struct stat sb;
+    if (lstat(dir, &sb) != 0
+        || !S_ISDIR(sb.st_mode)
+        || sb.st_uid != geteuid()
+        || (sb.st_mode & mode_mask) != 0)
+    {
+        log_debug("'%s' is not a private directory", dir);
+        return false;
+    }
+
+    return true;
+}
+
 /* Is it "." or ".."? */
 /* abrtlib candidate */
 bool dot_or_dotdot(const char *filename)
@@ -600,7 +600,8 @@ post_file_to_url(const char* url,
                 bool ssl_verify,
                 bool post_as_form,
                 const char **additional_headers,
-                const char *file_name)
+                const char *file_name,
+                const struct post_stream *stream)
 {
     rhts_result_t *result = xzalloc(sizeof(*result));
     char *url_copy = NULL;
@@ -618,7 +619,17 @@ post_file_to_url(const char* url,
     );
     atch_state->username = username;
     atch_state->password = password;
-    if (post_as_form)
+    if (stream)
+    {
+        /* Sends data as they are being produced */
+        post_stream_as_form(atch_state,
+            url,
+            "application/octet-stream",
+            additional_headers,
+            stream
+        );
+    }
+    else if (post_as_form)
     {
         /* Sends data in multipart/mixed document. One detail is that
 	 * file *name* is also sent to the server.
@@ -707,7 +718,29 @@ attach_file_to_case(const char* base_url,
                 ssl_verify,
                 /*post_as_form:*/ true,
                 (const char **) text_plain_header,
-                file_name
+                file_name,
+                /*stream:*/ NULL
+    );
+    free(url);
+    return result;
+}
+
+rhts_result_t*
+attach_stream_to_case(const char* base_url,
+                const char* username,
+                const char* password,
+                bool ssl_verify,
+                const struct post_stream *stream)
+{
+    char *url = concat_path_file(base_url, "attachments");
+    rhts_result_t *result = post_file_to_url(url,
+                username,
+                password,
+                ssl_verify,
+                /*post_as_form:*/ true,
+                (const char **) text_plain_header,
+                stream->ps_name,
+                stream
     );
     free(url);
     return result;
@@ -740,7 +773,8 @@ get_rhts_hints(const char* base_url,
                 ssl_verify,
                 /*post_as_form:*/ false,
                 /*headers:*/ NULL,
-                file_name
+                file_name,
+                /*stream:*/ NULL
     );
     free(url);
     return result;
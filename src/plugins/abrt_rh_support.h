@@ -85,6 +85,19 @@ attach_file_to_case(const char* baseURL,
                 const char* file_name
 );
 
+struct post_stream;
+
+/* Like attach_file_to_case(), but the attachment is uploaded while it is
+ * being produced by stream, see post_stream_as_form().
+ */
+rhts_result_t*
+attach_stream_to_case(const char* baseURL,
+                const char* username,
+                const char* password,
+                bool ssl_verify,
+                const struct post_stream *stream
+);
+
 #ifdef __cplusplus
 }
 #endif
@@ -19,7 +19,7 @@
 
 #include <curl/curl.h>
 
-#include <libxml/xmlreader.h>
+#include <libxml/parser.h>
 
 #include "internal_libreport.h"
 #include "libreport_curl.h"
@@ -387,49 +387,121 @@ soap_request_print(soap_request_t *req)
 }
 #endif
 
-static bool
-reader_move_reader_if_node_type_is_element_with_name_and_verify_its_value(xmlTextReaderPtr reader, const char *name)
-{
-    /* is not element node */
-    if (xmlTextReaderNodeType(reader) != XML_ELEMENT_NODE)
-        return false;
-
-    /* is not required name */
-    if (xmlStrcmp(xmlTextReaderConstName(reader), BAD_CAST name) != 0)
-        return false;
+/*
+ * SOAP responses
+ *
+ * The response is parsed once and its elements are indexed by name, so
+ * extracting the fields of issues with hundreds of notes doesn't walk the
+ * document over and over again.
+ */
 
-    /* read next node */
-    if (xmlTextReaderRead(reader) != 1)
-        return false;
+struct soap_element
+{
+    const xmlChar *se_value;    ///< text of the element, NULL if it has none
+    int se_depth;               ///< 0 for the root element
+    unsigned se_order;          ///< position in the document
+};
 
-    /* no value node */
-    if (xmlTextReaderHasValue(reader) == 0)
-        return false;
+struct soap_response
+{
+    xmlDocPtr sr_doc;
+    /* element name -> GList of struct soap_element in the document order */
+    GHashTable *sr_elements;
+};
 
-    /* no text node */
-    if (xmlTextReaderNodeType(reader) != XML_TEXT_NODE)
-        return false;
+static const xmlChar *
+soap_node_get_text(xmlNodePtr node)
+{
+    xmlNodePtr child = node->children;
+    if (child == NULL || child->type != XML_TEXT_NODE || child->content == NULL)
+        return NULL;
 
-    return true;
+    return child->content;
 }
 
 static void
-reader_find_element_by_name(xmlTextReaderPtr reader, const char *name)
+soap_response_index_nodes(soap_response_t *resp, xmlNodePtr node, int depth, unsigned *order)
 {
-    while (xmlTextReaderRead(reader) == 1)
+    for (; node != NULL; node = node->next)
     {
-        /* is not element node */
-        if (xmlTextReaderNodeType(reader) != XML_ELEMENT_NODE)
+        if (node->type != XML_ELEMENT_NODE)
             continue;
 
-        /* is not required name */
-        if (xmlStrcmp(xmlTextReaderConstName(reader), BAD_CAST name) != 0)
-            continue;
+        struct soap_element *elem = xmalloc(sizeof(*elem));
+        elem->se_value = soap_node_get_text(node);
+        elem->se_depth = depth;
+        elem->se_order = (*order)++;
 
-        break;
+        /* prepended, the lists are reversed once the whole document is indexed */
+        GList *elems = g_hash_table_lookup(resp->sr_elements, node->name);
+        g_hash_table_insert(resp->sr_elements, (gpointer)node->name, g_list_prepend(elems, elem));
+
+        soap_response_index_nodes(resp, node->children, depth + 1, order);
     }
+}
 
-    return;
+soap_response_t *
+soap_response_parse(const char *xml)
+{
+    xmlDocPtr doc = xmlParseDoc(BAD_CAST xml);
+    if (doc == NULL)
+        return NULL;
+
+    soap_response_t *resp = xmalloc(sizeof(*resp));
+    resp->sr_doc = doc;
+    /* keys are owned by the document, lists are freed by soap_response_free() */
+    resp->sr_elements = g_hash_table_new(g_str_hash, g_str_equal);
+
+    unsigned order = 0;
+    soap_response_index_nodes(resp, xmlDocGetRootElement(doc), 0, &order);
+
+    GHashTableIter iter;
+    gpointer elems;
+    g_hash_table_iter_init(&iter, resp->sr_elements);
+    while (g_hash_table_iter_next(&iter, NULL, &elems))
+        g_hash_table_iter_replace(&iter, g_list_reverse(elems));
+
+    return resp;
+}
+
+void
+soap_response_free(soap_response_t *resp)
+{
+    if (resp == NULL)
+        return;
+
+    GHashTableIter iter;
+    gpointer elems;
+    g_hash_table_iter_init(&iter, resp->sr_elements);
+    while (g_hash_table_iter_next(&iter, NULL, &elems))
+        g_list_free_full(elems, free);
+    g_hash_table_destroy(resp->sr_elements);
+    xmlFreeDoc(resp->sr_doc);
+    free(resp);
+}
+
+static GList *
+soap_response_get_elements(const soap_response_t *resp, const char *name)
+{
+    if (resp == NULL)
+        return NULL;
+
+    return g_hash_table_lookup(resp->sr_elements, name);
+}
+
+/* Returns the first element named 'name' with text which follows the
+ * position 'after' in the document */
+static const struct soap_element *
+soap_response_find_next_value(const soap_response_t *resp, const char *name, unsigned after)
+{
+    for (GList *e = soap_response_get_elements(resp, name); e != NULL; e = g_list_next(e))
+    {
+        const struct soap_element *elem = e->data;
+        if (elem->se_order > after && elem->se_value != NULL)
+            return elem;
+    }
+
+    return NULL;
 }
 
 /* It is not possible to search only by name because the response contains
@@ -449,34 +521,37 @@ reader_find_element_by_name(xmlTextReaderPtr reader, const char *name)
  * ...
  */
 static GList *
-response_values_at_depth_by_name(const char *xml, const char *name, int depth)
+response_values_at_depth_by_name(const soap_response_t *resp, const char *name, int depth)
 {
-    xmlDocPtr doc = xmlParseDoc(BAD_CAST xml);
-    if (doc == NULL)
-        error_msg_and_die(_("SOAP: Failed to parse xml (searching value at depth by name)."));
-
-    xmlTextReaderPtr reader = xmlReaderWalker(doc);
-    if (reader == NULL)
-        error_msg_and_die(_("SOAP: Failed to create xml text reader."));
-
     GList *result = NULL;
 
-    const xmlChar *value;
-    while (xmlTextReaderRead(reader) == 1)
+    for (GList *e = soap_response_get_elements(resp, name); e != NULL; e = g_list_next(e))
     {
+        const struct soap_element *elem = e->data;
+
         /* is not right depth */
-        if (depth != -1 && xmlTextReaderDepth(reader) != depth)
+        if (depth != -1 && elem->se_depth != depth)
             continue;
 
-        if (reader_move_reader_if_node_type_is_element_with_name_and_verify_its_value(reader, name) == false)
-            continue;
+        if (elem->se_value != NULL)
+            result = g_list_prepend(result, xstrdup((const char *) elem->se_value));
+    }
 
-        if ((value = xmlTextReaderConstValue(reader)) != NULL)
-            result = g_list_append(result, xstrdup((const char *) value));
+    return g_list_reverse(result);
+}
+
+/* Returns a text of the first element named 'name', NULL if there is none */
+static char *
+response_first_value_by_name(const soap_response_t *resp, const char *name, int depth)
+{
+    for (GList *e = soap_response_get_elements(resp, name); e != NULL; e = g_list_next(e))
+    {
+        const struct soap_element *elem = e->data;
+        if ((depth == -1 || elem->se_depth == depth) && elem->se_value != NULL)
+            return xstrdup((const char *) elem->se_value);
     }
-    xmlFreeTextReader(reader);
 
-    return result;
+    return NULL;
 }
 
 /*
@@ -492,120 +567,88 @@ response_values_at_depth_by_name(const char *xml, const char *name, int depth)
  *  returns "foo"
  */
 static char *
-response_get_name_value_of_element(const char *xml, const char *element)
+response_get_name_value_of_element(const soap_response_t *resp, const char *element)
 {
-    xmlDocPtr doc = xmlParseDoc(BAD_CAST xml);
-    if (doc == NULL)
-        error_msg_and_die(_("SOAP: Failed to parse xml."));
-
-    xmlTextReaderPtr reader = xmlReaderWalker(doc);
-    if (reader == NULL)
-        error_msg_and_die(_("SOAP: Failed to create xml text reader."));
-
-    const xmlChar *value = NULL;
-
-    reader_find_element_by_name(reader, element);
-
-    /* find 'name' element and return its text */
-    while (xmlTextReaderRead(reader) == 1)
-    {
-        if (reader_move_reader_if_node_type_is_element_with_name_and_verify_its_value(reader, "name") == false)
-            continue;
+    GList *elems = soap_response_get_elements(resp, element);
+    if (elems == NULL)
+        return NULL;
 
-        if ((value = xmlTextReaderConstValue(reader)) != NULL)
-            break;
-    }
-    xmlFreeTextReader(reader);
+    const struct soap_element *elem = elems->data;
+    const struct soap_element *name = soap_response_find_next_value(resp, "name", elem->se_order);
 
-    return (char *) value;
+    return name != NULL ? xstrdup((const char *) name->se_value) : NULL;
 }
 
 static int
-response_get_id_of_relatedto_issue(const char *xml)
+response_get_id_of_relatedto_issue(const soap_response_t *resp)
 {
-    xmlDocPtr doc = xmlParseDoc(BAD_CAST xml);
-    if (doc == NULL)
-        error_msg_and_die(_("SOAP: Failed to parse xml (get related to issue)."));
-
-    xmlTextReaderPtr reader = xmlReaderWalker(doc);
-    if (reader == NULL)
-        error_msg_and_die(_("SOAP: Failed to create xml text reader."));
-
-    const xmlChar *value = NULL;
-    const xmlChar *id = NULL;
-
     /* find relationships section */
-    reader_find_element_by_name(reader, "relationships");
+    GList *relationships = soap_response_get_elements(resp, "relationships");
+    if (relationships == NULL)
+        return -1;
 
-    /* find "name" value of 'name' element */
-    while (xmlTextReaderRead(reader) == 1)
-    {
-        /* find type of relattionship */
-        if (reader_move_reader_if_node_type_is_element_with_name_and_verify_its_value(reader, "name") == false)
-            continue;
+    const unsigned start = ((const struct soap_element *) relationships->data)->se_order;
 
-        if ((value = xmlTextReaderConstValue(reader)) == NULL)
+    /* find type of relationship */
+    for (GList *e = soap_response_get_elements(resp, "name"); e != NULL; e = g_list_next(e))
+    {
+        const struct soap_element *name = e->data;
+        if (name->se_order <= start || name->se_value == NULL)
             continue;
 
-        /* we need 'duplicate of' realtionship type */
-        if (xmlStrcmp(value, BAD_CAST "duplicate of") != 0)
+        /* we need 'duplicate of' relationship type */
+        if (xmlStrcmp(name->se_value, BAD_CAST "duplicate of") != 0)
             continue;
 
         /* find id of duplicate issues */
-        reader_find_element_by_name(reader, "target_id");
-
-        /* verify target_id node */
-        if (reader_move_reader_if_node_type_is_element_with_name_and_verify_its_value(reader, "target_id") == false)
-            continue;
-
-        /* get its value */
-        if ((id = xmlTextReaderConstValue(reader)) != NULL)
-            break;
+        const struct soap_element *id = soap_response_find_next_value(resp, "target_id", name->se_order);
+        if (id != NULL)
+            return atoi((const char *) id->se_value);
     }
-    xmlFreeTextReader(reader);
 
-    return (id == NULL) ? -1 : atoi((const char *) id);
+    return -1;
 }
 
 GList *
-response_get_main_ids_list(const char *xml)
+response_get_main_ids_list(const soap_response_t *resp)
 {
-    return response_values_at_depth_by_name(xml, "id", 5);
+    return response_values_at_depth_by_name(resp, "id", 5);
 }
 
 int
-response_get_main_id(const char *xml)
+response_get_main_id(const soap_response_t *resp)
 {
-    GList *l = response_values_at_depth_by_name(xml, "id", 5);
-    return (l != NULL) ? atoi(l->data) : -1;
+    char *id = response_first_value_by_name(resp, "id", 5);
+    int ret = (id != NULL) ? atoi(id) : -1;
+    free(id);
+    return ret;
 }
 
 static int
-response_get_return_value(const char *xml)
+response_get_return_value(const soap_response_t *resp)
 {
-    GList *l = response_values_at_depth_by_name(xml, "return", 3);
-    return (l != NULL) ? atoi(l->data) : -1;
+    char *value = response_first_value_by_name(resp, "return", 3);
+    int ret = (value != NULL) ? atoi(value) : -1;
+    free(value);
+    return ret;
 }
 
 static char*
-response_get_return_value_as_string(const char *xml)
+response_get_return_value_as_string(const soap_response_t *resp)
 {
-    GList *l = response_values_at_depth_by_name(xml, "return", 3);
-    return (l != NULL) ? l->data : NULL;
+    return response_first_value_by_name(resp, "return", 3);
 }
 
 static char *
-response_get_error_msg(const char *xml)
+response_get_error_msg(const soap_response_t *resp)
 {
-    GList *l = response_values_at_depth_by_name(xml, "faultstring", 3);
-    return (l != NULL) ? xstrdup(l->data) : NULL;
+    return response_first_value_by_name(resp, "faultstring", 3);
 }
 
 static char *
-response_get_additioanl_information(const char *xml)
+response_get_additioanl_information(const soap_response_t *resp)
 {
-    GList *l = response_values_at_depth_by_name(xml, "additional_information", -1);
-    return (l != NULL) ? xstrdup(l->data) : NULL;
+    return response_first_value_by_name(resp, "additional_information", -1);
 }
 
 void
@@ -627,6 +670,7 @@ mantisbt_result_free(mantisbt_result_t *result)
     free(result->mr_url);
     free(result->mr_msg);
     free(result->mr_body);
+    soap_response_free(result->mr_response);
     free(result);
 }
 
@@ -666,6 +710,18 @@ redirect:
 
     char *location = find_header_in_post_state(post_state, "Location:");
 
+    /* The response is parsed only once, all data are taken from the index */
+    soap_response_t *response = NULL;
+    if (post_state->body != NULL
+        && (post_state->http_resp_code == 200
+            || post_state->http_resp_code == 201
+            || post_state->http_resp_code == 500))
+    {
+        response = soap_response_parse(post_state->body);
+        if (response == NULL && post_state->http_resp_code != 500)
+            error_msg_and_die(_("SOAP: Failed to parse xml."));
+    }
+
     switch (post_state->http_resp_code)
     {
     case 404:
@@ -675,7 +731,9 @@ redirect:
         break;
     case 500:
         result->mr_error = -1;
-        result->mr_msg = response_get_error_msg(post_state->body);
+        result->mr_msg = response_get_error_msg(response);
+        if (result->mr_msg == NULL)
+            result->mr_msg = xasprintf(_("Error in MantisBT request at '%s'"), url);
 
         break;
     case 301: /* "301 Moved Permanently" (for example, used to move http:// to https://) */
@@ -707,6 +765,7 @@ redirect:
 
     result->mr_http_resp_code = post_state->http_resp_code;
     result->mr_body = post_state->body;
+    result->mr_response = response;
     post_state->body = NULL;
 
     free_post_state(post_state);
@@ -743,7 +802,7 @@ mantisbt_attach_data(const mantisbt_settings_t *settings, const char *bug_id,
         return ret;
     }
 
-    int id = response_get_return_value(result->mr_body);
+    int id = response_get_return_value(result->mr_response);
 
     mantisbt_result_free(result);
 
@@ -861,7 +920,8 @@ mantisbt_search_by_abrt_hash(mantisbt_settings_t *settings, const char *abrt_has
         return NULL;
     }
 
-    GList *ids = response_get_main_ids_list(result->mr_body);
+    GList *ids = response_get_main_ids_list(result->mr_response);
+    mantisbt_result_free(result);
 
     return ids;
 }
@@ -905,7 +965,8 @@ mantisbt_search_duplicate_issues(mantisbt_settings_t *settings, const char *cate
         return NULL;
     }
 
-    GList *ids = response_get_main_ids_list(result->mr_body);
+    GList *ids = response_get_main_ids_list(result->mr_response);
+    mantisbt_result_free(result);
 
     return ids;
 }
@@ -953,8 +1014,8 @@ mantisbt_get_custom_fields(const mantisbt_settings_t *settings, mantisbt_custom_
     if (result->mr_http_resp_code != 200)
         error_msg_and_die(_("Failed to get custom fields for '%s' project"), settings->m_project);
 
-    GList *ids = response_values_at_depth_by_name(result->mr_body, "id", -1);
-    GList *names = response_values_at_depth_by_name(result->mr_body, "name", -1);
+    GList *ids = response_values_at_depth_by_name(result->mr_response, "id", -1);
+    GList *names = response_values_at_depth_by_name(result->mr_response, "name", -1);
 
     mantisbt_result_free(result);
 
@@ -1000,7 +1061,7 @@ mantisbt_create_new_issue(const mantisbt_settings_t *settings,
         return -1;
     }
 
-    int id = response_get_return_value(result->mr_body);
+    int id = response_get_return_value(result->mr_response);
 
     mantisbt_result_free(result);
     return id;
@@ -1029,15 +1090,15 @@ mantisbt_get_issue_info(const mantisbt_settings_t *settings, int issue_id)
     mantisbt_issue_info_t *issue_info = mantisbt_issue_info_new();
 
     issue_info->mii_id = issue_id;
-    issue_info->mii_status = response_get_name_value_of_element(result->mr_body, "status");
-    issue_info->mii_resolution = response_get_name_value_of_element(result->mr_body, "resolution");
-    issue_info->mii_reporter = response_get_name_value_of_element(result->mr_body, "reporter");
-    issue_info->mii_project = response_get_name_value_of_element(result->mr_body, "project");
+    issue_info->mii_status = response_get_name_value_of_element(result->mr_response, "status");
+    issue_info->mii_resolution = response_get_name_value_of_element(result->mr_response, "resolution");
+    issue_info->mii_reporter = response_get_name_value_of_element(result->mr_response, "reporter");
+    issue_info->mii_project = response_get_name_value_of_element(result->mr_response, "project");
 
     if (strcmp(issue_info->mii_status, "closed") == 0 && !issue_info->mii_resolution)
         error_msg(_("Issue %i is CLOSED, but it has no RESOLUTION"), issue_info->mii_id);
 
-    issue_info->mii_dup_id = response_get_id_of_relatedto_issue(result->mr_body);
+    issue_info->mii_dup_id = response_get_id_of_relatedto_issue(result->mr_response);
 
     if (strcmp(issue_info->mii_status, "closed") == 0
         && strcmp(issue_info->mii_resolution, "duplicate") == 0
@@ -1048,13 +1109,13 @@ mantisbt_get_issue_info(const mantisbt_settings_t *settings, int issue_id)
     }
 
     /* notes are stored in <text> element */
-    issue_info->mii_notes = response_values_at_depth_by_name(result->mr_body, "text", -1);
+    issue_info->mii_notes = response_values_at_depth_by_name(result->mr_response, "text", -1);
 
     /* looking for bt rating in additional information too */
-    char *add_info = response_get_additioanl_information(result->mr_body);
+    char *add_info = response_get_additioanl_information(result->mr_response);
     if (add_info != NULL)
         issue_info->mii_notes = g_list_append (issue_info->mii_notes, add_info);
-    issue_info->mii_attachments = response_values_at_depth_by_name(result->mr_body, "filename", -1);
+    issue_info->mii_attachments = response_values_at_depth_by_name(result->mr_response, "filename", -1);
     issue_info->mii_best_bt_rating = comments_find_best_bt_rating(issue_info->mii_notes);
 
     mantisbt_result_free(result);
@@ -1084,7 +1145,7 @@ mantisbt_add_issue_note(const mantisbt_settings_t *settings, int issue_id, const
         mantisbt_result_free(result);
         return -1;
     }
-    int id = response_get_return_value(result->mr_body);
+    int id = response_get_return_value(result->mr_response);
 
     mantisbt_result_free(result);
     return id;
@@ -1105,7 +1166,7 @@ mantisbt_get_project_id_from_name(mantisbt_settings_t *settings)
     if (result->mr_http_resp_code != 200)
         error_msg_and_die(_("Failed to get project id from name"));
 
-    settings->m_project_id = response_get_return_value_as_string(result->mr_body);
+    settings->m_project_id = response_get_return_value_as_string(result->mr_response);
 
     return;
 }
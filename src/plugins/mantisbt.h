@@ -62,8 +62,12 @@ typedef struct mantisbt_settings
     const char *m_DontMatchComponents;
     int         m_ssl_verify;
     int         m_create_private;
+    unsigned    m_dup_search_cache_ttl;
 } mantisbt_settings_t;
 
+/* Parsed SOAP response, elements are indexed by name */
+typedef struct soap_response soap_response_t;
+
 typedef struct mantisbt_result
 {
     int mr_http_resp_code;
@@ -71,6 +75,7 @@ typedef struct mantisbt_result
     char *mr_msg;
     char *mr_url;
     char *mr_body;
+    soap_response_t *mr_response;   ///< NULL if the body isn't valid XML
 } mantisbt_result_t;
 
 typedef struct mantisbt_issue_info
@@ -107,8 +112,12 @@ char *soap_request_to_str(const soap_request_t *req);
 void soap_request_print(soap_request_t *req);
 #endif
 
-GList * response_get_main_ids_list(const char *xml);
-int response_get_main_id(const char *xml);
+/* Returns NULL if xml can't be parsed */
+soap_response_t *soap_response_parse(const char *xml);
+void soap_response_free(soap_response_t *resp);
+
+GList * response_get_main_ids_list(const soap_response_t *resp);
+int response_get_main_id(const soap_response_t *resp);
 void response_values_free(GList *values);
 
 void mantisbt_result_free(mantisbt_result_t *result);
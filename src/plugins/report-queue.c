@@ -0,0 +1,156 @@
+/*
+    Copyright (C) 2026  ABRT team
+    Copyright (C) 2026  RedHat Inc
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include "internal_libreport.h"
+#include "report_queue.h"
+
+static const char *state_name(enum report_queue_entry_state state)
+{
+    switch (state)
+    {
+        case REPORT_QUEUE_PENDING: return "pending";
+        case REPORT_QUEUE_DONE:    return "done";
+        case REPORT_QUEUE_GAVE_UP: return "gave-up";
+    }
+    return "?";
+}
+
+static void list_queue(report_queue_t *queue)
+{
+    for (GList *iter = report_queue_get_entries(queue); iter; iter = g_list_next(iter))
+    {
+        const struct report_queue_entry *entry = iter->data;
+        printf("%s %s %s %u", state_name(entry->rqe_state), entry->rqe_event,
+               entry->rqe_dump_dir, entry->rqe_attempts);
+        if (entry->rqe_state == REPORT_QUEUE_PENDING && entry->rqe_next_attempt != 0)
+            printf(" %s", iso_date_string(&entry->rqe_next_attempt));
+        putchar('\n');
+    }
+}
+
+int main(int argc, char **argv)
+{
+    abrt_init(argv);
+
+    /* I18n */
+    setlocale(LC_ALL, "");
+#if ENABLE_NLS
+    bindtextdomain(PACKAGE, LOCALEDIR);
+    textdomain(PACKAGE);
+#endif
+
+    const char *dump_dir_name = ".";
+    const char *event = NULL;
+    const char *queue_path = NULL;
+    struct report_queue_drain_options drain_options;
+    report_queue_drain_options_init(&drain_options);
+    int concurrency = drain_options.rqd_concurrency;
+    int max_attempts = drain_options.rqd_max_attempts;
+    int base_delay = drain_options.rqd_base_delay;
+
+    /* Can't keep these strings/structs static: _() doesn't support that */
+    const char *program_usage_string = _(
+        "& [-v] [-q FILE] -a -e EVENT [-d DIR]\n"
+        "& [-v] [-q FILE] -r [-w] [-j NUM] [-m NUM] [-b SECONDS]\n"
+        "& [-v] [-q FILE] -l\n"
+        "\n"
+        "Queues reporting events which failed because the reporting target\n"
+        "was unreachable and runs them again later"
+    );
+    enum {
+        OPT_v = 1 << 0,
+        OPT_d = 1 << 1,
+        OPT_q = 1 << 2,
+        OPT_a = 1 << 3,
+        OPT_e = 1 << 4,
+        OPT_r = 1 << 5,
+        OPT_w = 1 << 6,
+        OPT_j = 1 << 7,
+        OPT_m = 1 << 8,
+        OPT_b = 1 << 9,
+        OPT_l = 1 << 10,
+    };
+    /* Keep enum above and order of options below in sync! */
+    struct options program_options[] = {
+        OPT__VERBOSE(&g_verbose),
+        OPT__DUMP_DIR(&dump_dir_name),
+        OPT_STRING('q', NULL, &queue_path, "FILE", _("Queue file (default: "REPORT_QUEUE_PATH")")),
+        OPT_BOOL(  'a', NULL, NULL,                _("Add DIR to the queue")),
+        OPT_STRING('e', NULL, &event, "EVENT",     _("Event to run on DIR")),
+        OPT_BOOL(  'r', NULL, NULL,                _("Run the queued events whose time has come")),
+        OPT_BOOL(  'w', NULL, NULL,                _("Wait for and run the delayed events until the queue is empty")),
+        OPT_INTEGER('j', NULL, &concurrency,       _("Number of events run at once")),
+        OPT_INTEGER('m', NULL, &max_attempts,      _("Give up after NUM failures, 0 never")),
+        OPT_INTEGER('b', NULL, &base_delay,        _("Delay after the first failure, doubled after every next one")),
+        OPT_BOOL(  'l', NULL, NULL,                _("List the queue")),
+        OPT_END()
+    };
+    unsigned opts = parse_opts(argc, argv, program_options, program_usage_string);
+
+    if (!!(opts & OPT_a) + !!(opts & OPT_r) + !!(opts & OPT_l) != 1
+        || ((opts & OPT_a) && !event))
+        show_usage_and_die(program_usage_string, program_options);
+
+    if (concurrency <= 0 || max_attempts < 0 || base_delay < 0)
+        error_msg_and_die(_("-j, -m and -b must not be negative and -j must not be 0"));
+
+    report_queue_t *queue = report_queue_open(queue_path);
+    if (!queue)
+        xfunc_die();
+
+    int ret = 0;
+    if (opts & OPT_a)
+    {
+        int r = report_queue_add(queue, dump_dir_name, event);
+        if (r < 0)
+            error_msg(_("Can't add '%s' to the report queue"), dump_dir_name);
+        ret = r < 0;
+    }
+    else if (opts & OPT_l)
+        list_queue(queue);
+    else
+    {
+        drain_options.rqd_concurrency = concurrency;
+        drain_options.rqd_max_attempts = max_attempts;
+        drain_options.rqd_base_delay = base_delay;
+
+        for (;;)
+        {
+            time_t next_attempt;
+            int pending = report_queue_drain(queue, &drain_options, /*run event*/NULL, NULL, &next_attempt);
+            if (pending < 0)
+            {
+                /* Not an error, somebody else does the job */
+                ret = pending != -EAGAIN;
+                break;
+            }
+
+            log_info("%d reports are pending", pending);
+            if (pending == 0 || !(opts & OPT_w))
+                break;
+
+            const time_t now = time(NULL);
+            if (next_attempt > now)
+                sleep(next_attempt - now);
+        }
+    }
+
+    report_queue_close(queue);
+
+    return ret;
+}
@@ -20,6 +20,7 @@
 #include "problem_report.h"
 #include "client.h"
 #include "abrt_xmlrpc.h"
+#include "dup_search_cache.h"
 #include "rhbz.h"
 
 /* BZ attachments */
@@ -27,32 +28,32 @@
 #define DEFAULT_BUGZILLA_PRODUCT "Fedora"
 
 static
-int attach_text_item(struct abrt_xmlrpc *ax, const char *bug_id,
+void attach_text_item(struct abrt_xmlrpc_multicall *mc, const char *bug_id,
                 const char *item_name, struct problem_item *item)
 {
     if (!(item->flags & CD_FLAG_TXT))
-        return 0;
+        return;
     log_debug("attaching '%s' as text", item_name);
-    int r = rhbz_attach_blob(ax, bug_id,
+    rhbz_batch_attach_blob(mc, bug_id,
                 item_name, item->content, strlen(item->content),
                 RHBZ_NOMAIL_NOTIFY
     );
-    return (r == 0);
 }
 
+/* Opens the file of a binary item for rhbz_attach_fds() */
 static
-int attach_file_item(struct abrt_xmlrpc *ax, const char *bug_id,
-                const char *item_name, struct problem_item *item)
+bool open_file_item(const char *item_name, struct problem_item *item,
+                struct rhbz_attachment *attachment)
 {
     if (!(item->flags & CD_FLAG_BIN))
-        return 0;
+        return false;
 
     char *filename = item->content;
     int fd = open(filename, O_RDONLY);
     if (fd < 0)
     {
         perror_msg("Can't open '%s'", filename);
-        return 0;
+        return false;
     }
     errno = 0;
     struct stat st;
@@ -60,15 +61,60 @@ int attach_file_item(struct abrt_xmlrpc *ax, const char *bug_id,
     {
         perror_msg("'%s': not a regular file", filename);
         close(fd);
-        return 0;
+        return false;
     }
     log_debug("attaching '%s' as file", item_name);
     int flag = RHBZ_NOMAIL_NOTIFY;
     if (!(item->flags & CD_FLAG_BIGTXT))
         flag |= RHBZ_BINARY_ATTACHMENT;
-    int r = rhbz_attach_fd(ax, bug_id, item_name, fd, flag);
-    close(fd);
-    return (r == 0);
+
+    attachment->ra_name = item_name;
+    attachment->ra_fd = fd;
+    attachment->ra_flags = flag;
+    return true;
+}
+
+static
+void close_attachments(struct rhbz_attachment *attachments, unsigned count)
+{
+    for (unsigned i = 0; i < count; ++i)
+        close(attachments[i].ra_fd);
+    free(attachments);
+}
+
+/* Returns id of the first bug found by rhbz_search_duphash() or -1,
+ * the results are cached in cache (if not NULL) */
+static
+int search_duphash(struct abrt_xmlrpc *client, dup_search_cache_t *cache, unsigned rhbz_ver,
+                const char *product, const char *version, const char *component,
+                const char *duphash)
+{
+    int bug_id = -1;
+
+    GList *ids = NULL;
+    if (dup_search_cache_lookup(cache, product, version, component, duphash, &ids))
+    {
+        if (ids != NULL)
+            bug_id = xatoi_positive(ids->data);
+        log_debug("Cached search for duphash '%s' found bug %i", duphash, bug_id);
+        list_free_with_free(ids);
+        return bug_id;
+    }
+
+    xmlrpc_value *bugs = rhbz_search_duphash(client, product, version, component, duphash);
+    unsigned bugs_count = rhbz_array_size(bugs);
+    log_debug("Bugzilla has %i reports with duphash '%s'%s",
+            bugs_count, duphash, version ? "" : " including cross-version ones");
+    if (bugs_count > 0)
+        bug_id = rhbz_get_bug_id_from_array0(bugs, rhbz_ver);
+    xmlrpc_DECREF(bugs);
+
+    if (bug_id >= 0)
+        ids = g_list_append(ids, xasprintf("%i", bug_id));
+    dup_search_cache_store(cache, product, version, component, duphash, ids);
+    list_free_with_free(ids);
+
+    return bug_id;
 }
 
 /* Main */
@@ -84,6 +130,7 @@ struct bugzilla_struct {
     int         b_ssl_verify;
     int         b_create_private;
     GList       *b_private_groups;
+    unsigned    b_dup_search_cache_ttl;
 };
 
 static void set_default_settings(map_string_t *osinfo, map_string_t *settings)
@@ -161,6 +208,12 @@ static void set_settings(struct bugzilla_struct *b, map_string_t *settings)
     environ = getenv("Bugzilla_DontMatchComponents");
     b->b_DontMatchComponents = environ ? environ : get_map_string_item_or_empty(settings, "DontMatchComponents");
 
+    environ = getenv("Bugzilla_DuplicateSearchCacheTTL");
+    if (!environ)
+        environ = get_map_string_item_or_NULL(settings, "DuplicateSearchCacheTTL");
+    if (environ && environ[0])
+        b->b_dup_search_cache_ttl = xatou(environ);
+
     b->b_create_private = get_global_create_private_ticket();
 
     if (!b->b_create_private)
@@ -380,6 +433,8 @@ int main(int argc, char **argv)
     client = abrt_xmlrpc_new_client(rhbz.b_bugzilla_xmlrpc, rhbz.b_ssl_verify);
     unsigned rhbz_ver = rhbz_version(client);
 
+    dup_search_cache_t *dup_cache = dup_search_cache_open(rhbz.b_bugzilla_url, rhbz.b_dup_search_cache_ttl);
+
     if (abrt_hash)
     {
         log(_("Looking for similar problems in bugzilla"));
@@ -429,19 +484,16 @@ int main(int argc, char **argv)
         }
 
         log_debug("Using Bugzilla product '%s' to find duplicate bug", product);
-        xmlrpc_value *all_bugs = rhbz_search_duphash(client,
+        int bug_id = search_duphash(client, dup_cache, rhbz_ver,
                                 /*product:*/ product,
                                 /*version:*/ NULL,
                                 /*component:*/ NULL,
                                 hash);
         free(hash);
-        unsigned all_bugs_size = rhbz_array_size(all_bugs);
-        if (all_bugs_size > 0)
-        {
-            int bug_id = rhbz_get_bug_id_from_array0(all_bugs, rhbz_ver);
+        if (bug_id >= 0)
             printf("%i\n", bug_id);
-        }
 
+        dup_search_cache_close(dup_cache);
         return EXIT_SUCCESS;
     }
 
@@ -497,6 +549,8 @@ int main(int argc, char **argv)
             rhbz_mail_to_cc(client, xatoi_positive(ticket_no), rhbz.b_login, /* require mail notify */ 0);
         else
         {   /* Attach files to existing BZ */
+            struct rhbz_attachment *attachments = xzalloc(argc * sizeof(attachments[0]));
+            unsigned count = 0;
             while (*argv)
             {
                 const char *filename = *argv++;
@@ -517,9 +571,14 @@ int main(int argc, char **argv)
                     continue;
                 }
 
-                rhbz_attach_fd(client, ticket_no, filename, fd, /*flags*/ 0);
-                close(fd);
+                attachments[count].ra_name = filename;
+                attachments[count].ra_fd = fd;
+                attachments[count].ra_flags = 0;
+                ++count;
             }
+
+            rhbz_attach_fds(client, ticket_no, attachments, count, 0);
+            close_attachments(attachments, count);
         }
 
         log(_("Logging out"));
@@ -645,16 +704,10 @@ int main(int argc, char **argv)
              * but we do add a note if cross-version potential dup exists.
              * For that, we search for cross version dups first:
              */
-            xmlrpc_value *crossver_bugs = rhbz_search_duphash(client, rhbz.b_product, /*version:*/ NULL,
+            crossver_id = search_duphash(client, dup_cache, rhbz_ver, rhbz.b_product, /*version:*/ NULL,
                             component_substitute, duphash);
-            unsigned crossver_bugs_count = rhbz_array_size(crossver_bugs);
-            log_debug("Bugzilla has %i reports with duphash '%s' including cross-version ones",
-                    crossver_bugs_count, duphash);
-            if (crossver_bugs_count > 0)
-                crossver_id = rhbz_get_bug_id_from_array0(crossver_bugs, rhbz_ver);
-            xmlrpc_DECREF(crossver_bugs);
-
-            if (crossver_bugs_count > 0)
+
+            if (crossver_id >= 0)
             {
                 /* In dup detection we require match in product *and version*.
                  * Otherwise we sometimes have bugs in e.g. Fedora 17
@@ -663,14 +716,8 @@ int main(int argc, char **argv)
                  * match will make all newly detected crashes DUPed
                  * to a bug in a dead release.
                  */
-                xmlrpc_value *dup_bugs = rhbz_search_duphash(client, rhbz.b_product,
+                existing_id = search_duphash(client, dup_cache, rhbz_ver, rhbz.b_product,
                                 rhbz.b_product_version, component_substitute, duphash);
-                unsigned dup_bugs_count = rhbz_array_size(dup_bugs);
-                log_debug("Bugzilla has %i reports with duphash '%s'",
-                        dup_bugs_count, duphash);
-                if (dup_bugs_count > 0)
-                    existing_id = rhbz_get_bug_id_from_array0(dup_bugs, rhbz_ver);
-                xmlrpc_DECREF(dup_bugs);
             }
         }
 
@@ -745,6 +792,12 @@ int main(int argc, char **argv)
                 error_msg_and_die(_("Failed to create a new bug."));
             }
 
+            /* The searches for the duphash would not find the new bug */
+            dup_search_cache_invalidate(dup_cache, duphash);
+
+            /* Updates of the new bug go in one request */
+            struct abrt_xmlrpc_multicall *updates = abrt_xmlrpc_multicall_new(client);
+
             struct dump_dir *dd = dd_opendir(dump_dir_name, /*flags:*/ 0);
             if (dd)
             {
@@ -759,7 +812,7 @@ int main(int argc, char **argv)
                     char *email = strtok(extra, "\n");
                     while (email != NULL) {
                         log(_("Adding extra cc %s to bug report"), email);
-                        rhbz_mail_to_cc(client, new_id, email, /* require mail notify */ 0);
+                        rhbz_batch_mail_to_cc(updates, new_id, email, /* require mail notify */ 0);
                         email = strtok(NULL, "\n");
                     }
                     free(extra);
@@ -768,7 +821,7 @@ int main(int argc, char **argv)
                 if (reported_to && reported_to->url)
                 {
                     log(_("Adding External URL to bug %i"), new_id);
-                    rhbz_set_url(client, new_id, reported_to->url, RHBZ_NOMAIL_NOTIFY);
+                    rhbz_batch_set_url(updates, new_id, reported_to->url, RHBZ_NOMAIL_NOTIFY);
                     free_report_result(reported_to);
                 }
             }
@@ -777,18 +830,26 @@ int main(int argc, char **argv)
             char new_id_str[sizeof(int)*3 + 2];
             sprintf(new_id_str, "%i", new_id);
 
-            for (GList *a = problem_report_get_attachments(pr); a != NULL; a = g_list_next(a))
+            /* Text items are in memory already, files are uploaded concurrently */
+            GList *attachment_names = problem_report_get_attachments(pr);
+            struct rhbz_attachment *attachments = xzalloc(g_list_length(attachment_names) * sizeof(attachments[0]));
+            unsigned count = 0;
+            for (GList *a = attachment_names; a != NULL; a = g_list_next(a))
             {
                 const char *item_name = (const char *)a->data;
                 struct problem_item *item = problem_data_get_item_or_NULL(problem_data, item_name);
                 if (!item)
                     continue;
                 else if (item->flags & CD_FLAG_TXT)
-                    attach_text_item(client, new_id_str, item_name, item);
+                    attach_text_item(updates, new_id_str, item_name, item);
                 else if (item->flags & CD_FLAG_BIN)
-                    attach_file_item(client, new_id_str, item_name, item);
+                    count += open_file_item(item_name, item, &attachments[count]);
             }
 
+            rhbz_batch_perform(updates);
+            rhbz_attach_fds(client, new_id_str, attachments, count, 0);
+            close_attachments(attachments, count);
+
             bz = new_bug_info();
             bz->bi_status = xstrdup("NEW");
             bz->bi_id = new_id;
@@ -846,12 +907,15 @@ int main(int argc, char **argv)
      * bug's status.
      */
 
+    /* CC, comment and backtrace go in one request */
+    struct abrt_xmlrpc_multicall *updates = abrt_xmlrpc_multicall_new(client);
+
     /* Add user's login to CC if not there already */
     if (strcmp(bz->bi_reporter, rhbz.b_login) != 0
      && !g_list_find_custom(bz->bi_cc_list, rhbz.b_login, (GCompareFunc)g_strcmp0)
     ) {
         log(_("Adding %s to CC list"), rhbz.b_login);
-        rhbz_mail_to_cc(client, bz->bi_id, rhbz.b_login, RHBZ_NOMAIL_NOTIFY);
+        rhbz_batch_mail_to_cc(updates, bz->bi_id, rhbz.b_login, RHBZ_NOMAIL_NOTIFY);
     }
 
     /* Add comment and bt */
@@ -872,7 +936,7 @@ int main(int argc, char **argv)
         if (!dup_comment)
         {
             log(_("Adding new comment to bug %d"), bz->bi_id);
-            rhbz_add_comment(client, bz->bi_id, bzcomment, 0);
+            rhbz_batch_add_comment(updates, bz->bi_id, bzcomment, 0);
 
             const char *bt = problem_data_get_content_or_NULL(problem_data, FILENAME_BACKTRACE);
             unsigned rating = 0;
@@ -885,8 +949,8 @@ int main(int argc, char **argv)
                 char bug_id_str[sizeof(int)*3 + 2];
                 sprintf(bug_id_str, "%i", bz->bi_id);
                 log(_("Attaching better backtrace"));
-                rhbz_attach_blob(client, bug_id_str, FILENAME_BACKTRACE, bt, strlen(bt),
-                                 RHBZ_NOMAIL_NOTIFY);
+                rhbz_batch_attach_blob(updates, bug_id_str, FILENAME_BACKTRACE, bt, strlen(bt),
+                                       RHBZ_NOMAIL_NOTIFY);
             }
         }
         else
@@ -896,6 +960,8 @@ int main(int argc, char **argv)
         problem_formatter_free(pf);
     }
 
+    rhbz_batch_perform(updates);
+
  log_out:
     log(_("Logging out"));
     rhbz_logout(client);
@@ -907,6 +973,8 @@ int main(int argc, char **argv)
                 rhbz.b_bugzilla_url,
                 bz->bi_id);
 
+    dup_search_cache_close(dup_cache);
+
     struct dump_dir *dd = dd_opendir(dump_dir_name, /*flags:*/ 0);
     if (dd)
     {
@@ -85,6 +85,35 @@ static CURLcode http_post_to_kerneloops_site(const char *url, const char *oopsda
     return ret;
 }
 
+/* Sends the form url-encoded instead, so that post() can compress it */
+/* Returns 0 on success */
+static CURLcode http_post_compressed_to_kerneloops_site(const char *url, const char *oopsdata,
+                int content_encoding)
+{
+    CURL *handle = xcurl_easy_init();
+    char *escaped = curl_easy_escape(handle, oopsdata, 0);
+    curl_easy_cleanup(handle);
+    if (!escaped)
+        error_msg_and_die("out of memory");
+
+    char *form = xasprintf("oopsdata=%s&pass_on_allowed=yes", escaped);
+    curl_free(escaped);
+
+    static const char *headers[] = { "Accept: */*", "Expect:", NULL };
+    post_state_t *state = new_post_state(POST_WANT_ERROR_MSG | POST_WANT_SSL_VERIFY);
+    state->content_encoding = content_encoding;
+    post_string(state, url, "application/x-www-form-urlencoded", headers, form);
+    free(form);
+
+    CURLcode ret = state->curl_result;
+    /* Same as CURLOPT_FAILONERROR */
+    if (ret == CURLE_OK && state->http_resp_code >= 400)
+        ret = CURLE_HTTP_RETURNED_ERROR;
+
+    free_post_state(state);
+    return ret;
+}
+
 static void report_to_kerneloops(
                 const char *dump_dir_name,
                 map_string_t *settings)
@@ -102,9 +131,20 @@ static void report_to_kerneloops(
     if (!submitURL[0])
         submitURL = "http://oops.kernel.org/submitoops.php";
 
+    env = getenv("KerneloopsReporter_CompressRequests");
+    const char *compress = (env ? env : get_map_string_item_or_empty(settings, "CompressRequests"));
+    int content_encoding = post_content_encoding_from_string(compress);
+    if (content_encoding < 0)
+    {
+        log_warning("Ignoring unknown CompressRequests value '%s'", compress);
+        content_encoding = POST_CONTENT_ENCODING_IDENTITY;
+    }
+
     log(_("Submitting oops report to %s"), submitURL);
 
-    CURLcode ret = http_post_to_kerneloops_site(submitURL, backtrace);
+    CURLcode ret = content_encoding != POST_CONTENT_ENCODING_IDENTITY
+            ? http_post_compressed_to_kerneloops_site(submitURL, backtrace, content_encoding)
+            : http_post_to_kerneloops_site(submitURL, backtrace);
     if (ret != CURLE_OK)
         error_msg_and_die("Kernel oops has not been sent due to %s", curl_easy_strerror(ret));
 
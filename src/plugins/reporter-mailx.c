@@ -153,10 +153,12 @@ static void create_and_send_email(
     {
         printf("subject: %s\n"
                   "\n"
-                  "%s"
-                  "\n"
-                  , subject
-                  , dsc);
+                  , subject);
+        fflush(stdout);
+        /* The description can be huge, don't let stdio copy it */
+        if (problem_report_write_section(pr, PR_SEC_DESCRIPTION, STDOUT_FILENO) != 0)
+            perror_msg_and_die("Can't write the description");
+        putchar('\n');
 
         puts("attachments:");
         for (GList *a = problem_report_get_attachments(pr); a != NULL; a = g_list_next(a))
@@ -19,6 +19,7 @@
 
 #include "internal_libreport.h"
 #include "client.h"
+#include "dup_search_cache.h"
 #include "mantisbt.h"
 #include "problem_report.h"
 
@@ -104,7 +105,7 @@ verify_credentials(mantisbt_settings_t *settings)
 
         if (g_verbose > 2)
         {
-            GList *ids = response_get_main_ids_list(result->mr_body);
+            GList *ids = response_get_main_ids_list(result->mr_response);
             if (ids != NULL)
                 log("%s", (char *)ids->data);
             response_values_free(ids);
@@ -186,6 +187,12 @@ set_settings(mantisbt_settings_t *m, map_string_t *settings, struct dump_dir *dd
     environ = getenv("Mantisbt_DontMatchComponents");
     m->m_DontMatchComponents = environ ? environ : get_map_string_item_or_empty(settings, "DontMatchComponents");
 
+    environ = getenv("Mantisbt_DuplicateSearchCacheTTL");
+    if (!environ)
+        environ = get_map_string_item_or_NULL(settings, "DuplicateSearchCacheTTL");
+    if (environ && environ[0])
+        m->m_dup_search_cache_ttl = xatou(environ);
+
     m->m_create_private = get_global_create_private_ticket();
 
     if (!m->m_create_private)
@@ -196,6 +203,24 @@ set_settings(mantisbt_settings_t *m, map_string_t *settings, struct dump_dir *dd
     log_notice("create private MantisBT ticket: '%s'", m->m_create_private ? "YES": "NO");
 }
 
+/* Wrapper of mantisbt_search_duplicate_issues() remembering the results in
+ * cache (if not NULL) */
+static GList *
+search_duplicate_issues(mantisbt_settings_t *settings, dup_search_cache_t *cache,
+                const char *category, const char *version, const char *duphash)
+{
+    GList *ids = NULL;
+    if (dup_search_cache_lookup(cache, settings->m_project, version, category, duphash, &ids))
+    {
+        log_debug("Using cached search for duphash '%s'", duphash);
+        return ids;
+    }
+
+    ids = mantisbt_search_duplicate_issues(settings, category, version, duphash);
+    dup_search_cache_store(cache, settings->m_project, version, category, duphash, ids);
+    return ids;
+}
+
 int main(int argc, char **argv)
 {
     abrt_init(argv);
@@ -335,10 +360,20 @@ int main(int argc, char **argv)
      */
     verify_credentials(&mbt_settings);
 
+    dup_search_cache_t *dup_cache = dup_search_cache_open(mbt_settings.m_mantisbt_url,
+                                                          mbt_settings.m_dup_search_cache_ttl);
+
     if (abrt_hash)
     {
         log(_("Looking for similar problems in MantisBT"));
-        GList *ids = mantisbt_search_by_abrt_hash(&mbt_settings, abrt_hash);
+        /* The search is not restricted to a project */
+        GList *ids = NULL;
+        if (!dup_search_cache_lookup(dup_cache, NULL, NULL, NULL, abrt_hash, &ids))
+        {
+            ids = mantisbt_search_by_abrt_hash(&mbt_settings, abrt_hash);
+            dup_search_cache_store(dup_cache, NULL, NULL, NULL, abrt_hash, ids);
+        }
+        dup_search_cache_close(dup_cache);
         mantisbt_settings_free(&mbt_settings);
 
         if (ids == NULL)
@@ -498,24 +533,26 @@ int main(int argc, char **argv)
              * For that, we search for cross version dups first:
              */
             // SOAP API searching method is not in the final version, it's possible the project will be string
-            GList *crossver_bugs_ids = mantisbt_search_duplicate_issues(&mbt_settings, category_substitute, /*version*/ NULL, duphash);
+            GList *crossver_bugs_ids = search_duplicate_issues(&mbt_settings, dup_cache, category_substitute, /*version*/ NULL, duphash);
 
             unsigned crossver_bugs_count = g_list_length(crossver_bugs_ids);
             log_debug("MantisBT has %i reports with duphash '%s' including cross-version ones",
                     crossver_bugs_count, duphash);
             if (crossver_bugs_count > 0)
                 crossver_id = atoi(g_list_first(crossver_bugs_ids)->data);
+            response_values_free(crossver_bugs_ids);
 
             if (crossver_bugs_count > 0)
             {
                 // SOAP API searching method is not in the final version, it's possible the project will be string
-                GList *dup_bugs_ids = mantisbt_search_duplicate_issues(&mbt_settings, category_substitute, mbt_settings.m_project_version, duphash);
+                GList *dup_bugs_ids = search_duplicate_issues(&mbt_settings, dup_cache, category_substitute, mbt_settings.m_project_version, duphash);
 
                 unsigned dup_bugs_count =  g_list_length(dup_bugs_ids);
                 log_debug("MantisBT has %i reports with duphash '%s'",
                         dup_bugs_count, duphash);
                 if (dup_bugs_count > 0)
                     existing_id = atoi(g_list_first(dup_bugs_ids)->data);
+                response_values_free(dup_bugs_ids);
             }
         }
 
@@ -563,6 +600,9 @@ int main(int argc, char **argv)
             if (new_id == -1)
                 return EXIT_FAILURE;
 
+            /* The searches for the duphash would not find the new issue */
+            dup_search_cache_invalidate(dup_cache, duphash);
+
             log(_("Adding attachments to issue %i"), new_id);
             char *new_id_str = xasprintf("%u", new_id);
 
@@ -672,6 +712,8 @@ int main(int argc, char **argv)
     }
 
 finish:
+    dup_search_cache_close(dup_cache);
+
     log(_("Status: %s%s%s %s/view.php?id=%u"),
                 ii->mii_status,
                 ii->mii_resolution ? " " : "",
@@ -72,8 +72,9 @@ static report_result_t *get_reported_to(const char *dump_dir_name)
     return reported_to;
 }
 
+/* Writes the gzipped tarball to fd, does not close fd */
 static
-int create_tarball(const char *tempfile, struct dump_dir *dd,
+int write_tarball(int fd, const char *tarball_name, struct dump_dir *dd,
      problem_data_t *problem_data)
 {
     reportfile_t *file = NULL;
@@ -86,15 +87,16 @@ int create_tarball(const char *tempfile, struct dump_dir *dd,
     {
         /* child */
         close(pipe_from_parent_to_child[1]);
-        xmove_fd(xopen3(tempfile, O_WRONLY | O_CREAT | O_EXCL, 0600), 1);
         xmove_fd(pipe_from_parent_to_child[0], 0);
+        if (fd != 1)
+            xmove_fd(fd, 1);
         execlp("gzip", "gzip", NULL);
         perror_msg_and_die("Can't execute '%s'", "gzip");
     }
     close(pipe_from_parent_to_child[0]);
 
     TAR *tar = NULL;
-    if (tar_fdopen(&tar, pipe_from_parent_to_child[1], (char*)tempfile,
+    if (tar_fdopen(&tar, pipe_from_parent_to_child[1], (char*)tarball_name,
                 /*fileops:(standard)*/ NULL, O_WRONLY | O_CREAT, 0644, TAR_GNU) != 0)
     {
         goto ret_fail;
@@ -214,12 +216,51 @@ ret_fail:
     }
 
 ret_clean:
-    dd_close(dd);
     /* now it's safe to free file */
     free_reportfile(file);
     return retval;
 }
 
+static
+int create_tarball(const char *tempfile, struct dump_dir *dd,
+     problem_data_t *problem_data)
+{
+    int fd = open(tempfile, O_WRONLY | O_CREAT | O_EXCL, 0600);
+    if (fd < 0)
+    {
+        perror_msg("Can't open '%s'", tempfile);
+        dd_close(dd);
+        return 1;
+    }
+
+    int retval = write_tarball(fd, tempfile, dd, problem_data);
+    close(fd);
+    dd_close(dd);
+    return retval;
+}
+
+struct tarball_stream_param
+{
+    const char *dump_dir_name;
+    problem_data_t *problem_data;
+};
+
+/* post_stream_fn producing the tarball while it is being attached */
+static
+int produce_tarball(int fd, void *param)
+{
+    struct tarball_stream_param *p = param;
+
+    /* Runs in a child of the reporter which may keep the dump dir locked */
+    struct dump_dir *dd = dd_opendir(p->dump_dir_name, DD_OPEN_READONLY);
+    if (!dd)
+        return 1;
+
+    int retval = write_tarball(fd, "problem.tar.gz", dd, p->problem_data);
+    dd_close(dd);
+    return retval;
+}
+
 static
 struct ureport_server_response *ureport_do_post_credentials(const char *json, struct ureport_server_config *config, const char *action)
 {
@@ -260,17 +301,18 @@ char *submit_ureport(const char *dump_dir_name, struct ureport_server_config *co
         return NULL;
 
     report_result_t *rr_bthash = find_in_reported_to(dd, "uReport");
-    dd_close(dd);
-
     if (rr_bthash != NULL)
     {
+        dd_close(dd);
         log_notice("uReport has already been submitted.");
         char *ret = xstrdup(rr_bthash->bthash);
         free_report_result(rr_bthash);
         return ret;
     }
 
-    char *json = ureport_from_dump_dir(dump_dir_name);
+    /* Don't keep the dump dir locked while the credentials may be asked for */
+    char *json = ureport_from_dd(dd, NULL);
+    dd_close(dd);
     if (json == NULL)
     {
         log_notice(_("Failed to generate microreport from the problem data"));
@@ -793,20 +835,36 @@ int main(int argc, char **argv)
         exit(0);
     }
 
-    /* Gzipping e.g. 0.5gig coredump takes a while. Let user know what we are doing */
-    log(_("Compressing data"));
-
-    struct dump_dir *dd = dd_opendir(dump_dir_name, /*flags:*/ 0);
-    if (!dd)
-        xfunc_die(); /* error msg is already logged by dd_opendir */
+    /* Without -t, the size of the compressed tarball decides whether to
+     * check for hints, so the tarball must be created in advance. With -t,
+     * hints are not checked and the tarball is compressed while it is being
+     * attached to the case, so the upload starts right away and
+     * LARGE_DATA_TMP_DIR doesn't have to hold a copy of the problem data.
+     * The uncompressed size is the upper bound of the tarball size, thus
+     * it can tell only that the tarball won't go to the "big file" server.
+     */
+    const bool stream_tarball = (opts & OPT_t)
+            && (bigsize == 0 || get_dirsize(dump_dir_name) / (1024*1024) < bigsize);
 
-    if (create_tarball(tempfile, dd, problem_data) != 0)
+    off_t tempfile_size = 0;
+    struct dump_dir *dd;
+    if (!stream_tarball)
     {
-        errmsg = _("Can't create temporary file in "LARGE_DATA_TMP_DIR);
-        goto ret;
-    }
+        /* Gzipping e.g. 0.5gig coredump takes a while. Let user know what we are doing */
+        log(_("Compressing data"));
+
+        dd = dd_opendir(dump_dir_name, /*flags:*/ 0);
+        if (!dd)
+            xfunc_die(); /* error msg is already logged by dd_opendir */
+
+        if (create_tarball(tempfile, dd, problem_data) != 0)
+        {
+            errmsg = _("Can't create temporary file in "LARGE_DATA_TMP_DIR);
+            goto ret;
+        }
 
-    off_t tempfile_size = stat_st_size_or_die(tempfile);
+        tempfile_size = stat_st_size_or_die(tempfile);
+    }
 
     if (!(opts & OPT_t))
     {
@@ -914,7 +972,7 @@ int main(int argc, char **argv)
     }
 
     char *remote_filename = NULL;
-    if (bigsize != 0 && tempfile_size / (1024*1024) >= bigsize)
+    if (!stream_tarball && bigsize != 0 && tempfile_size / (1024*1024) >= bigsize)
     {
         /* Upload tarball of -d DIR to "big file" FTP */
         /* log(_("Uploading problem data to '%s'"), bigurl); - upload_file does this */
@@ -941,9 +999,27 @@ int main(int argc, char **argv)
     {
         /* Attach the tarball of -d DIR */
         log(_("Attaching problem data to case '%s'"), url);
-        INVALID_CREDENTIALS_LOOP(login, password,
-                result_atch, attach_file_to_case(url, login, password, ssl_verify, tempfile)
-        );
+        if (stream_tarball)
+        {
+            struct tarball_stream_param param = {
+                .dump_dir_name = dump_dir_name,
+                .problem_data = problem_data,
+            };
+            struct post_stream stream = {
+                .ps_produce = produce_tarball,
+                .ps_param = &param,
+                .ps_name = tarball_name,
+            };
+            INVALID_CREDENTIALS_LOOP(login, password,
+                    result_atch, attach_stream_to_case(url, login, password, ssl_verify, &stream)
+            );
+        }
+        else
+        {
+            INVALID_CREDENTIALS_LOOP(login, password,
+                    result_atch, attach_file_to_case(url, login, password, ssl_verify, tempfile)
+            );
+        }
     }
     if (result_atch->error)
     {
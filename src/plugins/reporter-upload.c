@@ -32,7 +32,12 @@ static char *ask_url(const char *message)
     return url;
 }
 
+/* Uploads file_name, or the data produced by stream if it is not NULL.
+ * file_name is uploaded in chunks if chunked is not NULL.
+ */
 static int interactive_upload_file(const char *url, const char *file_name,
+                                   const struct post_stream *stream,
+                                   const struct upload_chunked_options *chunked,
                                    map_string_t *settings, char **remote_name)
 {
     post_state_t *state = new_post_state(POST_WANT_ERROR_MSG);
@@ -63,7 +68,13 @@ static int interactive_upload_file(const char *url, const char *file_name,
     if (state->client_ssh_private_keyfile != NULL)
         log_debug("Using SSH private key '%s'", state->client_ssh_private_keyfile);
 
-    char *tmp = upload_file_ext(state, url, file_name, UPLOAD_FILE_HANDLE_ACCESS_DENIALS);
+    char *tmp;
+    if (stream)
+        tmp = upload_stream_ext(state, url, stream, UPLOAD_FILE_HANDLE_ACCESS_DENIALS);
+    else if (chunked)
+        tmp = upload_file_chunked(state, url, file_name, chunked, UPLOAD_FILE_HANDLE_ACCESS_DENIALS);
+    else
+        tmp = upload_file_ext(state, url, file_name, UPLOAD_FILE_HANDLE_ACCESS_DENIALS);
 
     if (remote_name)
         *remote_name = tmp;
@@ -77,6 +88,27 @@ static int interactive_upload_file(const char *url, const char *file_name,
     return tmp == NULL;
 }
 
+struct archive_stream_param
+{
+    const char *dump_dir_name;
+    string_vector_ptr_t exclude_elements;
+};
+
+/* post_stream_fn producing the archive while it is being uploaded */
+static int produce_archive(int fd, void *param)
+{
+    struct archive_stream_param *p = param;
+
+    /* Runs in a child process, must not touch the parent's lock */
+    struct dump_dir *dd = dd_opendir(p->dump_dir_name, DD_OPEN_READONLY);
+    if (!dd)
+        return 1;
+
+    int r = dd_write_archive(dd, fd, (const_string_vector_const_ptr_t)p->exclude_elements, 0);
+    dd_close(dd);
+    return r;
+}
+
 static int create_and_upload_archive(
                 const char *dump_dir_name,
                 const char *url,
@@ -95,25 +127,93 @@ static int create_and_upload_archive(
 
     string_vector_ptr_t exclude_from_report = get_global_always_excluded_elements();
 
-    struct dump_dir *dd = dd_opendir(dump_dir_name, /*flags:*/ 0);
-    if (!dd)
-        xfunc_die(); /* error msg is already logged by dd_opendir */
+    /* Chunked uploads are HTTP only. They need the archive on disk and keep
+     * it there until the upload is finished, so that it can be resumed.
+     */
+    struct upload_chunked_options chunked = { 0 };
+    const char *chunk_size = get_map_string_item_or_NULL(settings, "ChunkSize");
+    if (chunk_size && chunk_size[0]
+        && url && (prefixcmp(url, "http://") == 0 || prefixcmp(url, "https://") == 0))
+    {
+        chunked.uco_chunk_size = (off_t)xatou(chunk_size) * 1024 * 1024;
+        const char *parallel = get_map_string_item_or_NULL(settings, "ParallelChunks");
+        chunked.uco_parallel = parallel && parallel[0] ? xatou(parallel) : 1;
+    }
 
-    /* Compressing e.g. 0.5gig coredump takes a while. Let client know what we are doing */
-    log(_("Compressing data"));
-    if (dd_create_archive(dd, tempfile, (const_string_vector_const_ptr_t)exclude_from_report, 0) != 0)
+    char *journal = NULL;
+    if (chunked.uco_chunk_size > 0)
     {
-        log_error("Can't create temporary file in %s", LARGE_DATA_TMP_DIR);
-        goto ret;
+        /* The journal lives next to the problem directory */
+        char *dir = realpath(dump_dir_name, NULL);
+        if (dir)
+            chunked.uco_journal = journal = xasprintf("%s.upload-journal", dir);
+        free(dir);
     }
 
-    dd_close(dd);
-    dd = NULL;
+    /* Compress the data while they are being uploaded, so the upload starts
+     * right away and LARGE_DATA_TMP_DIR doesn't have to hold the archive.
+     * scp needs to know the size in advance.
+     */
+    if (url && url[0] && strcmp(url, "file://"LARGE_DATA_TMP_DIR"/") != 0
+        && prefixcmp(url, "scp://") != 0 && chunked.uco_chunk_size == 0)
+    {
+        struct archive_stream_param param = {
+            .dump_dir_name = dump_dir_name,
+            .exclude_elements = exclude_from_report,
+        };
+        struct post_stream stream = {
+            .ps_produce = produce_archive,
+            .ps_param = &param,
+            .ps_name = strrchr(tempfile, '/') + 1,
+        };
+
+        log(_("Compressing data"));
+        result = interactive_upload_file(url, NULL, &stream, /*chunked:*/ NULL, settings, remote_name);
+        free(tempfile);
+        return result;
+    }
+
+    struct dump_dir *dd = NULL;
+
+    /* The archive of an interrupted chunked upload is uploaded again,
+     * the journal knows which of its chunks were already sent
+     */
+    if (journal && access(journal, F_OK) == 0 && access(tempfile, R_OK) == 0)
+        log_notice("Reusing archive '%s'", tempfile);
+    else
+    {
+        dd = dd_opendir(dump_dir_name, /*flags:*/ 0);
+        if (!dd)
+            xfunc_die(); /* error msg is already logged by dd_opendir */
+
+        /* Compressing e.g. 0.5gig coredump takes a while. Let client know what we are doing */
+        log(_("Compressing data"));
+        if (dd_create_archive(dd, tempfile, (const_string_vector_const_ptr_t)exclude_from_report, 0) != 0)
+        {
+            log_error("Can't create temporary file in %s", LARGE_DATA_TMP_DIR);
+            goto ret;
+        }
+
+        dd_close(dd);
+        dd = NULL;
+    }
 
     /* Upload the archive */
     /* Upload from /tmp to /tmp + deletion -> BAD, exclude this possibility */
     if (url && url[0] && strcmp(url, "file://"LARGE_DATA_TMP_DIR"/") != 0)
-        result = interactive_upload_file(url, tempfile, settings, remote_name);
+    {
+        result = interactive_upload_file(url, tempfile, /*stream:*/ NULL,
+                                         chunked.uco_chunk_size > 0 ? &chunked : NULL,
+                                         settings, remote_name);
+
+        if (result != 0 && journal && access(journal, F_OK) == 0)
+        {
+            /* Keep the archive for the next attempt */
+            log(_("Run the upload again to resume it"));
+            free(tempfile);
+            tempfile = NULL;
+        }
+    }
     else
     {
         result = 0; /* success */
@@ -130,6 +230,7 @@ static int create_and_upload_archive(
         unlink(tempfile);
         free(tempfile);
     }
+    free(journal);
 
     return result;
 }
@@ -232,6 +333,11 @@ int main(int argc, char **argv)
     else if (getenv("Upload_SSHPrivateKey") != NULL)
         set_map_string_item_from_string(settings, "SSHPrivateKey", getenv("Upload_SSHPrivateKey"));
 
+    if (getenv("Upload_ChunkSize") != NULL)
+        set_map_string_item_from_string(settings, "ChunkSize", getenv("Upload_ChunkSize"));
+    if (getenv("Upload_ParallelChunks") != NULL)
+        set_map_string_item_from_string(settings, "ParallelChunks", getenv("Upload_ParallelChunks"));
+
     char *remote_name = NULL;
     const int result = create_and_upload_archive(dump_dir_name, conf_url, settings, &remote_name);
     if (result != 0)
@@ -24,6 +24,67 @@
 
 #define DEFAULT_WEB_SERVICE_URL "https://retrace.fedoraproject.org/faf"
 
+/* Reads problem directory paths from stdin, one per line */
+static GPtrArray *
+read_dump_dir_paths(void)
+{
+    GPtrArray *paths = g_ptr_array_new_with_free_func(free);
+    char *line;
+    while ((line = xmalloc_fgetline(stdin)) != NULL)
+    {
+        if (line[0] != '\0')
+            g_ptr_array_add(paths, line);
+        else
+            free(line);
+    }
+
+    return paths;
+}
+
+static int
+submit_batch(const char *const *dump_dir_paths, unsigned count,
+             struct ureport_server_config *config)
+{
+    struct ureport_preferences *prefs = &(config->ur_prefs);
+    prefs->urp_flags |= UREPORT_PREF_FLAG_RETURN_ON_FAILURE;
+
+    char **json_ureports = ureport_from_dump_dirs(dump_dir_paths, count, prefs, /*CPUs*/0);
+    struct ureport_server_response **responses =
+        ureport_submit_batch((const char *const *)json_ureports, count, config, /*default*/0);
+
+    unsigned failed = 0;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        struct ureport_server_response *response = responses[i];
+        bool ok = false;
+
+        if (!json_ureports[i])
+            error_msg(_("Failed to generate microreport from the problem data in '%s'"), dump_dir_paths[i]);
+        else if (!response)
+            error_msg(_("Failed to submit microreport of '%s'"), dump_dir_paths[i]);
+        else if (response->urr_is_error)
+            error_msg(_("Server responded with an error: '%s'"), response->urr_value);
+        else
+        {
+            log_notice("%s: is known: %s", dump_dir_paths[i], response->urr_value);
+            ok = ureport_server_response_save_in_dump_dir(response, dump_dir_paths[i], config);
+        }
+
+        if (!ok)
+            ++failed;
+
+        ureport_server_response_free(response);
+        free(json_ureports[i]);
+    }
+
+    free(responses);
+    free(json_ureports);
+
+    log(_("Submitted %u of %u microreports"), count - failed, count);
+
+    return failed == 0 ? 0 : 1;
+}
+
 int main(int argc, char **argv)
 {
     setlocale(LC_ALL, "");
@@ -68,6 +129,7 @@ int main(int argc, char **argv)
     char *attach_value_from_rt_data = NULL;
     char *report_result_type = NULL;
     char *attach_type = NULL;
+    int batch = 0;
     struct dump_dir *dd = NULL;
     struct options program_options[] = {
         OPT__VERBOSE(&g_verbose),
@@ -106,6 +168,8 @@ int main(int argc, char **argv)
                           _("use REPORT_RESULT_TYPE when looking for FIELD in reported_to (used only with -L)")),
         OPT_STRING('T', "type", &attach_type, "ATTACHMENT_TYPE",
                           _("attach DATA as ureport attachment ATTACHMENT_TYPE (used only with -l|-L)")),
+        OPT_BOOL('m', "batch", &batch,
+                          _("submit uReports of all DIRs given as arguments or on standard input (conflicts with -d and attaching)")),
         OPT_END(),
     };
 
@@ -115,13 +179,20 @@ int main(int argc, char **argv)
         "  [-A -a bthash -T ATTACHMENT_TYPE -r REPORT_RESULT_TYPE -L RESULT_FIELD] [-d DIR]\n"
         "  [-A -a bthash -T ATTACHMENT_TYPE -l DATA] [-d DIR]\n"
         "& [-v] [-c FILE] [-u URL] [-k] [-t SOURCE] [-h CREDENTIALS] [-i AUTH_ITEMS] [-d DIR]\n"
+        "& [-v] [-c FILE] [-u URL] [-k] [-t SOURCE] [-h CREDENTIALS] [-i AUTH_ITEMS] -m [DIR]...\n"
         "\n"
         "Upload micro report or add an attachment to a micro report\n"
         "\n"
+        "With -m, micro reports of all DIRs (read from standard input, one per line,\n"
+        "if none is given) are generated in parallel and uploaded at once\n"
+        "\n"
         "Reads the default configuration from "UREPORT_CONF_FILE_PATH
     );
 
     unsigned opts = parse_opts(argc, argv, program_options, program_usage_string);
+    argv += optind;
+    if (argv[0] && !batch)
+        show_usage_and_die(program_usage_string, program_options);
 
     map_string_t *settings = new_map_string();
     load_conf_file(conf_file, settings, /*skip key w/o values:*/ false);
@@ -174,6 +245,27 @@ int main(int argc, char **argv)
             error_msg_and_die("-L accepts only 'URL'");
     }
 
+    if (batch)
+    {
+        if ((opts & OPT_d) || ureport_hash || ureport_hash_from_rt || rhbz_bug >= 0 || rhbz_bug_from_rt
+            || email_address || email_address_from_env || comment || comment_file
+            || attach_value || attach_value_from_rt)
+            error_msg_and_die("-m can't be used together with -d or attaching options");
+
+        GPtrArray *paths = NULL;
+        if (argv[0] == NULL)
+            paths = read_dump_dir_paths();
+
+        const char *const *dump_dir_paths = paths ? (const char *const *)paths->pdata : (const char *const *)argv;
+        unsigned count = paths ? paths->len : g_strv_length(argv);
+
+        ret = submit_batch(dump_dir_paths, count, &config);
+
+        if (paths)
+            g_ptr_array_free(paths, TRUE);
+        goto finalize;
+    }
+
     if (ureport_hash_from_rt || rhbz_bug_from_rt || comment_file || attach_value_from_rt)
     {
         dd = dd_opendir(dump_dir_path, DD_OPEN_READONLY);
@@ -241,6 +333,7 @@ int main(int argc, char **argv)
         }
 
         dd_close(dd);
+        dd = NULL;
     }
 
     if (email_address_from_env)
@@ -289,7 +382,13 @@ int main(int argc, char **argv)
     struct ureport_preferences *prefs = &(config.ur_prefs);
     prefs->urp_flags |= UREPORT_PREF_FLAG_RETURN_ON_FAILURE;
 
-    char *json_ureport = ureport_from_dump_dir_ext(dump_dir_path, prefs);
+    /* The dump dir stays open (and locked) from generating the uReport
+     * until the server's response is saved in it */
+    dd = dd_opendir(dump_dir_path, /* flags */ 0);
+    if (!dd)
+        xfunc_die();
+
+    char *json_ureport = ureport_from_dd(dd, prefs);
     if (!json_ureport)
     {
         error_msg(_("Failed to generate microreport from the problem data"));
@@ -307,8 +406,7 @@ int main(int argc, char **argv)
         log_notice("is known: %s", response->urr_value);
         ret = 0; /* "success" */
 
-        if (!ureport_server_response_save_in_dump_dir(response, dump_dir_path, &config))
-            xfunc_die();
+        ureport_server_response_save_in_dd(response, dd, &config);
 
         /* If a reported problem is not known then emit NEEDMORE */
         if (strcmp("true", response->urr_value) == 0)
@@ -326,6 +424,7 @@ int main(int argc, char **argv)
     ureport_server_response_free(response);
 
 finalize:
+    dd_close(dd);
     free(attach_value_from_rt_data);
 
     if (config.ur_prefs.urp_auth_items == auth_items)
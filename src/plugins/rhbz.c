@@ -26,11 +26,18 @@
  */
 
 #include "internal_libreport.h"
+#include "libreport_curl.h"
 #include "rhbz.h"
 
 #define MAX_HOPS            5
 #define MAX_SUMMARY_LENGTH  255
 
+/* Bytes of an attachment encoded at once, must be divisible by 3 so that
+ * the encoded blocks can be simply concatenated */
+#define ATTACHMENT_BLOCK_SIZE (3 * 64 * 1024)
+/* Placeholder of the attachment data in the serialized call */
+#define ATTACHMENT_DATA_MARKER "@@LIBREPORT_ATTACHMENT_DATA@@"
+
 
 //#define DEBUG
 #ifdef DEBUG
@@ -68,7 +75,7 @@ void free_bug_info(struct bug_info *bi)
     free(bi);
 }
 
-static GList *rhbz_comments(struct abrt_xmlrpc *ax, int bug_id)
+static GList *rhbz_comments(xmlrpc_value *xml_response, int bug_id)
 {
     func_entry();
 
@@ -85,8 +92,7 @@ static GList *rhbz_comments(struct abrt_xmlrpc *ax, int bug_id)
      *           <value><array>
      * ...
      */
-    xmlrpc_value *xml_response = abrt_xmlrpc_call(ax, "Bug.comments", "{s:(i)}",
-                                                                      "ids", bug_id);
+
     /* bugs
      *     This is used for bugs specified in ids. This is a hash, where the
      *     keys are the numeric ids of the bugs, and the value is a hash with a
@@ -128,7 +134,6 @@ static GList *rhbz_comments(struct abrt_xmlrpc *ax, int bug_id)
     xmlrpc_DECREF(comments_memb);
     xmlrpc_DECREF(item_memb);
     xmlrpc_DECREF(bugs_memb);
-    xmlrpc_DECREF(xml_response);
 
     return g_list_reverse(comments);
 }
@@ -444,9 +449,25 @@ struct bug_info *rhbz_bug_info(struct abrt_xmlrpc *ax, int bug_id)
      *     <member><name>bugs</name>
      *        <value><array><data>
      *        ...
+     *
+     * Bug.comments (see rhbz_comments()) goes in the same request.
      */
-    xmlrpc_value *xml_bug_response = abrt_xmlrpc_call(ax, "Bug.get", "{s:(i)}",
-                                                          "ids", bug_id);
+    struct abrt_xmlrpc_multicall *mc = abrt_xmlrpc_multicall_new(ax);
+    const unsigned get_index = abrt_xmlrpc_multicall_add(mc, "Bug.get", "{s:(i)}",
+                                                         "ids", bug_id);
+    const unsigned comments_index = abrt_xmlrpc_multicall_add(mc, "Bug.comments", "{s:(i)}",
+                                                              "ids", bug_id);
+    xmlrpc_value *results = abrt_xmlrpc_multicall_perform(mc);
+    abrt_xmlrpc_multicall_free(mc);
+
+    xmlrpc_env env;
+    xmlrpc_value *xml_bug_response = abrt_xmlrpc_multicall_result(&env, results, get_index);
+    if (env.fault_occurred)
+        abrt_xmlrpc_die(&env);
+
+    xmlrpc_value *xml_comments_response = abrt_xmlrpc_multicall_result(&env, results, comments_index);
+    if (env.fault_occurred)
+        abrt_xmlrpc_die(&env);
 
     xmlrpc_value *bugs_memb = rhbz_get_member("bugs", xml_bug_response);
     xmlrpc_value *bug_item = rhbz_array_item_at(bugs_memb, 0);
@@ -484,12 +505,14 @@ struct bug_info *rhbz_bug_info(struct abrt_xmlrpc *ax, int bug_id)
 
     bz->bi_cc_list = rhbz_bug_cc(bug_item);
 
-    bz->bi_comments = rhbz_comments(ax, bug_id);
+    bz->bi_comments = rhbz_comments(xml_comments_response, bug_id);
     bz->bi_best_bt_rating = find_best_bt_rating_in_comments(bz->bi_comments);
 
     xmlrpc_DECREF(bugs_memb);
     xmlrpc_DECREF(bug_item);
+    xmlrpc_DECREF(xml_comments_response);
     xmlrpc_DECREF(xml_bug_response);
+    xmlrpc_DECREF(results);
 
     return bz;
 }
@@ -606,7 +629,7 @@ int rhbz_new_bug(struct abrt_xmlrpc *ax,
 }
 
 /* suppress mail notify by {s:i} (nomail:1) (driven by flag) */
-int rhbz_attach_blob(struct abrt_xmlrpc *ax, const char *bug_id,
+void rhbz_batch_attach_blob(struct abrt_xmlrpc_multicall *mc, const char *bug_id,
                 const char *filename, const char *data, int data_len, int flags)
 {
     func_entry();
@@ -614,12 +637,10 @@ int rhbz_attach_blob(struct abrt_xmlrpc *ax, const char *bug_id,
     if (strlen(data) == 0)
     {
         log_notice("not attaching an empty file: '%s'", filename);
-        /* Return SUCCESS */
-        return 0;
+        return;
     }
 
     char *fn = xasprintf("File: %s", filename);
-    xmlrpc_value* result;
     int nomail_notify = !!IS_NOMAIL_NOTIFY(flags);
 
     /* http://www.bugzilla.org/docs/4.2/en/html/api/Bugzilla/WebService/Bug.html#add_attachment
@@ -630,7 +651,7 @@ int rhbz_attach_blob(struct abrt_xmlrpc *ax, const char *bug_id,
      *   6 -> base64,  two arguments (char* plain data which will be encoded by xmlrpc-c to base64,
      *                                size_t number of bytes to encode)
      */
-    result = abrt_xmlrpc_call(ax, "Bug.add_attachment", "{s:(s),s:s,s:s,s:s,s:6,s:i}",
+    abrt_xmlrpc_multicall_add(mc, "Bug.add_attachment", "{s:(s),s:s,s:s,s:s,s:6,s:i}",
                 "ids", bug_id,
                 "summary", fn,
                 "file_name", filename,
@@ -647,15 +668,19 @@ int rhbz_attach_blob(struct abrt_xmlrpc *ax, const char *bug_id,
     );
 
     free(fn);
-    if (!result)
-        return -1;
+}
 
-    xmlrpc_DECREF(result);
+int rhbz_attach_blob(struct abrt_xmlrpc *ax, const char *bug_id,
+                const char *filename, const char *data, int data_len, int flags)
+{
+    struct abrt_xmlrpc_multicall *mc = abrt_xmlrpc_multicall_new(ax);
+    rhbz_batch_attach_blob(mc, bug_id, filename, data, data_len, flags);
+    rhbz_batch_perform(mc);
 
     return 0;
 }
 
-int rhbz_attach_fd(struct abrt_xmlrpc *ax, const char *bug_id,
+static int rhbz_attach_fd_in_memory(struct abrt_xmlrpc *ax, const char *bug_id,
                 const char *att_name, int fd, int flags)
 {
     func_entry();
@@ -695,6 +720,240 @@ int rhbz_attach_fd(struct abrt_xmlrpc *ax, const char *bug_id,
     return res;
 }
 
+/* The request body of a streamed attachment: head, base64 encoded contents
+ * of fd, tail. The data are encoded block by block while they are being
+ * sent, so neither the file nor its encoded form is ever held in memory.
+ */
+struct attachment_stream
+{
+    char *xml;                  ///< serialized call with ATTACHMENT_DATA_MARKER
+    size_t head_len;            ///< xml up to the data value
+    const char *tail;           ///< xml after the data value
+    size_t tail_len;
+    int fd;
+    off_t size;
+};
+
+#define ATTACHMENT_DATA_HEAD "<value><base64>"
+#define ATTACHMENT_DATA_TAIL "</base64></value>"
+
+/* Runs in a child process of the upload, see post_stream_fn */
+static int produce_attachment(int out, void *param)
+{
+    const struct attachment_stream *as = param;
+
+    if (full_write(out, as->xml, as->head_len) != (ssize_t)as->head_len
+        || full_write_str(out, ATTACHMENT_DATA_HEAD) < 0)
+        return 1;
+
+    char *block = xmalloc(ATTACHMENT_BLOCK_SIZE);
+    off_t offset = 0;
+    while (offset < as->size)
+    {
+        size_t want = MIN(ATTACHMENT_BLOCK_SIZE, as->size - offset);
+        size_t have = 0;
+        while (have < want)
+        {
+            /* pread() - the concurrent uploads share file offsets of fds */
+            ssize_t r = pread(as->fd, block + have, want - have, offset + have);
+            if (r < 0 && errno == EINTR)
+                continue;
+            if (r <= 0)
+            {
+                if (r < 0)
+                    perror_msg("Can't read the attachment");
+                else
+                    error_msg("The attachment has been truncated");
+                free(block);
+                return 1;
+            }
+            have += r;
+        }
+
+        char *encoded = encode_base64(block, want);
+        const ssize_t written = full_write_str(out, encoded);
+        free(encoded);
+        if (written < 0)
+        {
+            free(block);
+            return 1;
+        }
+
+        offset += want;
+    }
+    free(block);
+
+    if (full_write_str(out, ATTACHMENT_DATA_TAIL) < 0
+        || full_write(out, as->tail, as->tail_len) != (ssize_t)as->tail_len)
+        return 1;
+
+    return 0;
+}
+
+/* Prepares the Bug.add_attachment call of rhbz_attach_blob() with fd as the
+ * data. Returns false if there is nothing to attach.
+ */
+static bool attachment_stream_init(struct attachment_stream *as, struct post_stream *stream,
+                struct abrt_xmlrpc *ax, const char *bug_id, const struct rhbz_attachment *att)
+{
+    memset(as, 0, sizeof(*as));
+    as->fd = att->ra_fd;
+
+    struct stat st;
+    if (fstat(att->ra_fd, &st) != 0)
+    {
+        perror_msg("Can't stat '%s'", att->ra_name);
+        return false;
+    }
+    as->size = st.st_size;
+
+    if (as->size == 0)
+    {
+        log_notice("not attaching an empty file: '%s'", att->ra_name);
+        return false;
+    }
+
+    xmlrpc_env env;
+    xmlrpc_env_init(&env);
+
+    char *fn = xasprintf("File: %s", att->ra_name);
+    xmlrpc_value *params = xmlrpc_build_value(&env, "{s:(s),s:s,s:s,s:s,s:s,s:i}",
+                "ids", bug_id,
+                "summary", fn,
+                "file_name", att->ra_name,
+                "content_type", (att->ra_flags & RHBZ_BINARY_ATTACHMENT) ? "application/octet-stream" : "text/plain",
+                "data", ATTACHMENT_DATA_MARKER,
+                "nomail", !!IS_NOMAIL_NOTIFY(att->ra_flags)
+    );
+    free(fn);
+    if (env.fault_occurred)
+        abrt_xmlrpc_die(&env);
+
+    size_t xml_size;
+    as->xml = abrt_xmlrpc_serialize_call(&env, ax, "Bug.add_attachment", params, &xml_size);
+    xmlrpc_DECREF(params);
+
+    /* Replace the whole <value> of the placeholder string */
+    char *marker = strstr(as->xml, ATTACHMENT_DATA_MARKER);
+    char *value_end = marker ? strstr(marker, "</value>") : NULL;
+    if (value_end == NULL)
+        error_msg_and_die("Bug: can't find the attachment data in the serialized call");
+
+    char *value_start = marker;
+    while (value_start > as->xml && prefixcmp(value_start, "<value>") != 0)
+        --value_start;
+
+    as->head_len = value_start - as->xml;
+    as->tail = value_end + strlen("</value>");
+    as->tail_len = xml_size - (as->tail - as->xml);
+
+    stream->ps_produce = produce_attachment;
+    stream->ps_param = as;
+    stream->ps_name = att->ra_name;
+    stream->ps_size = as->head_len
+                      + strlen(ATTACHMENT_DATA_HEAD)
+                      + 4 * ((as->size + 2) / 3)
+                      + strlen(ATTACHMENT_DATA_TAIL)
+                      + as->tail_len;
+
+    return true;
+}
+
+static bool attachment_response_ok(const post_state_t *state, const char *att_name)
+{
+    if (state->curl_result != 0)
+    {
+        error_msg(_("Can't attach '%s': %s"), att_name,
+                  state->curl_error_msg ? state->curl_error_msg : "transfer failed");
+        return false;
+    }
+
+    if (state->http_resp_code != 200)
+    {
+        error_msg(_("Can't attach '%s': HTTP response code is %d"), att_name, state->http_resp_code);
+        return false;
+    }
+
+    xmlrpc_env env;
+    xmlrpc_value *result = abrt_xmlrpc_parse_response(&env, state->body, state->body_size);
+    if (env.fault_occurred)
+    {
+        error_msg(_("Can't attach '%s': %s"), att_name, env.fault_string);
+        xmlrpc_env_clean(&env);
+        return false;
+    }
+
+    xmlrpc_DECREF(result);
+    return true;
+}
+
+int rhbz_attach_fds(struct abrt_xmlrpc *ax, const char *bug_id,
+                const struct rhbz_attachment *attachments, unsigned count,
+                unsigned max_connections)
+{
+    func_entry();
+
+    int failed = 0;
+
+    /* The streamed calls don't go through xmlrpc-c and can't use its
+     * cookies, the session must be identified by a session param (token).
+     * Old Bugzillas without tokens get the attachments one by one.
+     */
+    if (ax->ax_session_params == NULL)
+    {
+        for (unsigned i = 0; i < count; ++i)
+            failed += !!rhbz_attach_fd_in_memory(ax, bug_id, attachments[i].ra_name,
+                                                 attachments[i].ra_fd, attachments[i].ra_flags);
+        return failed;
+    }
+
+    struct attachment_stream *as = xzalloc(count * sizeof(as[0]));
+    struct post_stream *streams = xzalloc(count * sizeof(streams[0]));
+    post_state_t **states = xmalloc(count * sizeof(states[0]));
+    const char **data = xmalloc(count * sizeof(data[0]));
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        states[i] = new_post_state(POST_WANT_BODY
+                                   | POST_WANT_ERROR_MSG
+                                   | (ax->ax_ssl_verify ? POST_WANT_SSL_VERIFY : 0));
+        data[i] = attachment_stream_init(&as[i], &streams[i], ax, bug_id, &attachments[i])
+                  ? (const char *)&streams[i]
+                  : NULL;
+    }
+
+    post_multi(states, count, ax->ax_url, "text/xml", /*headers*/ NULL,
+               data, POST_DATA_FROMSTREAM, max_connections);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        if (data[i] != NULL && !attachment_response_ok(states[i], attachments[i].ra_name))
+            ++failed;
+
+        free_post_state(states[i]);
+        free(as[i].xml);
+    }
+
+    free(data);
+    free(states);
+    free(streams);
+    free(as);
+
+    return failed;
+}
+
+int rhbz_attach_fd(struct abrt_xmlrpc *ax, const char *bug_id,
+                const char *att_name, int fd, int flags)
+{
+    const struct rhbz_attachment attachment = {
+        .ra_name = att_name,
+        .ra_fd = fd,
+        .ra_flags = flags,
+    };
+
+    return rhbz_attach_fds(ax, bug_id, &attachment, 1, 1) == 0 ? 0 : -1;
+}
+
 void rhbz_logout(struct abrt_xmlrpc *ax)
 {
     func_entry();
@@ -738,11 +997,10 @@ struct bug_info *rhbz_find_origin_bug_closed_duplicate(struct abrt_xmlrpc *ax,
 }
 
 /* suppress mail notify by {s:i} (nomail:1) */
-void rhbz_mail_to_cc(struct abrt_xmlrpc *ax, int bug_id, const char *mail, int flags)
+void rhbz_batch_mail_to_cc(struct abrt_xmlrpc_multicall *mc, int bug_id, const char *mail, int flags)
 {
     func_entry();
 
-    xmlrpc_value *result;
     int nomail_notify = !!IS_NOMAIL_NOTIFY(flags);
 #if 0 /* Obsolete API */
     result = abrt_xmlrpc_call(ax, "Bug.update", "({s:i,s:{s:(s),s:i}})",
@@ -752,13 +1010,11 @@ void rhbz_mail_to_cc(struct abrt_xmlrpc *ax, int bug_id, const char *mail, int f
     );
 #endif
     /* Bugzilla 4.0+ uses this API: */
-    result = abrt_xmlrpc_call(ax, "Bug.update", "{s:i,s:{s:(s),s:i}}",
+    abrt_xmlrpc_multicall_add(mc, "Bug.update", "{s:i,s:{s:(s),s:i}}",
                               "ids", bug_id,
                               "cc", "add", mail,
                                     "nomail", nomail_notify
     );
-    if (result)
-        xmlrpc_DECREF(result);
 
     /* TODO: check that result does indicate that CC was updated.
      * The structure I see from Bugzilla 4.2:
@@ -780,7 +1036,14 @@ void rhbz_mail_to_cc(struct abrt_xmlrpc *ax, int bug_id, const char *mail, int f
      */
 }
 
-void rhbz_add_comment(struct abrt_xmlrpc *ax, int bug_id, const char *comment,
+void rhbz_mail_to_cc(struct abrt_xmlrpc *ax, int bug_id, const char *mail, int flags)
+{
+    struct abrt_xmlrpc_multicall *mc = abrt_xmlrpc_multicall_new(ax);
+    rhbz_batch_mail_to_cc(mc, bug_id, mail, flags);
+    rhbz_batch_perform(mc);
+}
+
+void rhbz_batch_add_comment(struct abrt_xmlrpc_multicall *mc, int bug_id, const char *comment,
                       int flags)
 {
     func_entry();
@@ -788,21 +1051,25 @@ void rhbz_add_comment(struct abrt_xmlrpc *ax, int bug_id, const char *comment,
     int private = !!IS_PRIVATE(flags);
     int nomail_notify = !!IS_NOMAIL_NOTIFY(flags);
 
-    xmlrpc_value *result;
-    result = abrt_xmlrpc_call(ax, "Bug.add_comment", "{s:i,s:s,s:b,s:i}",
+    abrt_xmlrpc_multicall_add(mc, "Bug.add_comment", "{s:i,s:s,s:b,s:i}",
                               "id", bug_id, "comment", comment,
                               "private", private, "nomail", nomail_notify);
+}
 
-    if (result)
-        xmlrpc_DECREF(result);
+void rhbz_add_comment(struct abrt_xmlrpc *ax, int bug_id, const char *comment,
+                      int flags)
+{
+    struct abrt_xmlrpc_multicall *mc = abrt_xmlrpc_multicall_new(ax);
+    rhbz_batch_add_comment(mc, bug_id, comment, flags);
+    rhbz_batch_perform(mc);
 }
 
-void rhbz_set_url(struct abrt_xmlrpc *ax, int bug_id, const char *url, int flags)
+void rhbz_batch_set_url(struct abrt_xmlrpc_multicall *mc, int bug_id, const char *url, int flags)
 {
     func_entry();
 
     const int nomail_notify = !!IS_NOMAIL_NOTIFY(flags);
-    xmlrpc_value *result = abrt_xmlrpc_call(ax, "Bug.update", "{s:i,s:s,s:i}",
+    abrt_xmlrpc_multicall_add(mc, "Bug.update", "{s:i,s:s,s:i}",
                               "ids", bug_id,
                               "url", url,
 
@@ -811,9 +1078,39 @@ void rhbz_set_url(struct abrt_xmlrpc *ax, int bug_id, const char *url, int flags
                  */
                               "nomail", nomail_notify
     );
+}
 
-    if (result)
-        xmlrpc_DECREF(result);
+void rhbz_set_url(struct abrt_xmlrpc *ax, int bug_id, const char *url, int flags)
+{
+    struct abrt_xmlrpc_multicall *mc = abrt_xmlrpc_multicall_new(ax);
+    rhbz_batch_set_url(mc, bug_id, url, flags);
+    rhbz_batch_perform(mc);
+}
+
+void rhbz_batch_perform(struct abrt_xmlrpc_multicall *mc)
+{
+    func_entry();
+
+    const unsigned count = abrt_xmlrpc_multicall_size(mc);
+    if (count > 0)
+    {
+        xmlrpc_value *results = abrt_xmlrpc_multicall_perform(mc);
+
+        /* The calls are independent, all of them have been tried already */
+        for (unsigned i = 0; i < count; ++i)
+        {
+            xmlrpc_env env;
+            xmlrpc_value *result = abrt_xmlrpc_multicall_result(&env, results, i);
+            if (env.fault_occurred)
+                abrt_xmlrpc_die(&env);
+
+            xmlrpc_DECREF(result);
+        }
+
+        xmlrpc_DECREF(results);
+    }
+
+    abrt_xmlrpc_multicall_free(mc);
 }
 
 void rhbz_close_as_duplicate(struct abrt_xmlrpc *ax, int bug_id,
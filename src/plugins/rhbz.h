@@ -78,6 +78,28 @@ void rhbz_close_as_duplicate(struct abrt_xmlrpc *ax, int bug_id,
                              int duplicate_bug,
                              int flags);
 
+/* Batches of independent updates sent in one request, see
+ * abrt_xmlrpc_multicall. The functions above send batches of one call.
+ *
+ * Usage:
+ *   struct abrt_xmlrpc_multicall *mc = abrt_xmlrpc_multicall_new(ax);
+ *   rhbz_batch_mail_to_cc(mc, bug_id, login, RHBZ_NOMAIL_NOTIFY);
+ *   rhbz_batch_add_comment(mc, bug_id, comment, 0);
+ *   rhbz_batch_perform(mc);
+ */
+void rhbz_batch_mail_to_cc(struct abrt_xmlrpc_multicall *mc, int bug_id, const char *mail, int flags);
+
+void rhbz_batch_add_comment(struct abrt_xmlrpc_multicall *mc, int bug_id, const char *comment,
+                      int flags);
+
+void rhbz_batch_set_url(struct abrt_xmlrpc_multicall *mc, int bug_id, const char *url, int flags);
+
+void rhbz_batch_attach_blob(struct abrt_xmlrpc_multicall *mc, const char *bug_id,
+                const char *att_name, const char *data, int data_len, int flags);
+
+/* Sends the calls, dies if any of them fails and frees the batch */
+void rhbz_batch_perform(struct abrt_xmlrpc_multicall *mc);
+
 void *rhbz_bug_read_item(const char *memb, xmlrpc_value *xml, int flags);
 
 void rhbz_logout(struct abrt_xmlrpc *ax);
@@ -105,6 +127,22 @@ int rhbz_attach_blob(struct abrt_xmlrpc *ax, const char *bug_id,
 int rhbz_attach_fd(struct abrt_xmlrpc *ax, const char *bug_id,
                 const char *att_name, int fd, int flags);
 
+struct rhbz_attachment
+{
+    const char *ra_name;
+    int ra_fd;
+    int ra_flags;               ///< RHBZ_NOMAIL_NOTIFY, RHBZ_BINARY_ATTACHMENT
+};
+
+/* Uploads the attachments concurrently over at most max_connections
+ * (0 for the default) connections. The files are base64 encoded while
+ * they are being sent, the memory needed does not depend on their sizes.
+ * Returns the number of attachments which couldn't be uploaded.
+ */
+int rhbz_attach_fds(struct abrt_xmlrpc *ax, const char *bug_id,
+                const struct rhbz_attachment *attachments, unsigned count,
+                unsigned max_connections);
+
 GList *rhbz_bug_cc(xmlrpc_value *result_xml);
 
 struct bug_info *rhbz_bug_info(struct abrt_xmlrpc *ax, int bug_id);
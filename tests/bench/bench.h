@@ -0,0 +1,143 @@
+/*
+    Copyright (C) 2026  ABRT team <crash-catcher@lists.fedorahosted.org>
+    Copyright (C) 2026  RedHat inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+    ----
+
+    Helpers for benchmarks
+
+    Usage:
+      struct bench b;
+      bench_start(&b, "problem_report", "description");
+      for (unsigned i = 0; i < iterations; ++i)
+          ... measured code ...
+      bench_stop(&b, iterations);
+      bench_print(&b, "\"bytes\": %zu", size);
+
+    prints
+
+      {"benchmark": "problem_report", "case": "description", "iterations": 10,
+       "seconds": 0.123456789, "seconds_per_iteration": 0.012345678, "bytes": 1024}
+
+    on a single line.
+*/
+#ifndef LIBREPORT_BENCH_H
+#define LIBREPORT_BENCH_H
+
+#include "internal_libreport.h"
+
+#include <time.h>
+#include <stdarg.h>
+
+struct bench
+{
+    const char *b_benchmark;
+    const char *b_case;
+    unsigned b_iterations;
+    struct timespec b_start;
+    double b_seconds;
+};
+
+static inline double bench_timespec_diff(const struct timespec *start, const struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static inline void bench_start(struct bench *b, const char *benchmark, const char *case_name)
+{
+    b->b_benchmark = benchmark;
+    b->b_case = case_name;
+    b->b_iterations = 0;
+    b->b_seconds = 0;
+    clock_gettime(CLOCK_MONOTONIC, &b->b_start);
+}
+
+static inline void bench_stop(struct bench *b, unsigned iterations)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    b->b_iterations = iterations;
+    b->b_seconds = bench_timespec_diff(&b->b_start, &end);
+}
+
+/* extra_fmt adds case specific members, can be NULL */
+static inline void bench_print(const struct bench *b, const char *extra_fmt, ...)
+    __attribute__ ((format (printf, 2, 3)));
+
+static inline void bench_print(const struct bench *b, const char *extra_fmt, ...)
+{
+    printf("{\"benchmark\": \"%s\", \"case\": \"%s\", \"iterations\": %u, "
+           "\"seconds\": %.9f, \"seconds_per_iteration\": %.9f",
+           b->b_benchmark, b->b_case, b->b_iterations,
+           b->b_seconds, b->b_iterations ? b->b_seconds / b->b_iterations : 0.0);
+
+    if (extra_fmt != NULL)
+    {
+        va_list p;
+        va_start(p, extra_fmt);
+        fputs(", ", stdout);
+        vprintf(extra_fmt, p);
+        va_end(p);
+    }
+
+    puts("}");
+    fflush(stdout);
+}
+
+/* Counts of read and write system calls of this process (not of its
+ * children) from /proc/self/io, zeros if it can't be read */
+struct bench_syscalls
+{
+    unsigned long long bs_reads;
+    unsigned long long bs_writes;
+};
+
+static inline void bench_get_syscalls(struct bench_syscalls *sc)
+{
+    sc->bs_reads = 0;
+    sc->bs_writes = 0;
+
+    FILE *fp = fopen("/proc/self/io", "r");
+    if (fp == NULL)
+        return;
+
+    char line[128];
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        sscanf(line, "syscr: %llu", &sc->bs_reads);
+        sscanf(line, "syscw: %llu", &sc->bs_writes);
+    }
+    fclose(fp);
+}
+
+/* Parses the common options: -i ITERATIONS */
+static inline unsigned bench_parse_iterations(int argc, char **argv, unsigned def)
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "i:")) != -1)
+    {
+        if (opt == 'i')
+            def = xatou(optarg);
+        else
+            error_msg_and_die("Usage: %s [-i ITERATIONS]", argv[0]);
+    }
+
+    return def;
+}
+
+#endif /* LIBREPORT_BENCH_H */
@@ -0,0 +1,215 @@
+/*
+    Copyright (C) 2026  ABRT team <crash-catcher@lists.fedorahosted.org>
+    Copyright (C) 2026  RedHat inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+/*
+ * Storage layer operations on a synthetic spool
+ *
+ * ITERATIONS is the number of problem directories of every shape. The shapes
+ * can be limited by BENCH_SHAPES, e.g. BENCH_SHAPES=minimal,wide, the spool
+ * is created in BENCH_SPOOL_DIR (default /tmp).
+ */
+#include "bench.h"
+#include "spool.h"
+
+/* Processes opening the directories at once in the lock_contention case */
+#define CONTENDERS 4
+
+static void bench_print_shape(const struct bench *b, const struct spool_shape *shape, unsigned dirs)
+{
+    bench_print(b, "\"shape\": \"%s\", \"dirs\": %u, \"items\": %u",
+                shape->ss_name, dirs, spool_shape_items(shape));
+}
+
+static void bench_opendir(GList *dirs, const struct spool_shape *shape, unsigned count)
+{
+    struct bench b;
+    bench_start(&b, "dump_dir", "dd_opendir");
+    for (GList *iter = dirs; iter; iter = g_list_next(iter))
+    {
+        struct dump_dir *dd = dd_opendir(iter->data, DD_OPEN_READONLY);
+        if (dd == NULL)
+            error_msg_and_die("Can't open '%s'", (const char *)iter->data);
+        dd_close(dd);
+    }
+    bench_stop(&b, count);
+    bench_print_shape(&b, shape, count);
+}
+
+/* All contenders lock every directory in the same order */
+static void bench_lock_contention(GList *dirs, const struct spool_shape *shape, unsigned count)
+{
+    pid_t children[CONTENDERS];
+
+    struct bench b;
+    bench_start(&b, "dump_dir", "lock_contention");
+    fflush(NULL);
+    for (unsigned i = 0; i < CONTENDERS; ++i)
+    {
+        children[i] = fork();
+        if (children[i] < 0)
+            perror_msg_and_die("fork");
+        if (children[i] != 0)
+            continue;
+
+        for (GList *iter = dirs; iter; iter = g_list_next(iter))
+        {
+            struct dump_dir *dd = dd_opendir(iter->data, /*flags*/0);
+            if (dd == NULL)
+                _exit(1);
+            dd_close(dd);
+        }
+        _exit(0);
+    }
+
+    for (unsigned i = 0; i < CONTENDERS; ++i)
+    {
+        int status;
+        safe_waitpid(children[i], &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            error_msg_and_die("Contender %u failed", i);
+    }
+    bench_stop(&b, count * CONTENDERS);
+    bench_print(&b, "\"shape\": \"%s\", \"dirs\": %u, \"items\": %u, \"processes\": %u",
+                shape->ss_name, count, spool_shape_items(shape), CONTENDERS);
+}
+
+static void bench_load_text(GList *dirs, const struct spool_shape *shape, unsigned count)
+{
+    size_t loaded = 0;
+    struct bench b;
+    bench_start(&b, "dump_dir", "dd_load_text");
+    for (GList *iter = dirs; iter; iter = g_list_next(iter))
+    {
+        struct dump_dir *dd = dd_opendir(iter->data, DD_OPEN_READONLY);
+        if (dd == NULL)
+            error_msg_and_die("Can't open '%s'", (const char *)iter->data);
+
+        char *short_name;
+        dd_init_next_file(dd);
+        while (dd_get_next_file(dd, &short_name, NULL))
+        {
+            if (strcmp(short_name, FILENAME_COREDUMP) != 0)
+            {
+                char *text = dd_load_text_ext(dd, short_name, DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE);
+                if (text != NULL)
+                    loaded += strlen(text);
+                free(text);
+            }
+            free(short_name);
+        }
+        dd_close(dd);
+    }
+    bench_stop(&b, count);
+    bench_print(&b, "\"shape\": \"%s\", \"dirs\": %u, \"items\": %u, \"bytes\": %zu",
+                shape->ss_name, count, spool_shape_items(shape), loaded);
+}
+
+static void bench_problem_data_load(GList *dirs, const struct spool_shape *shape, unsigned count)
+{
+    struct bench b;
+    bench_start(&b, "dump_dir", "problem_data_load_from_dump_dir");
+    for (GList *iter = dirs; iter; iter = g_list_next(iter))
+    {
+        struct dump_dir *dd = dd_opendir(iter->data, DD_OPEN_READONLY);
+        if (dd == NULL)
+            error_msg_and_die("Can't open '%s'", (const char *)iter->data);
+
+        problem_data_t *pd = problem_data_new();
+        problem_data_load_from_dump_dir(pd, dd, NULL);
+        problem_data_free(pd);
+        dd_close(dd);
+    }
+    bench_stop(&b, count);
+    bench_print_shape(&b, shape, count);
+}
+
+static void bench_create_archive(GList *dirs, const struct spool_shape *shape, unsigned count,
+                                 const char *spool)
+{
+    char *archive = concat_path_file(spool, "archive.tar.gz");
+
+    struct bench b;
+    bench_start(&b, "dump_dir", "dd_create_archive");
+    for (GList *iter = dirs; iter; iter = g_list_next(iter))
+    {
+        struct dump_dir *dd = dd_opendir(iter->data, DD_OPEN_READONLY);
+        if (dd == NULL)
+            error_msg_and_die("Can't open '%s'", (const char *)iter->data);
+
+        const int r = dd_create_archive(dd, archive, NULL, 0);
+        if (r != 0)
+            error_msg_and_die("Can't archive '%s': %s", (const char *)iter->data, strerror(-r));
+
+        dd_close(dd);
+        xunlink(archive);
+    }
+    bench_stop(&b, count);
+    bench_print_shape(&b, shape, count);
+
+    free(archive);
+}
+
+static void bench_delete(GList *dirs, const struct spool_shape *shape, unsigned count)
+{
+    struct bench b;
+    bench_start(&b, "dump_dir", "dd_delete");
+    for (GList *iter = dirs; iter; iter = g_list_next(iter))
+    {
+        struct dump_dir *dd = dd_opendir(iter->data, /*flags*/0);
+        if (dd == NULL || dd_delete(dd) != 0)
+            error_msg_and_die("Can't delete '%s'", (const char *)iter->data);
+    }
+    bench_stop(&b, count);
+    bench_print_shape(&b, shape, count);
+}
+
+static void bench_shape(const struct spool_shape *shape, unsigned count)
+{
+    char *spool = spool_new_dir();
+
+    struct bench b;
+    bench_start(&b, "dump_dir", "dd_create");
+    GList *dirs = spool_generate(spool, shape, count);
+    bench_stop(&b, count);
+    bench_print_shape(&b, shape, count);
+
+    bench_opendir(dirs, shape, count);
+    bench_lock_contention(dirs, shape, count);
+    bench_load_text(dirs, shape, count);
+    bench_problem_data_load(dirs, shape, count);
+    bench_create_archive(dirs, shape, count, spool);
+    bench_delete(dirs, shape, count);
+
+    g_list_free_full(dirs, free);
+    spool_remove(spool, NULL);
+}
+
+int main(int argc, char **argv)
+{
+    const unsigned count = bench_parse_iterations(argc, argv, 100);
+
+    const char *shapes = getenv("BENCH_SHAPES");
+    for (unsigned i = 0; i < ARRAY_SIZE(spool_shapes); ++i)
+    {
+        if (shapes == NULL || is_in_comma_separated_list(spool_shapes[i].ss_name, shapes))
+            bench_shape(&spool_shapes[i], count);
+    }
+
+    return 0;
+}
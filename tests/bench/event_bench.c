@@ -0,0 +1,220 @@
+/*
+    Copyright (C) 2026  ABRT team <crash-catcher@lists.fedorahosted.org>
+    Copyright (C) 2026  RedHat inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+/*
+ * Event rule matching and handler dispatch
+ *
+ * Generates a report_event.conf tree like the ones of distributions:
+ *
+ *   report_event.conf           includes all events.d/NN.conf
+ *   events.d/NN.conf            rules, includes all events.d/NN.d/MM.conf
+ *   events.d/NN.d/MM.conf       rules
+ *
+ * by glob patterns. A third of the rules have a ~= condition, a third a !=
+ * condition. BENCH_RULES sets the number of rules (default 600).
+ *
+ * The run_event case runs the event 'bench_run' with HANDLERS no-op
+ * handlers matching the problem directory.
+ */
+#include "bench.h"
+#include "spool.h"
+#include "run_event.h"
+
+#define FILES 10
+#define SUBFILES 4
+#define HANDLERS 5
+
+static FILE *create_file(const char *path)
+{
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL)
+        perror_msg_and_die("Can't create '%s'", path);
+    return fp;
+}
+
+static void create_dir(const char *path)
+{
+    if (mkdir(path, 0755) != 0)
+        perror_msg_and_die("Can't create directory '%s'", path);
+}
+
+static void write_rules(FILE *fp, unsigned first, unsigned count)
+{
+    for (unsigned i = first; i < first + count; ++i)
+    {
+        switch (i % 3)
+        {
+            case 0:
+                fprintf(fp, "EVENT=report_bench_%u analyzer=abrt-ccpp component~=^pkg%u(-libs)?$\n"
+                            "        reporter-bench --rule %u\n\n", i, i, i);
+                break;
+            case 1:
+                fprintf(fp, "EVENT=post-create type=Python executable!=/usr/bin/foo%u\n"
+                            "        :\n\n", i);
+                break;
+            default:
+                fprintf(fp, "EVENT=analyze_bench_%u type=CCpp\n"
+                            "        :\n\n", i);
+                break;
+        }
+    }
+}
+
+/* @return Path to the top level configuration file */
+static char *generate_config(const char *dir, unsigned rules)
+{
+    const unsigned per_file = rules / (FILES * (SUBFILES + 1)) + 1;
+    unsigned written = 0;
+
+    char *events_d = concat_path_file(dir, "events.d");
+    create_dir(events_d);
+
+    for (unsigned f = 0; f < FILES; ++f)
+    {
+        char *path = xasprintf("%s/%02u.conf", events_d, f);
+        FILE *fp = create_file(path);
+        if (written < rules)
+        {
+            write_rules(fp, written, MIN(per_file, rules - written));
+            written += MIN(per_file, rules - written);
+        }
+        fprintf(fp, "include %02u.d/*.conf\n", f);
+        fclose(fp);
+        free(path);
+
+        char *subdir = xasprintf("%s/%02u.d", events_d, f);
+        create_dir(subdir);
+        for (unsigned s = 0; s < SUBFILES; ++s)
+        {
+            path = xasprintf("%s/%02u.conf", subdir, s);
+            fp = create_file(path);
+            if (written < rules)
+            {
+                write_rules(fp, written, MIN(per_file, rules - written));
+                written += MIN(per_file, rules - written);
+            }
+            fclose(fp);
+            free(path);
+        }
+        free(subdir);
+    }
+    free(events_d);
+
+    char *conf = concat_path_file(dir, "report_event.conf");
+    FILE *fp = create_file(conf);
+    fputs("include events.d/*.conf\n\n", fp);
+    for (unsigned i = 0; i < HANDLERS; ++i)
+        fputs("EVENT=bench_run type=CCpp component~=^foo\n"
+              "        :\n\n", fp);
+    fclose(fp);
+
+    return conf;
+}
+
+/* Prints the system calls per iteration */
+static void bench_print_stage(const struct bench *b, unsigned rules, unsigned handlers,
+                              const struct bench_syscalls *before, const struct bench_syscalls *after)
+{
+    const unsigned iterations = b->b_iterations ? b->b_iterations : 1;
+    bench_print(b, "\"rules\": %u, \"handlers\": %u, \"read_syscalls\": %llu, \"write_syscalls\": %llu",
+                rules, handlers,
+                (after->bs_reads - before->bs_reads) / iterations,
+                (after->bs_writes - before->bs_writes) / iterations);
+}
+
+static char *discard_log(char *log_line, void *param)
+{
+    return log_line;
+}
+
+int main(int argc, char **argv)
+{
+    const unsigned iterations = bench_parse_iterations(argc, argv, 50);
+    const char *rules_env = getenv("BENCH_RULES");
+    const unsigned rules = rules_env ? xatou(rules_env) : 600;
+
+    char *spool = spool_new_dir();
+    char *conf = generate_config(spool, rules);
+    xsetenv("LIBREPORT_DEBUG_REPORT_EVENT_CONF", conf);
+
+    GList *dirs = spool_generate(spool, spool_shape_find("minimal"), 1);
+    const char *dump_dir_name = dirs->data;
+
+    struct bench b;
+    struct bench_syscalls before, after;
+
+    /* Parsing only */
+    unsigned loaded = 0;
+    bench_get_syscalls(&before);
+    bench_start(&b, "event", "load_rule_list");
+    for (unsigned i = 0; i < iterations; ++i)
+    {
+        GList *rule_list = load_rule_list(NULL, conf, 0);
+        loaded = g_list_length(rule_list);
+        free_rule_list(rule_list);
+    }
+    bench_stop(&b, iterations);
+    bench_get_syscalls(&after);
+    bench_print_stage(&b, loaded, 0, &before, &after);
+
+    /* Parsing and matching the conditions against the dump dir */
+    bench_get_syscalls(&before);
+    bench_start(&b, "event", "list_possible_events");
+    for (unsigned i = 0; i < iterations; ++i)
+    {
+        struct dump_dir *dd = dd_opendir(dump_dir_name, DD_OPEN_READONLY);
+        if (dd == NULL)
+            error_msg_and_die("Can't open '%s'", dump_dir_name);
+        free(list_possible_events(dd, dump_dir_name, "report"));
+        dd_close(dd);
+    }
+    bench_stop(&b, iterations);
+    bench_get_syscalls(&after);
+    bench_print_stage(&b, loaded, 0, &before, &after);
+
+    /* Parsing, matching and spawning the handlers */
+    struct run_event_state *run_state = new_run_event_state();
+    run_state->logging_callback = discard_log;
+
+    bench_get_syscalls(&before);
+    bench_start(&b, "event", "run_event_on_dir_name");
+    for (unsigned i = 0; i < iterations; ++i)
+    {
+        if (run_event_on_dir_name(run_state, dump_dir_name, "bench_run") != 0)
+            error_msg_and_die("Event 'bench_run' failed");
+        if (run_state->children_count != HANDLERS)
+            error_msg_and_die("Expected %d handlers, run %d", HANDLERS, run_state->children_count);
+    }
+    bench_stop(&b, iterations);
+    bench_get_syscalls(&after);
+    bench_print_stage(&b, loaded, HANDLERS, &before, &after);
+
+    free_run_event_state(run_state);
+
+    /* Remove the configuration before the spool */
+    char *cmd = xasprintf("rm -rf '%s/events.d' '%s'", spool, conf);
+    if (system(cmd) != 0)
+        error_msg("Can't remove the configuration");
+    free(cmd);
+    free(conf);
+
+    spool_remove(spool, dirs);
+
+    return 0;
+}
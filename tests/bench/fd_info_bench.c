@@ -0,0 +1,120 @@
+/*
+    Copyright (C) 2026  ABRT team <crash-catcher@lists.fedorahosted.org>
+    Copyright (C) 2026  RedHat inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+/*
+ * Listing of open file descriptors of a process with very many of them
+ *
+ * The benchmark raises its RLIMIT_NOFILE to the hard limit and opens
+ * BENCH_FDS descriptors (default 100000, fewer if the limit is lower) by
+ * dup()-ing a socket, then lists its own descriptors.
+ */
+#include "bench.h"
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+/* Descriptors left for the benchmark itself */
+#define RESERVED_FDS 64
+
+#define CAPPED_FDS 1000
+
+static unsigned open_many_fds(unsigned count)
+{
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) != 0)
+        perror_msg_and_die("getrlimit");
+
+    rl.rlim_cur = rl.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &rl) != 0)
+        perror_msg_and_die("setrlimit");
+
+    if (rl.rlim_cur != RLIM_INFINITY && count + RESERVED_FDS > rl.rlim_cur)
+    {
+        count = rl.rlim_cur > RESERVED_FDS ? rl.rlim_cur - RESERVED_FDS : 0;
+        log_warning("RLIMIT_NOFILE is %lu, opening only %u descriptors",
+                    (unsigned long)rl.rlim_cur, count);
+    }
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+        perror_msg_and_die("socketpair");
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        if (dup(sv[0]) < 0)
+            perror_msg_and_die("dup");
+    }
+
+    return count + 2;
+}
+
+static void bench_bulk(const char *case_name, int pid_proc_fd, unsigned iterations,
+                       unsigned fds, unsigned max_fds, unsigned workers)
+{
+    size_t size = 0;
+    struct bench b;
+    bench_start(&b, "fd_info", case_name);
+    for (unsigned i = 0; i < iterations; ++i)
+    {
+        struct strbuf *buf = strbuf_new();
+        const int r = dump_fd_info_bulk_at(pid_proc_fd, buf, max_fds, workers);
+        if (r != 0)
+            error_msg_and_die("Can't list file descriptors: %s", strerror(-r));
+        size = buf->len;
+        strbuf_free(buf);
+    }
+    bench_stop(&b, iterations);
+    bench_print(&b, "\"fds\": %u, \"max_fds\": %u, \"workers\": %u, \"bytes\": %zu",
+                fds, max_fds, workers, size);
+}
+
+int main(int argc, char **argv)
+{
+    const unsigned iterations = bench_parse_iterations(argc, argv, 5);
+    const char *fds_env = getenv("BENCH_FDS");
+
+    /* Open the process directory and /dev/null before running out of descriptors */
+    const int pid_proc_fd = open_proc_pid_dir(getpid());
+    if (pid_proc_fd < 0)
+        perror_msg_and_die("Can't open /proc/%d", (int)getpid());
+
+    FILE *null = fopen("/dev/null", "w");
+    if (null == NULL)
+        perror_msg_and_die("Can't open /dev/null");
+
+    const unsigned fds = open_many_fds(fds_env ? xatou(fds_env) : 100000);
+
+    struct bench b;
+    bench_start(&b, "fd_info", "dump_fd_info_at");
+    for (unsigned i = 0; i < iterations; ++i)
+    {
+        if (dump_fd_info_at(pid_proc_fd, null) != 0)
+            error_msg_and_die("Can't list file descriptors");
+    }
+    bench_stop(&b, iterations);
+    bench_print(&b, "\"fds\": %u", fds);
+
+    bench_bulk("bulk_one_worker", pid_proc_fd, iterations, fds, 0, 1);
+    bench_bulk("bulk_auto_workers", pid_proc_fd, iterations, fds, 0, 0);
+    bench_bulk("bulk_capped", pid_proc_fd, iterations, fds, CAPPED_FDS, 0);
+
+    fclose(null);
+    close(pid_proc_fd);
+
+    return 0;
+}
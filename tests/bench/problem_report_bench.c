@@ -0,0 +1,147 @@
+/*
+    Copyright (C) 2026  ABRT team <crash-catcher@lists.fedorahosted.org>
+    Copyright (C) 2026  RedHat inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+/*
+ * Report generation on a problem with a 10 MB backtrace
+ */
+#include "bench.h"
+#include "problem_report.h"
+
+#define BACKTRACE_SIZE (10 * 1024 * 1024)
+
+static char *
+generate_backtrace(size_t size)
+{
+    struct strbuf *bt = strbuf_new();
+    strbuf_reserve(bt, size + 256);
+
+    unsigned thread = 1;
+    unsigned frame = 0;
+    while ((size_t)bt->len < size)
+    {
+        if (frame == 0)
+            strbuf_append_strf(bt, "\nThread %u (Thread 0x7f%010x (LWP %u)):\n",
+                               thread, thread * 4096, 1000 + thread);
+
+        strbuf_append_strf(bt,
+                "#%u  0x%016x in function_%u (arg=0x%x, len=%u) at /usr/src/debug/foo/src/file_%u.c:%u\n"
+                "        local_variable = %u\n",
+                frame, 0x400000 + frame * 16, frame, frame * 8, frame % 77, frame % 31, frame * 3 + 1, frame);
+
+        if (++frame == 64)
+        {
+            frame = 0;
+            ++thread;
+        }
+    }
+
+    return strbuf_free_nobuf(bt);
+}
+
+static void
+bench_format(problem_data_t *data, const char *case_name, const char *format, unsigned iterations)
+{
+    problem_formatter_t *pf = problem_formatter_new();
+    problem_formatter_load_string(pf, format);
+
+    size_t description_size = 0;
+    struct bench b;
+    bench_start(&b, "problem_report", case_name);
+    for (unsigned i = 0; i < iterations; ++i)
+    {
+        problem_report_t *pr = NULL;
+        if (problem_formatter_generate_report(pf, data, &pr) != 0)
+            error_msg_and_die("Failed to generate report");
+
+        description_size = strlen(problem_report_get_description(pr));
+        problem_report_free(pr);
+    }
+    bench_stop(&b, iterations);
+    bench_print(&b, "\"description_bytes\": %zu", description_size);
+
+    problem_formatter_free(pf);
+}
+
+static void
+bench_write_section(problem_data_t *data, unsigned iterations)
+{
+    problem_formatter_t *pf = problem_formatter_new();
+    problem_formatter_load_string(pf, "Backtrace:: backtrace\n");
+
+    problem_report_t *pr = NULL;
+    if (problem_formatter_generate_report(pf, data, &pr) != 0)
+        error_msg_and_die("Failed to generate report");
+
+    int fd = xopen("/dev/null", O_WRONLY);
+
+    struct bench b;
+    bench_start(&b, "problem_report", "write_description");
+    for (unsigned i = 0; i < iterations; ++i)
+    {
+        if (problem_report_write_section(pr, PR_SEC_DESCRIPTION, fd) != 0)
+            perror_msg_and_die("Can't write the description");
+    }
+    bench_stop(&b, iterations);
+    bench_print(&b, "\"description_bytes\": %zu", strlen(problem_report_get_description(pr)));
+
+    close(fd);
+    problem_report_free(pr);
+    problem_formatter_free(pf);
+}
+
+int main(int argc, char **argv)
+{
+    const unsigned iterations = bench_parse_iterations(argc, argv, 20);
+
+    char *backtrace = generate_backtrace(BACKTRACE_SIZE);
+
+    problem_data_t *data = problem_data_new();
+    problem_data_add_text_noteditable(data, FILENAME_BACKTRACE, backtrace);
+    problem_data_add_text_noteditable(data, FILENAME_REASON, "foo killed by SIGSEGV");
+    problem_data_add_text_noteditable(data, FILENAME_PACKAGE, "foo-1.0-1.fc99");
+    problem_data_add_text_noteditable(data, FILENAME_CMDLINE, "/usr/bin/foo --bar");
+    problem_data_add_text_noteditable(data, FILENAME_EXECUTABLE, "/usr/bin/foo");
+    problem_data_add_text_noteditable(data, FILENAME_COMMENT, "It crashed\nwhile I was doing nothing.");
+    free(backtrace);
+
+    /* Named multi-line item, every line is prefixed by a colon */
+    bench_format(data, "named_backtrace",
+            "%summary:: [abrt] %package%[[: %crash_function%]]: %reason%\n"
+            "Description of problem:: %bare_comment\n"
+            "\n"
+            "Backtrace:: backtrace\n", iterations);
+
+    /* Bare multi-line item is copied as is */
+    bench_format(data, "bare_backtrace",
+            "%summary:: [abrt] %package%: %reason%\n"
+            ":: %bare_backtrace\n", iterations);
+
+    /* The backtrace is printed by %text */
+    bench_format(data, "text",
+            "%summary:: [abrt] %package%: %reason%\n"
+            "Description of problem:: %bare_comment\n"
+            "\n"
+            "Additional info:: -comment,%text\n", iterations);
+
+    bench_write_section(data, iterations);
+
+    problem_data_free(data);
+
+    return 0;
+}
@@ -0,0 +1,166 @@
+/*
+    Copyright (C) 2026  ABRT team <crash-catcher@lists.fedorahosted.org>
+    Copyright (C) 2026  RedHat inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+/*
+ * Draining of the offline reporting queue
+ *
+ * Queues BENCH_REPORTS problem directories (default 200) for the
+ * report_uReport event and drains the queue by submitting their uReports
+ * to the stand-in uReport server on the loopback, so the throughput doesn't
+ * depend on the network. Every iteration starts with an empty journal and
+ * includes the queueing.
+ *
+ * The concurrency_N cases run N submissions at once. The half_failing case
+ * runs 4 at once against a server failing the first half of the requests and
+ * drains the queue again until all retries succeed.
+ */
+#include "bench.h"
+#include "testsuite_ureport_server.h"
+#include "report_queue.h"
+#include "ureport.h"
+
+static char *create_problem(const char *spool, unsigned i)
+{
+    char *path = xasprintf("%s/problem-%u", spool, i);
+    struct dump_dir *dd = dd_create(path, (uid_t)-1L, DEFAULT_DUMP_DIR_MODE);
+    if (dd == NULL)
+        xfunc_die();
+
+    dd_create_basic_files(dd, (uid_t)-1L, NULL);
+    dd_save_text(dd, FILENAME_TYPE, "CCpp");
+    dd_save_text(dd, FILENAME_ANALYZER, "CCpp");
+    dd_save_text(dd, FILENAME_PKG_EPOCH, "0");
+    dd_save_text(dd, FILENAME_PKG_ARCH, "x86_64");
+    dd_save_text(dd, FILENAME_PKG_RELEASE, "1.fc24");
+    dd_save_text(dd, FILENAME_PKG_VERSION, "0.8");
+    dd_save_text(dd, FILENAME_PKG_NAME, "will-crash");
+    dd_save_text(dd, FILENAME_CORE_BACKTRACE, "{ \"signal\": 6, \"executable\": \"/usr/bin/will_abort\" }");
+    dd_save_text(dd, FILENAME_COUNT, "1");
+
+    char *uuid = xasprintf("uuid%u", i);
+    dd_save_text(dd, FILENAME_UUID, uuid);
+    free(uuid);
+
+    dd_close(dd);
+    return path;
+}
+
+static int submit_to_stand_in(const struct report_queue_entry *entry, void *param)
+{
+    struct ureport_server_config *config = param;
+
+    char *json = ureport_from_dump_dir_ext(entry->rqe_dump_dir, NULL);
+    struct ureport_server_response *resp = ureport_submit(json, config);
+    free(json);
+
+    const int r = resp == NULL || resp->urr_is_error;
+    ureport_server_response_free(resp);
+    return r;
+}
+
+static void bench_drain(const char *case_name, const char *journal, GList *problems,
+                        unsigned iterations, unsigned concurrency, long fail_first)
+{
+    struct report_queue_drain_options options;
+    report_queue_drain_options_init(&options);
+    options.rqd_concurrency = concurrency;
+    options.rqd_max_attempts = 0;
+    /* Failed entries are due again right away */
+    options.rqd_base_delay = 0;
+
+    const unsigned reports = g_list_length(problems);
+    unsigned long drains = 0;
+    long requests = 0;
+
+    struct bench b;
+    bench_start(&b, "report_queue", case_name);
+    for (unsigned i = 0; i < iterations; ++i)
+    {
+        struct testsuite_ureport_server srv;
+        testsuite_ureport_server_start(&srv, fail_first);
+
+        struct ureport_server_config config;
+        ureport_server_config_init(&config);
+        ureport_server_config_set_url(&config, xstrdup(srv.url));
+
+        unlink(journal);
+        report_queue_t *queue = report_queue_open(journal);
+        if (queue == NULL)
+            xfunc_die();
+
+        for (GList *p = problems; p != NULL; p = g_list_next(p))
+        {
+            if (report_queue_add(queue, p->data, "report_uReport") != 0)
+                error_msg_and_die("Can't queue '%s'", (const char *)p->data);
+        }
+
+        int left;
+        while ((left = report_queue_drain(queue, &options, submit_to_stand_in, &config, NULL)) > 0)
+            ++drains;
+        if (left < 0)
+            error_msg_and_die("Can't drain the queue: %s", strerror(-left));
+        ++drains;
+
+        if (srv.stats->submitted != (long)reports)
+            error_msg_and_die("The server accepted %ld uReports instead of %u",
+                              srv.stats->submitted, reports);
+        requests += srv.stats->requests;
+
+        report_queue_close(queue);
+        ureport_server_config_destroy(&config);
+        testsuite_ureport_server_stop(&srv);
+    }
+    bench_stop(&b, iterations);
+
+    bench_print(&b, "\"reports\": %u, \"concurrency\": %u, \"requests\": %ld, "
+                    "\"drains\": %lu, \"reports_per_second\": %.1f",
+                reports, concurrency, requests, drains,
+                b.b_seconds > 0 ? reports * iterations / b.b_seconds : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+    const unsigned iterations = bench_parse_iterations(argc, argv, 3);
+    const char *reports_env = getenv("BENCH_REPORTS");
+    const unsigned reports = reports_env ? xatou(reports_env) : 200;
+
+    char spool[] = "/tmp/report_queue_bench.XXXXXX";
+    if (mkdtemp(spool) == NULL)
+        perror_msg_and_die("Can't create a temporary directory");
+
+    GList *problems = NULL;
+    for (unsigned i = 0; i < reports; ++i)
+        problems = g_list_prepend(problems, create_problem(spool, i));
+    problems = g_list_reverse(problems);
+
+    char *journal = concat_path_file(spool, "journal");
+    bench_drain("concurrency_1", journal, problems, iterations, 1, 0);
+    bench_drain("concurrency_4", journal, problems, iterations, 4, 0);
+    bench_drain("concurrency_16", journal, problems, iterations, 16, 0);
+    bench_drain("half_failing", journal, problems, iterations, 4, reports / 2);
+
+    for (GList *p = problems; p != NULL; p = g_list_next(p))
+        delete_dump_dir(p->data);
+    g_list_free_full(problems, free);
+    unlink(journal);
+    free(journal);
+    rmdir(spool);
+
+    return 0;
+}
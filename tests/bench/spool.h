@@ -0,0 +1,197 @@
+/*
+    Copyright (C) 2026  ABRT team <crash-catcher@lists.fedorahosted.org>
+    Copyright (C) 2026  RedHat inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+    ----
+
+    Synthetic spool of problem directories
+
+    Every problem directory has the basic files of dd_create_basic_files()
+    and the items of a shape:
+
+      minimal - a few short items, e.g. a Python exception
+      ccpp    - a C/C++ crash: 200 KiB backtrace, maps, environ and a 1 MiB
+                coredump
+      wide    - 500 short items
+
+    Usage:
+      const struct spool_shape *shape = spool_shape_find("ccpp");
+      char *spool = spool_new_dir();
+      GList *dirs = spool_generate(spool, shape, 100);
+      ...
+      spool_remove(spool, dirs);
+*/
+#ifndef LIBREPORT_BENCH_SPOOL_H
+#define LIBREPORT_BENCH_SPOOL_H
+
+#include "internal_libreport.h"
+
+struct spool_shape
+{
+    const char *ss_name;
+    unsigned ss_short_items;    ///< number of one line items
+    unsigned ss_backtrace_size;
+    unsigned ss_maps_size;
+    unsigned ss_environ_size;
+    unsigned ss_coredump_size;  ///< binary item
+};
+
+static const struct spool_shape spool_shapes[] = {
+    { "minimal",  5,         0,         0,        0,           0 },
+    { "ccpp",    20, 200 * 1024, 48 * 1024, 4 * 1024, 1024 * 1024 },
+    { "wide",   500,         0,         0,        0,           0 },
+};
+
+static inline const struct spool_shape *spool_shape_find(const char *name)
+{
+    for (unsigned i = 0; i < ARRAY_SIZE(spool_shapes); ++i)
+        if (strcmp(spool_shapes[i].ss_name, name) == 0)
+            return &spool_shapes[i];
+
+    return NULL;
+}
+
+/* @return Malloced text of lines like "prefix N: filler" of exactly size bytes */
+static inline char *spool_text(const char *prefix, unsigned size)
+{
+    struct strbuf *text = strbuf_new();
+    strbuf_reserve(text, size + 128);
+
+    for (unsigned line = 0; (unsigned)text->len < size; ++line)
+        strbuf_append_strf(text, "%s %u: 0x%08x libfoo.so.1 /usr/lib64/libfoo.so.1.2.3\n",
+                           prefix, line, line * 4096);
+
+    text->buf[size] = '\0';
+    text->len = size;
+    return strbuf_free_nobuf(text);
+}
+
+/* Creates a new directory for a spool in $BENCH_SPOOL_DIR or in /tmp, so the
+ * file system under test can be chosen */
+static inline char *spool_new_dir(void)
+{
+    const char *base = getenv("BENCH_SPOOL_DIR");
+    char *spool = concat_path_file(base ? base : "/tmp", "libreport-bench-XXXXXX");
+    if (mkdtemp(spool) == NULL)
+        perror_msg_and_die("Can't create directory '%s'", spool);
+
+    return spool;
+}
+
+static inline void spool_fill(struct dump_dir *dd, const struct spool_shape *shape, unsigned nth)
+{
+    dd_create_basic_files(dd, geteuid(), NULL);
+    dd_save_text(dd, FILENAME_TYPE, "CCpp");
+    dd_save_text(dd, FILENAME_ANALYZER, "abrt-ccpp");
+    dd_save_text(dd, FILENAME_EXECUTABLE, "/usr/bin/foo");
+    dd_save_text(dd, FILENAME_CMDLINE, "/usr/bin/foo --bar");
+    dd_save_text(dd, FILENAME_PACKAGE, "foo-1.0-1.fc99");
+    dd_save_text(dd, FILENAME_COMPONENT, "foo");
+
+    char *reason = xasprintf("foo killed by SIGSEGV in function_%u", nth);
+    dd_save_text(dd, FILENAME_REASON, reason);
+    free(reason);
+
+    for (unsigned i = 0; i < shape->ss_short_items; ++i)
+    {
+        char name[32];
+        char value[64];
+        snprintf(name, sizeof(name), "item_%u", i);
+        snprintf(value, sizeof(value), "value of item %u in problem %u", i, nth);
+        dd_save_text(dd, name, value);
+    }
+
+    const struct { const char *name; unsigned size; } texts[] = {
+        { FILENAME_BACKTRACE, shape->ss_backtrace_size },
+        { FILENAME_MAPS,      shape->ss_maps_size },
+        { FILENAME_ENVIRON,   shape->ss_environ_size },
+    };
+    for (unsigned i = 0; i < ARRAY_SIZE(texts); ++i)
+    {
+        if (texts[i].size == 0)
+            continue;
+
+        char *text = spool_text(texts[i].name, texts[i].size);
+        dd_save_text(dd, texts[i].name, text);
+        free(text);
+    }
+
+    if (shape->ss_coredump_size)
+    {
+        char *core = xmalloc(shape->ss_coredump_size);
+        for (unsigned i = 0; i < shape->ss_coredump_size; ++i)
+            core[i] = (char)(i * 31 + nth);
+        dd_save_binary(dd, FILENAME_COREDUMP, core, shape->ss_coredump_size);
+        free(core);
+    }
+}
+
+/* @return Number of items of a problem directory of the shape */
+static inline unsigned spool_shape_items(const struct spool_shape *shape)
+{
+    return shape->ss_short_items
+         + !!shape->ss_backtrace_size
+         + !!shape->ss_maps_size
+         + !!shape->ss_environ_size
+         + !!shape->ss_coredump_size;
+}
+
+/* Creates count problem directories in spool
+ *
+ * @return List of malloced paths of the directories
+ */
+static inline GList *spool_generate(const char *spool, const struct spool_shape *shape, unsigned count)
+{
+    /* dd_create() can't chown to abrt's group if we aren't root */
+    const gid_t fs_group_gid = dd_g_fs_group_gid;
+    if (geteuid() != 0 && dd_g_fs_group_gid == (gid_t)-1)
+        dd_g_fs_group_gid = getegid();
+
+    GList *dirs = NULL;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        char *name = xasprintf("%s/ccpp-2026-01-01-00:00:00.%06u-%u", spool, i, 1000 + i);
+        struct dump_dir *dd = dd_create(name, (uid_t)-1, 0640);
+        if (dd == NULL)
+            error_msg_and_die("Can't create '%s'", name);
+
+        spool_fill(dd, shape, i);
+        dd_close(dd);
+
+        dirs = g_list_prepend(dirs, name);
+    }
+
+    dd_g_fs_group_gid = fs_group_gid;
+
+    return g_list_reverse(dirs);
+}
+
+/* Deletes the remaining directories of the list, frees it and removes the
+ * spool */
+static inline void spool_remove(char *spool, GList *dirs)
+{
+    for (GList *iter = dirs; iter; iter = g_list_next(iter))
+        delete_dump_dir((const char *)iter->data);
+
+    g_list_free_full(dirs, free);
+
+    if (rmdir(spool) != 0)
+        perror_msg("Can't remove '%s'", spool);
+    free(spool);
+}
+
+#endif /* LIBREPORT_BENCH_SPOOL_H */
@@ -0,0 +1,69 @@
+/*
+    Copyright (C) 2026  ABRT team <crash-catcher@lists.fedorahosted.org>
+    Copyright (C) 2026  RedHat inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+/*
+ * Fills a directory with synthetic problem directories, e.g. to measure
+ * tools working on a spool:
+ *
+ *   spool_generator -n 1000 -s ccpp /var/tmp/spool
+ */
+#include "spool.h"
+
+int main(int argc, char **argv)
+{
+    unsigned count = 100;
+    const char *shape_name = "minimal";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                count = xatou(optarg);
+                break;
+            case 's':
+                shape_name = optarg;
+                break;
+            default:
+                goto usage;
+        }
+    }
+
+    if (optind + 1 != argc)
+        goto usage;
+
+    const struct spool_shape *shape = spool_shape_find(shape_name);
+    if (shape == NULL)
+        error_msg_and_die("Unknown shape '%s'", shape_name);
+
+    const char *spool = argv[optind];
+    if (mkdir(spool, 0755) != 0 && errno != EEXIST)
+        perror_msg_and_die("Can't create directory '%s'", spool);
+
+    GList *dirs = spool_generate(spool, shape, count);
+    for (GList *iter = dirs; iter; iter = g_list_next(iter))
+        puts((const char *)iter->data);
+    g_list_free_full(dirs, free);
+
+    return 0;
+
+ usage:
+    error_msg_and_die("Usage: %s [-n COUNT] [-s minimal|ccpp|wide] DIR", argv[0]);
+}
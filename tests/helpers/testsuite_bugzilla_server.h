@@ -0,0 +1,348 @@
+/*
+    Copyright (C) 2026  ABRT team <crash-catcher@lists.fedorahosted.org>
+    Copyright (C) 2026  RedHat inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+    ----
+
+    Local stand-in for Bugzilla XML-RPC server
+
+    Listens on a random port of the loopback and answers the XML-RPC calls
+    of reporter-bugzilla at .../xmlrpc.cgi, so that reporting can be tested
+    without network access:
+
+      Bugzilla.version    -> {version: "4.4.3"}
+      User.login          -> {id: 1, token: "1-stand-in"}
+      Bug.search          -> {bugs: []}
+      Bug.create          -> {id: 1000}
+      Bug.add_attachment  -> {ids: [1]}
+      Bug.update, Bug.add_comment, User.logout -> {}
+      system.multicall    -> [[result], ...] of the calls above
+      anything else       -> fault -32601
+
+    The data of every accepted attachment is saved decoded to
+    "received-<file_name>" in the current directory. Attachments with
+    file_name equal to 'reject_attachment' are answered by a fault.
+    If 'no_multicall' is set, system.multicall is answered by a fault as if
+    the server didn't support it.
+
+    Usage:
+      struct testsuite_bugzilla_server srv;
+      testsuite_bugzilla_server_start(&srv, false, "rejected.bin");
+      xsetenv("Bugzilla_BugzillaURL", srv.url);
+      ...
+      TS_ASSERT_SIGNED_EQ(srv.stats->attachments, 2);
+      testsuite_bugzilla_server_stop(&srv);
+*/
+#ifndef TESTSUITE_BUGZILLA_SERVER_H
+#define TESTSUITE_BUGZILLA_SERVER_H
+
+#include "testsuite_http_server.h"
+
+/* Attachment responses are delayed to let concurrent uploads overlap */
+#define TESTSUITE_BUGZILLA_SERVER_ATTACHMENT_DELAY_US (500 * 1000)
+
+/* Shared with the server processes */
+struct testsuite_bugzilla_server_stats
+{
+    long requests;              ///< all HTTP requests
+    long calls;                 ///< executed calls, batched ones included
+    long multicalls;            ///< accepted system.multicall requests
+    long rejected_multicalls;   ///< system.multicall answered by a fault
+    long attachments;           ///< accepted Bug.add_attachment calls
+    long rejected_attachments;  ///< Bug.add_attachment answered by a fault
+    long attachments_in_flight;
+    long max_attachments_in_flight; ///< the most attachments handled at once
+    long unexpected;            ///< unknown methods and paths
+};
+
+struct testsuite_bugzilla_server
+{
+    struct testsuite_http_server http;
+    char *url;                  ///< value for Bugzilla_BugzillaURL
+    bool no_multicall;
+    const char *reject_attachment;
+    struct testsuite_bugzilla_server_stats *stats;
+};
+
+#define TESTSUITE_BUGZILLA_SERVER_XML "Content-Type: text/xml\r\n"
+
+#define TESTSUITE_BUGZILLA_SERVER_EMPTY_STRUCT "<value><struct></struct></value>"
+
+/* @return the malloced text of the first string (or scalar) <value> following
+ * <name>name</name> in xml, or NULL
+ */
+static char *testsuite_bugzilla_server_member(const char *xml, const char *name)
+{
+    char *tag = xasprintf("<name>%s</name>", name);
+    const char *member = strstr(xml, tag);
+    free(tag);
+    if (member == NULL)
+        return NULL;
+
+    const char *value = strstr(member, "<value>");
+    if (value == NULL)
+        return NULL;
+    value += strlen("<value>");
+    value += strspn(value, " \t\r\n");
+
+    /* <string>, <base64>, <int>, ... */
+    if (value[0] == '<' && value[1] != '/')
+        value = strchrnul(value, '>') + 1;
+
+    return xstrndup(value, strchrnul(value, '<') - value);
+}
+
+/* Decodes base64 text, ignores white space */
+static char *testsuite_bugzilla_server_decode_base64(const char *text, size_t *len)
+{
+    static const char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    char *data = xmalloc(strlen(text) / 4 * 3 + 3);
+    unsigned bits = 0;
+    unsigned nbits = 0;
+
+    *len = 0;
+    for (; *text != '\0' && *text != '='; ++text)
+    {
+        const char *c = strchr(alphabet, *text);
+        if (c == NULL)
+            continue;
+
+        bits = (bits << 6) | (c - alphabet);
+        nbits += 6;
+        if (nbits >= 8)
+        {
+            nbits -= 8;
+            data[(*len)++] = (bits >> nbits) & 0xff;
+        }
+    }
+
+    return data;
+}
+
+static void testsuite_bugzilla_server_fault(struct strbuf *out, int code, const char *message)
+{
+    strbuf_append_strf(out,
+            "<value><struct>"
+            "<member><name>faultCode</name><value><int>%d</int></value></member>"
+            "<member><name>faultString</name><value><string>%s</string></value></member>"
+            "</struct></value>",
+            code, message);
+}
+
+static bool testsuite_bugzilla_server_attachment(struct testsuite_bugzilla_server *srv,
+        const char *call)
+{
+    struct testsuite_bugzilla_server_stats *stats = srv->stats;
+
+    const long in_flight = __sync_add_and_fetch(&stats->attachments_in_flight, 1);
+    long max = stats->max_attachments_in_flight;
+    while (in_flight > max
+           && !__sync_bool_compare_and_swap(&stats->max_attachments_in_flight, max, in_flight))
+        max = stats->max_attachments_in_flight;
+
+    usleep(TESTSUITE_BUGZILLA_SERVER_ATTACHMENT_DELAY_US);
+
+    char *file_name = testsuite_bugzilla_server_member(call, "file_name");
+    char *encoded = testsuite_bugzilla_server_member(call, "data");
+
+    bool accepted = file_name != NULL && encoded != NULL && strchr(file_name, '/') == NULL
+            && (srv->reject_attachment == NULL || strcmp(file_name, srv->reject_attachment) != 0);
+    if (accepted)
+    {
+        size_t len;
+        char *data = testsuite_bugzilla_server_decode_base64(encoded, &len);
+
+        char *path = xasprintf("received-%s", file_name);
+        int fd = xopen3(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        accepted = full_write(fd, data, len) == (ssize_t)len;
+        close(fd);
+        free(path);
+        free(data);
+    }
+
+    __sync_add_and_fetch(accepted ? &stats->attachments : &stats->rejected_attachments, 1);
+    __sync_sub_and_fetch(&stats->attachments_in_flight, 1);
+
+    free(encoded);
+    free(file_name);
+    return accepted;
+}
+
+/* Appends the <value> answering the call of method to out
+ * @return false if the value is a fault
+ */
+static bool testsuite_bugzilla_server_call(struct testsuite_bugzilla_server *srv,
+        const char *method, const char *call, struct strbuf *out)
+{
+    __sync_add_and_fetch(&srv->stats->calls, 1);
+
+    if (strcmp(method, "Bugzilla.version") == 0)
+        strbuf_append_str(out,
+            "<value><struct>"
+            "<member><name>version</name><value><string>4.4.3</string></value></member>"
+            "</struct></value>");
+    else if (strcmp(method, "User.login") == 0)
+        strbuf_append_str(out,
+            "<value><struct>"
+            "<member><name>id</name><value><int>1</int></value></member>"
+            "<member><name>token</name><value><string>1-stand-in</string></value></member>"
+            "</struct></value>");
+    else if (strcmp(method, "Bug.search") == 0)
+        strbuf_append_str(out,
+            "<value><struct>"
+            "<member><name>bugs</name><value><array><data></data></array></value></member>"
+            "</struct></value>");
+    else if (strcmp(method, "Bug.create") == 0)
+        strbuf_append_str(out,
+            "<value><struct>"
+            "<member><name>id</name><value><int>1000</int></value></member>"
+            "</struct></value>");
+    else if (strcmp(method, "Bug.add_attachment") == 0)
+    {
+        if (!testsuite_bugzilla_server_attachment(srv, call))
+        {
+            testsuite_bugzilla_server_fault(out, 600, "The attachment is rejected");
+            return false;
+        }
+
+        strbuf_append_str(out,
+            "<value><struct>"
+            "<member><name>ids</name><value><array><data>"
+            "<value><int>1</int></value>"
+            "</data></array></value></member>"
+            "</struct></value>");
+    }
+    else if (strcmp(method, "Bug.update") == 0
+             || strcmp(method, "Bug.add_comment") == 0
+             || strcmp(method, "User.logout") == 0)
+        strbuf_append_str(out, TESTSUITE_BUGZILLA_SERVER_EMPTY_STRUCT);
+    else
+    {
+        __sync_add_and_fetch(&srv->stats->unexpected, 1);
+        testsuite_bugzilla_server_fault(out, -32601, "Method not found");
+        return false;
+    }
+
+    return true;
+}
+
+/* Answers [[result] or {faultCode, faultString}, ...] */
+static void testsuite_bugzilla_server_multicall(struct testsuite_bugzilla_server *srv,
+        const char *xml, struct strbuf *out)
+{
+    __sync_add_and_fetch(&srv->stats->multicalls, 1);
+
+    static const char method_tag[] = "<name>methodName</name>";
+
+    strbuf_append_str(out, "<value><array><data>");
+    for (const char *call = strstr(xml, method_tag); call != NULL; )
+    {
+        const char *next = strstr(call + strlen(method_tag), method_tag);
+        char *text = next ? xstrndup(call, next - call) : xstrdup(call);
+
+        char *method = testsuite_bugzilla_server_member(text, "methodName");
+        struct strbuf *value = strbuf_new();
+        if (testsuite_bugzilla_server_call(srv, method, text, value))
+            strbuf_append_strf(out, "<value><array><data>%s</data></array></value>", value->buf);
+        else
+            strbuf_append_str(out, value->buf);
+
+        strbuf_free(value);
+        free(method);
+        free(text);
+        call = next;
+    }
+    strbuf_append_str(out, "</data></array></value>");
+}
+
+static void testsuite_bugzilla_server_handler(int fd, const struct testsuite_http_request *req, void *param)
+{
+    struct testsuite_bugzilla_server *srv = param;
+
+    __sync_add_and_fetch(&srv->stats->requests, 1);
+    if (!testsuite_http_request_is(req, "POST", "/xmlrpc.cgi"))
+    {
+        __sync_add_and_fetch(&srv->stats->unexpected, 1);
+        testsuite_http_respond(fd, 404, "Not Found", NULL, NULL);
+        return;
+    }
+
+    char *xml = xstrndup(req->body, req->body_len);
+    char *method = NULL;
+    const char *name = strstr(xml, "<methodName>");
+    if (name != NULL)
+    {
+        name += strlen("<methodName>");
+        method = xstrndup(name, strchrnul(name, '<') - name);
+    }
+
+    struct strbuf *value = strbuf_new();
+    bool ok;
+    if (method != NULL && strcmp(method, "system.multicall") == 0)
+    {
+        ok = !srv->no_multicall;
+        if (ok)
+            testsuite_bugzilla_server_multicall(srv, xml, value);
+        else
+        {
+            __sync_add_and_fetch(&srv->stats->rejected_multicalls, 1);
+            testsuite_bugzilla_server_fault(value, -32601, "Method not found");
+        }
+    }
+    else
+        ok = testsuite_bugzilla_server_call(srv, method ? method : "", xml, value);
+
+    char *response = xasprintf(
+            "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\r\n"
+            "<methodResponse>%s%s%s</methodResponse>\r\n",
+            ok ? "<params><param>" : "<fault>",
+            value->buf,
+            ok ? "</param></params>" : "</fault>");
+    testsuite_http_respond(fd, 200, "OK", TESTSUITE_BUGZILLA_SERVER_XML, response);
+
+    free(response);
+    strbuf_free(value);
+    free(method);
+    free(xml);
+}
+
+static void testsuite_bugzilla_server_start(struct testsuite_bugzilla_server *srv,
+        bool no_multicall, const char *reject_attachment)
+{
+    memset(srv, 0, sizeof(*srv));
+    srv->no_multicall = no_multicall;
+    srv->reject_attachment = reject_attachment;
+    srv->stats = mmap(NULL, sizeof(*srv->stats), PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    assert(srv->stats != MAP_FAILED);
+    memset(srv->stats, 0, sizeof(*srv->stats));
+
+    testsuite_http_server_start(&srv->http, "/bugzilla", testsuite_bugzilla_server_handler, srv);
+    srv->url = srv->http.url;
+}
+
+static void testsuite_bugzilla_server_stop(struct testsuite_bugzilla_server *srv)
+{
+    testsuite_http_server_stop(&srv->http);
+
+    munmap(srv->stats, sizeof(*srv->stats));
+    memset(srv, 0, sizeof(*srv));
+}
+
+#endif /* TESTSUITE_BUGZILLA_SERVER_H */
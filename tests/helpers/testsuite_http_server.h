@@ -0,0 +1,291 @@
+/*
+    Copyright (C) 2026  ABRT team <crash-catcher@lists.fedorahosted.org>
+    Copyright (C) 2026  RedHat inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+    ----
+
+    Local stand-in for HTTP servers
+
+    Listens on a random port of the loopback, reads keep-alive and pipelined
+    requests with Content-Length or chunked bodies and passes them to
+    a handler, which answers them. Every connection is served by its own process, so the
+    handler keeps state shared among requests in memory mapped by
+    MAP_SHARED.
+
+    Usage:
+      static void handler(int fd, const struct testsuite_http_request *req, void *param)
+      {
+          if (testsuite_http_request_is(req, "GET", "/index.html"))
+              testsuite_http_respond(fd, 200, "OK", NULL, "hello");
+          else
+              testsuite_http_respond(fd, 404, "Not Found", NULL, NULL);
+      }
+
+      struct testsuite_http_server srv;
+      testsuite_http_server_start(&srv, "/index.html", handler, NULL);
+      ... srv.url ...
+      testsuite_http_server_stop(&srv);
+*/
+#ifndef TESTSUITE_HTTP_SERVER_H
+#define TESTSUITE_HTTP_SERVER_H
+
+#include "testsuite.h"
+
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+struct testsuite_http_request
+{
+    const char *head;           ///< the request line followed by headers
+    const char *headers_end;    ///< the empty line ending the headers
+    const char *body;
+    size_t body_len;
+};
+
+/* Called in the connection process, must write one response to fd */
+typedef void (*testsuite_http_handler_t)(int fd, const struct testsuite_http_request *req, void *param);
+
+struct testsuite_http_server
+{
+    pid_t pid;
+    int port;
+    char *url;                  ///< http://127.0.0.1:<port><path>
+};
+
+/* @return true if the request line is "<method> <...path_suffix> HTTP/1.x" */
+static bool testsuite_http_request_is(const struct testsuite_http_request *req,
+        const char *method, const char *path_suffix)
+{
+    const char *line_end = strchrnul(req->head, '\r');
+    const size_t method_len = strlen(method);
+    if (strncmp(req->head, method, method_len) != 0 || req->head[method_len] != ' ')
+        return false;
+
+    const char *path_end = memchr(req->head + method_len + 1, ' ', line_end - req->head - method_len - 1);
+    const size_t suffix_len = strlen(path_suffix);
+    return path_end != NULL
+        && (size_t)(path_end - req->head) >= method_len + 1 + suffix_len
+        && strncmp(path_end - suffix_len, path_suffix, suffix_len) == 0;
+}
+
+/* @return the value of the header name (e.g. "Content-Range"), NULL if
+ * the request doesn't have it */
+static const char *testsuite_http_header(const struct testsuite_http_request *req, const char *name)
+{
+    char *needle = xasprintf("\r\n%s:", name);
+    const char *h = strcasestr(req->head, needle);
+    const char *value = NULL;
+    if (h != NULL && h < req->headers_end)
+        value = skip_whitespace(h + strlen(needle));
+    free(needle);
+    return value;
+}
+
+/* headers are complete lines "Name: value\r\n", both can be NULL */
+static void testsuite_http_respond(int fd, int code, const char *reason,
+        const char *headers, const char *body)
+{
+    char *response = xasprintf("HTTP/1.1 %d %s\r\n"
+                               "%s"
+                               "Content-Length: %zu\r\n"
+                               "\r\n"
+                               "%s",
+                               code, reason,
+                               headers ? headers : "",
+                               body ? strlen(body) : 0,
+                               body ? body : "");
+    full_write(fd, response, strlen(response));
+    free(response);
+}
+
+/* Reads from fd until buf holds at least min_len bytes, may read more */
+static bool testsuite_http_server_read(int fd, char **buf, size_t *len, size_t min_len)
+{
+    while (*buf == NULL || *len < min_len)
+    {
+        *buf = xrealloc(*buf, *len + 64 * 1024 + 1);
+        ssize_t r = safe_read(fd, *buf + *len, 64 * 1024);
+        if (r <= 0)
+            return false;
+        *len += r;
+        (*buf)[*len] = '\0';
+    }
+    return true;
+}
+
+/* Decodes the chunked body starting at offset pos of buf.
+ * @return the length of the encoded body, 0 if the connection was closed
+ */
+static size_t testsuite_http_server_read_chunked(int fd, char **buf, size_t *len, size_t pos,
+        char **body, size_t *body_len)
+{
+    const size_t start = pos;
+    for (;;)
+    {
+        char *line_end;
+        while ((line_end = memmem(*buf + pos, *len - pos, "\r\n", 2)) == NULL)
+        {
+            if (!testsuite_http_server_read(fd, buf, len, *len + 1))
+                return 0;
+        }
+
+        const size_t chunk_size = strtoul(*buf + pos, NULL, 16);
+        const size_t data = line_end + 2 - *buf;
+        /* The chunk is followed by CRLF, the last (empty) one has no trailers */
+        if (!testsuite_http_server_read(fd, buf, len, data + chunk_size + 2))
+            return 0;
+
+        if (chunk_size == 0)
+            return data + 2 - start;
+
+        *body = xrealloc(*body, *body_len + chunk_size + 1);
+        memcpy(*body + *body_len, *buf + data, chunk_size);
+        *body_len += chunk_size;
+        (*body)[*body_len] = '\0';
+        pos = data + chunk_size + 2;
+    }
+}
+
+/* Serves one keep-alive connection */
+static void testsuite_http_server_connection(int fd, testsuite_http_handler_t handler, void *param)
+{
+    char *buf = NULL;
+    size_t len = 0;
+    for (;;)
+    {
+        char *headers_end;
+        while (buf == NULL || (headers_end = memmem(buf, len, "\r\n\r\n", 4)) == NULL)
+        {
+            if (!testsuite_http_server_read(fd, &buf, &len, len + 1))
+                goto done;
+        }
+
+        struct testsuite_http_request req = { .head = buf, .headers_end = headers_end };
+        const size_t body_offset = headers_end + 4 - buf;
+
+        const char *te = testsuite_http_header(&req, "Transfer-Encoding");
+        const bool chunked = te != NULL && prefixcmp(te, "chunked") == 0;
+
+        const char *cl = testsuite_http_header(&req, "Content-Length");
+        if (cl != NULL && !chunked)
+            req.body_len = strtoul(cl, NULL, 10);
+
+        /* curl waits for "100 Continue" before it sends bigger bodies */
+        const char *expect = testsuite_http_header(&req, "Expect");
+        if (expect != NULL && prefixcmp(expect, "100-continue") == 0)
+            full_write(fd, "HTTP/1.1 100 Continue\r\n\r\n", strlen("HTTP/1.1 100 Continue\r\n\r\n"));
+
+        /* A chunked body is passed to the handler decoded */
+        char *decoded = NULL;
+        size_t request_len;
+        if (chunked)
+        {
+            const size_t encoded_len = testsuite_http_server_read_chunked(fd, &buf, &len,
+                    body_offset, &decoded, &req.body_len);
+            if (encoded_len == 0)
+            {
+                free(decoded);
+                goto done;
+            }
+            request_len = body_offset + encoded_len;
+        }
+        else
+        {
+            request_len = body_offset + req.body_len;
+            if (!testsuite_http_server_read(fd, &buf, &len, request_len))
+                goto done;
+        }
+
+        /* buf may have moved */
+        req.head = buf;
+        req.headers_end = buf + body_offset - 4;
+        req.body = decoded ? decoded : buf + body_offset;
+
+        handler(fd, &req, param);
+        free(decoded);
+
+        /* Keep the pipelined rest of the buffer */
+        memmove(buf, buf + request_len, len - request_len);
+        len -= request_len;
+        buf[len] = '\0';
+    }
+
+ done:
+    free(buf);
+    close(fd);
+}
+
+static void testsuite_http_server_start(struct testsuite_http_server *srv, const char *path,
+        testsuite_http_handler_t handler, void *param)
+{
+    memset(srv, 0, sizeof(*srv));
+
+    int sock = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    assert(sock >= 0);
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        .sin_port = 0,
+    };
+    assert(bind(sock, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    assert(listen(sock, 64) == 0);
+
+    socklen_t addr_len = sizeof(addr);
+    assert(getsockname(sock, (struct sockaddr *)&addr, &addr_len) == 0);
+    srv->port = ntohs(addr.sin_port);
+    srv->url = xasprintf("http://127.0.0.1:%d%s", srv->port, path);
+
+    fflush(NULL);
+    srv->pid = fork();
+    assert(srv->pid >= 0);
+    if (srv->pid == 0)
+    {
+        /* One process per connection, clients keep connections open */
+        signal(SIGCHLD, SIG_IGN);
+        for (;;)
+        {
+            int fd = accept(sock, NULL, NULL);
+            if (fd < 0)
+                continue;
+
+            if (fork() == 0)
+            {
+                close(sock);
+                testsuite_http_server_connection(fd, handler, param);
+                _exit(0);
+            }
+            close(fd);
+        }
+    }
+
+    close(sock);
+    TS_DEBUG_PRINTF("HTTP stand-in server listens at %s\n", srv->url);
+}
+
+static void testsuite_http_server_stop(struct testsuite_http_server *srv)
+{
+    /* Connection processes die with the closed connections */
+    kill(srv->pid, SIGTERM);
+    safe_waitpid(srv->pid, NULL, 0);
+
+    free(srv->url);
+    memset(srv, 0, sizeof(*srv));
+}
+
+#endif /* TESTSUITE_HTTP_SERVER_H */
@@ -0,0 +1,157 @@
+/*
+    Copyright (C) 2026  ABRT team <crash-catcher@lists.fedorahosted.org>
+    Copyright (C) 2026  RedHat inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+    ----
+
+    Local stand-in for HTTP upload targets
+
+    Listens on a random port of the loopback and stores the bodies of PUT
+    requests in the file 'path'. Requests with "Digest: SHA=..." are
+    refused by 400 if the digest doesn't match the body.
+
+    If 'accept_ranges' is set, responses carry "Accept-Ranges: bytes" and
+    requests with "Content-Range: bytes A-B/N" are stored at offset A.
+    Otherwise the server ignores Content-Range like many plain HTTP servers
+    do and every body replaces the whole file.
+
+      PUT with a valid body -> 201
+      anything else         -> 400
+
+    The first 'fail_first' requests are answered by 503, the requests after
+    'accept_max' successful ones too. 'stats->accept_max' can be changed
+    while the server runs.
+
+    Usage:
+      struct testsuite_upload_server srv = { .accept_max = -1, .accept_ranges = true };
+      testsuite_upload_server_start(&srv, "uploaded");
+      upload_file_chunked(state, srv.url, ...);
+      TS_ASSERT_SIGNED_EQ(srv.stats->stored, 4);
+      testsuite_upload_server_stop(&srv);
+*/
+#ifndef TESTSUITE_UPLOAD_SERVER_H
+#define TESTSUITE_UPLOAD_SERVER_H
+
+#include "testsuite_http_server.h"
+
+/* Shared with the server processes */
+struct testsuite_upload_server_stats
+{
+    long requests;      ///< all requests
+    long failed;        ///< answered by 503
+    long stored;        ///< accepted bodies
+    long bad_digest;    ///< refused because of Digest
+    long accept_max;    ///< initialized from the server, can be changed on the fly
+};
+
+struct testsuite_upload_server
+{
+    /* Supplied by caller: */
+    long fail_first;
+    long accept_max;    ///< negative for no limit
+    bool accept_ranges;
+
+    struct testsuite_http_server http;
+    char *url;          ///< URL of the uploaded file
+    const char *path;
+    struct testsuite_upload_server_stats *stats;
+};
+
+static bool testsuite_upload_server_digest_ok(const char *digest, const char *body, size_t len)
+{
+    if (digest == NULL)
+        return true;
+
+    if (prefixcmp(digest, "SHA=") != 0)
+        return false;
+
+    sha1_ctx_t ctx;
+    sha1_begin(&ctx);
+    sha1_hash(&ctx, body, len);
+    uint8_t sha1[SHA1_RESULT_LEN];
+    sha1_end(&ctx, sha1);
+
+    char *expected = encode_base64(sha1, SHA1_RESULT_LEN);
+    const bool ok = strncmp(digest + strlen("SHA="), expected, strlen(expected)) == 0;
+    free(expected);
+    return ok;
+}
+
+static void testsuite_upload_server_handler(int fd, const struct testsuite_http_request *req, void *param)
+{
+    struct testsuite_upload_server *srv = param;
+    const char *headers = srv->accept_ranges ? "Accept-Ranges: bytes\r\n" : NULL;
+
+    const long nth = __sync_add_and_fetch(&srv->stats->requests, 1);
+
+    unsigned long long first = 0, last, total;
+    const char *range = srv->accept_ranges ? testsuite_http_header(req, "Content-Range") : NULL;
+    const char *digest = testsuite_http_header(req, "Digest");
+
+    if (nth <= srv->fail_first
+        || (srv->stats->accept_max >= 0 && srv->stats->stored >= srv->stats->accept_max))
+    {
+        __sync_add_and_fetch(&srv->stats->failed, 1);
+        testsuite_http_respond(fd, 503, "Service Unavailable", headers, NULL);
+    }
+    else if (prefixcmp(req->head, "PUT ") != 0
+        || (range && (sscanf(range, "bytes %llu-%llu/%llu", &first, &last, &total) != 3
+                      || last - first + 1 != req->body_len)))
+    {
+        testsuite_http_respond(fd, 400, "Bad Request", headers, NULL);
+    }
+    else if (!testsuite_upload_server_digest_ok(digest, req->body, req->body_len))
+    {
+        __sync_add_and_fetch(&srv->stats->bad_digest, 1);
+        testsuite_http_respond(fd, 400, "Bad Request", headers, NULL);
+    }
+    else
+    {
+        int out = xopen3(srv->path, O_WRONLY | O_CREAT | (range ? 0 : O_TRUNC), 0600);
+        if (pwrite(out, req->body, req->body_len, first) != (ssize_t)req->body_len)
+            perror_msg_and_die("pwrite");
+        close(out);
+
+        __sync_add_and_fetch(&srv->stats->stored, 1);
+        testsuite_http_respond(fd, 201, "Created", headers, NULL);
+    }
+}
+
+static void testsuite_upload_server_start(struct testsuite_upload_server *srv, const char *path)
+{
+    srv->path = path;
+    srv->stats = mmap(NULL, sizeof(*srv->stats), PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    assert(srv->stats != MAP_FAILED);
+    memset(srv->stats, 0, sizeof(*srv->stats));
+    srv->stats->accept_max = srv->accept_max;
+
+    unlink(path);
+
+    testsuite_http_server_start(&srv->http, "/upload/problem.tar.gz", testsuite_upload_server_handler, srv);
+    srv->url = srv->http.url;
+}
+
+static void testsuite_upload_server_stop(struct testsuite_upload_server *srv)
+{
+    testsuite_http_server_stop(&srv->http);
+
+    munmap(srv->stats, sizeof(*srv->stats));
+    srv->url = NULL;
+}
+
+#endif /* TESTSUITE_UPLOAD_SERVER_H */
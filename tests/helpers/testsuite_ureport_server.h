@@ -0,0 +1,114 @@
+/*
+    Copyright (C) 2026  ABRT team <crash-catcher@lists.fedorahosted.org>
+    Copyright (C) 2026  RedHat inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+    ----
+
+    Local stand-in for uReport server
+
+    Listens on a random port of the loopback and answers the uReport
+    endpoints, so that reporting, retries and throughput can be tested
+    without network access:
+
+      POST .../reports/new/     -> 202 {"result": false, "bthash": ...}
+      POST .../reports/attach/  -> 202 {"result": true}
+      anything else             -> 404
+
+    The first 'fail_first' requests are answered by 503 to simulate an
+    unreachable server.
+
+    Usage:
+      struct testsuite_ureport_server srv;
+      testsuite_ureport_server_start(&srv, 2);
+      ureport_server_config_set_url(&config, xstrdup(srv.url));
+      ...
+      TS_ASSERT_SIGNED_EQ(srv.stats->requests, 3);
+      testsuite_ureport_server_stop(&srv);
+*/
+#ifndef TESTSUITE_UREPORT_SERVER_H
+#define TESTSUITE_UREPORT_SERVER_H
+
+#include "testsuite_http_server.h"
+
+#define TESTSUITE_UREPORT_SERVER_BTHASH "0123456789abcdef0123456789abcdef01234567"
+
+/* Shared with the server processes */
+struct testsuite_ureport_server_stats
+{
+    long requests;      ///< all requests
+    long failed;        ///< answered by 503
+    long submitted;     ///< accepted uReports
+    long attached;      ///< accepted attachments
+};
+
+struct testsuite_ureport_server
+{
+    struct testsuite_http_server http;
+    char *url;          ///< base URL for ureport_server_config_set_url()
+    long fail_first;
+    struct testsuite_ureport_server_stats *stats;
+};
+
+#define TESTSUITE_UREPORT_SERVER_JSON "Content-Type: application/json\r\n"
+
+static void testsuite_ureport_server_handler(int fd, const struct testsuite_http_request *req, void *param)
+{
+    struct testsuite_ureport_server *srv = param;
+
+    const long nth = __sync_add_and_fetch(&srv->stats->requests, 1);
+    if (nth <= srv->fail_first)
+    {
+        __sync_add_and_fetch(&srv->stats->failed, 1);
+        testsuite_http_respond(fd, 503, "Service Unavailable", TESTSUITE_UREPORT_SERVER_JSON, NULL);
+    }
+    else if (testsuite_http_request_is(req, "POST", "/reports/new/"))
+    {
+        __sync_add_and_fetch(&srv->stats->submitted, 1);
+        testsuite_http_respond(fd, 202, "Accepted", TESTSUITE_UREPORT_SERVER_JSON,
+                "{\"result\": false, \"bthash\": \""TESTSUITE_UREPORT_SERVER_BTHASH"\"}");
+    }
+    else if (testsuite_http_request_is(req, "POST", "/reports/attach/"))
+    {
+        __sync_add_and_fetch(&srv->stats->attached, 1);
+        testsuite_http_respond(fd, 202, "Accepted", TESTSUITE_UREPORT_SERVER_JSON, "{\"result\": true}");
+    }
+    else
+        testsuite_http_respond(fd, 404, "Not Found", TESTSUITE_UREPORT_SERVER_JSON, "{\"error\": \"not found\"}");
+}
+
+static void testsuite_ureport_server_start(struct testsuite_ureport_server *srv, long fail_first)
+{
+    memset(srv, 0, sizeof(*srv));
+    srv->fail_first = fail_first;
+    srv->stats = mmap(NULL, sizeof(*srv->stats), PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    assert(srv->stats != MAP_FAILED);
+    memset(srv->stats, 0, sizeof(*srv->stats));
+
+    testsuite_http_server_start(&srv->http, "/faf", testsuite_ureport_server_handler, srv);
+    srv->url = srv->http.url;
+}
+
+static void testsuite_ureport_server_stop(struct testsuite_ureport_server *srv)
+{
+    testsuite_http_server_stop(&srv->http);
+
+    munmap(srv->stats, sizeof(*srv->stats));
+    memset(srv, 0, sizeof(*srv));
+}
+
+#endif /* TESTSUITE_UREPORT_SERVER_H */